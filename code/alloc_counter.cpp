@@ -0,0 +1,286 @@
+/**
+ * @file alloc_counter.cpp
+ * @brief Implements counting replacements of the global allocation functions.
+ */
+
+#include "alloc_counter.h"
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+/**
+ * @brief Prefix of every block: its size and the component it is charged to.
+ *
+ * Sixteen bytes keep the block behind it aligned like malloc's.
+ */
+struct BlockHeader {
+    uint64_t size;
+    uint64_t component;
+};
+
+static_assert(sizeof(BlockHeader) == 16, "the block header must preserve malloc's alignment");
+
+/**
+ * @brief Counters of one component, on their own cache line.
+ */
+struct alignas(64) ComponentCounters {
+    std::atomic<long long> live{0};
+    std::atomic<long long> peak{0};
+    std::atomic<long long> allocations{0};
+    std::atomic<long long> frees{0};
+};
+
+/**
+ * @brief Console names, in MemoryComponent order.
+ */
+const char* const COMPONENT_NAMES[MEMORY_COMPONENTS] = {"other", "queues", "servers", "firewall", "requests"};
+
+/**
+ * @brief Number of allocations performed.
+ */
+std::atomic<size_t> allocations(0);
+
+/**
+ * @brief Number of bytes requested.
+ */
+std::atomic<size_t> bytes(0);
+
+/**
+ * @brief Per-component counters.
+ */
+ComponentCounters components[MEMORY_COMPONENTS];
+
+/**
+ * @brief Live bytes of the whole process and their peak.
+ */
+std::atomic<long long> total_live(0);
+std::atomic<long long> total_peak(0);
+
+/**
+ * @brief Component the calling thread's allocations are charged to.
+ */
+thread_local MemoryComponent active = MemoryComponent::OTHER;
+
+/**
+ * @brief Set by SIGUSR1, cleared by memory_report_requested().
+ */
+volatile std::sig_atomic_t report_pending = 0;
+
+/**
+ * @brief Raises a peak to at least value.
+ */
+void raise_peak(std::atomic<long long>& peak, long long value) {
+    long long seen = peak.load(std::memory_order_relaxed);
+    while (value > seen && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief Charges size bytes to a component and raises the peaks.
+ */
+void charge(size_t component, long long size) {
+    ComponentCounters& counters = components[component];
+    long long live = counters.live.fetch_add(size, std::memory_order_relaxed) + size;
+    counters.allocations.fetch_add(1, std::memory_order_relaxed);
+    raise_peak(counters.peak, live);
+    raise_peak(total_peak, total_live.fetch_add(size, std::memory_order_relaxed) + size);
+}
+
+/**
+ * @brief Credits size bytes back to a component.
+ */
+void credit(size_t component, long long size) {
+    ComponentCounters& counters = components[component];
+    counters.live.fetch_sub(size, std::memory_order_relaxed);
+    counters.frees.fetch_add(1, std::memory_order_relaxed);
+    total_live.fetch_sub(size, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Counts and performs one allocation.
+ */
+void* counted_alloc(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+    BlockHeader* header = static_cast<BlockHeader*>(std::malloc(sizeof(BlockHeader) + size));
+    if (!header) {
+        throw std::bad_alloc();
+    }
+    header->size = size;
+    header->component = static_cast<uint64_t>(active);
+    charge(header->component, static_cast<long long>(size));
+    return header + 1;
+}
+
+/**
+ * @brief Credits a block to its component and frees it.
+ */
+void counted_free(void* pointer) {
+    if (!pointer) {
+        return;
+    }
+    BlockHeader* header = static_cast<BlockHeader*>(pointer) - 1;
+    credit(header->component, static_cast<long long>(header->size));
+    std::free(header);
+}
+
+/**
+ * @brief Marks a report as requested.
+ */
+void handle_report_signal(int) {
+    report_pending = 1;
+}
+
+} // namespace
+
+/**
+ * @brief Returns the number of heap allocations made so far.
+ *
+ * @return Count of calls to any global operator new.
+ */
+size_t allocation_count() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the number of bytes requested from the heap so far.
+ *
+ * @return Sum of the sizes passed to global operator new.
+ */
+size_t allocated_bytes() {
+    return bytes.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns a component's heap usage.
+ *
+ * @param component Component.
+ * @return Usage since the program started.
+ */
+MemoryUsage memory_usage(MemoryComponent component) {
+    const ComponentCounters& counters = components[static_cast<size_t>(component)];
+    MemoryUsage usage;
+    usage.live_bytes = counters.live.load(std::memory_order_relaxed);
+    usage.peak_bytes = counters.peak.load(std::memory_order_relaxed);
+    usage.allocations = counters.allocations.load(std::memory_order_relaxed);
+    usage.frees = counters.frees.load(std::memory_order_relaxed);
+    return usage;
+}
+
+/**
+ * @brief Returns the heap usage of the whole process.
+ *
+ * @return Usage summed over the components; the peak is that of the sum.
+ */
+MemoryUsage memory_total() {
+    MemoryUsage total;
+    for (size_t component = 0; component < MEMORY_COMPONENTS; ++component) {
+        MemoryUsage usage = memory_usage(static_cast<MemoryComponent>(component));
+        total.allocations += usage.allocations;
+        total.frees += usage.frees;
+    }
+    total.live_bytes = total_live.load(std::memory_order_relaxed);
+    total.peak_bytes = total_peak.load(std::memory_order_relaxed);
+    return total;
+}
+
+/**
+ * @brief Returns the console name of a component.
+ *
+ * @param component Component.
+ * @return Lower-case name.
+ */
+const char* memory_component_name(MemoryComponent component) {
+    return COMPONENT_NAMES[static_cast<size_t>(component)];
+}
+
+/**
+ * @brief Makes a component active on the calling thread.
+ *
+ * @param component Component later allocations are charged to.
+ * @return Component that was active before.
+ */
+MemoryComponent memory_enter(MemoryComponent component) {
+    MemoryComponent previous = active;
+    active = component;
+    return previous;
+}
+
+/**
+ * @brief Returns the component active on the calling thread.
+ */
+MemoryComponent memory_active() {
+    return active;
+}
+
+/**
+ * @brief Charges memory obtained outside operator new (such as mmap) to a component.
+ *
+ * Mapped bytes count toward the component's live and peak bytes but not
+ * toward allocation_count(), which only covers operator new.
+ *
+ * @param component Component the bytes are charged to.
+ * @param bytes Bytes mapped (positive, counted as an allocation) or unmapped
+ *        (negative, counted as a free).
+ */
+void memory_record(MemoryComponent component, long long bytes) {
+    if (bytes > 0) {
+        charge(static_cast<size_t>(component), bytes);
+    } else if (bytes < 0) {
+        credit(static_cast<size_t>(component), -bytes);
+    }
+}
+
+/**
+ * @brief Writes the per-component table of live and peak bytes and allocation counts.
+ *
+ * Counters are process-wide: with several simulations on their own threads
+ * (sweeps, topologies) a component's row covers all of them.
+ *
+ * @param out Stream receiving the table.
+ */
+void memory_report(std::ostream& out) {
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-12s %14s %14s %13s %13s", "component", "live bytes", "peak bytes", "allocations",
+                  "frees");
+    out << "Heap memory by component:" << std::endl << line << std::endl;
+    for (size_t component = 0; component <= MEMORY_COMPONENTS; ++component) {
+        bool total = component == MEMORY_COMPONENTS;
+        MemoryUsage usage = total ? memory_total() : memory_usage(static_cast<MemoryComponent>(component));
+        std::snprintf(line, sizeof(line), "%-12s %14lld %14lld %13lld %13lld",
+                      total ? "total" : COMPONENT_NAMES[component], usage.live_bytes, usage.peak_bytes,
+                      usage.allocations, usage.frees);
+        out << line << std::endl;
+    }
+}
+
+/**
+ * @brief Installs a SIGUSR1 handler that asks for a report.
+ */
+void memory_report_on_signal() {
+    std::signal(SIGUSR1, handle_report_signal);
+}
+
+/**
+ * @brief Checks and clears a pending SIGUSR1 report request.
+ *
+ * @return true once per signal received.
+ */
+bool memory_report_requested() {
+    if (report_pending == 0) {
+        return false;
+    }
+    report_pending = 0;
+    return true;
+}
+
+void* operator new(size_t size) { return counted_alloc(size); }
+void* operator new[](size_t size) { return counted_alloc(size); }
+void operator delete(void* pointer) noexcept { counted_free(pointer); }
+void operator delete[](void* pointer) noexcept { counted_free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { counted_free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { counted_free(pointer); }
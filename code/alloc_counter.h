@@ -0,0 +1,171 @@
+/**
+ * @file alloc_counter.h
+ * @brief Declares the heap allocation counters, process-wide and per component.
+ *
+ * Linking alloc_counter.cpp into a program replaces the global operator new
+ * and operator delete with versions that count every heap allocation, so a
+ * benchmark can verify how many allocations a code path performs.
+ *
+ * Every allocation is also charged to the component active on the calling
+ * thread. MEMORY_SCOPE(component) makes a component active for the rest of
+ * the enclosing block; the load balancer queues, server handlers, firewall
+ * and request arena open one in each of their methods that can allocate. A
+ * small header in front of each block remembers its size and component, so
+ * a block freed elsewhere is still credited to the component that allocated
+ * it. Large buffers mapped by large_alloc.cpp are charged with
+ * memory_record(). Building with -DNO_MEMORY_TAGS (make MEMORY_TAGS=0) removes the scopes
+ * and charges everything to OTHER.
+ */
+
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * @brief Components heap memory is charged to.
+ */
+enum class MemoryComponent : uint8_t {
+    OTHER,     ///< Everything outside a component scope (logs, options, results, ...).
+    QUEUES,    ///< LoadBalancer queues, tails and spill buffers.
+    SERVERS,   ///< ServerHandler: servers, the server table, retries, hedges and batches.
+    FIREWALL,  ///< Firewall rules.
+    REQUESTS,  ///< RequestArena chunks, generations and free list.
+    COUNT      ///< Number of components.
+};
+
+/**
+ * @brief Number of components.
+ */
+constexpr size_t MEMORY_COMPONENTS = static_cast<size_t>(MemoryComponent::COUNT);
+
+/**
+ * @brief Heap usage of one component (or of the whole process).
+ */
+struct MemoryUsage {
+    long long live_bytes = 0;   ///< Bytes allocated and not freed yet.
+    long long peak_bytes = 0;   ///< Largest live_bytes so far.
+    long long allocations = 0;  ///< Allocations so far.
+    long long frees = 0;        ///< Frees so far.
+};
+
+/**
+ * @brief Returns the number of heap allocations made so far.
+ *
+ * @return Count of calls to any global operator new.
+ */
+size_t allocation_count();
+
+/**
+ * @brief Returns the number of bytes requested from the heap so far.
+ *
+ * @return Sum of the sizes passed to global operator new.
+ */
+size_t allocated_bytes();
+
+/**
+ * @brief Returns a component's heap usage.
+ *
+ * @param component Component.
+ * @return Usage since the program started.
+ */
+MemoryUsage memory_usage(MemoryComponent component);
+
+/**
+ * @brief Returns the heap usage of the whole process.
+ *
+ * @return Usage summed over the components; the peak is that of the sum.
+ */
+MemoryUsage memory_total();
+
+/**
+ * @brief Returns the console name of a component.
+ *
+ * @param component Component.
+ * @return Lower-case name.
+ */
+const char* memory_component_name(MemoryComponent component);
+
+/**
+ * @brief Makes a component active on the calling thread.
+ *
+ * @param component Component later allocations are charged to.
+ * @return Component that was active before.
+ */
+MemoryComponent memory_enter(MemoryComponent component);
+
+/**
+ * @brief Returns the component active on the calling thread.
+ */
+MemoryComponent memory_active();
+
+/**
+ * @brief Charges memory obtained outside operator new (such as mmap) to a component.
+ *
+ * @param component Component the bytes are charged to.
+ * @param bytes Bytes mapped (positive, counted as an allocation) or unmapped
+ *        (negative, counted as a free).
+ */
+void memory_record(MemoryComponent component, long long bytes);
+
+/**
+ * @brief Writes the per-component table of live and peak bytes and allocation counts.
+ *
+ * @param out Stream receiving the table.
+ */
+void memory_report(std::ostream& out);
+
+/**
+ * @brief Installs a SIGUSR1 handler that asks for a report.
+ */
+void memory_report_on_signal();
+
+/**
+ * @brief Checks and clears a pending SIGUSR1 report request.
+ *
+ * @return true once per signal received.
+ */
+bool memory_report_requested();
+
+/**
+ * @class MemoryScope
+ * @brief Makes a component active for its own lifetime.
+ */
+class MemoryScope {
+public:
+
+    /**
+     * @brief Makes a component active.
+     *
+     * @param component Component allocations are charged to.
+     */
+    explicit MemoryScope(MemoryComponent component) : previous(memory_enter(component)) {}
+
+    /**
+     * @brief Restores the component that was active before.
+     */
+    ~MemoryScope() { memory_enter(previous); }
+
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+
+private:
+    MemoryComponent previous;
+};
+
+#define MEMORY_CONCAT_INNER(a, b) a##b
+#define MEMORY_CONCAT(a, b) MEMORY_CONCAT_INNER(a, b)
+
+#ifdef NO_MEMORY_TAGS
+#define MEMORY_SCOPE(component) ((void)0)
+#else
+
+/**
+ * @brief Charges the rest of the enclosing block's allocations to a MemoryComponent.
+ */
+#define MEMORY_SCOPE(component) MemoryScope MEMORY_CONCAT(memory_scope_, __LINE__)(component)
+#endif
+
+#endif
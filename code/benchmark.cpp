@@ -0,0 +1,352 @@
+/**
+ * @file benchmark.cpp
+ * @brief Micro-benchmarks for the request hot path.
+ *
+ * Each benchmark drives the balancer components without console output and
+ * reports time and heap allocations per request (see alloc_counter.h).
+ *
+ * Options: --bench=NAME (default: all), --ticks=N (measured clock cycles,
+ * default 20000), --servers=N (per pool, default 64), --depth=N (requests in
+ * the deep-queue benchmarks, default 1048576), --budget=N (in-memory requests
+ * of deep-queue-spill, default 65536), --spill-dir=DIR (default /tmp),
+ * --sources=N (distinct addresses of heavy-hitters, default 1048576),
+ * --table-servers=N and --table-ticks=N (server table of huge-pages, default
+ * 1048576 servers for 100 cycles), --huge-pages=off|transparent|explicit
+ * (backing of the large buffers in the other benchmarks, default transparent).
+ */
+
+#include "alloc_counter.h"
+#include "config.h"
+#include "firewall.h"
+#include "heavy_hitters.h"
+#include "large_alloc.h"
+#include "load_balancer.h"
+#include "request_arena.h"
+#include "server_handler.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Result of one benchmark run.
+ */
+struct BenchResult {
+    long long requests = 0;   ///< Requests pushed through the measured section.
+    size_t allocations = 0;   ///< Heap allocations in the measured section.
+    double seconds = 0.0;     ///< Wall time of the measured section.
+};
+
+/**
+ * @brief Prints one result line.
+ */
+void report(const std::string& name, const BenchResult& result) {
+    double per_request = result.requests > 0 ? static_cast<double>(result.allocations) / result.requests : 0.0;
+    std::cout << name << ": " << result.requests << " requests, "
+              << (result.requests > 0 ? result.seconds * 1e9 / result.requests : 0.0) << " ns/request, "
+              << result.allocations << " allocations (" << per_request << " per request)" << std::endl;
+}
+
+/**
+ * @brief Arena + handle path: generate, filter, queue, dispatch, tick.
+ *
+ * The first quarter of the ticks warms the arena, queues and scratch buffers
+ * up to their steady-state size and is not measured.
+ */
+BenchResult bench_arena(int ticks, int servers) {
+    std::mt19937 rng(42);
+    RequestArena arena;
+    Firewall firewall;
+    firewall.blockRange("10.0.0.0", "10.255.255.255");
+    LoadBalancer balancers[2];
+    ServerHandler streaming(arena), processing(arena);
+    ServerHandler* handlers[2] = {&streaming, &processing};
+    for (ServerHandler* handler : handlers) {
+        handler->set_verbose(false);
+        for (int i = 0; i < servers; ++i) {
+            handler->add_server();
+        }
+    }
+    std::vector<RequestHandle> burst;
+    std::vector<uint32_t> ips;
+    std::vector<uint8_t> verdicts;
+
+    BenchResult result;
+    int warmup = ticks / 4;
+    size_t allocations_before = 0;
+    auto started = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < warmup + ticks; ++tick) {
+        if (tick == warmup) {
+            allocations_before = allocation_count();
+            started = std::chrono::steady_clock::now();
+        }
+        int arrivals = static_cast<int>(rng() % 12);
+        for (int i = 0; i < arrivals; ++i) {
+            burst.push_back(arena.create(rng(), rng(), static_cast<int>(rng() % 12 + 1), (rng() & 1) ? 'P' : 'S'));
+        }
+        ips.resize(burst.size());
+        verdicts.resize((burst.size() + 7) / 8);
+        for (size_t i = 0; i < burst.size(); ++i) {
+            ips[i] = arena.get(burst[i]).get_ip_in_int();
+        }
+        firewall.classify_batch(ips.data(), ips.size(), verdicts.data());
+        for (size_t i = 0; i < burst.size(); ++i) {
+            if (Firewall::is_blocked_verdict(verdicts.data(), i)) {
+                arena.release(std::move(burst[i]));
+            } else {
+                balancers[arena.get(burst[i]).get_request_type() == 'P'].queue_request(std::move(burst[i]));
+            }
+        }
+        burst.clear();
+        for (int pool = 0; pool < 2; ++pool) {
+            handlers[pool]->update_servers();
+            while (!balancers[pool].is_empty() && handlers[pool]->get_available_server() != nullptr) {
+                handlers[pool]->assign_request(balancers[pool].process_request());
+            }
+        }
+        if (tick >= warmup) {
+            result.requests += arrivals;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    result.allocations = allocation_count() - allocations_before;
+    return result;
+}
+
+/**
+ * @brief Request copied by value with string addresses, as before the arena.
+ */
+struct ValueRequest {
+    int request_id;
+    std::string ip_in;
+    std::string ip_out;
+    int time_to_process;
+    char request_type;
+};
+
+/**
+ * @brief Baseline: the same workload with by-value requests in std::queue.
+ *
+ * Requests carry their addresses as strings and are copied into and out of
+ * the queue, which is how the balancer worked before requests moved into
+ * the arena.
+ */
+BenchResult bench_value_queue(int ticks, int servers) {
+    std::mt19937 rng(42);
+    Firewall firewall;
+    firewall.blockRange("10.0.0.0", "10.255.255.255");
+    std::queue<ValueRequest> queues[2];
+    std::vector<int> busy[2] = {std::vector<int>(servers, 0), std::vector<int>(servers, 0)};
+    int next_id = 0;
+
+    BenchResult result;
+    int warmup = ticks / 4;
+    size_t allocations_before = 0;
+    auto started = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < warmup + ticks; ++tick) {
+        if (tick == warmup) {
+            allocations_before = allocation_count();
+            started = std::chrono::steady_clock::now();
+        }
+        int arrivals = static_cast<int>(rng() % 12);
+        for (int i = 0; i < arrivals; ++i) {
+            ValueRequest request{next_id++, Request::format_ip(rng()), Request::format_ip(rng()),
+                                 static_cast<int>(rng() % 12 + 1), (rng() & 1) ? 'P' : 'S'};
+            if (Request::parse_ip(request.ip_in) >> 24 != 10) {
+                queues[request.request_type == 'P'].push(request);
+            }
+        }
+        for (int pool = 0; pool < 2; ++pool) {
+            for (int& remaining : busy[pool]) {
+                remaining -= remaining > 0;
+            }
+            for (int& remaining : busy[pool]) {
+                if (remaining == 0 && !queues[pool].empty()) {
+                    ValueRequest request = queues[pool].front();
+                    queues[pool].pop();
+                    remaining = request.time_to_process;
+                }
+            }
+        }
+        if (tick >= warmup) {
+            result.requests += arrivals;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    result.allocations = allocation_count() - allocations_before;
+    return result;
+}
+
+/**
+ * @brief Deep backlog: queue depth requests, then drain them in FIFO order.
+ *
+ * With a budget the queue spills everything beyond it to disk and reads it
+ * back while draining; without one the whole backlog stays in the arena.
+ * The arena capacity afterwards shows the memory each variant needed.
+ */
+BenchResult bench_deep_queue(int depth, int budget, const std::string& spill_dir) {
+    std::mt19937 rng(42);
+    RequestArena arena;
+    LoadBalancer balancer;
+    if (budget > 0 && !balancer.enable_spill(arena, budget, spill_dir, SpillHooks())) {
+        return BenchResult();
+    }
+
+    BenchResult result;
+    size_t allocations_before = allocation_count();
+    auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < depth; ++i) {
+        balancer.queue_request(arena.create(rng(), rng(), static_cast<int>(rng() % 12 + 1), 'S'));
+    }
+    while (!balancer.is_empty()) {
+        arena.release(balancer.process_request());
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    result.allocations = allocation_count() - allocations_before;
+    result.requests = depth;
+    std::cout << "  arena capacity " << arena.capacity() << " slots, peak on disk " << balancer.get_peak_spilled()
+              << " requests" << std::endl;
+    return result;
+}
+
+/**
+ * @brief Heavy-hitter detection: count requests from many sources plus a few heavy ones.
+ *
+ * A tenth of the requests come from 16 sources of one /24; the rest are
+ * spread over `sources` distinct addresses. The window slides every 64
+ * requests, as it would with one burst per cycle.
+ */
+BenchResult bench_heavy_hitters(int ticks, int sources) {
+    std::mt19937 rng(42);
+    HeavyHitterSettings settings;
+    settings.share = 0.05;
+    HeavyHitterDetector detector(settings);
+    std::vector<HeavyHitter> promoted;
+    promoted.reserve(64);
+    uint32_t attack_prefix = rng() & 0xFFFFFF00u;
+    long long blocked = 0;
+
+    BenchResult result;
+    size_t allocations_before = allocation_count();
+    auto started = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < ticks; ++tick) {
+        detector.advance(tick);
+        for (int i = 0; i < 64; ++i) {
+            uint32_t ip = rng() % 10 == 0 ? attack_prefix | (rng() & 15u) : rng() % static_cast<uint32_t>(sources);
+            promoted.clear();
+            blocked += static_cast<long long>(detector.add(ip, tick, promoted));
+        }
+        result.requests += 64;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    result.allocations = allocation_count() - allocations_before;
+    std::cout << "  " << blocked << " blocks reported, " << detector.memory_bytes() / 1024 << " KiB" << std::endl;
+    return result;
+}
+
+/**
+ * @brief Server table under one page backing: tick every server, restart random ones.
+ *
+ * Each cycle ticks the whole table and then tries to start a request on an
+ * eighth of the slots picked at random, which touches six columns at random
+ * offsets; with 4 KiB pages nearly every one of those touches misses the TLB
+ * once the table outgrows it. Counts one request per start attempt.
+ */
+BenchResult bench_huge_pages(HugePages mode, int servers, int ticks) {
+    large_alloc_configure(mode, false);
+    std::mt19937 rng(42);
+    ServerTable table;
+    for (int i = 0; i < servers; ++i) {
+        table.add();
+    }
+    long long huge_bytes = transparent_huge_bytes();
+    size_t attempts = static_cast<size_t>(servers) / 8;
+    long long started = 0;
+
+    BenchResult result;
+    size_t allocations_before = allocation_count();
+    auto begin = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < ticks; ++tick) {
+        table.tick();
+        for (size_t i = 0; i < attempts; ++i) {
+            size_t slot = rng() % static_cast<uint32_t>(servers);
+            if (table.busy_until_time(slot) == 0) {
+                table.start(slot, static_cast<int>(i), static_cast<int>(rng() % 12 + 1), 'S');
+                started++;
+            }
+        }
+        result.requests += static_cast<long long>(attempts);
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    result.allocations = allocation_count() - allocations_before;
+    LargeAllocStats stats = large_alloc_stats();
+    std::cout << "  " << started << " starts, " << stats.live_blocks << " mapped blocks, "
+              << (huge_bytes >= 0 ? huge_bytes / (1024 * 1024) : -1) << " MiB on transparent huge pages, "
+              << stats.explicit_blocks << " hugetlbfs blocks and " << stats.fallbacks << " fallbacks so far"
+              << std::endl;
+    return result;
+}
+
+/**
+ * @brief Entry point of the benchmark program.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @return 0 on success, 1 if an unknown benchmark or page backing was requested.
+ */
+int main(int argc, char* argv[]) {
+    Config config(argc, argv);
+    std::string bench = config.get_string("bench", "all");
+    int ticks = config.get_int("ticks", 20000);
+    int servers = config.get_int("servers", 64);
+    int depth = config.get_int("depth", 1 << 20);
+    int budget = config.get_int("budget", 65536);
+    std::string spill_dir = config.get_string("spill-dir", "/tmp");
+    int sources = config.get_int("sources", 1 << 20);
+    int table_servers = config.get_int("table-servers", 1 << 20);
+    int table_ticks = config.get_int("table-ticks", 100);
+    HugePages huge_pages = HugePages::TRANSPARENT;
+    if (!parse_huge_pages(config.get_string("huge-pages", "transparent"), huge_pages)) {
+        std::cerr << "Unknown --huge-pages mode '" << config.get_string("huge-pages", "") << "'." << std::endl;
+        return 1;
+    }
+    large_alloc_configure(huge_pages, false);
+    bool ran = false;
+
+    if (bench == "all" || bench == "arena") {
+        report("arena", bench_arena(ticks, servers));
+        ran = true;
+    }
+    if (bench == "all" || bench == "value-queue") {
+        report("value-queue", bench_value_queue(ticks, servers));
+        ran = true;
+    }
+    if (bench == "all" || bench == "deep-queue") {
+        report("deep-queue", bench_deep_queue(depth, 0, spill_dir));
+        ran = true;
+    }
+    if (bench == "all" || bench == "deep-queue-spill") {
+        report("deep-queue-spill", bench_deep_queue(depth, budget, spill_dir));
+        ran = true;
+    }
+    if (bench == "all" || bench == "heavy-hitters") {
+        report("heavy-hitters", bench_heavy_hitters(ticks, sources > 0 ? sources : 1));
+        ran = true;
+    }
+    if (bench == "all" || bench == "huge-pages") {
+        for (HugePages mode : {HugePages::OFF, HugePages::TRANSPARENT, HugePages::EXPLICIT}) {
+            report(std::string("huge-pages-") + huge_pages_name(mode),
+                   bench_huge_pages(mode, table_servers > 0 ? table_servers : 1, table_ticks));
+        }
+        large_alloc_configure(huge_pages, false);
+        ran = true;
+    }
+    if (!ran) {
+        std::cerr << "Unknown benchmark '" << bench << "'." << std::endl;
+        return 1;
+    }
+    return 0;
+}
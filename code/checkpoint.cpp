@@ -0,0 +1,224 @@
+/**
+ * @file checkpoint.cpp
+ * @brief Implements the checkpoint writer and memory-mapped reader.
+ */
+
+#include "checkpoint.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * @brief Fixed header at the start of every checkpoint file.
+ */
+struct CheckpointHeader {
+    char magic[4];          ///< "LBCK".
+    uint32_t version;       ///< CheckpointWriter::VERSION of the writer.
+    uint64_t payload_size;  ///< Bytes following the header.
+};
+
+const char MAGIC[4] = {'L', 'B', 'C', 'K'};
+
+} // namespace
+
+/**
+ * @brief Appends a string as its length and characters.
+ *
+ * @param text String to append.
+ */
+void CheckpointWriter::write_string(const std::string& text) {
+    write(static_cast<uint64_t>(text.size()));
+    append(text.data(), text.size());
+}
+
+/**
+ * @brief Appends the state of a Mersenne Twister generator.
+ *
+ * The standard only defines the generator's textual state, which is what is
+ * stored.
+ *
+ * @param rng Generator to save.
+ */
+void CheckpointWriter::write_rng(const std::mt19937& rng) {
+    std::ostringstream state;
+    state << rng;
+    write_string(state.str());
+}
+
+/**
+ * @brief Appends raw bytes.
+ *
+ * @param data First byte.
+ * @param size Number of bytes.
+ */
+void CheckpointWriter::append(const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    payload.insert(payload.end(), bytes, bytes + size);
+}
+
+/**
+ * @brief Writes the header and payload to a file.
+ *
+ * @param path Output file, replaced if it exists.
+ * @return false if the file could not be written.
+ */
+bool CheckpointWriter::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+    CheckpointHeader header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.payload_size = payload.size();
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    return static_cast<bool>(out);
+}
+
+/**
+ * @brief Returns the payload size so far.
+ *
+ * @return Bytes appended.
+ */
+size_t CheckpointWriter::size() const {
+    return payload.size();
+}
+
+/**
+ * @brief Constructs a reader with no file open.
+ */
+CheckpointReader::CheckpointReader()
+    : mapping(nullptr), mapping_size(0), payload(nullptr), payload_size(0), offset(0), failed(true) {}
+
+/**
+ * @brief Unmaps the file.
+ */
+CheckpointReader::~CheckpointReader() {
+    if (mapping) {
+        munmap(mapping, mapping_size);
+    }
+}
+
+/**
+ * @brief Maps a checkpoint file and checks its header.
+ *
+ * @param path Checkpoint file.
+ * @return false if the file cannot be mapped or is not a checkpoint of this version.
+ */
+bool CheckpointReader::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "open(" << path << ") failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(CheckpointHeader)) {
+        close(fd);
+        std::cerr << path << " is too short to be a checkpoint." << std::endl;
+        return false;
+    }
+    mapping_size = static_cast<size_t>(info.st_size);
+    mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        std::cerr << "mmap(" << path << ") failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    CheckpointHeader header;
+    std::memcpy(&header, mapping, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != CheckpointWriter::VERSION ||
+        header.payload_size != mapping_size - sizeof(header)) {
+        std::cerr << path << " is not a version " << CheckpointWriter::VERSION << " checkpoint." << std::endl;
+        return false;
+    }
+    payload = static_cast<const char*>(mapping) + sizeof(header);
+    payload_size = static_cast<size_t>(header.payload_size);
+    offset = 0;
+    failed = false;
+    return true;
+}
+
+/**
+ * @brief Reads a string written by CheckpointWriter::write_string().
+ *
+ * @param text Receives the string.
+ */
+void CheckpointReader::read_string(std::string& text) {
+    uint64_t length = 0;
+    read(length);
+    if (length > remaining()) {
+        failed = true;
+        length = 0;
+    }
+    text.assign(payload ? payload + offset : "", static_cast<size_t>(length));
+    offset += static_cast<size_t>(length);
+}
+
+/**
+ * @brief Restores a Mersenne Twister generator written by CheckpointWriter::write_rng().
+ *
+ * @param rng Generator to restore.
+ */
+void CheckpointReader::read_rng(std::mt19937& rng) {
+    std::string text;
+    read_string(text);
+    std::istringstream state(text);
+    state >> rng;
+    if (!state) {
+        failed = true;
+    }
+}
+
+/**
+ * @brief Copies raw bytes out of the mapping.
+ *
+ * @param data Destination.
+ * @param size Number of bytes.
+ * @return false (and the reader fails) if fewer bytes are left.
+ */
+bool CheckpointReader::take(void* data, size_t size) {
+    if (failed || size > remaining()) {
+        failed = true;
+        return false;
+    }
+    if (size > 0) {
+        std::memcpy(data, payload + offset, size);
+    }
+    offset += size;
+    return true;
+}
+
+/**
+ * @brief Marks the checkpoint as inconsistent with the reading program.
+ */
+void CheckpointReader::fail() {
+    failed = true;
+}
+
+/**
+ * @brief Checks that every read so far succeeded.
+ *
+ * @return false after a short read or fail().
+ */
+bool CheckpointReader::ok() const {
+    return !failed;
+}
+
+/**
+ * @brief Returns the number of payload bytes not read yet.
+ *
+ * @return Unread payload bytes.
+ */
+size_t CheckpointReader::remaining() const {
+    return payload_size - offset;
+}
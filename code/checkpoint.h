@@ -0,0 +1,238 @@
+/**
+ * @file checkpoint.h
+ * @brief Declares the binary writer and memory-mapped reader used for simulation checkpoints.
+ *
+ * A checkpoint file is a fixed header (magic "LBCK", format version and
+ * payload size) followed by the payload: the sections written by each
+ * component's save() in a fixed order. Values are stored in native byte
+ * order and vectors as a length followed by their raw elements, so restoring
+ * is mostly memcpy out of the mapped file. Checkpoints are meant to be read
+ * back on the machine (and build) that wrote them.
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @class CheckpointWriter
+ * @brief Appends values to an in-memory payload and writes it out with a header.
+ */
+class CheckpointWriter {
+public:
+
+    /**
+     * @brief Format version written to the header; bumped whenever the layout changes.
+     */
+    static constexpr uint32_t VERSION = 5;
+
+    /**
+     * @brief Appends a trivially copyable value.
+     *
+     * @param value Value to append.
+     */
+    template <class T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint values must be trivially copyable");
+        append(&value, sizeof(T));
+    }
+
+    /**
+     * @brief Appends a vector as its length and raw elements.
+     *
+     * @param values Vector of trivially copyable elements.
+     */
+    template <class T, class A>
+    void write_vector(const std::vector<T, A>& values) {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint values must be trivially copyable");
+        write(static_cast<uint64_t>(values.size()));
+        append(values.data(), values.size() * sizeof(T));
+    }
+
+    /**
+     * @brief Appends a string as its length and characters.
+     *
+     * @param text String to append.
+     */
+    void write_string(const std::string& text);
+
+    /**
+     * @brief Appends the state of a Mersenne Twister generator.
+     *
+     * @param rng Generator to save.
+     */
+    void write_rng(const std::mt19937& rng);
+
+    /**
+     * @brief Appends raw bytes.
+     *
+     * @param data First byte.
+     * @param size Number of bytes.
+     */
+    void append(const void* data, size_t size);
+
+    /**
+     * @brief Writes the header and payload to a file.
+     *
+     * @param path Output file, replaced if it exists.
+     * @return false if the file could not be written.
+     */
+    bool save(const std::string& path) const;
+
+    /**
+     * @brief Returns the payload size so far.
+     */
+    size_t size() const;
+
+private:
+
+    /**
+     * @brief Payload written so far.
+     */
+    std::vector<char> payload;
+};
+
+/**
+ * @class CheckpointReader
+ * @brief Reads a checkpoint file through a read-only memory mapping.
+ *
+ * Reads past the end of the payload or of a malformed section leave the
+ * target zeroed or empty and mark the reader as failed; callers read a whole
+ * component and then check ok() once.
+ */
+class CheckpointReader {
+public:
+
+    /**
+     * @brief Constructs a reader with no file open.
+     */
+    CheckpointReader();
+
+    /**
+     * @brief Unmaps the file.
+     */
+    ~CheckpointReader();
+
+    CheckpointReader(const CheckpointReader&) = delete;
+    CheckpointReader& operator=(const CheckpointReader&) = delete;
+
+    /**
+     * @brief Maps a checkpoint file and checks its header.
+     *
+     * @param path Checkpoint file.
+     * @return false if the file cannot be mapped or is not a checkpoint of this version.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Reads a trivially copyable value.
+     *
+     * @param value Receives the value.
+     */
+    template <class T>
+    void read(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint values must be trivially copyable");
+        if (!take(&value, sizeof(T))) {
+            std::memset(static_cast<void*>(&value), 0, sizeof(T));
+        }
+    }
+
+    /**
+     * @brief Reads a vector written by CheckpointWriter::write_vector().
+     *
+     * @param values Receives the elements.
+     */
+    template <class T, class A>
+    void read_vector(std::vector<T, A>& values) {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint values must be trivially copyable");
+        uint64_t count = 0;
+        read(count);
+        if (count > remaining() / (sizeof(T) > 0 ? sizeof(T) : 1)) {
+            failed = true;
+            count = 0;
+        }
+        values.resize(static_cast<size_t>(count));
+        take(values.data(), values.size() * sizeof(T));
+    }
+
+    /**
+     * @brief Reads a string written by CheckpointWriter::write_string().
+     *
+     * @param text Receives the string.
+     */
+    void read_string(std::string& text);
+
+    /**
+     * @brief Restores a Mersenne Twister generator written by CheckpointWriter::write_rng().
+     *
+     * @param rng Generator to restore.
+     */
+    void read_rng(std::mt19937& rng);
+
+    /**
+     * @brief Copies raw bytes out of the mapping.
+     *
+     * @param data Destination.
+     * @param size Number of bytes.
+     * @return false (and the reader fails) if fewer bytes are left.
+     */
+    bool take(void* data, size_t size);
+
+    /**
+     * @brief Marks the checkpoint as inconsistent with the reading program.
+     */
+    void fail();
+
+    /**
+     * @brief Checks that every read so far succeeded.
+     *
+     * @return false after a short read or fail().
+     */
+    bool ok() const;
+
+    /**
+     * @brief Returns the number of payload bytes not read yet.
+     */
+    size_t remaining() const;
+
+private:
+
+    /**
+     * @brief Start of the mapping (nullptr if no file is open).
+     */
+    void* mapping;
+
+    /**
+     * @brief Length of the mapping in bytes.
+     */
+    size_t mapping_size;
+
+    /**
+     * @brief Payload inside the mapping.
+     */
+    const char* payload;
+
+    /**
+     * @brief Payload length in bytes.
+     */
+    size_t payload_size;
+
+    /**
+     * @brief Read position in the payload.
+     */
+    size_t offset;
+
+    /**
+     * @brief Whether a read failed.
+     */
+    bool failed;
+};
+
+#endif
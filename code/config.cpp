@@ -0,0 +1,170 @@
+/**
+ * @file config.cpp
+ * @brief Implements the Config class holding simulation options.
+ *
+ * This file contains the command-line and configuration-file parsing logic as
+ * well as the typed option accessors.
+ */
+
+#include "config.h"
+#include <fstream>
+#include <string>
+
+/**
+ * @brief Constructs an empty Config.
+ */
+Config::Config() = default;
+
+/**
+ * @brief Constructs a Config from command-line arguments.
+ *
+ * The --config file (if any) is loaded without overwriting, so values given
+ * directly on the command line always win.
+ *
+ * @param argc Argument count passed to main().
+ * @param argv Argument vector passed to main().
+ */
+Config::Config(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            continue;
+        }
+        arg = arg.substr(2);
+        size_t eq = arg.find('=');
+        if (eq == std::string::npos) {
+            set(arg, "true");
+        } else {
+            set(arg.substr(0, eq), arg.substr(eq + 1));
+        }
+    }
+    if (has("config")) {
+        load_file(get_string("config", ""), false);
+    }
+}
+
+/**
+ * @brief Loads key=value pairs from a configuration file.
+ *
+ * Surrounding whitespace is trimmed from keys and values.
+ *
+ * @param path Path of the configuration file.
+ * @param overwrite Whether values in the file replace values already set.
+ * @return true if the file could be opened, false otherwise.
+ */
+bool Config::load_file(const std::string& path, bool overwrite) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+    auto trim = [](const std::string& text) {
+        size_t first = text.find_first_not_of(" \t\r");
+        if (first == std::string::npos) {
+            return std::string();
+        }
+        size_t last = text.find_last_not_of(" \t\r");
+        return text.substr(first, last - first + 1);
+    };
+    std::string line;
+    while (std::getline(file, line)) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        size_t eq = line.find('=');
+        std::string key = trim(line.substr(0, eq));
+        std::string value = (eq == std::string::npos) ? "true" : trim(line.substr(eq + 1));
+        if (overwrite || !has(key)) {
+            set(key, value);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Sets an option value.
+ *
+ * @param key Option name (without the leading dashes).
+ * @param value Option value.
+ */
+void Config::set(const std::string& key, const std::string& value) {
+    values[key] = value;
+}
+
+/**
+ * @brief Checks whether an option has been set.
+ *
+ * @param key Option name.
+ * @return true if the option is present, false otherwise.
+ */
+bool Config::has(const std::string& key) const {
+    return values.find(key) != values.end();
+}
+
+/**
+ * @brief Returns an option as a string.
+ *
+ * @param key Option name.
+ * @param fallback Value returned when the option is missing.
+ * @return The option value or fallback.
+ */
+std::string Config::get_string(const std::string& key, const std::string& fallback) const {
+    auto it = values.find(key);
+    return it == values.end() ? fallback : it->second;
+}
+
+/**
+ * @brief Returns an option as an integer.
+ *
+ * @param key Option name.
+ * @param fallback Value returned when the option is missing or not numeric.
+ * @return The option value or fallback.
+ */
+int Config::get_int(const std::string& key, int fallback) const {
+    auto it = values.find(key);
+    if (it == values.end()) {
+        return fallback;
+    }
+    try {
+        return std::stoi(it->second);
+    } catch (...) {
+        return fallback;
+    }
+}
+
+/**
+ * @brief Returns an option as a floating-point number.
+ *
+ * @param key Option name.
+ * @param fallback Value returned when the option is missing or not numeric.
+ * @return The option value or fallback.
+ */
+double Config::get_double(const std::string& key, double fallback) const {
+    auto it = values.find(key);
+    if (it == values.end()) {
+        return fallback;
+    }
+    try {
+        return std::stod(it->second);
+    } catch (...) {
+        return fallback;
+    }
+}
+
+/**
+ * @brief Returns an option as a boolean.
+ *
+ * @param key Option name.
+ * @param fallback Value returned when the option is missing or unrecognized.
+ * @return The option value or fallback.
+ */
+bool Config::get_bool(const std::string& key, bool fallback) const {
+    std::string value = get_string(key, "");
+    if (value == "true" || value == "yes" || value == "on" || value == "1") {
+        return true;
+    }
+    if (value == "false" || value == "no" || value == "off" || value == "0") {
+        return false;
+    }
+    return fallback;
+}
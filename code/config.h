@@ -0,0 +1,119 @@
+/**
+ * @file config.h
+ * @brief Declares the Config class holding simulation options.
+ *
+ * This header defines a small key/value store that is filled from command-line
+ * arguments of the form --key=value and, optionally, from a configuration file
+ * with one key=value pair per line.
+ */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <map>
+#include <string>
+
+/**
+ * @class Config
+ * @brief Stores named simulation options with typed accessors.
+ *
+ * Options are parsed from argv ("--cache=lru", "--verbose") and from the file
+ * named by "--config=path". Command-line values override values read from the
+ * file. Lookups fall back to a caller-supplied default when a key is missing.
+ */
+class Config {
+public:
+
+    /**
+     * @brief Constructs an empty Config.
+     */
+    Config();
+
+    /**
+     * @brief Constructs a Config from command-line arguments.
+     *
+     * Each argument of the form --key=value sets key to value, and a bare
+     * --key sets key to "true". If --config=path is given, the file is loaded
+     * first so that the remaining arguments override it.
+     *
+     * @param argc Argument count passed to main().
+     * @param argv Argument vector passed to main().
+     */
+    Config(int argc, char* argv[]);
+
+    /**
+     * @brief Loads key=value pairs from a configuration file.
+     *
+     * Blank lines and lines starting with '#' are ignored. Existing keys are
+     * only overwritten when overwrite is true.
+     *
+     * @param path Path of the configuration file.
+     * @param overwrite Whether values in the file replace values already set.
+     * @return true if the file could be opened, false otherwise.
+     */
+    bool load_file(const std::string& path, bool overwrite = true);
+
+    /**
+     * @brief Sets an option value.
+     *
+     * @param key Option name (without the leading dashes).
+     * @param value Option value.
+     */
+    void set(const std::string& key, const std::string& value);
+
+    /**
+     * @brief Checks whether an option has been set.
+     *
+     * @param key Option name.
+     * @return true if the option is present, false otherwise.
+     */
+    bool has(const std::string& key) const;
+
+    /**
+     * @brief Returns an option as a string.
+     *
+     * @param key Option name.
+     * @param fallback Value returned when the option is missing.
+     * @return The option value or fallback.
+     */
+    std::string get_string(const std::string& key, const std::string& fallback) const;
+
+    /**
+     * @brief Returns an option as an integer.
+     *
+     * @param key Option name.
+     * @param fallback Value returned when the option is missing or not numeric.
+     * @return The option value or fallback.
+     */
+    int get_int(const std::string& key, int fallback) const;
+
+    /**
+     * @brief Returns an option as a floating-point number.
+     *
+     * @param key Option name.
+     * @param fallback Value returned when the option is missing or not numeric.
+     * @return The option value or fallback.
+     */
+    double get_double(const std::string& key, double fallback) const;
+
+    /**
+     * @brief Returns an option as a boolean.
+     *
+     * "true", "yes", "on" and "1" are treated as true; "false", "no", "off"
+     * and "0" as false.
+     *
+     * @param key Option name.
+     * @param fallback Value returned when the option is missing or unrecognized.
+     * @return The option value or fallback.
+     */
+    bool get_bool(const std::string& key, bool fallback) const;
+
+private:
+
+    /**
+     * @brief Option values keyed by name.
+     */
+    std::map<std::string, std::string> values;
+};
+
+#endif
@@ -0,0 +1,82 @@
+/**
+ * @file fault_injector.cpp
+ * @brief Implements the FaultInjector class.
+ */
+
+#include "fault_injector.h"
+
+/**
+ * @brief Constructs an injector with every fault disabled.
+ */
+FaultInjector::FaultInjector() : rng(0), unit(0.0, 1.0) {}
+
+/**
+ * @brief Sets the fault rates and reseeds the generator.
+ *
+ * @param settings Fault rates.
+ * @param seed Seed of the injector's random number generator.
+ */
+void FaultInjector::configure(const FaultSettings& settings, uint32_t seed) {
+    this->settings = settings;
+    rng.seed(seed);
+}
+
+/**
+ * @brief Returns the fault rates in use.
+ *
+ * @return Current settings.
+ */
+const FaultSettings& FaultInjector::get_settings() const {
+    return settings;
+}
+
+/**
+ * @brief Draws the slowdown factor of a newly added server.
+ *
+ * @return slow_multiplier for slow nodes, 1 otherwise.
+ */
+float FaultInjector::draw_slowdown() {
+    if (settings.slow_fraction > 0.0 && unit(rng) < settings.slow_fraction) {
+        return static_cast<float>(settings.slow_multiplier);
+    }
+    return 1.0f;
+}
+
+/**
+ * @brief Draws the stall added to a request being started.
+ *
+ * @return stall_cycles if the request stalls, 0 otherwise.
+ */
+int FaultInjector::draw_stall() {
+    if (settings.stall_probability > 0.0 && unit(rng) < settings.stall_probability) {
+        return settings.stall_cycles;
+    }
+    return 0;
+}
+
+/**
+ * @brief Draws whether a busy server crashes this cycle.
+ *
+ * @return true if the server crashes.
+ */
+bool FaultInjector::draw_crash() {
+    return settings.crash_probability > 0.0 && unit(rng) < settings.crash_probability;
+}
+
+/**
+ * @brief Writes the generator state to a checkpoint.
+ *
+ * @param out Checkpoint being written.
+ */
+void FaultInjector::save(CheckpointWriter& out) const {
+    out.write_rng(rng);
+}
+
+/**
+ * @brief Restores the generator state; the fault rates are kept.
+ *
+ * @param in Checkpoint being read.
+ */
+void FaultInjector::restore(CheckpointReader& in) {
+    in.read_rng(rng);
+}
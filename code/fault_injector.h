@@ -0,0 +1,120 @@
+/**
+ * @file fault_injector.h
+ * @brief Declares the FaultInjector used to make servers stall, crash or run slow.
+ *
+ * Real servers do not finish every request in exactly time_to_process
+ * cycles. A FaultInjector decides, from its own seeded random number
+ * generator, which servers are slow nodes, which requests stall and when a
+ * busy server crashes, so tail-latency behaviour can be studied in the
+ * simulation.
+ */
+
+#ifndef FAULT_INJECTOR_H
+#define FAULT_INJECTOR_H
+
+#include "checkpoint.h"
+#include <cstdint>
+#include <random>
+
+/**
+ * @brief Fault and slowdown rates applied to one server pool.
+ */
+struct FaultSettings {
+    double stall_probability = 0.0;  ///< Chance that a started request stalls.
+    int stall_cycles = 20;           ///< Extra cycles added by a stall.
+    double crash_probability = 0.0;  ///< Chance per cycle that a busy server crashes.
+    int restart_cycles = 50;         ///< Cycles a crashed server stays down.
+    double slow_fraction = 0.0;      ///< Fraction of new servers that are slow nodes.
+    double slow_multiplier = 3.0;    ///< time_to_process multiplier of slow nodes.
+
+    /**
+     * @brief Checks whether any fault is enabled.
+     *
+     * @return true if at least one probability or fraction is positive.
+     */
+    bool enabled() const {
+        return stall_probability > 0.0 || crash_probability > 0.0 || slow_fraction > 0.0;
+    }
+};
+
+/**
+ * @class FaultInjector
+ * @brief Draws fault events for a server pool.
+ */
+class FaultInjector {
+public:
+
+    /**
+     * @brief Constructs an injector with every fault disabled.
+     */
+    FaultInjector();
+
+    /**
+     * @brief Sets the fault rates and reseeds the generator.
+     *
+     * @param settings Fault rates.
+     * @param seed Seed of the injector's random number generator.
+     */
+    void configure(const FaultSettings& settings, uint32_t seed);
+
+    /**
+     * @brief Returns the fault rates in use.
+     *
+     * @return Current settings.
+     */
+    const FaultSettings& get_settings() const;
+
+    /**
+     * @brief Draws the slowdown factor of a newly added server.
+     *
+     * @return slow_multiplier for slow nodes, 1 otherwise.
+     */
+    float draw_slowdown();
+
+    /**
+     * @brief Draws the stall added to a request being started.
+     *
+     * @return stall_cycles if the request stalls, 0 otherwise.
+     */
+    int draw_stall();
+
+    /**
+     * @brief Draws whether a busy server crashes this cycle.
+     *
+     * @return true if the server crashes.
+     */
+    bool draw_crash();
+
+    /**
+     * @brief Writes the generator state to a checkpoint.
+     *
+     * @param out Checkpoint being written.
+     */
+    void save(CheckpointWriter& out) const;
+
+    /**
+     * @brief Restores the generator state; the fault rates are kept.
+     *
+     * @param in Checkpoint being read.
+     */
+    void restore(CheckpointReader& in);
+
+private:
+
+    /**
+     * @brief Fault rates.
+     */
+    FaultSettings settings;
+
+    /**
+     * @brief Generator behind every draw.
+     */
+    std::mt19937 rng;
+
+    /**
+     * @brief Uniform [0, 1) distribution used for probability checks.
+     */
+    std::uniform_real_distribution<double> unit;
+};
+
+#endif
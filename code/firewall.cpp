@@ -7,6 +7,144 @@
  */
 
 #include "firewall.h"
+#include "alloc_counter.h"
+#include "profiler.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FIREWALL_HAVE_X86_KERNELS 1
+#endif
+
+namespace {
+
+/**
+ * @brief Signature shared by every batch classification kernel.
+ */
+using BatchKernel = void (*)(const std::pair<unsigned int, unsigned int>* ranges, size_t range_count,
+                             const uint32_t* ips, size_t n, uint8_t* verdicts);
+
+/**
+ * @brief Computes the verdict byte for up to eight addresses with scalar compares.
+ *
+ * @return Bitmask with bit i set when ips[i] falls in a blocked range.
+ */
+uint8_t classify_byte_scalar(const std::pair<unsigned int, unsigned int>* ranges, size_t range_count,
+                             const uint32_t* ips, size_t count) {
+    uint8_t bits = 0;
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t r = 0; r < range_count; ++r) {
+            if (ips[i] >= ranges[r].first && ips[i] <= ranges[r].second) {
+                bits |= static_cast<uint8_t>(1u << i);
+                break;
+            }
+        }
+    }
+    return bits;
+}
+
+/**
+ * @brief Portable fallback kernel used when no vector extension is available.
+ */
+void classify_scalar(const std::pair<unsigned int, unsigned int>* ranges, size_t range_count,
+                     const uint32_t* ips, size_t n, uint8_t* verdicts) {
+    for (size_t i = 0; i < n; i += 8) {
+        size_t count = (n - i < 8) ? n - i : 8;
+        verdicts[i >> 3] = classify_byte_scalar(ranges, range_count, ips + i, count);
+    }
+}
+
+#ifdef FIREWALL_HAVE_X86_KERNELS
+
+/**
+ * @brief SSE2 kernel: tests four addresses per compare.
+ *
+ * SSE2 only has signed 32-bit compares, so both operands are biased by
+ * 0x80000000 to turn the unsigned range test into a signed one.
+ */
+void classify_sse2(const std::pair<unsigned int, unsigned int>* ranges, size_t range_count,
+                   const uint32_t* ips, size_t n, uint8_t* verdicts) {
+    const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+    const __m128i ones = _mm_set1_epi32(-1);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i lo = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ips + i)), bias);
+        __m128i hi = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ips + i + 4)), bias);
+        __m128i blocked_lo = _mm_setzero_si128();
+        __m128i blocked_hi = _mm_setzero_si128();
+        for (size_t r = 0; r < range_count; ++r) {
+            __m128i start = _mm_xor_si128(_mm_set1_epi32(static_cast<int>(ranges[r].first)), bias);
+            __m128i end = _mm_xor_si128(_mm_set1_epi32(static_cast<int>(ranges[r].second)), bias);
+            __m128i outside_lo = _mm_or_si128(_mm_cmpgt_epi32(start, lo), _mm_cmpgt_epi32(lo, end));
+            __m128i outside_hi = _mm_or_si128(_mm_cmpgt_epi32(start, hi), _mm_cmpgt_epi32(hi, end));
+            blocked_lo = _mm_or_si128(blocked_lo, _mm_andnot_si128(outside_lo, ones));
+            blocked_hi = _mm_or_si128(blocked_hi, _mm_andnot_si128(outside_hi, ones));
+        }
+        int bits = _mm_movemask_ps(_mm_castsi128_ps(blocked_lo)) |
+                   (_mm_movemask_ps(_mm_castsi128_ps(blocked_hi)) << 4);
+        verdicts[i >> 3] = static_cast<uint8_t>(bits);
+    }
+    if (i < n) {
+        verdicts[i >> 3] = classify_byte_scalar(ranges, range_count, ips + i, n - i);
+    }
+}
+
+/**
+ * @brief AVX2 kernel: tests eight addresses (one verdict byte) per compare.
+ */
+__attribute__((target("avx2")))
+void classify_avx2(const std::pair<unsigned int, unsigned int>* ranges, size_t range_count,
+                   const uint32_t* ips, size_t n, uint8_t* verdicts) {
+    const __m256i bias = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i ip = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ips + i)), bias);
+        __m256i inside_any = _mm256_setzero_si256();
+        for (size_t r = 0; r < range_count; ++r) {
+            __m256i start = _mm256_xor_si256(_mm256_set1_epi32(static_cast<int>(ranges[r].first)), bias);
+            __m256i end = _mm256_xor_si256(_mm256_set1_epi32(static_cast<int>(ranges[r].second)), bias);
+            __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(start, ip), _mm256_cmpgt_epi32(ip, end));
+            // andnot(outside, all-ones) == inside this range
+            inside_any = _mm256_or_si256(inside_any, _mm256_andnot_si256(outside, _mm256_set1_epi32(-1)));
+        }
+        verdicts[i >> 3] = static_cast<uint8_t>(_mm256_movemask_ps(_mm256_castsi256_ps(inside_any)));
+    }
+    if (i < n) {
+        verdicts[i >> 3] = classify_byte_scalar(ranges, range_count, ips + i, n - i);
+    }
+}
+
+#endif
+
+/**
+ * @brief Picks the widest kernel supported by the running CPU.
+ */
+BatchKernel select_kernel(const char** name) {
+#ifdef FIREWALL_HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "avx2";
+        return classify_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        *name = "sse2";
+        return classify_sse2;
+    }
+#endif
+    *name = "scalar";
+    return classify_scalar;
+}
+
+/**
+ * @brief Name of the kernel chosen by select_kernel().
+ */
+const char* kernel_name = "scalar";
+
+/**
+ * @brief Kernel used by Firewall::classify_batch, resolved once at startup.
+ */
+const BatchKernel active_kernel = select_kernel(&kernel_name);
+
+} // namespace
 
 /**
  * @brief Constructs an empty Firewall with no blocked ranges.
@@ -16,24 +154,26 @@ Firewall::Firewall() = default;
 /**
  * @brief Converts a dotted-quad IPv4 string into an unsigned integer.
  *
- * The IPv4 address is parsed as four octets separated by '.' and packed into a
+ * Delegates to Request::parse_ip(), which packs the four octets into a
  * 32-bit unsigned integer using left shifts.
  *
  * @param ip IPv4 address as a string in dotted-quad form (e.g., "192.168.0.1").
  * @return Unsigned integer representation of the IPv4 address.
  */
 unsigned int Firewall::ip_to_int(const std::string& ip) const {
-    unsigned int result = 0;
-    size_t start = 0;
-    for (int i = 0; i < 4; ++i) {
-        size_t end = ip.find('.', start);
-        if (end == std::string::npos) {
-            end = ip.length();
-        }
-        result = (result << 8) | std::stoi(ip.substr(start, end - start));
-        start = end + 1;
-    }
-    return result;
+    return Request::parse_ip(ip);
+}
+
+/**
+ * @brief Converts an unsigned integer back into a dotted-quad IPv4 string.
+ *
+ * The most significant byte becomes the first octet, matching ip_to_int().
+ *
+ * @param ip Integer representation of the IPv4 address.
+ * @return IPv4 address as a string in dotted-quad form.
+ */
+std::string Firewall::int_to_ip(unsigned int ip) const {
+    return Request::format_ip(ip);
 }
 
 /**
@@ -47,12 +187,68 @@ unsigned int Firewall::ip_to_int(const std::string& ip) const {
  * @param end_ip Ending IPv4 address (inclusive).
  */
 void Firewall::blockRange(const std::string& start_ip, const std::string& end_ip) {
+    MEMORY_SCOPE(MemoryComponent::FIREWALL);
     unsigned int start = ip_to_int(start_ip);
     unsigned int end = ip_to_int(end_ip);
     if (start > end) {
         std::swap(start, end);
     }
     blockedRanges.emplace_back(start, end);
+    expiries.push_back(PERMANENT);
+}
+
+/**
+ * @brief Blocks an inclusive address range until a given cycle.
+ *
+ * @param start First blocked address in integer form.
+ * @param end Last blocked address in integer form.
+ * @param expires Cycle from which the range is no longer blocked.
+ */
+void Firewall::block_until(uint32_t start, uint32_t end, int expires) {
+    MEMORY_SCOPE(MemoryComponent::FIREWALL);
+    if (start > end) {
+        std::swap(start, end);
+    }
+    for (size_t i = 0; i < blockedRanges.size(); ++i) {
+        if (blockedRanges[i].first == start && blockedRanges[i].second == end) {
+            expiries[i] = expiries[i] > expires ? expiries[i] : expires;
+            return;
+        }
+    }
+    blockedRanges.emplace_back(start, end);
+    expiries.push_back(expires);
+}
+
+/**
+ * @brief Drops the ranges whose block has expired.
+ *
+ * The remaining ranges keep their order.
+ *
+ * @param now Current cycle.
+ * @return Number of ranges dropped.
+ */
+size_t Firewall::expire(int now) {
+    size_t kept = 0;
+    for (size_t i = 0; i < blockedRanges.size(); ++i) {
+        if (expiries[i] > now) {
+            blockedRanges[kept] = blockedRanges[i];
+            expiries[kept] = expiries[i];
+            kept++;
+        }
+    }
+    size_t dropped = blockedRanges.size() - kept;
+    blockedRanges.resize(kept);
+    expiries.resize(kept);
+    return dropped;
+}
+
+/**
+ * @brief Returns the number of blocked ranges.
+ *
+ * @return Permanent and temporary ranges.
+ */
+size_t Firewall::get_range_count() const {
+    return blockedRanges.size();
 }
 
 /**
@@ -65,11 +261,79 @@ void Firewall::blockRange(const std::string& start_ip, const std::string& end_ip
  * @return true if the request's IP is in a blocked range, false otherwise.
  */
 bool Firewall::isBlocked(const Request& request) const {
-    unsigned int ip_in = ip_to_int(request.get_ip_in());
+    PROFILE_SCOPE(ProfilePhase::FIREWALL_IS_BLOCKED);
+    unsigned int ip_in = request.get_ip_in_int();
     for (const auto& range : blockedRanges) {
         if (ip_in >= range.first && ip_in <= range.second) {
             return true;
         }
     }
     return false;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Classifies a batch of packed IPv4 addresses against the blocked ranges.
+ *
+ * Dispatches to the vector kernel chosen at startup. With no blocked ranges
+ * every address passes, so the bitmask is simply cleared.
+ *
+ * @param ips Addresses in the integer form produced by ip_to_int().
+ * @param n Number of addresses in ips.
+ * @param verdicts Output bitmask with one bit per address (1 = blocked).
+ */
+void Firewall::classify_batch(const uint32_t* ips, size_t n, uint8_t* verdicts) const {
+    PROFILE_SCOPE(ProfilePhase::FIREWALL_CLASSIFY);
+    if (blockedRanges.empty()) {
+        for (size_t i = 0; i < (n + 7) / 8; ++i) {
+            verdicts[i] = 0;
+        }
+        return;
+    }
+    active_kernel(blockedRanges.data(), blockedRanges.size(), ips, n, verdicts);
+}
+
+/**
+ * @brief Returns the name of the batch kernel selected for this CPU.
+ *
+ * @return "avx2", "sse2" or "scalar".
+ */
+const char* Firewall::batch_kernel_name() {
+    return kernel_name;
+}
+
+/**
+ * @brief Writes the blocked ranges and their expiries to a checkpoint.
+ *
+ * @param out Checkpoint being written.
+ */
+void Firewall::save(CheckpointWriter& out) const {
+    // std::pair is not trivially copyable, so each range is stored as two bounds
+    std::vector<uint32_t> bounds;
+    for (const auto& range : blockedRanges) {
+        bounds.push_back(range.first);
+        bounds.push_back(range.second);
+    }
+    out.write_vector(bounds);
+    out.write_vector(expiries);
+}
+
+/**
+ * @brief Replaces the blocked ranges with checkpointed ones.
+ *
+ * @param in Checkpoint being read.
+ * @return false if the section is malformed.
+ */
+bool Firewall::restore(CheckpointReader& in) {
+    MEMORY_SCOPE(MemoryComponent::FIREWALL);
+    std::vector<uint32_t> bounds;
+    in.read_vector(bounds);
+    in.read_vector(expiries);
+    if (bounds.size() % 2 != 0 || expiries.size() != bounds.size() / 2) {
+        in.fail();
+    }
+    blockedRanges.clear();
+    for (size_t i = 0; i + 1 < bounds.size(); i += 2) {
+        blockedRanges.emplace_back(bounds[i], bounds[i + 1]);
+    }
+    return in.ok();
+}
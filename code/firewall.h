@@ -4,13 +4,17 @@
  *
  * This header defines a simple firewall that supports blocking inclusive IPv4
  * address ranges. Incoming requests can be checked against the configured
- * blocked ranges.
+ * blocked ranges. Ranges are permanent unless added with block_until(),
+ * which lets them lapse once expire() passes their expiry cycle.
  */
 
 #ifndef FIREWALL_H
 #define FIREWALL_H
 
+#include "checkpoint.h"
 #include "request.h"
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <utility>
@@ -41,6 +45,17 @@ public:
      */
     unsigned int ip_to_int(const std::string& ip) const;
 
+    /**
+     * @brief Converts an unsigned integer back into a dotted-quad IPv4 string.
+     *
+     * This is the inverse of ip_to_int() and is used when addresses arrive in
+     * packed form (for example from the network front end).
+     *
+     * @param ip Integer representation of the IPv4 address.
+     * @return IPv4 address as a string in dotted-quad form.
+     */
+    std::string int_to_ip(unsigned int ip) const;
+
     /**
      * @brief Determines whether an incoming request should be blocked.
      *
@@ -64,6 +79,83 @@ public:
      */
     void blockRange(const std::string& start_ip, const std::string& end_ip);
 
+    /**
+     * @brief Blocks an inclusive address range until a given cycle.
+     *
+     * Blocking a range that is already blocked until an earlier cycle
+     * extends that block instead of adding a second one.
+     *
+     * @param start First blocked address in integer form.
+     * @param end Last blocked address in integer form.
+     * @param expires Cycle from which the range is no longer blocked.
+     */
+    void block_until(uint32_t start, uint32_t end, int expires);
+
+    /**
+     * @brief Drops the ranges whose block has expired.
+     *
+     * @param now Current cycle.
+     * @return Number of ranges dropped.
+     */
+    size_t expire(int now);
+
+    /**
+     * @brief Returns the number of blocked ranges.
+     *
+     * @return Permanent and temporary ranges.
+     */
+    size_t get_range_count() const;
+
+    /**
+     * @brief Classifies a batch of packed IPv4 addresses against the blocked ranges.
+     *
+     * Each address is tested against every blocked range (inclusive) and the
+     * result is written as a bitmask: bit (i % 8) of verdicts[i / 8] is set when
+     * ips[i] is blocked and cleared when it may pass. The caller must provide
+     * at least (n + 7) / 8 bytes of output.
+     *
+     * The comparison kernel (AVX2, SSE2 or portable scalar) is selected once at
+     * runtime based on the features supported by the CPU.
+     *
+     * @param ips Addresses in the integer form produced by ip_to_int().
+     * @param n Number of addresses in ips.
+     * @param verdicts Output bitmask of blocked verdicts.
+     */
+    void classify_batch(const uint32_t* ips, size_t n, uint8_t* verdicts) const;
+
+    /**
+     * @brief Tests a single verdict bit produced by classify_batch().
+     *
+     * @param verdicts Bitmask written by classify_batch().
+     * @param i Index of the address in the classified batch.
+     * @return true if address i was blocked, false otherwise.
+     */
+    static bool is_blocked_verdict(const uint8_t* verdicts, size_t i) {
+        return (verdicts[i >> 3] >> (i & 7)) & 1u;
+    }
+
+    /**
+     * @brief Returns the name of the batch kernel selected for this CPU.
+     *
+     * @return "avx2", "sse2" or "scalar".
+     */
+    static const char* batch_kernel_name();
+
+    /**
+     * @brief Writes the blocked ranges and their expiries to a checkpoint.
+     *
+     * @param out Checkpoint being written.
+     */
+    void save(CheckpointWriter& out) const;
+
+    /**
+     * @brief Replaces the blocked ranges with checkpointed ones.
+     *
+     * @param in Checkpoint being read.
+     * @return false if the section is malformed.
+     */
+    bool restore(CheckpointReader& in);
+
 private:
     /**
      * @brief Collection of blocked IPv4 ranges.
@@ -71,6 +163,16 @@ private:
      * Each entry stores (start, end) as integer-converted IPv4 addresses.
      */
     std::vector<std::pair<unsigned int, unsigned int>> blockedRanges;
+
+    /**
+     * @brief Cycle from which each range is no longer blocked (PERMANENT for blockRange()).
+     */
+    std::vector<int> expiries;
+
+    /**
+     * @brief Expiry of ranges that never lapse.
+     */
+    static constexpr int PERMANENT = 0x7FFFFFFF;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,434 @@
+/**
+ * @file heavy_hitters.cpp
+ * @brief Implements the HeavyHitterDetector.
+ *
+ * This file contains the sliding-window Count-Min sketch, the space-saving
+ * heap of top talkers and its hash index.
+ */
+
+#include "heavy_hitters.h"
+#include <algorithm>
+
+namespace {
+
+/**
+ * @brief Mixes a 64-bit key into a well-distributed hash (splitmix64 finalizer).
+ */
+uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief Returns the smallest power of two that is >= value.
+ */
+size_t next_pow2(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+/**
+ * @brief Tag of /24 prefix keys; source keys are the bare address.
+ */
+const uint64_t PREFIX_KEY = 1ull << 32;
+
+/**
+ * @brief Mask of the network part of a /24.
+ */
+const uint32_t PREFIX_MASK = 0xFFFFFF00u;
+
+} // namespace
+
+/**
+ * @brief Constructs a detector and preallocates its sketch, heap and index.
+ *
+ * The index is sized to at least twice the heap capacity to keep probe
+ * sequences short. A prefix share of 0 becomes twice the source share, so
+ * a lone source only takes its /24 with it when it is twice as heavy as
+ * the source threshold.
+ *
+ * @param settings Thresholds and sizes.
+ */
+HeavyHitterDetector::HeavyHitterDetector(const HeavyHitterSettings& settings)
+    : settings(settings), pane_totals(PANES, 0), current(0), pane_end(0), pane_cycles(1) {
+    if (this->settings.prefix_share <= 0.0) {
+        this->settings.prefix_share = 2.0 * this->settings.share;
+    }
+    this->settings.capacity = std::max<size_t>(this->settings.capacity, 1);
+    size_t width = next_pow2(std::max<size_t>(this->settings.width, 16));
+    column_mask = width - 1;
+    counters.assign(PANES * ROWS * width, 0);
+    pane_cycles = std::max(this->settings.window / static_cast<int>(PANES), 1);
+    pane_end = pane_cycles;
+    keys.assign(this->settings.capacity, 0);
+    blocked_until.assign(this->settings.capacity, 0);
+    for (size_t slot = this->settings.capacity; slot-- > 0;) {
+        free_slots.push_back(static_cast<uint32_t>(slot));
+        heap.set(slot, 0);
+    }
+    heap.clear(); // keeps the heap's storage for every slot
+    index.assign(next_pow2(2 * this->settings.capacity), NONE);
+    index_mask = index.size() - 1;
+}
+
+/**
+ * @brief Slides the window up to a cycle.
+ *
+ * Each pane that ended hands its place to a cleared one. The tracked keys'
+ * estimates only fall when a pane is cleared, so that is when the heap is
+ * refreshed; keys whose estimate reaches zero stop being tracked.
+ *
+ * @param now Current clock cycle.
+ */
+void HeavyHitterDetector::advance(int now) {
+    if (now < pane_end) {
+        return;
+    }
+    size_t width = column_mask + 1;
+    size_t rotations = 0;
+    while (now >= pane_end && rotations < PANES) {
+        current = (current + 1) % PANES;
+        std::fill(counters.begin() + current * ROWS * width, counters.begin() + (current + 1) * ROWS * width, 0u);
+        pane_totals[current] = 0;
+        pane_end += pane_cycles;
+        rotations++;
+    }
+    if (now >= pane_end) {
+        // the whole window went by without a request: start a fresh one
+        pane_end = now + pane_cycles;
+    }
+    for (size_t slot = 0; slot < keys.size(); ++slot) {
+        if (!heap.contains(slot)) {
+            continue;
+        }
+        uint32_t value = estimate(keys[slot]);
+        if (value == 0 && now >= blocked_until[slot]) {
+            heap.remove(slot);
+            index_erase(keys[slot]);
+            free_slots.push_back(static_cast<uint32_t>(slot));
+        } else {
+            heap.set(slot, rank(value, slot));
+        }
+    }
+}
+
+/**
+ * @brief Counts one request from a source address.
+ *
+ * The source is checked against the source share and its /24 against the
+ * prefix share, both as shares of the requests in the window. Nothing is
+ * reported before the window holds min_requests, and a key is not reported
+ * again while the block from its last report lasts.
+ *
+ * @param ip Source address in integer form.
+ * @param now Current clock cycle.
+ * @param promoted Receives the source and/or /24 that just crossed their threshold (appended).
+ * @return Number of entries appended.
+ */
+size_t HeavyHitterDetector::add(uint32_t ip, int now, std::vector<HeavyHitter>& promoted) {
+    pane_totals[current]++;
+    long long total = window_total();
+    size_t before = promoted.size();
+    observe(ip, settings.share, total, now, promoted);
+    observe(PREFIX_KEY | (ip & PREFIX_MASK), settings.prefix_share, total, now, promoted);
+    return promoted.size() - before;
+}
+
+/**
+ * @brief Returns the tracked keys with the largest estimates.
+ *
+ * @param count Largest number of entries returned.
+ * @return Top talkers, largest estimate first.
+ */
+std::vector<HeavyHitter> HeavyHitterDetector::top(size_t count) const {
+    std::vector<HeavyHitter> talkers;
+    long long total = window_total();
+    for (size_t slot = 0; slot < keys.size(); ++slot) {
+        if (heap.contains(slot)) {
+            talkers.push_back(describe(keys[slot], estimate(keys[slot]), total));
+        }
+    }
+    std::sort(talkers.begin(), talkers.end(),
+              [](const HeavyHitter& a, const HeavyHitter& b) {
+                  if (a.estimate != b.estimate) {
+                      return a.estimate > b.estimate;
+                  }
+                  return a.first != b.first ? a.first < b.first : a.last < b.last;
+              });
+    if (talkers.size() > count) {
+        talkers.resize(count);
+    }
+    return talkers;
+}
+
+/**
+ * @brief Returns the requests counted in the current window.
+ *
+ * @return Sum of the pane totals.
+ */
+long long HeavyHitterDetector::window_total() const {
+    long long total = 0;
+    for (long long pane : pane_totals) {
+        total += pane;
+    }
+    return total;
+}
+
+/**
+ * @brief Returns the bytes of the sketch, heap and index.
+ *
+ * @return Memory held by the detector, fixed at construction.
+ */
+size_t HeavyHitterDetector::memory_bytes() const {
+    return counters.size() * sizeof(uint32_t) + keys.size() * (sizeof(uint64_t) + sizeof(int) + sizeof(uint32_t)) +
+           index.size() * sizeof(uint32_t) + settings.capacity * (sizeof(int64_t) + 2 * sizeof(size_t));
+}
+
+/**
+ * @brief Counts a key in the current pane and returns its window estimate.
+ *
+ * @param key Source or prefix key.
+ * @return Smallest row sum over the panes, including this request.
+ */
+uint32_t HeavyHitterDetector::count(uint64_t key) {
+    size_t width = column_mask + 1;
+    uint32_t smallest = 0xFFFFFFFFu;
+    for (size_t row = 0; row < ROWS; ++row) {
+        size_t column = mix(key + row * 0xD6E8FEB86659FD93ull) & column_mask;
+        counters[(current * ROWS + row) * width + column]++;
+        uint32_t sum = 0;
+        for (size_t pane = 0; pane < PANES; ++pane) {
+            sum += counters[(pane * ROWS + row) * width + column];
+        }
+        smallest = std::min(smallest, sum);
+    }
+    return smallest;
+}
+
+/**
+ * @brief Returns a key's window estimate without counting it.
+ *
+ * @param key Source or prefix key.
+ * @return Smallest row sum over the panes.
+ */
+uint32_t HeavyHitterDetector::estimate(uint64_t key) const {
+    size_t width = column_mask + 1;
+    uint32_t smallest = 0xFFFFFFFFu;
+    for (size_t row = 0; row < ROWS; ++row) {
+        size_t column = mix(key + row * 0xD6E8FEB86659FD93ull) & column_mask;
+        uint32_t sum = 0;
+        for (size_t pane = 0; pane < PANES; ++pane) {
+            sum += counters[(pane * ROWS + row) * width + column];
+        }
+        smallest = std::min(smallest, sum);
+    }
+    return smallest;
+}
+
+/**
+ * @brief Updates or admits a key in the space-saving heap.
+ *
+ * A tracked key takes its new estimate. An untracked key takes a free slot,
+ * or replaces the smallest tracked key if its estimate is larger.
+ *
+ * @param key Source or prefix key.
+ * @param estimate Window estimate of the key.
+ * @return Slot of the key, or NONE if it is not tracked.
+ */
+uint32_t HeavyHitterDetector::track(uint64_t key, uint32_t estimate) {
+    uint32_t slot = find(key);
+    if (slot != NONE) {
+        heap.set(slot, rank(estimate, slot));
+        return slot;
+    }
+    if (free_slots.empty()) {
+        if (static_cast<uint32_t>(heap.top_key() >> 32) >= estimate) {
+            return NONE;
+        }
+        uint32_t victim = static_cast<uint32_t>(heap.top());
+        heap.remove(victim);
+        index_erase(keys[victim]);
+        free_slots.push_back(victim);
+    }
+    slot = free_slots.back();
+    free_slots.pop_back();
+    keys[slot] = key;
+    blocked_until[slot] = 0;
+    index_insert(key, slot);
+    heap.set(slot, rank(estimate, slot));
+    return slot;
+}
+
+/**
+ * @brief Returns the heap key of a slot: its estimate, ties broken by slot.
+ *
+ * A unique key makes the evicted slot independent of the heap's layout, so a
+ * restored detector evicts the same keys as the one that was saved.
+ *
+ * @param estimate Window estimate of the slot's key.
+ * @param slot Heap slot.
+ * @return Estimate in the high word, slot in the low word.
+ */
+int64_t HeavyHitterDetector::rank(uint32_t estimate, size_t slot) {
+    return static_cast<int64_t>(static_cast<uint64_t>(estimate) << 32 | slot);
+}
+
+/**
+ * @brief Counts a key and reports it if it crossed share of the window.
+ *
+ * @param key Source or prefix key.
+ * @param share Threshold as a share of the window's requests.
+ * @param total Requests in the window.
+ * @param now Current clock cycle.
+ * @param promoted Receives the key's range if it is reported.
+ */
+void HeavyHitterDetector::observe(uint64_t key, double share, long long total, int now,
+                                  std::vector<HeavyHitter>& promoted) {
+    uint32_t value = count(key);
+    uint32_t slot = track(key, value);
+    if (slot == NONE || total < settings.min_requests || value <= share * static_cast<double>(total) ||
+        now < blocked_until[slot]) {
+        return;
+    }
+    blocked_until[slot] = now + settings.block_cycles;
+    promoted.push_back(describe(key, value, total));
+}
+
+/**
+ * @brief Finds the slot tracking key by linear probing.
+ *
+ * @param key Source or prefix key.
+ * @return Heap slot, or NONE if the key is not tracked.
+ */
+uint32_t HeavyHitterDetector::find(uint64_t key) const {
+    for (size_t i = mix(key) & index_mask; index[i] != NONE; i = (i + 1) & index_mask) {
+        if (keys[index[i]] == key) {
+            return index[i];
+        }
+    }
+    return NONE;
+}
+
+/**
+ * @brief Adds key -> slot to the hash index.
+ *
+ * @param key Source or prefix key.
+ * @param slot Heap slot tracking the key.
+ */
+void HeavyHitterDetector::index_insert(uint64_t key, uint32_t slot) {
+    size_t i = mix(key) & index_mask;
+    while (index[i] != NONE) {
+        i = (i + 1) & index_mask;
+    }
+    index[i] = slot;
+}
+
+/**
+ * @brief Removes key from the hash index.
+ *
+ * Uses backward-shift deletion, as ResponseCache does, so no tombstones
+ * build up while keys come and go.
+ *
+ * @param key Source or prefix key to remove.
+ */
+void HeavyHitterDetector::index_erase(uint64_t key) {
+    size_t hole = mix(key) & index_mask;
+    while (index[hole] != NONE && keys[index[hole]] != key) {
+        hole = (hole + 1) & index_mask;
+    }
+    if (index[hole] == NONE) {
+        return;
+    }
+    index[hole] = NONE;
+    for (size_t j = (hole + 1) & index_mask; index[j] != NONE; j = (j + 1) & index_mask) {
+        size_t home = mix(keys[index[j]]) & index_mask;
+        bool stays = (hole < j) ? (home > hole && home <= j) : (home > hole || home <= j);
+        if (!stays) {
+            index[hole] = index[j];
+            index[j] = NONE;
+            hole = j;
+        }
+    }
+}
+
+/**
+ * @brief Converts a tracked key into the address range it stands for.
+ *
+ * @param key Source or prefix key.
+ * @param estimate Window estimate of the key.
+ * @param total Requests in the window.
+ * @return The range with its estimate.
+ */
+HeavyHitter HeavyHitterDetector::describe(uint64_t key, uint32_t estimate, long long total) {
+    HeavyHitter hitter;
+    hitter.first = static_cast<uint32_t>(key);
+    hitter.last = (key & PREFIX_KEY) ? hitter.first | ~PREFIX_MASK : hitter.first;
+    hitter.estimate = estimate;
+    hitter.window_total = total;
+    return hitter;
+}
+
+/**
+ * @brief Writes the sketch, window position and tracked keys to a checkpoint.
+ *
+ * The heap and index follow from the tracked keys and are rebuilt on restore;
+ * the free slots are written in order so that new keys take the same slots.
+ *
+ * @param out Checkpoint being written.
+ */
+void HeavyHitterDetector::save(CheckpointWriter& out) const {
+    out.write_vector(counters);
+    out.write_vector(pane_totals);
+    out.write(current);
+    out.write(pane_end);
+    out.write_vector(keys);
+    out.write_vector(blocked_until);
+    out.write_vector(free_slots);
+}
+
+/**
+ * @brief Replaces the detector state with a checkpointed one.
+ *
+ * @param in Checkpoint being read.
+ * @return false if the section is malformed or was written with other sizes.
+ */
+bool HeavyHitterDetector::restore(CheckpointReader& in) {
+    size_t counter_count = counters.size();
+    size_t capacity = keys.size();
+    in.read_vector(counters);
+    in.read_vector(pane_totals);
+    in.read(current);
+    in.read(pane_end);
+    in.read_vector(keys);
+    in.read_vector(blocked_until);
+    in.read_vector(free_slots);
+    std::vector<uint8_t> tracked(capacity, 1);
+    for (uint32_t slot : free_slots) {
+        if (slot >= capacity || !tracked[slot]) {
+            in.fail();
+            break;
+        }
+        tracked[slot] = 0;
+    }
+    if (counters.size() != counter_count || pane_totals.size() != PANES || current >= PANES || keys.size() != capacity ||
+        blocked_until.size() != capacity) {
+        in.fail();
+    }
+    if (!in.ok()) {
+        return false;
+    }
+    heap.clear();
+    std::fill(index.begin(), index.end(), NONE);
+    for (size_t slot = 0; slot < capacity; ++slot) {
+        if (tracked[slot]) {
+            index_insert(keys[slot], static_cast<uint32_t>(slot));
+            heap.set(slot, rank(estimate(keys[slot]), slot));
+        }
+    }
+    return true;
+}
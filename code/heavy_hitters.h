@@ -0,0 +1,251 @@
+/**
+ * @file heavy_hitters.h
+ * @brief Declares the HeavyHitterDetector that finds top-talking sources and /24 prefixes.
+ *
+ * Every request's source address is counted in a sliding-window Count-Min
+ * sketch, once as the address and once as its /24 prefix. A space-saving
+ * min-heap keeps the keys with the largest estimates; a key whose share of
+ * the window's traffic crosses the threshold is reported so the caller can
+ * block it for a while. Memory is fixed at construction and does not grow
+ * with the number of distinct sources.
+ */
+
+#ifndef HEAVY_HITTERS_H
+#define HEAVY_HITTERS_H
+
+#include "checkpoint.h"
+#include "indexed_heap.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Thresholds and sizes of heavy-hitter detection.
+ */
+struct HeavyHitterSettings {
+    double share = 0.0;          ///< Share of the window's requests above which a source is blocked (0 = off).
+    double prefix_share = 0.0;   ///< Share above which a /24 is blocked (0 = twice the source share).
+    int window = 200;            ///< Cycles covered by the sliding window.
+    int block_cycles = 500;      ///< Cycles an automatic block lasts.
+    long long min_requests = 500; ///< Requests the window must hold before anything is blocked.
+    size_t width = 4096;         ///< Counters per sketch row (rounded up to a power of two).
+    size_t capacity = 64;        ///< Keys tracked by the space-saving heap.
+
+    /**
+     * @brief Returns whether detection is on.
+     */
+    bool enabled() const { return share > 0.0; }
+};
+
+/**
+ * @brief A source or /24 prefix that crossed its threshold, or a tracked top talker.
+ */
+struct HeavyHitter {
+    uint32_t first = 0;            ///< First address of the range.
+    uint32_t last = 0;             ///< Last address of the range (first for a single source).
+    uint32_t estimate = 0;         ///< Estimated requests in the window.
+    long long window_total = 0;    ///< Requests in the window when it was reported.
+};
+
+/**
+ * @class HeavyHitterDetector
+ * @brief Sliding-window Count-Min sketch plus a space-saving heap of top talkers.
+ *
+ * The window is split into PANES panes with one sketch each; the oldest pane
+ * is cleared when the window slides, and a key's estimate is the smallest
+ * row sum over the panes. All storage is allocated in the constructor.
+ */
+class HeavyHitterDetector {
+public:
+
+    /**
+     * @brief Constructs a detector and preallocates its sketch, heap and index.
+     *
+     * @param settings Thresholds and sizes.
+     */
+    explicit HeavyHitterDetector(const HeavyHitterSettings& settings);
+
+    /**
+     * @brief Slides the window up to a cycle.
+     *
+     * Clears every pane that ended and refreshes the heap's estimates.
+     *
+     * @param now Current clock cycle.
+     */
+    void advance(int now);
+
+    /**
+     * @brief Counts one request from a source address.
+     *
+     * @param ip Source address in integer form.
+     * @param now Current clock cycle.
+     * @param promoted Receives the source and/or /24 that just crossed their
+     *        threshold and are not blocked already (appended).
+     * @return Number of entries appended.
+     */
+    size_t add(uint32_t ip, int now, std::vector<HeavyHitter>& promoted);
+
+    /**
+     * @brief Returns the tracked keys with the largest estimates.
+     *
+     * @param count Largest number of entries returned.
+     * @return Top talkers, largest estimate first.
+     */
+    std::vector<HeavyHitter> top(size_t count) const;
+
+    /**
+     * @brief Returns the requests counted in the current window.
+     */
+    long long window_total() const;
+
+    /**
+     * @brief Returns the bytes of the sketch, heap and index.
+     */
+    size_t memory_bytes() const;
+
+    /**
+     * @brief Writes the sketch, window position and tracked keys to a checkpoint.
+     *
+     * @param out Checkpoint being written.
+     */
+    void save(CheckpointWriter& out) const;
+
+    /**
+     * @brief Replaces the detector state with a checkpointed one.
+     *
+     * @param in Checkpoint being read.
+     * @return false if the section is malformed or was written with other sizes.
+     */
+    bool restore(CheckpointReader& in);
+
+    /**
+     * @brief Sliding-window panes, each with its own sketch.
+     */
+    static constexpr size_t PANES = 4;
+
+    /**
+     * @brief Hash rows per sketch.
+     */
+    static constexpr size_t ROWS = 4;
+
+private:
+
+    /**
+     * @brief Marks an empty index bucket.
+     */
+    static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+    /**
+     * @brief Counts a key in the current pane and returns its window estimate.
+     */
+    uint32_t count(uint64_t key);
+
+    /**
+     * @brief Returns a key's window estimate without counting it.
+     */
+    uint32_t estimate(uint64_t key) const;
+
+    /**
+     * @brief Updates or admits a key in the space-saving heap.
+     *
+     * @return Slot of the key, or NONE if its estimate does not beat the smallest tracked one.
+     */
+    uint32_t track(uint64_t key, uint32_t estimate);
+
+    /**
+     * @brief Returns the heap key of a slot: its estimate, ties broken by slot.
+     */
+    static int64_t rank(uint32_t estimate, size_t slot);
+
+    /**
+     * @brief Counts a key and reports it if it crossed share of the window.
+     */
+    void observe(uint64_t key, double share, long long total, int now, std::vector<HeavyHitter>& promoted);
+
+    /**
+     * @brief Finds the slot tracking key by linear probing (NONE if untracked).
+     */
+    uint32_t find(uint64_t key) const;
+
+    /**
+     * @brief Adds key -> slot to the hash index.
+     */
+    void index_insert(uint64_t key, uint32_t slot);
+
+    /**
+     * @brief Removes key from the hash index (backward-shift deletion).
+     */
+    void index_erase(uint64_t key);
+
+    /**
+     * @brief Converts a tracked key into the address range it stands for.
+     */
+    static HeavyHitter describe(uint64_t key, uint32_t estimate, long long total);
+
+    /**
+     * @brief Thresholds and sizes.
+     */
+    HeavyHitterSettings settings;
+
+    /**
+     * @brief Counters as [pane][row][column].
+     */
+    std::vector<uint32_t> counters;
+
+    /**
+     * @brief Column mask of a sketch row.
+     */
+    size_t column_mask;
+
+    /**
+     * @brief Requests counted in each pane.
+     */
+    std::vector<long long> pane_totals;
+
+    /**
+     * @brief Pane being counted.
+     */
+    size_t current;
+
+    /**
+     * @brief Cycle at which the current pane ends.
+     */
+    int pane_end;
+
+    /**
+     * @brief Cycles per pane.
+     */
+    int pane_cycles;
+
+    /**
+     * @brief Key tracked in each heap slot.
+     */
+    std::vector<uint64_t> keys;
+
+    /**
+     * @brief Cycle until which each tracked key is blocked (no new report before then).
+     */
+    std::vector<int> blocked_until;
+
+    /**
+     * @brief Heap slots not tracking a key.
+     */
+    std::vector<uint32_t> free_slots;
+
+    /**
+     * @brief Tracked slots ordered by estimate, smallest on top.
+     */
+    IndexedHeap heap;
+
+    /**
+     * @brief Open-addressing index from key to heap slot.
+     */
+    std::vector<uint32_t> index;
+
+    /**
+     * @brief Bucket mask of index.
+     */
+    size_t index_mask;
+};
+
+#endif
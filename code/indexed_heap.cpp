@@ -0,0 +1,181 @@
+/**
+ * @file indexed_heap.cpp
+ * @brief Implements the IndexedHeap class.
+ */
+
+#include "indexed_heap.h"
+
+/**
+ * @brief Constructs an empty heap.
+ */
+IndexedHeap::IndexedHeap() = default;
+
+/**
+ * @brief Inserts an id or changes its key if already present.
+ *
+ * @param id Element id.
+ * @param key New key.
+ */
+void IndexedHeap::set(size_t id, int64_t key) {
+    if (id >= positions.size()) {
+        positions.resize(id + 1, NOT_IN_HEAP);
+    }
+    size_t position = positions[id];
+    if (position == NOT_IN_HEAP) {
+        entries.push_back({key, id});
+        positions[id] = entries.size() - 1;
+        sift_up(entries.size() - 1);
+        return;
+    }
+    int64_t old_key = entries[position].key;
+    entries[position].key = key;
+    if (key < old_key) {
+        sift_up(position);
+    } else if (key > old_key) {
+        sift_down(position);
+    }
+}
+
+/**
+ * @brief Removes an id (no effect if absent).
+ *
+ * The last entry takes the removed entry's place and is sifted whichever
+ * way restores the heap order.
+ *
+ * @param id Element id.
+ */
+void IndexedHeap::remove(size_t id) {
+    if (!contains(id)) {
+        return;
+    }
+    size_t position = positions[id];
+    positions[id] = NOT_IN_HEAP;
+    Entry last = entries.back();
+    entries.pop_back();
+    if (position == entries.size()) {
+        return;
+    }
+    place(position, last);
+    sift_up(position);
+    sift_down(positions[last.id]);
+}
+
+/**
+ * @brief Checks whether an id is in the heap.
+ *
+ * @param id Element id.
+ * @return true if present.
+ */
+bool IndexedHeap::contains(size_t id) const {
+    return id < positions.size() && positions[id] != NOT_IN_HEAP;
+}
+
+/**
+ * @brief Returns the id with the smallest key.
+ *
+ * @return Id at the top.
+ */
+size_t IndexedHeap::top() const {
+    return entries.front().id;
+}
+
+/**
+ * @brief Returns the smallest key.
+ *
+ * @return Key at the top.
+ */
+int64_t IndexedHeap::top_key() const {
+    return entries.front().key;
+}
+
+/**
+ * @brief Returns the key of an id in the heap.
+ *
+ * @param id Element id.
+ * @return The id's key.
+ */
+int64_t IndexedHeap::key(size_t id) const {
+    return entries[positions[id]].key;
+}
+
+/**
+ * @brief Checks whether the heap is empty.
+ *
+ * @return true if there are no elements.
+ */
+bool IndexedHeap::empty() const {
+    return entries.empty();
+}
+
+/**
+ * @brief Returns the number of elements.
+ *
+ * @return Element count.
+ */
+size_t IndexedHeap::size() const {
+    return entries.size();
+}
+
+/**
+ * @brief Removes every element.
+ */
+void IndexedHeap::clear() {
+    for (const Entry& entry : entries) {
+        positions[entry.id] = NOT_IN_HEAP;
+    }
+    entries.clear();
+}
+
+/**
+ * @brief Moves the entry at a position up until the heap order holds.
+ *
+ * @param position Heap position.
+ */
+void IndexedHeap::sift_up(size_t position) {
+    Entry entry = entries[position];
+    while (position > 0) {
+        size_t parent = (position - 1) / 2;
+        if (entries[parent].key <= entry.key) {
+            break;
+        }
+        place(position, entries[parent]);
+        position = parent;
+    }
+    place(position, entry);
+}
+
+/**
+ * @brief Moves the entry at a position down until the heap order holds.
+ *
+ * @param position Heap position.
+ */
+void IndexedHeap::sift_down(size_t position) {
+    Entry entry = entries[position];
+    size_t count = entries.size();
+    while (true) {
+        size_t child = 2 * position + 1;
+        if (child >= count) {
+            break;
+        }
+        if (child + 1 < count && entries[child + 1].key < entries[child].key) {
+            child++;
+        }
+        if (entries[child].key >= entry.key) {
+            break;
+        }
+        place(position, entries[child]);
+        position = child;
+    }
+    place(position, entry);
+}
+
+/**
+ * @brief Stores an entry at a position and updates the position index.
+ *
+ * @param position Heap position.
+ * @param entry Entry to store.
+ */
+void IndexedHeap::place(size_t position, const Entry& entry) {
+    entries[position] = entry;
+    positions[entry.id] = position;
+}
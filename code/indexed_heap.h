@@ -0,0 +1,134 @@
+/**
+ * @file indexed_heap.h
+ * @brief Declares IndexedHeap, a binary min-heap with O(log n) key updates.
+ *
+ * Every element is identified by a small integer id (for example a server
+ * table slot). A position index maps ids to heap positions, so the key of
+ * any element can be changed or the element removed without a search.
+ */
+
+#ifndef INDEXED_HEAP_H
+#define INDEXED_HEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class IndexedHeap
+ * @brief Min-heap of (id, key) pairs addressable by id.
+ */
+class IndexedHeap {
+public:
+
+    /**
+     * @brief Marker for ids that are not in the heap.
+     */
+    static constexpr size_t NOT_IN_HEAP = static_cast<size_t>(-1);
+
+    /**
+     * @brief Constructs an empty heap.
+     */
+    IndexedHeap();
+
+    /**
+     * @brief Inserts an id or changes its key if already present.
+     *
+     * @param id Element id.
+     * @param key New key.
+     */
+    void set(size_t id, int64_t key);
+
+    /**
+     * @brief Removes an id (no effect if absent).
+     *
+     * @param id Element id.
+     */
+    void remove(size_t id);
+
+    /**
+     * @brief Checks whether an id is in the heap.
+     *
+     * @param id Element id.
+     * @return true if present.
+     */
+    bool contains(size_t id) const;
+
+    /**
+     * @brief Returns the id with the smallest key.
+     *
+     * @return Id at the top; the heap must not be empty.
+     */
+    size_t top() const;
+
+    /**
+     * @brief Returns the smallest key.
+     *
+     * @return Key at the top; the heap must not be empty.
+     */
+    int64_t top_key() const;
+
+    /**
+     * @brief Returns the key of an id in the heap.
+     *
+     * @param id Element id (must be present).
+     * @return The id's key.
+     */
+    int64_t key(size_t id) const;
+
+    /**
+     * @brief Checks whether the heap is empty.
+     *
+     * @return true if there are no elements.
+     */
+    bool empty() const;
+
+    /**
+     * @brief Returns the number of elements.
+     *
+     * @return Element count.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Removes every element.
+     */
+    void clear();
+
+private:
+
+    /**
+     * @brief One heap element.
+     */
+    struct Entry {
+        int64_t key;  ///< Ordering key.
+        size_t id;    ///< Element id.
+    };
+
+    /**
+     * @brief Moves the entry at a position up until the heap order holds.
+     */
+    void sift_up(size_t position);
+
+    /**
+     * @brief Moves the entry at a position down until the heap order holds.
+     */
+    void sift_down(size_t position);
+
+    /**
+     * @brief Stores an entry at a position and updates the position index.
+     */
+    void place(size_t position, const Entry& entry);
+
+    /**
+     * @brief Heap-ordered entries.
+     */
+    std::vector<Entry> entries;
+
+    /**
+     * @brief Heap position of each id, NOT_IN_HEAP if absent.
+     */
+    std::vector<size_t> positions;
+};
+
+#endif
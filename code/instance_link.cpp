@@ -0,0 +1,112 @@
+/**
+ * @file instance_link.cpp
+ * @brief Implements the distributor-to-instance channel of a topology.
+ */
+
+#include "instance_link.h"
+#include <thread>
+#include <utility>
+
+/**
+ * @brief Constructs an open link.
+ *
+ * @param max_lag Batches the distributor may have outstanding before send() waits.
+ */
+InstanceLink::InstanceLink(size_t max_lag)
+    : max_lag(max_lag > 0 ? max_lag : 1), closed(false), load(0), report_cycle(-1), version(0) {}
+
+/**
+ * @brief Sends the next cycle's batch, waiting while max_lag batches are outstanding.
+ *
+ * @param batch Arrivals for the cycle; replaced by an empty recycled vector.
+ */
+void InstanceLink::send(std::vector<Arrival>& batch) {
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait(guard, [this] { return pending.size() < max_lag; });
+    pending.push_back(std::move(batch));
+    batch.clear();
+    if (!recycled.empty()) {
+        batch.swap(recycled.back());
+        recycled.pop_back();
+    }
+    changed.notify_all();
+}
+
+/**
+ * @brief Tells the instance that no more batches follow.
+ */
+void InstanceLink::close() {
+    std::lock_guard<std::mutex> guard(lock);
+    closed = true;
+    changed.notify_all();
+}
+
+/**
+ * @brief Takes the next cycle's batch, waiting for the distributor if needed.
+ *
+ * @param batch Receives the arrivals; its previous storage is recycled.
+ * @return false (with batch empty) if the link was closed and drained.
+ */
+bool InstanceLink::take(std::vector<Arrival>& batch) {
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait(guard, [this] { return !pending.empty() || closed; });
+    batch.clear();
+    if (batch.capacity() > 0) {
+        recycled.push_back(std::move(batch));
+        batch = std::vector<Arrival>();
+    }
+    if (pending.empty()) {
+        return false;
+    }
+    batch.swap(pending.front());
+    pending.pop_front();
+    changed.notify_all();
+    return true;
+}
+
+/**
+ * @brief Publishes the instance's load.
+ *
+ * The cycle and the load are written under a seqlock (the instance is the
+ * only writer), so a reader never pairs values from different reports.
+ *
+ * @param report Load at the end of a cycle.
+ */
+void InstanceLink::report(const LoadReport& report) {
+    uint32_t start = version.load(std::memory_order_relaxed);
+    version.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    load.store(static_cast<uint64_t>(static_cast<uint32_t>(report.queued)) << 32 | static_cast<uint32_t>(report.servers),
+               std::memory_order_relaxed);
+    report_cycle.store(report.cycle, std::memory_order_relaxed);
+    version.store(start + 2, std::memory_order_release);
+}
+
+/**
+ * @brief Returns the last published load without waiting.
+ *
+ * Reads again if report() was writing meanwhile; the writer holds the
+ * seqlock for three stores only.
+ *
+ * @return Last report (cycle -1 if the instance has not reported yet).
+ */
+LoadReport InstanceLink::latest() const {
+    LoadReport report;
+    uint64_t packed = 0;
+    while (true) {
+        uint32_t before = version.load(std::memory_order_acquire);
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        packed = load.load(std::memory_order_relaxed);
+        report.cycle = report_cycle.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (version.load(std::memory_order_relaxed) == before) {
+            break;
+        }
+    }
+    report.queued = static_cast<int>(packed >> 32);
+    report.servers = static_cast<int>(packed & 0xFFFFFFFFu);
+    return report;
+}
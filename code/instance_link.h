@@ -0,0 +1,140 @@
+/**
+ * @file instance_link.h
+ * @brief Declares the channel between a topology's front distributor and one balancer instance.
+ *
+ * The distributor sends each instance one batch of arrivals per clock cycle
+ * and may run up to max_lag cycles ahead of it. In the other direction the
+ * instance publishes load reports (its queued requests and servers) that
+ * the distributor reads whenever it likes, without waiting; a report is
+ * therefore as old as the report interval plus the instance's lag.
+ */
+
+#ifndef INSTANCE_LINK_H
+#define INSTANCE_LINK_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief A request handed from the distributor to an instance.
+ */
+struct Arrival {
+    uint32_t ip_in;        ///< Source IPv4 address in integer form.
+    uint32_t ip_out;       ///< Destination IPv4 address in integer form.
+    int time_to_process;   ///< Processing time in clock cycles.
+    char request_type;     ///< Request type, which selects the instance's pool.
+    bool is_long;          ///< Drawn from the long streaming range.
+};
+
+/**
+ * @brief Load an instance last published.
+ */
+struct LoadReport {
+    int cycle = -1;   ///< Instance clock cycle of the report (-1 = none yet).
+    int queued = 0;   ///< Queued requests over all pools.
+    int servers = 0;  ///< Servers over all pools.
+};
+
+/**
+ * @class InstanceLink
+ * @brief Per-cycle arrival batches in one direction and load reports in the other.
+ */
+class InstanceLink {
+public:
+
+    /**
+     * @brief Constructs an open link.
+     *
+     * @param max_lag Batches the distributor may have outstanding before send() waits.
+     */
+    explicit InstanceLink(size_t max_lag);
+
+    InstanceLink(const InstanceLink&) = delete;
+    InstanceLink& operator=(const InstanceLink&) = delete;
+
+    /**
+     * @brief Sends the next cycle's batch, waiting while max_lag batches are outstanding.
+     *
+     * @param batch Arrivals for the cycle; replaced by an empty recycled vector.
+     */
+    void send(std::vector<Arrival>& batch);
+
+    /**
+     * @brief Tells the instance that no more batches follow.
+     */
+    void close();
+
+    /**
+     * @brief Takes the next cycle's batch, waiting for the distributor if needed.
+     *
+     * @param batch Receives the arrivals; its previous storage is recycled.
+     * @return false (with batch empty) if the link was closed and drained.
+     */
+    bool take(std::vector<Arrival>& batch);
+
+    /**
+     * @brief Publishes the instance's load.
+     *
+     * @param report Load at the end of a cycle.
+     */
+    void report(const LoadReport& report);
+
+    /**
+     * @brief Returns the last published load without waiting.
+     */
+    LoadReport latest() const;
+
+private:
+
+    /**
+     * @brief Guards pending, recycled and closed.
+     */
+    std::mutex lock;
+
+    /**
+     * @brief Signals a new batch to the instance and a taken one to the distributor.
+     */
+    std::condition_variable changed;
+
+    /**
+     * @brief Batches not taken yet, oldest first.
+     */
+    std::deque<std::vector<Arrival>> pending;
+
+    /**
+     * @brief Emptied batch vectors handed back to the distributor.
+     */
+    std::vector<std::vector<Arrival>> recycled;
+
+    /**
+     * @brief Outstanding batches at which send() waits.
+     */
+    size_t max_lag;
+
+    /**
+     * @brief Whether the distributor is done.
+     */
+    bool closed;
+
+    /**
+     * @brief Queued requests (high half) and servers (low half) of the last report.
+     */
+    std::atomic<uint64_t> load;
+
+    /**
+     * @brief Cycle of the last report.
+     */
+    std::atomic<int> report_cycle;
+
+    /**
+     * @brief Seqlock over load and report_cycle: odd while report() is writing them.
+     */
+    std::atomic<uint32_t> version;
+};
+
+#endif
@@ -0,0 +1,454 @@
+/**
+ * @file large_alloc.cpp
+ * @brief Implements the huge-page and NUMA-aware allocator for large buffers.
+ */
+
+#include "large_alloc.h"
+#include "alloc_counter.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * @brief A block mapped by large_allocate().
+ */
+struct Mapping {
+    void* address;              ///< Start of the mapping (and of the block).
+    size_t length;              ///< Bytes mapped.
+    MemoryComponent component;  ///< Component the bytes are charged to.
+};
+
+/**
+ * @brief A NUMA node and its CPUs.
+ */
+struct NumaNode {
+    int id;                     ///< Node number in /sys.
+    std::vector<int> cpus;      ///< CPUs of the node.
+};
+
+/**
+ * @brief Largest node number mbind() is told about.
+ */
+constexpr size_t MAX_NODES = 1024;
+
+/**
+ * @brief Page backing of new blocks.
+ */
+std::atomic<uint8_t> configured_mode(static_cast<uint8_t>(HugePages::TRANSPARENT));
+
+/**
+ * @brief Whether blocks are bound to their thread's home node.
+ */
+std::atomic<bool> numa_placement(false);
+
+/**
+ * @brief Index in numa_nodes() of the node the calling thread's blocks are bound to (-1 = first touch).
+ */
+thread_local int home = -1;
+
+/**
+ * @brief Counters reported by large_alloc_stats().
+ */
+std::atomic<long long> blocks(0);
+std::atomic<long long> live_blocks(0);
+std::atomic<long long> mapped_bytes(0);
+std::atomic<long long> peak_bytes(0);
+std::atomic<long long> explicit_blocks(0);
+std::atomic<long long> transparent_blocks(0);
+std::atomic<long long> fallbacks(0);
+std::atomic<long long> numa_blocks(0);
+
+/**
+ * @brief Live mappings, so large_free() knows their length and component.
+ */
+std::mutex mappings_lock;
+std::vector<Mapping> mappings;
+
+/**
+ * @brief Rounds value up to a multiple of a power of two.
+ */
+size_t round_up(size_t value, size_t multiple) {
+    return (value + multiple - 1) & ~(multiple - 1);
+}
+
+/**
+ * @brief Parses a /sys cpulist such as "0-3,8-11".
+ */
+std::vector<int> parse_cpulist(const std::string& text) {
+    std::vector<int> cpus;
+    std::stringstream stream(text);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        int first = 0, last = 0;
+        int fields = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+        if (fields < 1) {
+            continue;
+        }
+        if (fields == 1) {
+            last = first;
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+/**
+ * @brief Returns the nodes with CPUs, read once from /sys/devices/system/node.
+ */
+const std::vector<NumaNode>& numa_nodes() {
+    static const std::vector<NumaNode> nodes = [] {
+        std::vector<NumaNode> found;
+        DIR* directory = opendir("/sys/devices/system/node");
+        if (!directory) {
+            return found;
+        }
+        while (dirent* entry = readdir(directory)) {
+            int id = 0;
+            char extra = 0;
+            if (std::sscanf(entry->d_name, "node%d%c", &id, &extra) != 1 || id < 0 ||
+                static_cast<size_t>(id) >= MAX_NODES) {
+                continue;
+            }
+            std::ifstream list("/sys/devices/system/node/" + std::string(entry->d_name) + "/cpulist");
+            std::string text;
+            std::getline(list, text);
+            NumaNode node{id, parse_cpulist(text)};
+            if (!node.cpus.empty()) {
+                found.push_back(node);
+            }
+        }
+        closedir(directory);
+        std::sort(found.begin(), found.end(), [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+        return found;
+    }();
+    return nodes;
+}
+
+/**
+ * @brief Maps length bytes of anonymous memory with extra flags (nullptr on failure).
+ */
+void* map(size_t length, int flags) {
+    void* address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    return address == MAP_FAILED ? nullptr : address;
+}
+
+/**
+ * @brief Maps length bytes at a huge-page boundary (nullptr on failure).
+ *
+ * Maps one huge page more than needed and unmaps the unaligned ends.
+ */
+void* map_aligned(size_t length) {
+    char* raw = static_cast<char*>(map(length + HUGE_PAGE_BYTES, 0));
+    if (!raw) {
+        return nullptr;
+    }
+    char* aligned = reinterpret_cast<char*>(round_up(reinterpret_cast<uintptr_t>(raw), HUGE_PAGE_BYTES));
+    if (aligned > raw) {
+        munmap(raw, static_cast<size_t>(aligned - raw));
+    }
+    char* end = raw + length + HUGE_PAGE_BYTES;
+    if (end > aligned + length) {
+        munmap(aligned + length, static_cast<size_t>(end - (aligned + length)));
+    }
+    return aligned;
+}
+
+/**
+ * @brief Binds a fresh mapping to the calling thread's home node, before its first touch.
+ *
+ * @return true if the mapping was bound.
+ */
+bool bind_home(void* address, size_t length) {
+    if (!numa_placement.load(std::memory_order_relaxed) || home < 0 || numa_nodes().size() < 2) {
+        return false;
+    }
+    size_t id = static_cast<size_t>(numa_nodes()[static_cast<size_t>(home)].id);
+    unsigned long mask[MAX_NODES / (8 * sizeof(unsigned long))] = {};
+    mask[id / (8 * sizeof(unsigned long))] = 1UL << (id % (8 * sizeof(unsigned long)));
+    return syscall(SYS_mbind, address, length, MPOL_PREFERRED, mask, MAX_NODES + 1, 0) == 0;
+}
+
+/**
+ * @brief Raises the peak of mapped bytes to at least value.
+ */
+void raise_peak(long long value) {
+    long long seen = peak_bytes.load(std::memory_order_relaxed);
+    while (value > seen && !peak_bytes.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Sets the process-wide page backing and NUMA placement of later blocks.
+ *
+ * Blocks mapped earlier keep their backing.
+ *
+ * @param mode Page backing.
+ * @param numa true to bind blocks to the allocating thread's home node.
+ */
+void large_alloc_configure(HugePages mode, bool numa) {
+    configured_mode.store(static_cast<uint8_t>(mode), std::memory_order_relaxed);
+    numa_placement.store(numa, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the page backing of new blocks.
+ */
+HugePages large_alloc_mode() {
+    return static_cast<HugePages>(configured_mode.load(std::memory_order_relaxed));
+}
+
+/**
+ * @brief Returns whether NUMA placement is on.
+ */
+bool large_alloc_numa() {
+    return numa_placement.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Parses a --huge-pages value.
+ *
+ * @param text "off", "transparent" or "explicit".
+ * @param mode Receives the page backing.
+ * @return false if the text names no mode.
+ */
+bool parse_huge_pages(const std::string& text, HugePages& mode) {
+    for (HugePages candidate : {HugePages::OFF, HugePages::TRANSPARENT, HugePages::EXPLICIT}) {
+        if (text == huge_pages_name(candidate)) {
+            mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Returns the console name of a page backing.
+ */
+const char* huge_pages_name(HugePages mode) {
+    switch (mode) {
+        case HugePages::OFF: return "off";
+        case HugePages::TRANSPARENT: return "transparent";
+        case HugePages::EXPLICIT: return "explicit";
+    }
+    return "off";
+}
+
+/**
+ * @brief Allocates a block, mapping it with huge pages when it is large.
+ *
+ * Blocks below LARGE_BLOCK_BYTES come from operator new. Larger ones are
+ * mapped on their own. Blocks of at least HUGE_PAGE_BYTES come from the
+ * hugetlbfs pool in EXPLICIT mode, otherwise they are 2 MiB aligned and
+ * advised to use transparent huge pages. Blocks below HUGE_PAGE_BYTES, and
+ * all blocks when huge pages are off, are rounded to whole 4 KiB pages
+ * without advice, since a huge page would be up to eight times their size
+ * (and again on every doubling of a growing vector). The mapping is bound
+ * to the thread's home node before anything touches it, and its length is
+ * charged to the active MemoryComponent.
+ *
+ * @param bytes Size of the block.
+ * @return Block aligned to at least 16 bytes; throws std::bad_alloc when out of memory.
+ */
+void* large_allocate(size_t bytes) {
+    if (bytes < LARGE_BLOCK_BYTES) {
+        return ::operator new(bytes);
+    }
+    HugePages backing = bytes < HUGE_PAGE_BYTES ? HugePages::OFF : large_alloc_mode();
+    size_t length = round_up(bytes, HUGE_PAGE_BYTES);
+    void* address = nullptr;
+    if (backing == HugePages::EXPLICIT) {
+        address = map(length, MAP_HUGETLB);
+        if (address) {
+            explicit_blocks.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            // no reserved huge pages (or none left): use transparent ones
+            fallbacks.fetch_add(1, std::memory_order_relaxed);
+            backing = HugePages::TRANSPARENT;
+        }
+    }
+    if (!address && backing == HugePages::TRANSPARENT) {
+        address = map_aligned(length);
+        if (address) {
+            if (madvise(address, length, MADV_HUGEPAGE) == 0) {
+                transparent_blocks.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                fallbacks.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+    if (backing == HugePages::OFF) {
+        length = round_up(bytes, static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+        address = map(length, 0);
+    }
+    if (!address) {
+        throw std::bad_alloc();
+    }
+    if (bind_home(address, length)) {
+        numa_blocks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Mapping mapping{address, length, memory_active()};
+    {
+        MEMORY_SCOPE(MemoryComponent::OTHER);
+        std::lock_guard<std::mutex> guard(mappings_lock);
+        mappings.push_back(mapping);
+    }
+    memory_record(mapping.component, static_cast<long long>(length));
+    blocks.fetch_add(1, std::memory_order_relaxed);
+    live_blocks.fetch_add(1, std::memory_order_relaxed);
+    raise_peak(mapped_bytes.fetch_add(static_cast<long long>(length), std::memory_order_relaxed) +
+               static_cast<long long>(length));
+    return address;
+}
+
+/**
+ * @brief Releases a block from large_allocate().
+ *
+ * @param pointer Block (may be null).
+ * @param bytes Size it was allocated with.
+ */
+void large_free(void* pointer, size_t bytes) {
+    if (!pointer) {
+        return;
+    }
+    if (bytes < LARGE_BLOCK_BYTES) {
+        ::operator delete(pointer);
+        return;
+    }
+    Mapping mapping{nullptr, 0, MemoryComponent::OTHER};
+    {
+        std::lock_guard<std::mutex> guard(mappings_lock);
+        for (size_t i = 0; i < mappings.size(); ++i) {
+            if (mappings[i].address == pointer) {
+                mapping = mappings[i];
+                mappings[i] = mappings.back();
+                mappings.pop_back();
+                break;
+            }
+        }
+    }
+    if (!mapping.address) {
+        return;
+    }
+    munmap(mapping.address, mapping.length);
+    memory_record(mapping.component, -static_cast<long long>(mapping.length));
+    live_blocks.fetch_sub(1, std::memory_order_relaxed);
+    mapped_bytes.fetch_sub(static_cast<long long>(mapping.length), std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the allocator counters.
+ */
+LargeAllocStats large_alloc_stats() {
+    LargeAllocStats stats;
+    stats.blocks = blocks.load(std::memory_order_relaxed);
+    stats.live_blocks = live_blocks.load(std::memory_order_relaxed);
+    stats.mapped_bytes = mapped_bytes.load(std::memory_order_relaxed);
+    stats.peak_bytes = peak_bytes.load(std::memory_order_relaxed);
+    stats.explicit_blocks = explicit_blocks.load(std::memory_order_relaxed);
+    stats.transparent_blocks = transparent_blocks.load(std::memory_order_relaxed);
+    stats.fallbacks = fallbacks.load(std::memory_order_relaxed);
+    stats.numa_blocks = numa_blocks.load(std::memory_order_relaxed);
+    return stats;
+}
+
+/**
+ * @brief Returns the bytes of the process currently backed by transparent huge pages.
+ *
+ * @return AnonHugePages from /proc/self/smaps_rollup, or -1 if unavailable.
+ */
+long long transparent_huge_bytes() {
+    std::ifstream rollup("/proc/self/smaps_rollup");
+    std::string line;
+    while (std::getline(rollup, line)) {
+        long long kilobytes = 0;
+        if (std::sscanf(line.c_str(), "AnonHugePages: %lld kB", &kilobytes) == 1) {
+            return kilobytes * 1024;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Writes the allocator settings and counters.
+ *
+ * @param out Stream receiving the report.
+ */
+void large_alloc_report(std::ostream& out) {
+    LargeAllocStats stats = large_alloc_stats();
+    size_t nodes = numa_node_count();
+    out << "Large buffers: huge pages " << huge_pages_name(large_alloc_mode()) << ", NUMA placement "
+        << (large_alloc_numa() ? (nodes > 1 ? "on" : "on (single node, ignored)") : "off") << ", " << nodes
+        << (nodes == 1 ? " node" : " nodes") << std::endl;
+    out << "  " << stats.blocks << " blocks mapped (" << stats.live_blocks << " live, " << stats.mapped_bytes
+        << " bytes, peak " << stats.peak_bytes << "): " << stats.explicit_blocks << " hugetlbfs, "
+        << stats.transparent_blocks << " transparent, " << stats.fallbacks << " fallbacks, " << stats.numa_blocks
+        << " node-bound" << std::endl;
+}
+
+/**
+ * @brief Returns the number of NUMA nodes with CPUs (1 when unknown).
+ */
+size_t numa_node_count() {
+    size_t count = numa_nodes().size();
+    return count > 0 ? count : 1;
+}
+
+/**
+ * @brief Sets the calling thread's home node.
+ *
+ * @param node Node index (taken modulo numa_node_count()) later blocks of this
+ *        thread are bound to, or -1 for wherever the first touch lands.
+ * @return Home node index that was set before.
+ */
+int numa_set_home(int node) {
+    int previous = home;
+    home = node < 0 ? -1 : static_cast<int>(static_cast<size_t>(node) % numa_node_count());
+    return previous;
+}
+
+/**
+ * @brief Restricts the calling thread to the CPUs of a node and makes it the home node.
+ *
+ * Does nothing (and returns false) when NUMA placement is off or the machine
+ * has a single node.
+ *
+ * @param node Node index; taken modulo numa_node_count().
+ * @return true if the thread was pinned.
+ */
+bool numa_pin_thread(size_t node) {
+    const std::vector<NumaNode>& nodes = numa_nodes();
+    if (!large_alloc_numa() || nodes.size() < 2) {
+        return false;
+    }
+    size_t index = node % nodes.size();
+    const NumaNode& target = nodes[index];
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu : target.cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &cpus);
+        }
+    }
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+        return false;
+    }
+    home = static_cast<int>(index);
+    return true;
+}
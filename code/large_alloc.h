@@ -0,0 +1,210 @@
+/**
+ * @file large_alloc.h
+ * @brief Declares the huge-page and NUMA-aware allocator for large queue and server buffers.
+ *
+ * With 100k+ servers or millions of queued requests, the server table columns
+ * and the load balancer ring span many megabytes, and the per-tick loops miss
+ * the TLB on almost every 4 KiB page. LargeAllocator maps blocks of at least
+ * LARGE_BLOCK_BYTES directly with mmap, and backs those of at least
+ * HUGE_PAGE_BYTES with 2 MiB aligned huge pages:
+ * - HugePages::TRANSPARENT asks for transparent huge pages with
+ *   madvise(MADV_HUGEPAGE), which works with THP set to "always" or "madvise";
+ * - HugePages::EXPLICIT takes pages from the hugetlbfs pool (MAP_HUGETLB) and
+ *   falls back to transparent ones when the pool is empty;
+ * - HugePages::OFF maps plain 4 KiB pages.
+ *
+ * Mapped blocks below HUGE_PAGE_BYTES get plain pages, so rounding never
+ * costs more than 4 KiB; smaller blocks go to operator new, so short vectors
+ * cost nothing extra.
+ *
+ * With NUMA placement on, a thread can choose a home node: blocks it
+ * allocates are bound (preferred policy) to that node, and numa_pin_thread()
+ * restricts the thread to the node's CPUs, so a shard's memory and the
+ * thread running it stay together. On a single-node machine both are no-ops.
+ * Node information comes from /sys and the mbind system call; libnuma is
+ * not needed.
+ */
+
+#ifndef LARGE_ALLOC_H
+#define LARGE_ALLOC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Page backing of large blocks.
+ */
+enum class HugePages : uint8_t {
+    OFF,          ///< Plain 4 KiB pages.
+    TRANSPARENT,  ///< Transparent huge pages (madvise).
+    EXPLICIT      ///< hugetlbfs pages, transparent ones when none are reserved.
+};
+
+/**
+ * @brief Smallest block mapped directly instead of taken from operator new.
+ */
+constexpr size_t LARGE_BLOCK_BYTES = 256 * 1024;
+
+/**
+ * @brief Size and alignment of a huge page.
+ */
+constexpr size_t HUGE_PAGE_BYTES = 2 * 1024 * 1024;
+
+/**
+ * @brief Counters of the large-block allocator.
+ */
+struct LargeAllocStats {
+    long long blocks = 0;           ///< Blocks mapped so far.
+    long long live_blocks = 0;      ///< Blocks mapped and not unmapped yet.
+    long long mapped_bytes = 0;     ///< Bytes mapped now.
+    long long peak_bytes = 0;       ///< Largest mapped_bytes so far.
+    long long explicit_blocks = 0;  ///< Blocks backed by hugetlbfs pages.
+    long long transparent_blocks = 0; ///< Blocks advised to use transparent huge pages.
+    long long fallbacks = 0;        ///< Blocks that could not get the requested backing.
+    long long numa_blocks = 0;      ///< Blocks bound to a home node.
+};
+
+/**
+ * @brief Sets the process-wide page backing and NUMA placement of later blocks.
+ *
+ * @param mode Page backing.
+ * @param numa true to bind blocks to the allocating thread's home node.
+ */
+void large_alloc_configure(HugePages mode, bool numa);
+
+/**
+ * @brief Returns the page backing of new blocks.
+ */
+HugePages large_alloc_mode();
+
+/**
+ * @brief Returns whether NUMA placement is on.
+ */
+bool large_alloc_numa();
+
+/**
+ * @brief Parses a --huge-pages value.
+ *
+ * @param text "off", "transparent" or "explicit".
+ * @param mode Receives the page backing.
+ * @return false if the text names no mode.
+ */
+bool parse_huge_pages(const std::string& text, HugePages& mode);
+
+/**
+ * @brief Returns the console name of a page backing.
+ */
+const char* huge_pages_name(HugePages mode);
+
+/**
+ * @brief Allocates a block, mapping it with huge pages when it is large.
+ *
+ * @param bytes Size of the block.
+ * @return Block aligned to at least 16 bytes; throws std::bad_alloc when out of memory.
+ */
+void* large_allocate(size_t bytes);
+
+/**
+ * @brief Releases a block from large_allocate().
+ *
+ * @param pointer Block (may be null).
+ * @param bytes Size it was allocated with.
+ */
+void large_free(void* pointer, size_t bytes);
+
+/**
+ * @brief Returns the allocator counters.
+ */
+LargeAllocStats large_alloc_stats();
+
+/**
+ * @brief Returns the bytes of the process currently backed by transparent huge pages.
+ *
+ * @return AnonHugePages from /proc/self/smaps_rollup, or -1 if unavailable.
+ */
+long long transparent_huge_bytes();
+
+/**
+ * @brief Writes the allocator settings and counters.
+ *
+ * @param out Stream receiving the report.
+ */
+void large_alloc_report(std::ostream& out);
+
+/**
+ * @brief Returns the number of NUMA nodes with CPUs (1 when unknown).
+ */
+size_t numa_node_count();
+
+/**
+ * @brief Sets the calling thread's home node.
+ *
+ * @param node Node index (taken modulo numa_node_count()) later blocks of this
+ *        thread are bound to, or -1 for wherever the first touch lands.
+ * @return Home node index that was set before.
+ */
+int numa_set_home(int node);
+
+/**
+ * @brief Restricts the calling thread to the CPUs of a node and makes it the home node.
+ *
+ * Does nothing (and returns false) when NUMA placement is off or the machine
+ * has a single node.
+ *
+ * @param node Node index; taken modulo numa_node_count().
+ * @return true if the thread was pinned.
+ */
+bool numa_pin_thread(size_t node);
+
+/**
+ * @class LargeAllocator
+ * @brief Standard allocator over large_allocate() and large_free().
+ */
+template <class T>
+class LargeAllocator {
+public:
+    using value_type = T;
+
+    static_assert(alignof(T) <= 16, "large blocks are only 16-byte aligned when they come from operator new");
+
+    LargeAllocator() = default;
+
+    /**
+     * @brief Converts from an allocator of another type (all are interchangeable).
+     */
+    template <class U>
+    LargeAllocator(const LargeAllocator<U>&) {}
+
+    /**
+     * @brief Allocates room for count elements.
+     */
+    T* allocate(size_t count) {
+        if (count > static_cast<size_t>(-1) / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(large_allocate(count * sizeof(T)));
+    }
+
+    /**
+     * @brief Releases room for count elements.
+     */
+    void deallocate(T* pointer, size_t count) { large_free(pointer, count * sizeof(T)); }
+};
+
+template <class T, class U>
+bool operator==(const LargeAllocator<T>&, const LargeAllocator<U>&) { return true; }
+
+template <class T, class U>
+bool operator!=(const LargeAllocator<T>&, const LargeAllocator<U>&) { return false; }
+
+/**
+ * @brief Vector whose buffer is mapped once it reaches LARGE_BLOCK_BYTES and huge-page backed from HUGE_PAGE_BYTES.
+ */
+template <class T>
+using LargeVector = std::vector<T, LargeAllocator<T>>;
+
+#endif
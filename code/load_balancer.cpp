@@ -7,74 +7,132 @@
  */
 
 #include "load_balancer.h"
-#include <queue>
-# include "request.h"
+#include "alloc_counter.h"
+#include "profiler.h"
+#include <algorithm>
+#include <iostream>
+#include <utility>
 
 /**
  * @brief Constructs an empty LoadBalancer.
  *
- * Initializes the internal request queue.
+ * Initializes the internal ring buffer with room for 64 requests and the
+ * default thresholds of 50 (low) and 80 (high) queued requests per server.
  */
-LoadBalancer::LoadBalancer() {}
+LoadBalancer::LoadBalancer()
+    : head(0), count(0), low_multiplier(50.0), high_multiplier(80.0), arena(nullptr), budget(0),
+      segment_size(0), spill_failed(false), spill_writes(0), peak_spilled(0),
+      coalesce_window(0), coalesce_max(0) {
+    MEMORY_SCOPE(MemoryComponent::QUEUES);
+    requestQueue.resize(64);
+}
 
 /**
  * @brief Adds a request to the processing queue.
  *
- * The request is appended to the internal FIFO queue and will be processed
- * in the order it was received.
+ * The handle is moved to the tail of the ring buffer and will be processed
+ * in the order it was received. The buffer doubles when full. Once spilling
+ * is enabled and the ring holds the budget, arrivals go to the in-memory
+ * tail instead, which is written out whenever it fills a segment.
  *
- * @param request The incoming request to enqueue.
+ * @param request Handle of the incoming request to enqueue.
  */
-void LoadBalancer::queue_request(const Request& request) {
-    requestQueue.push(request);
+void LoadBalancer::queue_request(RequestHandle&& request) {
+    PROFILE_SCOPE(ProfilePhase::QUEUE_REQUEST);
+    if (arena && (count >= budget || !tail.empty() || spill->size() > 0)) {
+        MEMORY_SCOPE(MemoryComponent::QUEUES);
+        tail.push_back(std::move(request));
+        if (tail.size() >= segment_size && !spill_failed) {
+            spill_tail();
+        }
+        return;
+    }
+    push_back(std::move(request));
 }
 
 /**
  * @brief Removes and returns the next request in the queue.
  *
- * The request at the front of the queue is retrieved and removed.
+ * The handle at the head of the ring buffer is moved out and the head
+ * advances. With spilling enabled the ring is topped up from disk first
+ * when it runs low.
  *
- * @return The next Request to be processed.
+ * @return Handle of the next request to be processed.
  */
-Request LoadBalancer::process_request(){
-    Request req = requestQueue.front();
-    requestQueue.pop();
+RequestHandle LoadBalancer::process_request(){
+    PROFILE_SCOPE(ProfilePhase::PROCESS_REQUEST);
+    if (arena && count < 2 * segment_size) {
+        refill();
+    }
+    RequestHandle req = std::move(requestQueue[head]);
+    head = (head + 1) & (requestQueue.size() - 1);
+    count--;
     return req;
 }
 
+/**
+ * @brief Puts a request taken with process_request() back at the head of the queue.
+ *
+ * The head moves back one slot, so the request is the next one processed.
+ *
+ * @param request Handle of the request to return.
+ */
+void LoadBalancer::return_request(RequestHandle&& request) {
+    PROFILE_SCOPE(ProfilePhase::RETURN_REQUEST);
+    if (count == requestQueue.size()) {
+        grow();
+    }
+    head = (head - 1) & (requestQueue.size() - 1);
+    requestQueue[head] = std::move(request);
+    count++;
+}
+
 /**
  * @brief Checks whether the request queue is empty.
  *
  * @return true if there are no pending requests, false otherwise.
  */
 bool LoadBalancer::is_empty() const {
-    return requestQueue.empty();
+    return queued() == 0;
 }
 
 /**
  * @brief Determines whether the system is under low load.
  *
  * The system is considered under low load if the number of queued
- * requests is less than 50 times the number of active servers.
+ * requests is less than low_multiplier (50 by default) times the number of
+ * active servers.
  *
  * @param server_count The number of active servers.
  * @return true if the queue size is below the low-load threshold.
  */
 bool LoadBalancer::low_load(int server_count) const {
-    return requestQueue.size() < 50*server_count;
+    return static_cast<double>(queued()) < low_multiplier * server_count;
 }
 
 /**
  * @brief Determines whether the system is under high load.
  *
  * The system is considered under high load if the number of queued
- * requests exceeds 80 times the number of active servers.
+ * requests exceeds high_multiplier (80 by default) times the number of
+ * active servers.
  *
  * @param server_count The number of active servers.
  * @return true if the queue size exceeds the high-load threshold.
  */
 bool LoadBalancer::high_load(int server_count) const {
-    return requestQueue.size() > 80*server_count;
+    return static_cast<double>(queued()) > high_multiplier * server_count;
+}
+
+/**
+ * @brief Sets the per-server queue lengths used by low_load() and high_load().
+ *
+ * @param low_multiplier Queued requests per server below which load is low.
+ * @param high_multiplier Queued requests per server above which load is high.
+ */
+void LoadBalancer::set_thresholds(double low_multiplier, double high_multiplier) {
+    this->low_multiplier = low_multiplier;
+    this->high_multiplier = high_multiplier;
 }
 
 /**
@@ -83,5 +141,309 @@ bool LoadBalancer::high_load(int server_count) const {
  * @return The size of the internal request queue.
  */
 int LoadBalancer::get_queue_size() const {
-    return requestQueue.size();
-}
\ No newline at end of file
+    return static_cast<int>(queued());
+}
+
+/**
+ * @brief Keeps at most about budget queued requests in memory and spills the rest.
+ *
+ * Segments hold a quarter of the budget. At most the budget plus one
+ * segment of requests stays in memory: the ring fills up to the budget, and
+ * later arrivals wait in the tail until a full segment can be written.
+ *
+ * @param arena Arena the queued requests live in.
+ * @param budget Queued requests kept in memory (a quarter more while a segment fills).
+ * @param directory Directory of the spill file.
+ * @param hooks Callbacks carrying the owner's per-slot state.
+ * @return false if the spill file could not be created.
+ */
+bool LoadBalancer::enable_spill(RequestArena& arena, size_t budget, const std::string& directory, const SpillHooks& hooks) {
+    MEMORY_SCOPE(MemoryComponent::QUEUES);
+    std::unique_ptr<SpillFile> file(new SpillFile());
+    if (!file->open(directory)) {
+        return false;
+    }
+    spill = std::move(file);
+    this->arena = &arena;
+    this->budget = std::max<size_t>(budget, 4);
+    segment_size = this->budget / 4;
+    spill_directory = directory;
+    this->hooks = hooks;
+    tail.reserve(segment_size);
+    spill_buffer.reserve(segment_size);
+    return true;
+}
+
+/**
+ * @brief Returns the number of queued requests currently on disk.
+ *
+ * @return Spilled requests not read back yet.
+ */
+size_t LoadBalancer::get_spilled() const {
+    return spill ? spill->size() : 0;
+}
+
+/**
+ * @brief Returns the number of requests written to disk so far.
+ *
+ * @return Spilled requests, counting a request again each time it is spilled.
+ */
+long long LoadBalancer::get_spill_writes() const {
+    return spill_writes;
+}
+
+/**
+ * @brief Returns the largest number of requests that were on disk at once.
+ *
+ * @return Peak spilled backlog.
+ */
+size_t LoadBalancer::get_peak_spilled() const {
+    return peak_spilled;
+}
+
+/**
+ * @brief Lets take_batch() coalesce requests for the same backend.
+ *
+ * @param window Queued requests behind the head that are searched for batch members.
+ * @param max_batch Largest batch, including the request it is built around (0 or 1 = no coalescing).
+ */
+void LoadBalancer::set_coalescing(size_t window, size_t max_batch) {
+    coalesce_window = window;
+    coalesce_max = max_batch;
+}
+
+/**
+ * @brief Takes the queued requests that can share one backend call with a request.
+ *
+ * The window is walked from its far end towards the head: members are
+ * moved out and the requests that stay are shifted back over the gaps, so
+ * the head simply advances past the members' slots and the rest of the
+ * ring is not touched. Only the in-memory head is searched; spilled
+ * requests join a batch once they are read back.
+ *
+ * @param arena Arena the queued requests live in.
+ * @param leader Request taken with process_request() that the batch is built around.
+ * @param members Receives the handles of the other batch members (appended), oldest first.
+ * @return Number of members taken.
+ */
+size_t LoadBalancer::take_batch(const RequestArena& arena, const Request& leader, std::vector<RequestHandle>& members) {
+    if (coalesce_max < 2) {
+        return 0;
+    }
+    size_t mask = requestQueue.size() - 1;
+    size_t window = std::min(coalesce_window, count);
+    // find the members first, oldest first, so a full batch takes the oldest matches
+    size_t wanted = coalesce_max - 1;
+    size_t taken = 0;
+    size_t last = 0;
+    for (size_t i = 0; i < window && taken < wanted; ++i) {
+        const Request& request = arena.get(requestQueue[(head + i) & mask]);
+        if (request.get_ip_out_int() == leader.get_ip_out_int() && request.get_request_type() == leader.get_request_type() &&
+            request.get_remaining_work() == request.get_time_to_process()) {
+            taken++;
+            last = i;
+        }
+    }
+    if (taken == 0) {
+        return 0;
+    }
+    size_t first_member = members.size();
+    members.resize(first_member + taken);
+    size_t member = taken;
+    size_t write = last;
+    for (size_t i = last + 1; i-- > 0;) {
+        RequestHandle& slot = requestQueue[(head + i) & mask];
+        const Request& request = arena.get(slot);
+        if (member > 0 && request.get_ip_out_int() == leader.get_ip_out_int() &&
+            request.get_request_type() == leader.get_request_type() &&
+            request.get_remaining_work() == request.get_time_to_process()) {
+            members[first_member + --member] = std::move(slot);
+            continue;
+        }
+        if (write != i) {
+            requestQueue[(head + write) & mask] = std::move(slot);
+        }
+        write--;
+    }
+    head = (head + taken) & mask;
+    count -= taken;
+    return taken;
+}
+
+/**
+ * @brief Writes the queued requests, oldest first, to a checkpoint.
+ *
+ * The in-memory head, the spilled middle (as full records) and the
+ * in-memory tail are written as three sections.
+ *
+ * @param out Checkpoint being written.
+ */
+void LoadBalancer::save(CheckpointWriter& out) const {
+    std::vector<uint32_t> handles(count);
+    for (size_t i = 0; i < count; ++i) {
+        handles[i] = requestQueue[(head + i) & (requestQueue.size() - 1)].get_index();
+    }
+    out.write_vector(handles);
+    std::vector<SpilledRequest> spilled;
+    if (spill && !spill->copy_all(spilled)) {
+        std::cerr << "Could not read the spill file; spilled requests are missing from the checkpoint." << std::endl;
+    }
+    out.write_vector(spilled);
+    handles.resize(tail.size());
+    for (size_t i = 0; i < tail.size(); ++i) {
+        handles[i] = tail[i].get_index();
+    }
+    out.write_vector(handles);
+    out.write(spill_writes);
+    out.write(static_cast<uint64_t>(peak_spilled));
+}
+
+/**
+ * @brief Replaces the queue with a checkpointed one.
+ *
+ * Spilled requests are written to a fresh spill file in segments of this
+ * run's size.
+ *
+ * @param in Checkpoint being read.
+ * @param arena Restored arena the queued handles are adopted from.
+ * @return false if the queue section is malformed.
+ */
+bool LoadBalancer::restore(CheckpointReader& in, const RequestArena& arena) {
+    MEMORY_SCOPE(MemoryComponent::QUEUES);
+    std::vector<uint32_t> handles, tail_handles;
+    std::vector<SpilledRequest> spilled;
+    uint64_t peak = 0;
+    in.read_vector(handles);
+    in.read_vector(spilled);
+    in.read_vector(tail_handles);
+    in.read(spill_writes);
+    in.read(peak);
+    peak_spilled = static_cast<size_t>(peak);
+    if (!this->arena && (!spilled.empty() || !tail_handles.empty())) {
+        std::cerr << "The checkpoint has " << spilled.size() << " spilled requests; restore it with a queue budget." << std::endl;
+        return false;
+    }
+
+    size_t capacity = 64;
+    while (capacity < handles.size()) {
+        capacity *= 2;
+    }
+    requestQueue.clear();
+    requestQueue.resize(capacity);
+    head = 0;
+    count = handles.size();
+    for (size_t i = 0; i < count; ++i) {
+        requestQueue[i] = arena.adopt(handles[i]);
+    }
+    tail.clear();
+    for (uint32_t index : tail_handles) {
+        tail.push_back(arena.adopt(index));
+    }
+    if (this->arena) {
+        spill.reset(new SpillFile());
+        if (!spill->open(spill_directory)) {
+            return false;
+        }
+        for (size_t first = 0; first < spilled.size(); first += segment_size) {
+            if (!spill->append(spilled.data() + first, std::min(segment_size, spilled.size() - first))) {
+                std::cerr << "Could not write the spill file." << std::endl;
+                return false;
+            }
+        }
+    }
+    return in.ok();
+}
+
+/**
+ * @brief Doubles the ring buffer, keeping queued handles in order.
+ *
+ * Handles are moved so that the oldest request ends up at index 0.
+ */
+void LoadBalancer::grow() {
+    MEMORY_SCOPE(MemoryComponent::QUEUES);
+    LargeVector<RequestHandle> larger(requestQueue.size() * 2);
+    for (size_t i = 0; i < count; ++i) {
+        larger[i] = std::move(requestQueue[(head + i) & (requestQueue.size() - 1)]);
+    }
+    requestQueue.swap(larger);
+    head = 0;
+}
+
+/**
+ * @brief Appends a handle to the ring buffer.
+ *
+ * @param request Handle to append.
+ */
+void LoadBalancer::push_back(RequestHandle&& request) {
+    if (count == requestQueue.size()) {
+        grow();
+    }
+    requestQueue[(head + count) & (requestQueue.size() - 1)] = std::move(request);
+    count++;
+}
+
+/**
+ * @brief Returns the number of queued requests, in memory and on disk.
+ *
+ * @return Requests in the ring, the spill file and the tail.
+ */
+size_t LoadBalancer::queued() const {
+    return count + tail.size() + (spill ? spill->size() : 0);
+}
+
+/**
+ * @brief Writes the in-memory tail to the spill file as one segment.
+ *
+ * The requests are copied out with their owner state and released from the
+ * arena. If the write fails the tail stays in memory and spilling stops.
+ */
+void LoadBalancer::spill_tail() {
+    MEMORY_SCOPE(MemoryComponent::QUEUES);
+    spill_buffer.clear();
+    for (const RequestHandle& request : tail) {
+        spill_buffer.push_back({arena->get(request), hooks.pack ? hooks.pack(request) : 0});
+    }
+    if (!spill->append(spill_buffer.data(), spill_buffer.size())) {
+        std::cerr << "Could not write the spill file; the queue stays in memory from now on." << std::endl;
+        spill_failed = true;
+        return;
+    }
+    for (RequestHandle& request : tail) {
+        arena->release(std::move(request));
+    }
+    spill_writes += static_cast<long long>(tail.size());
+    peak_spilled = std::max(peak_spilled, spill->size());
+    tail.clear();
+}
+
+/**
+ * @brief Prefetches the next segment and moves it (or the tail) into the ring when the head runs low.
+ *
+ * Called while the ring holds fewer than two segments: the oldest segment is
+ * mapped and read ahead, and once fewer than one segment is left it is
+ * copied back into the arena behind the ring's requests. When nothing is on
+ * disk, the tail joins the ring instead.
+ */
+void LoadBalancer::refill() {
+    MEMORY_SCOPE(MemoryComponent::QUEUES);
+    spill->prefetch();
+    while (count < segment_size && spill->size() > 0) {
+        spill_buffer.clear();
+        if (!spill->take_front(spill_buffer)) {
+            std::cerr << "Could not read the spill file; a segment of queued requests was lost." << std::endl;
+        }
+        for (const SpilledRequest& record : spill_buffer) {
+            RequestHandle request = arena->insert(record.request);
+            if (hooks.unpack) {
+                hooks.unpack(request, record.tag);
+            }
+            push_back(std::move(request));
+        }
+    }
+    if (count < segment_size && spill->size() == 0 && !tail.empty()) {
+        for (RequestHandle& request : tail) {
+            push_back(std::move(request));
+        }
+        tail.clear();
+    }
+}
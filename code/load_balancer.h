@@ -4,19 +4,44 @@
  *
  * This header defines a simple load balancer that stores incoming requests
  * in a queue and provides logic to determine system load conditions.
+ * Requests are held as RequestHandle values; the requests themselves live
+ * in a RequestArena. With a memory budget, the middle of a deep queue is
+ * spilled to a SpillFile and read back before the head reaches it.
  */
 
 #ifndef LOAD_BALANCER_H
 #define LOAD_BALANCER_H
 
-#include "request.h"
-#include <queue>
+#include "large_alloc.h"
+#include "request_arena.h"
+#include "spill_file.h"
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Callbacks that carry the queue owner's per-slot state through a spill.
+ *
+ * A spilled request leaves the arena, so state the owner keeps by slot index
+ * (such as its arrival time) would be lost; pack() folds it into the
+ * request's SpilledRequest::tag and unpack() applies it to the new slot.
+ */
+struct SpillHooks {
+    std::function<uint64_t(const RequestHandle&)> pack;          ///< Called before a request is written out.
+    std::function<void(const RequestHandle&, uint64_t)> unpack;  ///< Called after it is read back.
+};
 
 /**
  * @class LoadBalancer
  * @brief Manages and distributes incoming requests using a FIFO queue.
  *
- * The LoadBalancer maintains a queue of Request objects. It provides
+ * The LoadBalancer maintains a FIFO of request handles in a growable ring
+ * buffer, so steady-state enqueue and dequeue never allocate. With
+ * enable_spill(), the FIFO is split into the in-memory head (the ring), the
+ * spilled middle and an in-memory tail of recent arrivals that is written out
+ * one segment at a time. It provides
  * functionality for enqueueing, processing, and evaluating load
  * conditions based on the number of active servers.
  */
@@ -31,18 +56,31 @@ class LoadBalancer {
         /**
          * @brief Adds a request to the processing queue.
          *
-         * @param request The incoming request to enqueue.
+         * The queue takes ownership of the handle.
+         *
+         * @param request Handle of the incoming request to enqueue.
          */
-        void queue_request(const Request& request);
+        void queue_request(RequestHandle&& request);
 
         /**
          * @brief Removes and returns the next request in the queue.
          *
          * Requests are processed in First-In-First-Out (FIFO) order.
+         * Ownership of the handle passes to the caller.
          *
-         * @return The next Request to be processed.
+         * @return Handle of the next request to be processed.
          */
-        Request process_request();
+        RequestHandle process_request();
+
+        /**
+         * @brief Puts a request taken with process_request() back at the head of the queue.
+         *
+         * Used when no server will take the request yet, so it keeps its
+         * place ahead of later arrivals.
+         *
+         * @param request Handle of the request to return.
+         */
+        void return_request(RequestHandle&& request);
 
         /**
          * @brief Checks whether the request queue is empty.
@@ -73,6 +111,14 @@ class LoadBalancer {
          */
         bool high_load(int server_count) const;
 
+        /**
+         * @brief Sets the per-server queue lengths used by low_load() and high_load().
+         *
+         * @param low_multiplier Queued requests per server below which load is low.
+         * @param high_multiplier Queued requests per server above which load is high.
+         */
+        void set_thresholds(double low_multiplier, double high_multiplier);
+
         /**
          * @brief Retrieves the current simulation time.
          *
@@ -87,14 +133,195 @@ class LoadBalancer {
          */
         int get_queue_size() const;
 
+        /**
+         * @brief Lets take_batch() coalesce requests for the same backend.
+         *
+         * @param window Queued requests behind the head that are searched for batch members.
+         * @param max_batch Largest batch, including the request it is built around (0 or 1 = no coalescing).
+         */
+        void set_coalescing(size_t window, size_t max_batch);
+
+        /**
+         * @brief Takes the queued requests that can share one backend call with a request.
+         *
+         * Searches the first coalescing window of the in-memory head for
+         * requests with the same destination and type that have not started
+         * yet, and removes up to max_batch - 1 of them, keeping the order of
+         * the requests left behind.
+         *
+         * @param arena Arena the queued requests live in.
+         * @param leader Request taken with process_request() that the batch is built around.
+         * @param members Receives the handles of the other batch members (appended), oldest first.
+         * @return Number of members taken.
+         */
+        size_t take_batch(const RequestArena& arena, const Request& leader, std::vector<RequestHandle>& members);
+
+        /**
+         * @brief Keeps at most about budget queued requests in memory and spills the rest.
+         *
+         * @param arena Arena the queued requests live in.
+         * @param budget Queued requests kept in memory (a quarter more while a segment fills).
+         * @param directory Directory of the spill file.
+         * @param hooks Callbacks carrying the owner's per-slot state.
+         * @return false if the spill file could not be created.
+         */
+        bool enable_spill(RequestArena& arena, size_t budget, const std::string& directory, const SpillHooks& hooks);
+
+        /**
+         * @brief Returns the number of queued requests currently on disk.
+         */
+        size_t get_spilled() const;
+
+        /**
+         * @brief Returns the number of requests written to disk so far.
+         */
+        long long get_spill_writes() const;
+
+        /**
+         * @brief Returns the largest number of requests that were on disk at once.
+         */
+        size_t get_peak_spilled() const;
+
+        /**
+         * @brief Writes the queued requests, oldest first, to a checkpoint.
+         *
+         * @param out Checkpoint being written.
+         */
+        void save(CheckpointWriter& out) const;
+
+        /**
+         * @brief Replaces the queue with a checkpointed one.
+         *
+         * The thresholds and spill settings are configuration and are kept;
+         * a checkpoint with spilled requests needs spilling to be enabled.
+         *
+         * @param in Checkpoint being read.
+         * @param arena Restored arena the queued handles are adopted from.
+         * @return false if the queue section is malformed.
+         */
+        bool restore(CheckpointReader& in, const RequestArena& arena);
+
     private:
 
         /**
-         * @brief Queue storing pending requests.
+         * @brief Doubles the ring buffer, keeping queued handles in order.
+         */
+        void grow();
+
+        /**
+         * @brief Appends a handle to the ring buffer.
          *
-         * Requests are processed in FIFO order.
+         * @param request Handle to append.
+         */
+        void push_back(RequestHandle&& request);
+
+        /**
+         * @brief Returns the number of queued requests, in memory and on disk.
+         */
+        size_t queued() const;
+
+        /**
+         * @brief Writes the in-memory tail to the spill file as one segment.
+         */
+        void spill_tail();
+
+        /**
+         * @brief Prefetches the next segment and moves it (or the tail) into the ring when the head runs low.
+         */
+        void refill();
+
+        /**
+         * @brief Ring buffer storing pending request handles.
+         *
+         * The capacity is always a power of two. Requests are processed in
+         * FIFO order starting at head.
+         */
+        LargeVector<RequestHandle> requestQueue;
+
+        /**
+         * @brief Index of the oldest queued handle.
+         */
+        size_t head;
+
+        /**
+         * @brief Number of queued handles.
+         */
+        size_t count;
+
+        /**
+         * @brief Queued requests per server below which load is considered low.
+         */
+        double low_multiplier;
+
+        /**
+         * @brief Queued requests per server above which load is considered high.
+         */
+        double high_multiplier;
+
+        /**
+         * @brief Arena requests are spilled from and read back into (nullptr = no spilling).
+         */
+        RequestArena* arena;
+
+        /**
+         * @brief Queued requests kept in the ring before arrivals go to the tail.
+         */
+        size_t budget;
+
+        /**
+         * @brief Requests per spilled segment; the ring is refilled when it holds fewer.
+         */
+        size_t segment_size;
+
+        /**
+         * @brief Directory of the spill file.
+         */
+        std::string spill_directory;
+
+        /**
+         * @brief Spilled middle of the queue.
+         */
+        std::unique_ptr<SpillFile> spill;
+
+        /**
+         * @brief Arrivals behind the spilled middle, oldest first.
+         */
+        std::vector<RequestHandle> tail;
+
+        /**
+         * @brief Owner callbacks for per-slot state.
+         */
+        SpillHooks hooks;
+
+        /**
+         * @brief Scratch buffer for segments being written or read.
+         */
+        std::vector<SpilledRequest> spill_buffer;
+
+        /**
+         * @brief Whether a segment write failed; the tail then stays in memory.
+         */
+        bool spill_failed;
+
+        /**
+         * @brief Requests written to disk so far.
+         */
+        long long spill_writes;
+
+        /**
+         * @brief Largest number of requests on disk at once.
+         */
+        size_t peak_spilled;
+
+        /**
+         * @brief Queued requests searched by take_batch().
+         */
+        size_t coalesce_window;
+
+        /**
+         * @brief Largest batch built by take_batch() (0 or 1 = no coalescing).
          */
-        std::queue<Request> requestQueue;
+        size_t coalesce_max;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,187 @@
+/**
+ * @file load_generator.cpp
+ * @brief Loopback load generator for the network front end.
+ *
+ * This program opens several TCP connections to a load_balancer_simulation
+ * running with --mode=net, keeps a window of pipelined request frames in
+ * flight on each connection, and reports throughput and latency percentiles.
+ *
+ * Options: --host (default 127.0.0.1), --port (9090), --connections (4),
+ * --requests (total, 10000), --window (in-flight frames per connection, 16).
+ */
+
+#include "config.h"
+#include "net_protocol.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <random>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// color codes
+#define GREEN   "\033[32m"
+#define RED     "\033[31m"
+#define RESET   "\033[0m"
+
+/**
+ * @brief Per-connection results merged after the run.
+ */
+struct ConnectionResult {
+    std::vector<double> latencies_us; ///< Round-trip time of every answered request.
+    long long blocked = 0;            ///< Requests rejected by the firewall.
+    bool failed = false;              ///< Whether the connection could not be used.
+};
+
+/**
+ * @brief Sends all bytes of a buffer on a blocking socket.
+ *
+ * @return true if every byte was written.
+ */
+bool send_all(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t count = send(fd, data, size, 0);
+        if (count <= 0) {
+            return false;
+        }
+        data += count;
+        size -= count;
+    }
+    return true;
+}
+
+/**
+ * @brief Drives one connection: keeps `window` requests in flight until
+ * `requests` responses have been received.
+ *
+ * @param host Server address.
+ * @param port Server port.
+ * @param requests Number of requests to send on this connection.
+ * @param window Maximum pipelined requests in flight.
+ * @param seed Seed for this connection's request generator.
+ * @param result Receives latencies and counters.
+ */
+void run_connection(const std::string& host, int port, int requests, int window, unsigned seed, ConnectionResult& result) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    inet_pton(AF_INET, host.c_str(), &address.sin_addr);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        result.failed = true;
+        if (fd >= 0) close(fd);
+        return;
+    }
+    int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+    std::mt19937 rng(seed);
+    std::vector<std::chrono::steady_clock::time_point> sent_at(requests);
+    result.latencies_us.reserve(requests);
+    int sent = 0, received = 0;
+    auto send_next = [&]() {
+        uint8_t frame[REQUEST_FRAME_SIZE];
+        RequestFrame request{static_cast<uint32_t>(sent), static_cast<uint32_t>(rng()), static_cast<uint32_t>(rng()),
+                             static_cast<uint16_t>(rng() % 12 + 1), (rng() % 2) ? 'P' : 'S'};
+        encode_request_frame(request, frame);
+        sent_at[sent] = std::chrono::steady_clock::now();
+        sent++;
+        return send_all(fd, frame, sizeof(frame));
+    };
+
+    while (sent < requests && sent < window) {
+        if (!send_next()) { result.failed = true; close(fd); return; }
+    }
+    std::vector<uint8_t> buffer;
+    uint8_t chunk[4096];
+    while (received < requests) {
+        ssize_t count = recv(fd, chunk, sizeof(chunk), 0);
+        if (count <= 0) {
+            result.failed = true;
+            break;
+        }
+        buffer.insert(buffer.end(), chunk, chunk + count);
+        size_t offset = 0;
+        for (; offset + RESPONSE_FRAME_SIZE <= buffer.size(); offset += RESPONSE_FRAME_SIZE) {
+            ResponseFrame response = decode_response_frame(buffer.data() + offset);
+            auto now = std::chrono::steady_clock::now();
+            if (response.sequence < sent_at.size()) {
+                result.latencies_us.push_back(std::chrono::duration<double, std::micro>(now - sent_at[response.sequence]).count());
+            }
+            if (response.status == FrameStatus::BLOCKED) {
+                result.blocked++;
+            }
+            received++;
+            if (sent < requests && !send_next()) {
+                result.failed = true;
+                break;
+            }
+        }
+        buffer.erase(buffer.begin(), buffer.begin() + offset);
+    }
+    close(fd);
+}
+
+/**
+ * @brief Returns the given percentile of a sorted sample.
+ */
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+/**
+ * @brief Entry point of the load generator.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @return 0 if every connection completed, 1 otherwise.
+ */
+int main(int argc, char* argv[]) {
+    Config config(argc, argv);
+    std::string host = config.get_string("host", "127.0.0.1");
+    int port = config.get_int("port", 9090);
+    int connections = std::max(1, config.get_int("connections", 4));
+    int total_requests = std::max(1, config.get_int("requests", 10000));
+    int window = std::max(1, config.get_int("window", 16));
+
+    std::vector<ConnectionResult> results(connections);
+    std::vector<std::thread> threads;
+    auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < connections; ++i) {
+        int share = total_requests / connections + (i < total_requests % connections ? 1 : 0);
+        threads.emplace_back(run_connection, host, port, share, window, 1234u + i, std::ref(results[i]));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::vector<double> latencies;
+    long long blocked = 0;
+    bool failed = false;
+    for (const auto& result : results) {
+        latencies.insert(latencies.end(), result.latencies_us.begin(), result.latencies_us.end());
+        blocked += result.blocked;
+        failed = failed || result.failed;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << (failed ? RED : GREEN)
+              << "Responses: " << latencies.size() << " (" << blocked << " blocked) in " << elapsed << " s" << RESET << std::endl;
+    std::cout << "Throughput: " << (elapsed > 0 ? latencies.size() / elapsed : 0.0) << " requests/sec" << std::endl;
+    std::cout << "Latency (us): p50 " << percentile(latencies, 50) << ", p90 " << percentile(latencies, 90)
+              << ", p99 " << percentile(latencies, 99) << ", max " << (latencies.empty() ? 0.0 : latencies.back()) << std::endl;
+    return failed ? 1 : 0;
+}
@@ -3,19 +3,27 @@
  * @brief Runs a load balancer simulation with streaming and processing servers.
  *
  * This program simulates a system that generates random requests over time,
- * optionally filters them through a firewall, queues them into one of two load
- * balancers (streaming vs processing), and assigns them to available servers.
+ * optionally filters them through a firewall, queues them into the load
+ * balancer of their request type's pool (streaming and processing by default),
+ * and assigns them to available servers.
  * The system dynamically scales the number of servers based on queue load.
  */
 
 #include <iostream>
-#include "server_handler.h"
-#include "request.h"
+#include "alloc_counter.h"
 #include "firewall.h"
-#include "load_balancer.h"
-#include <vector>
+#include "config.h"
+#include "large_alloc.h"
+#include "net_frontend.h"
+#include "profiler.h"
+#include "queueing_model.h"
+#include "shm_ring.h"
+#include "simulation.h"
+#include "sweep.h"
+#include "topology.h"
+#include <chrono>
+#include <memory>
 #include <string>
-#include <unistd.h>
 #include <ctime>
 #include <fstream>
 
@@ -23,261 +31,244 @@
 #define RED     "\033[31m"
 #define GREEN   "\033[32m"
 #define YELLOW  "\033[33m"
-#define BLUE    "\033[34m"
 #define RESET   "\033[0m"
 
 /**
- * @brief Generates a random IPv4 address string.
+ * @brief Reads an integer setting from the configuration or the console.
  *
- * The generated IP is in dotted-quad form with each octet in [0, 255].
- *
- * @return Random IPv4 address (e.g., "192.168.1.25").
- */
-std::string generate_random_ip() {
-    return std::to_string(rand() % 256) + "." +
-           std::to_string(rand() % 256) + "." +
-           std::to_string(rand() % 256) + "." +
-           std::to_string(rand() % 256);
-}
-
-/**
- * @brief Generates a random request type.
- *
- * The request type is chosen from a fixed set:
- * - 'P' for processing
- * - 'S' for streaming
- *
- * @return A character representing the request type.
+ * @param config Parsed command-line / file options.
+ * @param key Option name that supplies the value non-interactively.
+ * @param prompt Prompt shown when the option is not set.
+ * @return The configured or entered value.
  */
-char generate_random_request_type() {
-    const char types[] = {'P', 'S'};
-    return types[rand() % 2];
-}
-
-/**
- * @brief Generates a random processing time for a request.
- *
- * @return Random time-to-process value in the range [1, 10].
- */
-int generate_random_time() {
-    return rand() % 12 + 1;
+int read_int_setting(const Config& config, const std::string& key, const std::string& prompt) {
+    if (config.has(key)) {
+        return config.get_int(key, 0);
+    }
+    int value = 0;
+    std::cout << prompt;
+    std::cin >> value;
+    return value;
 }
 
 /**
- * @brief Generates a random number of requests to add per clock interval.
+ * @brief Splits a "start_ip,end_ip" option value into its two addresses.
  *
- * @return Random request count in the range [1, 20].
+ * @param range Option value, or "none".
+ * @param start_ip Receives the first address.
+ * @param end_ip Receives the second address.
+ * @return true if a range was given, false for "none" or malformed values.
  */
-int generate_random_request_count(){
-    return rand() % 40 + 20;
+bool parse_block_range(const std::string& range, std::string& start_ip, std::string& end_ip) {
+    size_t comma = range.find(',');
+    if (range == "none" || comma == std::string::npos) {
+        return false;
+    }
+    start_ip = range.substr(0, comma);
+    end_ip = range.substr(comma + 1);
+    return true;
 }
 
 /**
  * @brief Entry point for the load balancer simulation.
  *
  * Prompts the user for initial server counts and total simulation time,
- * optionally configures firewall blocked IP ranges, generates and processes
- * requests over time, scales servers based on load thresholds, and logs
- * periodic simulation statistics to a file.
+ * optionally configures firewall blocked IP ranges and runs one Simulation,
+ * which generates and processes requests over time, scales servers based on
+ * load thresholds, and logs periodic simulation statistics to a file.
+ *
+ * Any prompt can be answered ahead of time with a command-line option or a
+ * --config file (see Config). Supported options:
+ * - --streaming-servers=N, --processing-servers=N, --cycles=N
+ * - --types=S:20,P:20,V:4:20-60:0.05: any number of traffic classes instead of the
+ *   streaming and processing pools (see parse_pool_types)
+ * - --block-range=start_ip,end_ip (or "none")
+ * - --backends=N: draw destination IPs from N fixed backend addresses
+ * - --cache=lru|clock|tinylfu and --cache-capacity=N: enable the response cache
+ * - --low-load=X, --high-load=X, --check-buffer=N: scaling thresholds (queued requests
+ *   per server) and how often they are checked
+ * - --arrival-rate=X: mean requests per cycle instead of the built-in burst sizes
+ * - --initial-queue=N: requests queued per initial server before the first cycle (default 100)
+ * - --seed=N: seed the run's random number generator (default: current time)
+ * - --quiet=true: do not print per-request events
+ * - --stall-probability, --crash-probability, --slow-fraction (and related, see
+ *   read_resilience_settings): inject server faults
+ * - --hedge-after=N, --max-retries=N: hedge requests running longer than N cycles
+ *   and retry requests lost in a crash
+ * - --dispatch=first-idle|sec, --fast-share=X, --cheap-share=X, --fast-backlog=X,
+ *   --affinity-speedup=X: mixed fleets and shortest-expected-completion dispatch
+ *   (see read_fleet_settings)
+ * - --steal=true, --steal-penalty=X, --steal-limit=N, --steal-threshold=X: let idle pools
+ *   serve requests from backed-up pools at a service time penalty
+ * - --time-slice=N, --long-share=X, --long-time=LO,HI: draw a share of streaming
+ *   requests from a long range and preempt running requests every N cycles
+ * - --coalesce=N, --coalesce-window=N, --batch-setup=N: run up to N queued requests for
+ *   the same backend and type as one call that pays the setup cycles once
+ * - --auto-block-share=X, --auto-block-prefix-share=X, --auto-block-window=N,
+ *   --auto-block-cycles=N (and related, see read_heavy_hitter_settings): block sources
+ *   and /24s sending more than a share of the recent requests for N cycles;
+ *   --attack-share=X, --attackers=N: send a share of the traffic from N sources of one /24
+ * - --rtt=N, --prefetch=N: hand requests to servers over an N-cycle round trip, and let
+ *   each busy server hold up to N requests ahead so the next one is already local
+ * - --trace=PATH, --trace-sample=X, --trace-capacity=N: write the lifecycle of a sampled
+ *   fraction of requests as Chrome trace-event JSON (see RequestTracer)
+ * - --checkpoint=PATH, --checkpoint-at=N: save the full simulation state after cycle N
+ *   (default: the last cycle); --restore=PATH: resume a saved state and run up to --cycles
+ *   (server counts and the blocked ranges come from the checkpoint)
+ * - --metrics=PATH, --metrics-csv=PATH: record queue depths, server and idle counts,
+ *   arrivals, assignments, blocked requests and scale events for every cycle as
+ *   columnar binary and/or CSV (see MetricsRecorder)
+ * - --queue-budget=N, --spill-dir=DIR: keep about N queued requests per pool in memory
+ *   and spill the rest of a deep backlog to segment files in DIR (default /tmp)
+ * - --profile=true: time the loop steps and hot-path calls and print a per-phase
+ *   breakdown at the end (see profiler.h; compiled out with make PROFILE=0)
+ * - kill -USR1 <pid>: print the heap bytes and allocations of each component (queues,
+ *   servers, firewall, requests) at the end of the current cycle; the table is also
+ *   written at the end of the log (see alloc_counter.h; make MEMORY_TAGS=0 drops the tags)
+ * - --huge-pages=off|transparent|explicit: back the server tables and queue rings with
+ *   4 KiB pages, transparent huge pages (default) or hugetlbfs pages; --numa=true: in sweeps
+ *   and topologies, pin each thread to a NUMA node and take its buffers from that node
+ *   (see large_alloc.h)
+ * - --mode=net: serve framed requests over TCP instead of simulating (see NetFrontend)
+ * - --mode=sweep: run many quiet simulations over a parameter grid (see run_sweep)
+ * - --mode=topology: run several balancer instances on their own threads behind a front
+ *   distributor (see run_topology)
+ * - --mode=analytic: estimate server counts with an M/G/c model (see run_analytic)
+ * - --mode=validate: compare the model against simulated waits (see run_validation)
+ * - --source=shm, --shm-name=NAME, --shm-capacity=N, --shm-batch=N: take requests
+ *   from a shared-memory ring written by external producers instead of generating them
  *
+ * @param argc Argument count.
+ * @param argv Argument vector.
  * @return 0 on normal program termination.
  */
-int main(){
-    std::srand(static_cast<unsigned>(std::time(nullptr))); // seed random number generator
-    std::ofstream logFile("log.txt");
-
-    int initial_streaming_server_count = 0;
-    std::cout << "Enter an initial streaming server count: ";
-    std::cin >> initial_streaming_server_count;
-    logFile << "Initial streaming server count: " << initial_streaming_server_count << "." << std::endl;
-
-    int initial_processing_server_count = 0;
-    std::cout << "Enter an initial processing server count: ";
-    std::cin >> initial_processing_server_count;
-    logFile << "Initial processing server count: " << initial_processing_server_count << "." << std::endl;
-
-    int total_simulation_time = 0;
-    std::cout << "Enter total simulation time (clock cycles): ";
-    std::cin >> total_simulation_time;
-    logFile << "Total simulation time: " << total_simulation_time << " clock cycles." << std::endl;
-    int initial_request_count = (initial_streaming_server_count + initial_processing_server_count) * 100;
-    logFile << "Initial request queue size: " << initial_request_count << "." << std::endl;
-
-    int total_request_generated = initial_request_count;
-    int total_servers_created = initial_streaming_server_count + initial_processing_server_count;
-    int total_servers_removed = 0;
-
-    int clock = 0;
-    int check_server_count_buffer = 3; // only check load balancer and scale up/down servers every 3 clock cycles
-    int time_to_add_requests = generate_random_time();
-
-    int requests_per_clock = generate_random_request_count();
-
-    int blocked_requests = 0;
-
-
-    Firewall firewall;
-    logFile << "Firewall initialized" << std::endl;
-    LoadBalancer streaming_load_balancer;
-    logFile << "Streaming load balancer initialized" << std::endl;
-    LoadBalancer processing_load_balancer;
-    logFile << "Processing load balancer initialized" << std::endl;
-    ServerHandler streaming_server_handler;
-    logFile  << "Streaming server handler initialized" << std::endl;
-    ServerHandler processing_server_handler;
-    logFile << "Processing server handler initialized" << std::endl;
-
-    std::string block_choice;
-    std:: cout << "Would you like to block any IP ranges in the firewall before starting the simulation? (yes/no): ";
-    std::cin >> block_choice;
-
-    if (block_choice == "yes") {
-        std::cout << "Enter IP range to block in the format start_ip end_ip (e.g. 192.168.1.1 192.168.1.255): ";
+int main(int argc, char* argv[]){
+    Config config(argc, argv);
+    memory_report_on_signal();
+    HugePages huge_pages = HugePages::TRANSPARENT;
+    if (!parse_huge_pages(config.get_string("huge-pages", "transparent"), huge_pages)) {
+        std::cerr << RED << "Unknown --huge-pages mode; use off, transparent or explicit." << RESET << std::endl;
+        return 1;
+    }
+    large_alloc_configure(huge_pages, config.get_bool("numa", false));
+    if (config.get_string("mode", "simulate") == "net") {
+        Firewall firewall;
         std::string start_ip, end_ip;
-        std::cin >> start_ip >> end_ip;
-        logFile << "Blocking IP range: " << start_ip << " - " << end_ip << "." << std::endl;
-        firewall.blockRange(start_ip, end_ip);
+        if (parse_block_range(config.get_string("block-range", "none"), start_ip, end_ip)) {
+            firewall.blockRange(start_ip, end_ip);
+        }
+        NetFrontend frontend(config, firewall);
+        return frontend.run();
     }
 
-    logFile << "requests take random time to process between 1 and 13 clock cycles" << std::endl;
-    logFile << "Starting simulation..." << std::endl;
-   
-
-    // initialize servers
-    for (int i = 0; i < initial_streaming_server_count; ++i) {
-        streaming_server_handler.add_server();
+    if (config.get_string("mode", "simulate") == "sweep") {
+        return run_sweep(config);
     }
-    for (int i = 0; i < initial_processing_server_count; ++i) {
-        processing_server_handler.add_server();
+    if (config.get_string("mode", "simulate") == "topology") {
+        return run_topology(config);
     }
-
-    //initialze request and add to load balancers
-    for (int i = 0; i < initial_request_count; ++i){
-        Request request(generate_random_ip(), generate_random_ip(), generate_random_time(), generate_random_request_type());
-        if (firewall.isBlocked(request) == false){
-            if (request.get_request_type() == 'P') {
-                processing_load_balancer.queue_request(request);
-            } else {
-                streaming_load_balancer.queue_request(request);
-            }
-        }else{
-            std::cout << YELLOW <<  "Request from " << request.get_ip_in() << " is blocked by the firewall." << RESET << std::endl;
-            logFile << "Request from " << request.get_ip_in() << " is blocked by the firewall." << std::endl;
-            blocked_requests++;
-        }
+    if (config.get_string("mode", "simulate") == "analytic") {
+        return run_analytic(config);
+    }
+    if (config.get_string("mode", "simulate") == "validate") {
+        return run_validation(config);
     }
 
-    // Simulate processing requests
-    while (clock < total_simulation_time) {
-        // step 1: add new requests to the load balancers
-        if(time_to_add_requests <= 0){
-            for (int i = 0; i < requests_per_clock; ++i){
-                Request request(generate_random_ip(), generate_random_ip(), generate_random_time(), generate_random_request_type());
-                if (firewall.isBlocked(request) == false){
-                    if (request.get_request_type() == 'P') {
-                        processing_load_balancer.queue_request(request);
-                    } else {
-                        streaming_load_balancer.queue_request(request);
-                    }
-                    total_request_generated++;
-                }else{
-                    std::cout << YELLOW <<  "Request from " << request.get_ip_in() << " is blocked by the firewall." << RESET << std::endl;
-                    logFile << "Request from " << request.get_ip_in() << " is blocked by the firewall." << std::endl;
-                    blocked_requests++;
-                }
-            }
-            time_to_add_requests = generate_random_time();
-            requests_per_clock = generate_random_request_count();
-        }
+    std::ofstream logFile("log.txt");
+    SimulationParams params;
 
+    // with --types every traffic class carries its own server count; a checkpoint brings its own servers
+    bool restoring = config.has("restore");
+    if (!config.has("types") && !restoring) {
+        params.streaming_servers = read_int_setting(config, "streaming-servers", "Enter an initial streaming server count: ");
+        logFile << "Initial streaming server count: " << params.streaming_servers << "." << std::endl;
 
-        //step 2: check each server's busy time and update it
-        streaming_server_handler.update_servers();
-        processing_server_handler.update_servers();
+        params.processing_servers = read_int_setting(config, "processing-servers", "Enter an initial processing server count: ");
+        logFile << "Initial processing server count: " << params.processing_servers << "." << std::endl;
+    }
 
-        // step 3: check if there are any open servers and assign requests to them
+    params.cycles = read_int_setting(config, "cycles", "Enter total simulation time (clock cycles): ");
+    logFile << "Total simulation time: " << params.cycles << " clock cycles." << std::endl;
+
+    params.check_server_count_buffer = config.get_int("check-buffer", 3); // only check load balancer and scale up/down servers every 3 clock cycles
+    params.low_load = config.get_double("low-load", 50.0);
+    params.high_load = config.get_double("high-load", 80.0);
+    params.arrival_rate = config.get_double("arrival-rate", 0.0);
+    params.initial_requests_per_server = config.get_int("initial-queue", 100);
+    params.backends = config.get_int("backends", 0);
+    params.cache = config.get_string("cache", "off");
+    params.cache_capacity = config.get_int("cache-capacity", 1024);
+    params.shm_batch = config.get_int("shm-batch", 4096);
+    params.seed = config.has("seed") ? static_cast<uint32_t>(config.get_int("seed", 0)) : static_cast<uint32_t>(std::time(nullptr));
+    params.verbose = !config.get_bool("quiet", false);
+    params.checkpoint_path = config.get_string("checkpoint", "");
+    params.checkpoint_at = config.get_int("checkpoint-at", 0);
+    read_resilience_settings(config, params);
+    read_metrics_settings(config, params);
+    if (!read_fleet_settings(config, params) || !read_trace_settings(config, params) ||
+        !read_spill_settings(config, params) || !read_heavy_hitter_settings(config, params)) {
+        return 1;
+    }
 
-        while (!streaming_load_balancer.is_empty() && streaming_server_handler.get_available_server() != nullptr){
-            Request request = streaming_load_balancer.process_request();
-            Server* server = streaming_server_handler.assign_request(request);
-            if (server) {
-                std::cout << BLUE << "Assigned request from " << request.get_ip_in() << " sent to streaming server " << server->get_server_id() << "." << RESET << std::endl;
-            } else {
-                std::cout << YELLOW << "No available servers to handle the request from " << request.get_ip_in() << "." << RESET << std::endl;
-            }   
+    Firewall firewall;
+    if (restoring) {
+        // the checkpoint restores the blocked ranges
+    } else if (config.has("block-range")) {
+        std::string start_ip, end_ip;
+        if (parse_block_range(config.get_string("block-range", "none"), start_ip, end_ip)) {
+            logFile << "Blocking IP range: " << start_ip << " - " << end_ip << "." << std::endl;
+            firewall.blockRange(start_ip, end_ip);
         }
-        while (!processing_load_balancer.is_empty() && processing_server_handler.get_available_server() != nullptr){
-            Request request = processing_load_balancer.process_request();
-            Server* server = processing_server_handler.assign_request(request);
-            if (server) {
-                std::cout << BLUE << "Assigned request from " << request.get_ip_in() << " sent to processing server " << server->get_server_id() << "." << RESET << std::endl;
-            } else {
-                std::cout << YELLOW << "No available servers to handle the request from " << request.get_ip_in() <<  RESET << std::endl;
-            }   
+    } else {
+        std::string block_choice;
+        std:: cout << "Would you like to block any IP ranges in the firewall before starting the simulation? (yes/no): ";
+        std::cin >> block_choice;
+
+        if (block_choice == "yes") {
+            std::cout << "Enter IP range to block in the format start_ip end_ip (e.g. 192.168.1.1 192.168.1.255): ";
+            std::string start_ip, end_ip;
+            std::cin >> start_ip >> end_ip;
+            logFile << "Blocking IP range: " << start_ip << " - " << end_ip << "." << std::endl;
+            firewall.blockRange(start_ip, end_ip);
         }
+    }
 
-        //step 4: check load balancer and scale up or down servers only every check_server_count_buffer clocks
-        if (clock % check_server_count_buffer == 0) {
-            if (streaming_load_balancer.low_load(streaming_server_handler.get_server_count()) && streaming_server_handler.get_server_count() > 1){
-                // only scale down if there is a server that is not busy
-                Server* down_server = streaming_server_handler.get_available_server();
-                if (down_server) {
-                    streaming_server_handler.scale_down(down_server);
-                    total_servers_removed++;
-                    std::cout << RED << "Scaling down streaming servers. Current server count: " << streaming_server_handler.get_server_count() << "." << RESET << std::endl;
-                }
-            }else if (streaming_load_balancer.high_load(streaming_server_handler.get_server_count())){
-                streaming_server_handler.scale_up();
-                total_servers_created++;
-                std::cout << GREEN << "Scaling up streaming servers. Current server count: " << streaming_server_handler.get_server_count() << "." << RESET << std::endl;
-             } 
-
-             if(processing_load_balancer.low_load(processing_server_handler.get_server_count()) && processing_server_handler.get_server_count() > 1){
-                // only scale down if there is a server that is not busy
-                Server* down_server = processing_server_handler.get_available_server();
-                if (down_server) {
-                    processing_server_handler.scale_down(down_server);
-                    total_servers_removed++;
-                    std::cout << RED << "Scaling down processing servers. Current server count: " << processing_server_handler.get_server_count() << "." << RESET << std::endl;
-                }
-            }else if (processing_load_balancer.high_load(processing_server_handler.get_server_count())){
-                processing_server_handler.scale_up();
-                total_servers_created++;
-                std::cout << GREEN << "Scaling up processing servers. Current server count: " << processing_server_handler.get_server_count() << "." << RESET << std::endl;
-             }
+    std::unique_ptr<ShmRing> ring;
+    if (config.get_string("source", "random") == "shm") {
+        std::string shm_name = config.get_string("shm-name", "/lb_requests");
+        ring = ShmRing::create(shm_name, config.get_int("shm-capacity", 65536));
+        if (!ring) {
+            std::cout << RED << "Could not create shared-memory ring " << shm_name << "." << RESET << std::endl;
+            return 1;
         }
+        logFile << "Ingesting requests from shared-memory ring " << shm_name << " (" << ring->capacity() << " slots)." << std::endl;
+        std::cout << GREEN << "Waiting for producers on shared-memory ring " << shm_name << "." << RESET << std::endl;
+    }
 
-        // step 5: increment clock
-        clock++;
-        time_to_add_requests--;
-        std::cout << BLUE << "Clock: " << clock << RESET << std::endl;
-        if (clock % 50 == 0) {
-            logFile << std::endl;
-            logFile << "Clock: " << clock << std::endl;
-            logFile << "Current streaming server count: " << streaming_server_handler.get_server_count() << "." << std::endl;
-            logFile << "Current streaming load balancer queue size: " << streaming_load_balancer.get_queue_size() << "." << std::endl;
-
-            logFile << "Current processing server count: " << processing_server_handler.get_server_count() << "." << std::endl;
-            logFile << "Current processing load balancer queue size: " << processing_load_balancer.get_queue_size() << "." << std::endl;
-
-            logFile << "Requests processed (or currently processing) so far: " << total_request_generated - streaming_load_balancer.get_queue_size() - processing_load_balancer.get_queue_size() << "." << std::endl;
+    bool profiling = config.get_bool("profile", false);
+    if (profiling && !PROFILE_COMPILED) {
+        std::cout << YELLOW << "Profiling was compiled out (PROFILE=0); --profile ignored." << RESET << std::endl;
+        profiling = false;
+    }
+    Simulation simulation(params, firewall, &logFile);
+    simulation.set_source(ring.get());
+    if (restoring) {
+        std::string checkpoint = config.get_string("restore", "");
+        auto started = std::chrono::steady_clock::now();
+        if (!read_checkpoint(checkpoint, firewall, simulation)) {
+            return 1;
         }
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        std::cout << GREEN << "Restored " << checkpoint << " at clock cycle " << simulation.get_clock() << " in "
+                  << elapsed << " ms." << RESET << std::endl;
+        logFile << "Restored " << checkpoint << " (clock cycle " << simulation.get_clock() << ") in " << elapsed << " ms." << std::endl;
+    }
+    profile_set_enabled(profiling);
+    simulation.run();
+    if (profiling) {
+        profile_set_enabled(false);
+        profile_report(std::cout);
+        profile_report(logFile);
     }
-
-    logFile << std::endl << std::endl;
-    logFile << "Simulation ended at clock " << clock << "." << std::endl;
-    logFile << "Final streaming server count: " << streaming_server_handler.get_server_count() << std::endl;
-    logFile << "Final processing server count: " << processing_server_handler.get_server_count() << std::endl;
-
-    logFile << "Total request queue size at the end of simulation: " << streaming_load_balancer.get_queue_size() + processing_load_balancer.get_queue_size() << std::endl;
-    logFile << "Final streaming load balancer queue size: " << streaming_load_balancer.get_queue_size() << std::endl;
-    logFile << "Final processing load balancer queue size: " << processing_load_balancer.get_queue_size() << std::endl;
-
-    logFile << "Total requests generated: " << total_request_generated << std::endl;
-    logFile << "Total requests processed (or currently processing): " << total_request_generated - streaming_load_balancer.get_queue_size() - processing_load_balancer.get_queue_size() << std::endl;
-    
-    logFile << "Total servers created: " << total_servers_created << std::endl;
-    logFile << "Total servers removed: " << total_servers_removed << std::endl;
-    logFile << "Total requests blocked by firewall: " << blocked_requests << std::endl;
     logFile.close();
-}
\ No newline at end of file
+}
@@ -0,0 +1,202 @@
+/**
+ * @file metrics_recorder.cpp
+ * @brief Implements the MetricsRecorder and its background writer thread.
+ */
+
+#include "metrics_recorder.h"
+#include <charconv>
+
+namespace {
+
+/**
+ * @brief Blocks preallocated per recorder: one being filled and two the writer can work through.
+ */
+const size_t BLOCK_COUNT = 3;
+
+/**
+ * @brief Writes a trivially copyable value in native byte order.
+ *
+ * @param out Output stream.
+ * @param value Value to write.
+ */
+template <class T>
+void write_raw(std::ofstream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+} // namespace
+
+/**
+ * @brief Constructs a recorder and preallocates its blocks.
+ *
+ * @param columns Column names, in column order.
+ * @param block_rows Rows per block handed to the writer thread.
+ */
+MetricsRecorder::MetricsRecorder(const std::vector<std::string>& columns, size_t block_rows)
+    : names(columns), block_rows(block_rows > 0 ? block_rows : 1), totals(columns.size(), 0), current(nullptr),
+      handed_rows(0), stopping(false) {
+    for (size_t i = 0; i < BLOCK_COUNT; ++i) {
+        blocks.emplace_back(new Block());
+        blocks.back()->values.resize(names.size() * this->block_rows);
+        spare.push_back(blocks.back().get());
+    }
+    current = spare.back();
+    spare.pop_back();
+}
+
+/**
+ * @brief Writes out the last partial block and stops the writer thread.
+ */
+MetricsRecorder::~MetricsRecorder() {
+    close();
+}
+
+/**
+ * @brief Opens the output files, writes their headers and starts the writer thread.
+ *
+ * @param binary_path Columnar binary output (empty = none).
+ * @param csv_path CSV output (empty = none).
+ * @return false if a file could not be opened.
+ */
+bool MetricsRecorder::open(const std::string& binary_path, const std::string& csv_path) {
+    if (!binary_path.empty()) {
+        binary.open(binary_path, std::ios::binary | std::ios::trunc);
+        if (!binary) {
+            return false;
+        }
+        binary.write("LBMT", 4);
+        write_raw(binary, VERSION);
+        write_raw(binary, static_cast<uint32_t>(names.size()));
+        write_raw(binary, static_cast<uint32_t>(block_rows));
+        for (const std::string& name : names) {
+            write_raw(binary, static_cast<uint32_t>(name.size()));
+            binary.write(name.data(), static_cast<std::streamsize>(name.size()));
+        }
+    }
+    if (!csv_path.empty()) {
+        csv.open(csv_path, std::ios::trunc);
+        if (!csv) {
+            return false;
+        }
+        for (size_t column = 0; column < names.size(); ++column) {
+            csv << (column > 0 ? "," : "") << names[column];
+        }
+        csv << '\n';
+    }
+    writer = std::thread(&MetricsRecorder::write_loop, this);
+    return true;
+}
+
+/**
+ * @brief Writes out the last partial block, stops the writer thread and closes the files.
+ *
+ * Does nothing if the recorder was never opened or is already closed.
+ *
+ * @return false if a write failed.
+ */
+bool MetricsRecorder::close() {
+    if (!writer.joinable()) {
+        return true;
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (current->rows > 0) {
+            handed_rows += static_cast<long long>(current->rows);
+            full.push_back(current);
+        } else {
+            spare.push_back(current);
+        }
+        current = nullptr;
+        stopping = true;
+    }
+    changed.notify_all();
+    writer.join();
+    bool ok = true;
+    if (binary.is_open()) {
+        binary.close();
+        ok = ok && !binary.fail();
+    }
+    if (csv.is_open()) {
+        csv.close();
+        ok = ok && !csv.fail();
+    }
+    return ok;
+}
+
+/**
+ * @brief Returns the number of completed rows.
+ *
+ * @return Rows recorded so far.
+ */
+long long MetricsRecorder::get_rows() const {
+    return handed_rows + (current ? static_cast<long long>(current->rows) : 0);
+}
+
+/**
+ * @brief Queues the current block for writing and takes a free one.
+ *
+ * Only waits if the writer thread is two blocks behind.
+ */
+void MetricsRecorder::hand_off() {
+    handed_rows += static_cast<long long>(current->rows);
+    std::unique_lock<std::mutex> guard(lock);
+    full.push_back(current);
+    changed.notify_all();
+    changed.wait(guard, [this] { return !spare.empty(); });
+    current = spare.back();
+    spare.pop_back();
+    current->rows = 0;
+}
+
+/**
+ * @brief Body of the writer thread.
+ *
+ * Writes full blocks in order and returns them to the spare list; exits
+ * when stopping is set and nothing is left to write.
+ */
+void MetricsRecorder::write_loop() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        changed.wait(guard, [this] { return !full.empty() || stopping; });
+        if (full.empty()) {
+            return;
+        }
+        Block* block = full.front();
+        full.pop_front();
+        guard.unlock();
+        write_block(*block);
+        guard.lock();
+        spare.push_back(block);
+        changed.notify_all();
+    }
+}
+
+/**
+ * @brief Appends a block to the open files.
+ *
+ * @param block Block to write.
+ */
+void MetricsRecorder::write_block(const Block& block) {
+    if (binary.is_open()) {
+        write_raw(binary, static_cast<uint32_t>(block.rows));
+        for (size_t column = 0; column < names.size(); ++column) {
+            binary.write(reinterpret_cast<const char*>(block.values.data() + column * block_rows),
+                         static_cast<std::streamsize>(block.rows * sizeof(int32_t)));
+        }
+    }
+    if (csv.is_open()) {
+        char number[16];
+        for (size_t row = 0; row < block.rows; ++row) {
+            line.clear();
+            for (size_t column = 0; column < names.size(); ++column) {
+                if (column > 0) {
+                    line += ',';
+                }
+                char* end = std::to_chars(number, number + sizeof(number), block.values[column * block_rows + row]).ptr;
+                line.append(number, end);
+            }
+            line += '\n';
+            csv.write(line.data(), static_cast<std::streamsize>(line.size()));
+        }
+    }
+}
@@ -0,0 +1,222 @@
+/**
+ * @file metrics_recorder.h
+ * @brief Declares the per-tick metrics recorder and its columnar file format.
+ *
+ * The recorder keeps one int32 value per column and clock cycle in
+ * preallocated blocks of block_rows rows, stored column by column. A full
+ * block is handed to a background thread, which appends it to the binary
+ * file and/or the CSV file, so a tick only stores a few integers.
+ *
+ * Binary layout (native byte order): magic "LBMT", uint32 version, uint32
+ * column count, uint32 block_rows, then per column a uint32 name length and
+ * the name. The data follows as blocks, each a uint32 row count followed by
+ * every column's values for those rows (row count int32 values per column).
+ */
+
+#ifndef METRICS_RECORDER_H
+#define METRICS_RECORDER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class MetricsRecorder
+ * @brief Records rows of int32 counters and writes them out on a background thread.
+ */
+class MetricsRecorder {
+public:
+
+    /**
+     * @brief Format version written to the binary header.
+     */
+    static constexpr uint32_t VERSION = 1;
+
+    /**
+     * @brief Constructs a recorder and preallocates its blocks.
+     *
+     * @param columns Column names, in column order.
+     * @param block_rows Rows per block handed to the writer thread.
+     */
+    explicit MetricsRecorder(const std::vector<std::string>& columns, size_t block_rows = 4096);
+
+    /**
+     * @brief Writes out the last partial block and stops the writer thread.
+     */
+    ~MetricsRecorder();
+
+    MetricsRecorder(const MetricsRecorder&) = delete;
+    MetricsRecorder& operator=(const MetricsRecorder&) = delete;
+
+    /**
+     * @brief Opens the output files, writes their headers and starts the writer thread.
+     *
+     * @param binary_path Columnar binary output (empty = none).
+     * @param csv_path CSV output (empty = none).
+     * @return false if a file could not be opened.
+     */
+    bool open(const std::string& binary_path, const std::string& csv_path);
+
+    /**
+     * @brief Sets a value of the current row.
+     *
+     * @param column Column index.
+     * @param value Value for the current cycle.
+     */
+    void set(size_t column, int32_t value) {
+        current->values[column * block_rows + current->rows] = value;
+    }
+
+    /**
+     * @brief Sets a value of the current row to the growth of a running total.
+     *
+     * @param column Column index.
+     * @param total Running total; the column receives its change since the previous row.
+     */
+    void set_delta(size_t column, long long total) {
+        set(column, static_cast<int32_t>(total - totals[column]));
+        totals[column] = total;
+    }
+
+    /**
+     * @brief Sets the running total that the next set_delta() of a column is relative to.
+     *
+     * @param column Column index.
+     * @param total Current value of the running total.
+     */
+    void prime(size_t column, long long total) {
+        totals[column] = total;
+    }
+
+    /**
+     * @brief Completes the current row; a full block goes to the writer thread.
+     */
+    void end_row() {
+        if (++current->rows == block_rows) {
+            hand_off();
+        }
+    }
+
+    /**
+     * @brief Writes out the last partial block, stops the writer thread and closes the files.
+     *
+     * @return false if a write failed.
+     */
+    bool close();
+
+    /**
+     * @brief Returns the number of completed rows.
+     */
+    long long get_rows() const;
+
+private:
+
+    /**
+     * @brief Column-major values of up to block_rows rows.
+     */
+    struct Block {
+        std::vector<int32_t> values;  ///< Column c, row r is at c * block_rows + r.
+        size_t rows = 0;              ///< Completed rows.
+    };
+
+    /**
+     * @brief Queues the current block for writing and takes a free one.
+     */
+    void hand_off();
+
+    /**
+     * @brief Body of the writer thread.
+     */
+    void write_loop();
+
+    /**
+     * @brief Appends a block to the open files.
+     *
+     * @param block Block to write.
+     */
+    void write_block(const Block& block);
+
+    /**
+     * @brief Column names.
+     */
+    std::vector<std::string> names;
+
+    /**
+     * @brief Rows per block.
+     */
+    size_t block_rows;
+
+    /**
+     * @brief Running totals of set_delta() columns.
+     */
+    std::vector<long long> totals;
+
+    /**
+     * @brief Every block, owned here; the others point into it.
+     */
+    std::vector<std::unique_ptr<Block>> blocks;
+
+    /**
+     * @brief Block receiving the current row.
+     */
+    Block* current;
+
+    /**
+     * @brief Rows in blocks already handed off.
+     */
+    long long handed_rows;
+
+    /**
+     * @brief Guards full, spare and stopping.
+     */
+    std::mutex lock;
+
+    /**
+     * @brief Signals the writer about a full block and the tick thread about a spare one.
+     */
+    std::condition_variable changed;
+
+    /**
+     * @brief Blocks waiting to be written, oldest first.
+     */
+    std::deque<Block*> full;
+
+    /**
+     * @brief Written blocks ready for reuse.
+     */
+    std::vector<Block*> spare;
+
+    /**
+     * @brief Whether the writer should exit once full is empty.
+     */
+    bool stopping;
+
+    /**
+     * @brief Columnar binary output.
+     */
+    std::ofstream binary;
+
+    /**
+     * @brief CSV output.
+     */
+    std::ofstream csv;
+
+    /**
+     * @brief Scratch line for CSV formatting (writer thread only).
+     */
+    std::string line;
+
+    /**
+     * @brief Writer thread (not joinable until open()).
+     */
+    std::thread writer;
+};
+
+#endif
@@ -0,0 +1,485 @@
+/**
+ * @file net_frontend.cpp
+ * @brief Implements the NetFrontend epoll event loop and worker threads.
+ */
+
+#include "net_frontend.h"
+#include "net_protocol.h"
+#include "request.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+
+/**
+ * @brief ANSI escape code for green-colored console output.
+ */
+#define GREEN   "\033[32m"
+
+/**
+ * @brief ANSI escape code for red-colored console output.
+ */
+#define RED     "\033[31m"
+
+/**
+ * @brief ANSI escape code to reset console color formatting.
+ */
+#define RESET   "\033[0m"
+
+namespace {
+
+/**
+ * @brief epoll tag of the listening socket.
+ */
+const uint64_t LISTEN_TAG = 0;
+
+/**
+ * @brief epoll tag of the completion eventfd.
+ */
+const uint64_t EVENT_TAG = 1;
+
+/**
+ * @brief Set by SIGINT/SIGTERM to end the event loop.
+ */
+volatile std::sig_atomic_t stop_requested = 0;
+
+/**
+ * @brief Signal handler requesting a clean shutdown.
+ */
+void handle_stop_signal(int) {
+    stop_requested = 1;
+}
+
+} // namespace
+
+/**
+ * @brief Constructs a front end using the given options and firewall.
+ *
+ * @param config Options controlling port, pool sizes and timing.
+ * @param firewall Firewall used to filter incoming requests.
+ */
+NetFrontend::NetFrontend(const Config& config, const Firewall& firewall)
+    : firewall(firewall), port(config.get_int("port", 9090)), tick_us(config.get_int("tick-us", 100)),
+      max_work(config.get_int("max-work", 100)), duration(config.get_int("duration", 0)),
+      streaming_count(config.get_int("streaming-servers", 4)), processing_count(config.get_int("processing-servers", 4)),
+      epoll_fd(-1), listen_fd(-1), event_fd(-1), next_connection_id(2),
+      streaming('S', arena), processing('P', arena),
+      received(0), served(0), blocked(0), invalid(0), accepted(0) {}
+
+/**
+ * @brief Stops any running worker threads and closes descriptors.
+ */
+NetFrontend::~NetFrontend() {
+    stop_workers();
+    for (auto& entry : connections) {
+        close(entry.second.fd);
+    }
+    if (listen_fd >= 0) close(listen_fd);
+    if (event_fd >= 0) close(event_fd);
+    if (epoll_fd >= 0) close(epoll_fd);
+}
+
+/**
+ * @brief Runs the event loop until the duration elapses or a signal arrives.
+ *
+ * Each iteration waits up to 100 ms for socket or completion events, handles
+ * them, and then dispatches queued requests to idle servers.
+ *
+ * @return 0 on normal shutdown, 1 if the listening socket could not be set up.
+ */
+int NetFrontend::run() {
+    if (!open_listener()) {
+        return 1;
+    }
+    std::signal(SIGINT, handle_stop_signal);
+    std::signal(SIGTERM, handle_stop_signal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    start_pool(streaming, streaming_count);
+    start_pool(processing, processing_count);
+    std::cout << GREEN << "Listening on 127.0.0.1:" << port << " with " << streaming_count << " streaming and "
+              << processing_count << " processing workers." << RESET << std::endl;
+
+    auto started = std::chrono::steady_clock::now();
+    epoll_event events[64];
+    while (!stop_requested) {
+        int ready = epoll_wait(epoll_fd, events, 64, 100);
+        if (ready < 0 && errno != EINTR) {
+            std::cerr << RED << "epoll_wait failed: " << std::strerror(errno) << RESET << std::endl;
+            break;
+        }
+        for (int i = 0; i < ready; ++i) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == LISTEN_TAG) {
+                accept_connections();
+            } else if (tag == EVENT_TAG) {
+                uint64_t count;
+                while (read(event_fd, &count, sizeof(count)) > 0) {
+                }
+                drain_completions();
+            } else {
+                auto it = connections.find(tag);
+                if (it == connections.end()) {
+                    continue;
+                }
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    close_connection(tag);
+                    continue;
+                }
+                if (events[i].events & EPOLLOUT) {
+                    flush_connection(tag, it->second);
+                }
+                if (events[i].events & (EPOLLIN | EPOLLRDHUP)) {
+                    read_connection(tag);
+                }
+            }
+        }
+        dispatch();
+        if (duration > 0 && std::chrono::steady_clock::now() - started >= std::chrono::seconds(duration)) {
+            break;
+        }
+    }
+
+    stop_workers();
+    std::cout << GREEN << "Front end stopped. Connections: " << accepted << ", requests received: " << received
+              << ", served: " << served << ", blocked: " << blocked << ", invalid: " << invalid << "." << RESET << std::endl;
+    return 0;
+}
+
+/**
+ * @brief Creates, binds and registers the listening socket and the eventfd.
+ *
+ * @return true on success, false if any system call failed.
+ */
+bool NetFrontend::open_listener() {
+    epoll_fd = epoll_create1(0);
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    event_fd = eventfd(0, EFD_NONBLOCK);
+    if (epoll_fd < 0 || listen_fd < 0 || event_fd < 0) {
+        std::cerr << RED << "Could not create sockets: " << std::strerror(errno) << RESET << std::endl;
+        return false;
+    }
+    int enable = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listen_fd, 128) < 0) {
+        std::cerr << RED << "Could not listen on port " << port << ": " << std::strerror(errno) << RESET << std::endl;
+        return false;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = LISTEN_TAG;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+    event.data.u64 = EVENT_TAG;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_fd, &event);
+    return true;
+}
+
+/**
+ * @brief Accepts every pending connection on the listening socket.
+ *
+ * New sockets are non-blocking with Nagle's algorithm disabled so that small
+ * response frames are sent immediately.
+ */
+void NetFrontend::accept_connections() {
+    while (true) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK);
+        if (fd < 0) {
+            return;
+        }
+        int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        uint64_t id = next_connection_id++;
+        connections[id] = Connection{fd, {}, {}, false};
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.u64 = id;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+        accepted++;
+    }
+}
+
+/**
+ * @brief Reads available bytes from a connection and parses frames.
+ *
+ * @param connection_id Connection to read from.
+ */
+void NetFrontend::read_connection(uint64_t connection_id) {
+    Connection& connection = connections[connection_id];
+    uint8_t buffer[16384];
+    bool closed = false;
+    while (true) {
+        ssize_t count = read(connection.fd, buffer, sizeof(buffer));
+        if (count > 0) {
+            connection.input.insert(connection.input.end(), buffer, buffer + count);
+            continue;
+        }
+        if (count == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            closed = true;
+        }
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        break;
+    }
+    parse_frames(connection_id, connection);
+    if (closed) {
+        close_connection(connection_id);
+    }
+}
+
+/**
+ * @brief Filters and queues every complete frame in a connection's buffer.
+ *
+ * All frames received in one read are classified with a single
+ * Firewall::classify_batch call. Blocked and malformed requests are answered
+ * immediately; the rest are queued on the pool matching their type.
+ *
+ * @param connection_id Connection that sent the frames.
+ * @param connection State of that connection.
+ */
+void NetFrontend::parse_frames(uint64_t connection_id, Connection& connection) {
+    size_t frame_count = connection.input.size() / REQUEST_FRAME_SIZE;
+    if (frame_count == 0) {
+        return;
+    }
+    std::vector<RequestFrame> frames(frame_count);
+    std::vector<uint32_t> ips(frame_count);
+    std::vector<uint8_t> verdicts((frame_count + 7) / 8);
+    for (size_t i = 0; i < frame_count; ++i) {
+        frames[i] = decode_request_frame(connection.input.data() + i * REQUEST_FRAME_SIZE);
+        ips[i] = frames[i].ip_in;
+    }
+    connection.input.erase(connection.input.begin(), connection.input.begin() + frame_count * REQUEST_FRAME_SIZE);
+    firewall.classify_batch(ips.data(), frame_count, verdicts.data());
+
+    received += frame_count;
+    for (size_t i = 0; i < frame_count; ++i) {
+        const RequestFrame& frame = frames[i];
+        if (Firewall::is_blocked_verdict(verdicts.data(), i)) {
+            blocked++;
+            respond(connection_id, frame.sequence, static_cast<uint8_t>(FrameStatus::BLOCKED), -1);
+            continue;
+        }
+        if ((frame.request_type != 'P' && frame.request_type != 'S') || frame.time_to_process < 1 ||
+            frame.time_to_process > max_work) {
+            invalid++;
+            respond(connection_id, frame.sequence, static_cast<uint8_t>(FrameStatus::INVALID), -1);
+            continue;
+        }
+        RequestHandle request = arena.create(frame.ip_in, frame.ip_out, frame.time_to_process, frame.request_type);
+        pending[arena.get(request).get_request_id()] = Pending{connection_id, frame.sequence};
+        pool_for(frame.request_type).balancer.queue_request(std::move(request));
+    }
+}
+
+/**
+ * @brief Writes as much buffered output as the socket accepts.
+ *
+ * EPOLLOUT is armed only while output remains, so idle connections do not
+ * wake the loop.
+ *
+ * @param connection_id Connection to flush.
+ * @param connection State of that connection.
+ */
+void NetFrontend::flush_connection(uint64_t connection_id, Connection& connection) {
+    size_t written = 0;
+    while (written < connection.output.size()) {
+        ssize_t count = write(connection.fd, connection.output.data() + written, connection.output.size() - written);
+        if (count > 0) {
+            written += count;
+        } else if (count < 0 && errno == EINTR) {
+            continue;
+        } else {
+            break;
+        }
+    }
+    connection.output.erase(connection.output.begin(), connection.output.begin() + written);
+    bool want_write = !connection.output.empty();
+    if (want_write != connection.want_write) {
+        epoll_event event{};
+        event.events = static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP) | (want_write ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+        event.data.u64 = connection_id;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.want_write = want_write;
+    }
+}
+
+/**
+ * @brief Closes a connection and forgets its buffers.
+ *
+ * Requests still in flight for the connection are processed normally; their
+ * responses are dropped because the connection no longer exists.
+ *
+ * @param connection_id Connection to close.
+ */
+void NetFrontend::close_connection(uint64_t connection_id) {
+    auto it = connections.find(connection_id);
+    if (it == connections.end()) {
+        return;
+    }
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+    close(it->second.fd);
+    connections.erase(it);
+}
+
+/**
+ * @brief Queues a response frame for a connection and tries to send it.
+ *
+ * @param connection_id Connection to answer.
+ * @param sequence Sequence number of the answered request.
+ * @param status FrameStatus value of the outcome.
+ * @param server_id Server that processed the request, or -1.
+ */
+void NetFrontend::respond(uint64_t connection_id, uint32_t sequence, uint8_t status, int server_id) {
+    auto it = connections.find(connection_id);
+    if (it == connections.end()) {
+        return;
+    }
+    uint8_t frame[RESPONSE_FRAME_SIZE];
+    encode_response_frame(ResponseFrame{sequence, static_cast<FrameStatus>(status), server_id}, frame);
+    it->second.output.insert(it->second.output.end(), frame, frame + RESPONSE_FRAME_SIZE);
+    flush_connection(connection_id, it->second);
+}
+
+/**
+ * @brief Applies completions reported by worker threads.
+ *
+ * Each finished server is marked available again and the client that sent
+ * the request receives a SERVED response.
+ */
+void NetFrontend::drain_completions() {
+    std::vector<Completion> finished;
+    {
+        std::lock_guard<std::mutex> lock(completion_mutex);
+        finished.swap(completions);
+    }
+    for (const Completion& completion : finished) {
+        Pool& pool = pool_for(completion.pool);
+        Server* server = pool.servers.server_at(completion.slot);
+        int server_id = server->get_server_id();
+        pool.servers.finish_request(server);
+        served++;
+        auto it = pending.find(completion.request_id);
+        if (it != pending.end()) {
+            respond(it->second.connection_id, it->second.sequence, static_cast<uint8_t>(FrameStatus::SERVED), server_id);
+            pending.erase(it);
+        }
+    }
+}
+
+/**
+ * @brief Hands queued requests to idle servers of every pool.
+ *
+ * ServerHandler::assign_request marks the chosen server busy; the matching
+ * worker thread then performs the work and reports back.
+ */
+void NetFrontend::dispatch() {
+    for (Pool* pool : {&streaming, &processing}) {
+        while (!pool->balancer.is_empty() && pool->servers.get_available_server() != nullptr) {
+            RequestHandle handle = pool->balancer.process_request();
+            const Request& request = arena.get(handle);
+            Job job{request.get_request_id(), request.get_time_to_process()};
+            Server* server = pool->servers.assign_request(std::move(handle));
+            Worker& worker = *pool->workers[server->get_slot()];
+            {
+                std::lock_guard<std::mutex> lock(worker.mutex);
+                worker.jobs.push_back(job);
+            }
+            worker.cv.notify_one();
+        }
+    }
+}
+
+/**
+ * @brief Starts the worker threads of a pool, one per server.
+ *
+ * @param pool Pool to populate.
+ * @param server_count Number of servers (and worker threads).
+ */
+void NetFrontend::start_pool(Pool& pool, int server_count) {
+    for (int i = 0; i < server_count; ++i) {
+        pool.servers.add_server();
+        pool.workers.emplace_back(new Worker());
+    }
+    for (size_t slot = 0; slot < pool.workers.size(); ++slot) {
+        Worker& worker = *pool.workers[slot];
+        worker.thread = std::thread(&NetFrontend::worker_loop, this, std::ref(pool), std::ref(worker), slot);
+    }
+}
+
+/**
+ * @brief Body of a worker thread.
+ *
+ * Waits for a job, sleeps tick_us microseconds per clock cycle of work, and
+ * reports the completion to the event loop through the eventfd.
+ *
+ * @param pool Pool the worker belongs to.
+ * @param worker Worker state.
+ * @param slot Server slot the worker stands in for.
+ */
+void NetFrontend::worker_loop(Pool& pool, Worker& worker, size_t slot) {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            worker.cv.wait(lock, [&worker] { return worker.stop || !worker.jobs.empty(); });
+            if (worker.stop) {
+                return;
+            }
+            job = worker.jobs.front();
+            worker.jobs.pop_front();
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(static_cast<long long>(job.time_to_process) * tick_us));
+        {
+            std::lock_guard<std::mutex> lock(completion_mutex);
+            completions.push_back(Completion{job.request_id, pool.type, slot});
+        }
+        uint64_t one = 1;
+        ssize_t ignored = write(event_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+/**
+ * @brief Stops and joins every worker thread.
+ */
+void NetFrontend::stop_workers() {
+    for (Pool* pool : {&streaming, &processing}) {
+        for (auto& worker : pool->workers) {
+            {
+                std::lock_guard<std::mutex> lock(worker->mutex);
+                worker->stop = true;
+            }
+            worker->cv.notify_one();
+        }
+        for (auto& worker : pool->workers) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+    }
+}
+
+/**
+ * @brief Returns the pool serving a request type.
+ *
+ * @param type Request type ('P' or 'S').
+ * @return The processing pool for 'P', otherwise the streaming pool.
+ */
+NetFrontend::Pool& NetFrontend::pool_for(char type) {
+    return type == 'P' ? processing : streaming;
+}
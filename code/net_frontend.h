@@ -0,0 +1,272 @@
+/**
+ * @file net_frontend.h
+ * @brief Declares the NetFrontend class serving real loopback traffic.
+ *
+ * This header defines an optional network ingress mode. Clients connect over
+ * TCP on localhost and send fixed-size request frames (see net_protocol.h);
+ * each request is filtered by the Firewall, queued on the streaming or
+ * processing LoadBalancer and dispatched to a worker thread that stands in for
+ * a Server. A response frame is returned when the request has been handled.
+ */
+
+#ifndef NET_FRONTEND_H
+#define NET_FRONTEND_H
+
+#include "config.h"
+#include "firewall.h"
+#include "load_balancer.h"
+#include "request_arena.h"
+#include "server_handler.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class NetFrontend
+ * @brief Non-blocking epoll event loop feeding the balancers from TCP clients.
+ *
+ * A single event-loop thread owns the sockets, the load balancers and the
+ * server handlers. Worker threads only receive jobs and report completions;
+ * completions are handed back to the event loop through an eventfd so that
+ * all balancing state is touched by one thread.
+ *
+ * Options (see Config): --port (default 9090), --streaming-servers and
+ * --processing-servers (worker threads per pool, default 4), --tick-us
+ * (wall-clock microseconds per clock cycle of work, default 100),
+ * --max-work (largest time_to_process a frame may ask for, default 100;
+ * frames outside 1..max-work are answered with FrameStatus::INVALID) and
+ * --duration (seconds to run, 0 = until SIGINT/SIGTERM).
+ */
+class NetFrontend {
+public:
+
+    /**
+     * @brief Constructs a front end using the given options and firewall.
+     *
+     * @param config Options controlling port, pool sizes and timing.
+     * @param firewall Firewall used to filter incoming requests.
+     */
+    NetFrontend(const Config& config, const Firewall& firewall);
+
+    /**
+     * @brief Stops any running worker threads.
+     */
+    ~NetFrontend();
+
+    /**
+     * @brief Runs the event loop until the duration elapses or a signal arrives.
+     *
+     * @return 0 on normal shutdown, 1 if the listening socket could not be set up.
+     */
+    int run();
+
+private:
+
+    /**
+     * @brief State of one client connection.
+     */
+    struct Connection {
+        int fd;                      ///< Socket descriptor.
+        std::vector<uint8_t> input;  ///< Bytes received but not yet parsed.
+        std::vector<uint8_t> output; ///< Encoded responses not yet written.
+        bool want_write;             ///< Whether EPOLLOUT is currently armed.
+    };
+
+    /**
+     * @brief Client and sequence number waiting for a dispatched request.
+     */
+    struct Pending {
+        uint64_t connection_id; ///< Connection that sent the request.
+        uint32_t sequence;      ///< Sequence number to echo back.
+    };
+
+    /**
+     * @brief Work item handed to a worker thread.
+     */
+    struct Job {
+        int request_id;      ///< ID of the Request being processed.
+        int time_to_process; ///< Clock cycles of work to perform.
+    };
+
+    /**
+     * @brief Notification that a worker finished a job.
+     */
+    struct Completion {
+        int request_id; ///< ID of the finished Request.
+        char pool;      ///< Request type of the pool that handled it.
+        size_t slot;    ///< Server slot (and worker index) in that pool.
+    };
+
+    /**
+     * @brief Worker thread standing in for one Server.
+     */
+    struct Worker {
+        std::thread thread;          ///< The worker thread.
+        std::mutex mutex;            ///< Guards jobs and stop.
+        std::condition_variable cv;  ///< Signalled when a job arrives.
+        std::deque<Job> jobs;        ///< Jobs waiting for this worker.
+        bool stop = false;           ///< Set to end the thread.
+    };
+
+    /**
+     * @brief A load balancer with its servers and their worker threads.
+     */
+    struct Pool {
+        /**
+         * @brief Constructs an empty pool for a request type.
+         */
+        Pool(char type, RequestArena& arena) : type(type), servers(arena) {}
+
+        char type;                                    ///< Request type served by the pool.
+        LoadBalancer balancer;                        ///< Queue of waiting requests.
+        ServerHandler servers;                        ///< Availability of each server.
+        std::vector<std::unique_ptr<Worker>> workers; ///< Worker per server slot.
+    };
+
+    /**
+     * @brief Creates, binds and registers the listening socket.
+     */
+    bool open_listener();
+
+    /**
+     * @brief Accepts every pending connection on the listening socket.
+     */
+    void accept_connections();
+
+    /**
+     * @brief Reads available bytes from a connection and parses frames.
+     */
+    void read_connection(uint64_t connection_id);
+
+    /**
+     * @brief Filters and queues every complete frame in a connection's buffer.
+     */
+    void parse_frames(uint64_t connection_id, Connection& connection);
+
+    /**
+     * @brief Writes as much buffered output as the socket accepts.
+     */
+    void flush_connection(uint64_t connection_id, Connection& connection);
+
+    /**
+     * @brief Closes a connection and forgets its buffers.
+     */
+    void close_connection(uint64_t connection_id);
+
+    /**
+     * @brief Queues a response frame for a connection.
+     */
+    void respond(uint64_t connection_id, uint32_t sequence, uint8_t status, int server_id);
+
+    /**
+     * @brief Applies completions reported by worker threads.
+     */
+    void drain_completions();
+
+    /**
+     * @brief Hands queued requests to idle servers of every pool.
+     */
+    void dispatch();
+
+    /**
+     * @brief Starts the worker threads of a pool.
+     */
+    void start_pool(Pool& pool, int server_count);
+
+    /**
+     * @brief Body of a worker thread.
+     */
+    void worker_loop(Pool& pool, Worker& worker, size_t slot);
+
+    /**
+     * @brief Stops and joins every worker thread.
+     */
+    void stop_workers();
+
+    /**
+     * @brief Returns the pool serving a request type.
+     */
+    Pool& pool_for(char type);
+
+    /**
+     * @brief Firewall used to filter requests.
+     */
+    const Firewall& firewall;
+
+    /**
+     * @brief TCP port to listen on (localhost only).
+     */
+    int port;
+
+    /**
+     * @brief Wall-clock microseconds of work per clock cycle.
+     */
+    int tick_us;
+
+    /**
+     * @brief Largest time_to_process accepted from a frame.
+     */
+    int max_work;
+
+    /**
+     * @brief Run time in seconds (0 = until signalled).
+     */
+    int duration;
+
+    /**
+     * @brief Worker threads per pool.
+     */
+    int streaming_count, processing_count;
+
+    /**
+     * @brief Descriptors of the epoll instance, listener and completion eventfd.
+     */
+    int epoll_fd, listen_fd, event_fd;
+
+    /**
+     * @brief ID assigned to the next accepted connection.
+     */
+    uint64_t next_connection_id;
+
+    /**
+     * @brief Open connections keyed by connection ID.
+     */
+    std::unordered_map<uint64_t, Connection> connections;
+
+    /**
+     * @brief Dispatched requests waiting for a worker, keyed by request ID.
+     */
+    std::unordered_map<int, Pending> pending;
+
+    /**
+     * @brief Arena owning every request received from clients.
+     */
+    RequestArena arena;
+
+    /**
+     * @brief Streaming and processing pools.
+     */
+    Pool streaming, processing;
+
+    /**
+     * @brief Guards completions.
+     */
+    std::mutex completion_mutex;
+
+    /**
+     * @brief Completions reported by workers but not yet applied.
+     */
+    std::vector<Completion> completions;
+
+    /**
+     * @brief Counters reported at shutdown.
+     */
+    long long received, served, blocked, invalid, accepted;
+};
+
+#endif
@@ -0,0 +1,87 @@
+/**
+ * @file net_protocol.cpp
+ * @brief Implements encoding and decoding of the network front end frames.
+ */
+
+#include "net_protocol.h"
+
+namespace {
+
+/**
+ * @brief Writes a 32-bit value in big-endian order.
+ */
+void put_u32(uint8_t* out, uint32_t value) {
+    out[0] = static_cast<uint8_t>(value >> 24);
+    out[1] = static_cast<uint8_t>(value >> 16);
+    out[2] = static_cast<uint8_t>(value >> 8);
+    out[3] = static_cast<uint8_t>(value);
+}
+
+/**
+ * @brief Reads a big-endian 32-bit value.
+ */
+uint32_t get_u32(const uint8_t* in) {
+    return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+           (static_cast<uint32_t>(in[2]) << 8) | static_cast<uint32_t>(in[3]);
+}
+
+} // namespace
+
+/**
+ * @brief Encodes a request frame into REQUEST_FRAME_SIZE bytes.
+ *
+ * @param frame Frame to encode.
+ * @param out Destination buffer of at least REQUEST_FRAME_SIZE bytes.
+ */
+void encode_request_frame(const RequestFrame& frame, uint8_t* out) {
+    put_u32(out, frame.sequence);
+    put_u32(out + 4, frame.ip_in);
+    put_u32(out + 8, frame.ip_out);
+    out[12] = static_cast<uint8_t>(frame.time_to_process >> 8);
+    out[13] = static_cast<uint8_t>(frame.time_to_process);
+    out[14] = static_cast<uint8_t>(frame.request_type);
+    out[15] = 0;
+}
+
+/**
+ * @brief Decodes a request frame from REQUEST_FRAME_SIZE bytes.
+ *
+ * @param in Source buffer of at least REQUEST_FRAME_SIZE bytes.
+ * @return The decoded frame.
+ */
+RequestFrame decode_request_frame(const uint8_t* in) {
+    RequestFrame frame;
+    frame.sequence = get_u32(in);
+    frame.ip_in = get_u32(in + 4);
+    frame.ip_out = get_u32(in + 8);
+    frame.time_to_process = static_cast<uint16_t>((in[12] << 8) | in[13]);
+    frame.request_type = static_cast<char>(in[14]);
+    return frame;
+}
+
+/**
+ * @brief Encodes a response frame into RESPONSE_FRAME_SIZE bytes.
+ *
+ * @param frame Frame to encode.
+ * @param out Destination buffer of at least RESPONSE_FRAME_SIZE bytes.
+ */
+void encode_response_frame(const ResponseFrame& frame, uint8_t* out) {
+    put_u32(out, frame.sequence);
+    out[4] = static_cast<uint8_t>(frame.status);
+    out[5] = out[6] = out[7] = 0;
+    put_u32(out + 8, static_cast<uint32_t>(frame.server_id));
+}
+
+/**
+ * @brief Decodes a response frame from RESPONSE_FRAME_SIZE bytes.
+ *
+ * @param in Source buffer of at least RESPONSE_FRAME_SIZE bytes.
+ * @return The decoded frame.
+ */
+ResponseFrame decode_response_frame(const uint8_t* in) {
+    ResponseFrame frame;
+    frame.sequence = get_u32(in);
+    frame.status = static_cast<FrameStatus>(in[4]);
+    frame.server_id = static_cast<int32_t>(get_u32(in + 8));
+    return frame;
+}
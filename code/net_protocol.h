@@ -0,0 +1,95 @@
+/**
+ * @file net_protocol.h
+ * @brief Declares the framed wire protocol used by the network front end.
+ *
+ * This header defines the fixed-size request and response frames exchanged
+ * between the load generator and NetFrontend over TCP, together with the
+ * helpers that encode and decode them in network byte order.
+ */
+
+#ifndef NET_PROTOCOL_H
+#define NET_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Size in bytes of an encoded RequestFrame.
+ */
+const size_t REQUEST_FRAME_SIZE = 16;
+
+/**
+ * @brief Size in bytes of an encoded ResponseFrame.
+ */
+const size_t RESPONSE_FRAME_SIZE = 12;
+
+/**
+ * @brief Outcome reported for a request in a ResponseFrame.
+ */
+enum class FrameStatus : uint8_t {
+    SERVED = 0,  ///< Processed by a server.
+    BLOCKED = 1, ///< Rejected by the firewall.
+    INVALID = 2  ///< Malformed request (e.g. unknown request type or out-of-range work).
+};
+
+/**
+ * @struct RequestFrame
+ * @brief One request sent by a client.
+ *
+ * Wire layout (16 bytes, big-endian): sequence number (4), source IP (4),
+ * destination IP (4), time to process (2), request type (1), reserved (1).
+ */
+struct RequestFrame {
+    uint32_t sequence;        ///< Client-chosen ID echoed in the response.
+    uint32_t ip_in;           ///< Source IPv4 address in integer form.
+    uint32_t ip_out;          ///< Destination IPv4 address in integer form.
+    uint16_t time_to_process; ///< Processing time in clock cycles.
+    char request_type;        ///< 'P' (processing) or 'S' (streaming).
+};
+
+/**
+ * @struct ResponseFrame
+ * @brief Reply sent by the front end once a request is finished.
+ *
+ * Wire layout (12 bytes, big-endian): sequence number (4), status (1),
+ * reserved (3), ID of the server that handled the request or -1 (4).
+ */
+struct ResponseFrame {
+    uint32_t sequence;  ///< Sequence number of the answered request.
+    FrameStatus status; ///< Outcome of the request.
+    int32_t server_id;  ///< Server that processed the request, or -1.
+};
+
+/**
+ * @brief Encodes a request frame into REQUEST_FRAME_SIZE bytes.
+ *
+ * @param frame Frame to encode.
+ * @param out Destination buffer of at least REQUEST_FRAME_SIZE bytes.
+ */
+void encode_request_frame(const RequestFrame& frame, uint8_t* out);
+
+/**
+ * @brief Decodes a request frame from REQUEST_FRAME_SIZE bytes.
+ *
+ * @param in Source buffer of at least REQUEST_FRAME_SIZE bytes.
+ * @return The decoded frame.
+ */
+RequestFrame decode_request_frame(const uint8_t* in);
+
+/**
+ * @brief Encodes a response frame into RESPONSE_FRAME_SIZE bytes.
+ *
+ * @param frame Frame to encode.
+ * @param out Destination buffer of at least RESPONSE_FRAME_SIZE bytes.
+ */
+void encode_response_frame(const ResponseFrame& frame, uint8_t* out);
+
+/**
+ * @brief Decodes a response frame from RESPONSE_FRAME_SIZE bytes.
+ *
+ * @param in Source buffer of at least RESPONSE_FRAME_SIZE bytes.
+ * @return The decoded frame.
+ */
+ResponseFrame decode_response_frame(const uint8_t* in);
+
+#endif
@@ -0,0 +1,84 @@
+/**
+ * @file pool_registry.cpp
+ * @brief Implements the pool naming and traffic class parsing helpers.
+ */
+
+#include "pool_registry.h"
+#include <cstdio>
+#include <sstream>
+
+/**
+ * @brief Returns the console name of a request type's pool.
+ *
+ * @param request_type Request type.
+ * @return "streaming" for 'S', "processing" for 'P', otherwise "type-X".
+ */
+std::string pool_name(char request_type) {
+    if (request_type == 'S') {
+        return "streaming";
+    }
+    if (request_type == 'P') {
+        return "processing";
+    }
+    return std::string("type-") + request_type;
+}
+
+/**
+ * @brief Parses a list of traffic classes.
+ *
+ * @param text List of type[:servers[:low-high[:share]]] entries.
+ * @param pools Receives one configuration per entry.
+ * @return false if an entry is malformed, a type repeats or the shares exceed 1.
+ */
+bool parse_pool_types(const std::string& text, std::vector<PoolConfig>& pools) {
+    pools.clear();
+    std::vector<bool> has_share;
+    std::stringstream entries(text);
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+        PoolConfig config;
+        if (entry.empty() || (entry.size() > 1 && entry[1] != ':')) {
+            return false;
+        }
+        config.request_type = entry[0];
+        config.name = pool_name(config.request_type);
+        double share = -1.0;
+        if (entry.size() > 1) {
+            char trailing = 0;
+            int fields = std::sscanf(entry.c_str() + 2, "%d:%d-%d:%lf%c", &config.initial_servers,
+                                     &config.time_range[0], &config.time_range[1], &share, &trailing);
+            // fields may stop after the server count or the range, but not inside the range
+            if (fields < 1 || fields == 2 || fields > 4 || config.initial_servers < 1 ||
+                config.time_range[0] < 1 || config.time_range[1] < config.time_range[0] || (fields == 4 && share < 0.0)) {
+                return false;
+            }
+        }
+        for (const PoolConfig& other : pools) {
+            if (other.request_type == config.request_type) {
+                return false;
+            }
+        }
+        config.share = share < 0.0 ? 0.0 : share;
+        has_share.push_back(share >= 0.0);
+        pools.push_back(config);
+    }
+
+    double assigned = 0.0;
+    size_t unassigned = 0;
+    for (size_t i = 0; i < pools.size(); ++i) {
+        if (has_share[i]) {
+            assigned += pools[i].share;
+        } else {
+            unassigned++;
+        }
+    }
+    if (pools.empty() || assigned > 1.0 + 1e-9) {
+        return false;
+    }
+    for (size_t i = 0; i < pools.size(); ++i) {
+        if (!has_share[i]) {
+            pools[i].share = (1.0 - assigned) / unassigned;
+        }
+    }
+    return true;
+}
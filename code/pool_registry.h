@@ -0,0 +1,180 @@
+/**
+ * @file pool_registry.h
+ * @brief Declares the server pools of a simulation and the registry that routes request types to them.
+ *
+ * A pool pairs a request queue with a ServerHandler and serves one request
+ * type; the per-cycle dispatch and scaling loops call them directly, without
+ * virtual functions. The registry maps each request type to its pool
+ * with a 256-entry table, so routing a request is one array lookup no matter
+ * how many traffic classes are configured.
+ */
+
+#ifndef POOL_REGISTRY_H
+#define POOL_REGISTRY_H
+
+#include "load_balancer.h"
+#include "request_arena.h"
+#include "server_handler.h"
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Configuration of one traffic class and the pool serving it.
+ */
+struct PoolConfig {
+    std::string name;              ///< Console name of the pool.
+    char request_type = 'S';       ///< Request type routed to the pool.
+    int initial_servers = 1;       ///< Servers created before the first cycle.
+    int time_range[2] = {1, 12};   ///< Inclusive time_to_process range of generated requests.
+    double share = 0.0;            ///< Fraction of generated requests of this type.
+    double long_share = 0.0;       ///< Fraction of the class's requests drawn from long_time instead.
+    int long_time[2] = {100, 400}; ///< Inclusive time_to_process range of long requests.
+};
+
+/**
+ * @brief A request queue and the servers that drain it.
+ */
+struct Pool {
+    PoolConfig config;          ///< Traffic class served by the pool.
+    LoadBalancer queue;         ///< Requests waiting for a server.
+    ServerHandler servers;      ///< Servers of the pool.
+    long long wait_sum = 0;     ///< Sum of the queue waits of served requests.
+    long long served = 0;       ///< Requests taken from the queue.
+    long long stolen = 0;       ///< Requests this pool's servers took from other pools' queues.
+    long long given = 0;        ///< Requests other pools took from this pool's queue.
+
+    /**
+     * @brief Creates an empty pool.
+     *
+     * @param config Traffic class served by the pool.
+     * @param arena Arena holding the requests.
+     */
+    Pool(const PoolConfig& config, RequestArena& arena) : config(config), servers(arena) {}
+
+    /**
+     * @brief Decides whether the pool should grow or shrink.
+     *
+     * The pool grows when its queue holds more than the high load threshold
+     * per server and shrinks (never below one server) when it holds fewer
+     * than the low one.
+     *
+     * @return 1 to add a server, -1 to remove an idle one, 0 to keep the size.
+     */
+    int scale_decision() const {
+        int count = servers.get_server_count();
+        if (queue.low_load(count) && count > 1) {
+            return -1;
+        }
+        return queue.high_load(count) ? 1 : 0;
+    }
+};
+
+/**
+ * @class PoolRegistry
+ * @brief Owns the pools of a simulation and routes request types to them.
+ *
+ * @tparam PoolType Pool specialisation used for every traffic class.
+ */
+template <class PoolType>
+class PoolRegistry {
+public:
+
+    /**
+     * @brief Route of request types that no pool serves.
+     */
+    static constexpr int NO_POOL = -1;
+
+    /**
+     * @brief Constructs an empty registry.
+     */
+    PoolRegistry() {
+        routes.fill(NO_POOL);
+    }
+
+    /**
+     * @brief Adds a pool for a traffic class.
+     *
+     * @param config Traffic class; its request type must not be routed yet.
+     * @param arena Arena holding the requests.
+     * @return Index of the new pool, or NO_POOL if the type already has a pool.
+     */
+    int add(const PoolConfig& config, RequestArena& arena) {
+        unsigned char type = static_cast<unsigned char>(config.request_type);
+        if (routes[type] != NO_POOL) {
+            return NO_POOL;
+        }
+        routes[type] = static_cast<int>(pools.size());
+        pools.emplace_back(new PoolType(config, arena));
+        return routes[type];
+    }
+
+    /**
+     * @brief Returns the index of the pool serving a request type.
+     *
+     * @param request_type Request type.
+     * @return Pool index, or NO_POOL.
+     */
+    int route(char request_type) const {
+        return routes[static_cast<unsigned char>(request_type)];
+    }
+
+    /**
+     * @brief Returns the number of pools.
+     */
+    size_t size() const {
+        return pools.size();
+    }
+
+    /**
+     * @brief Returns the pool at an index.
+     */
+    PoolType& operator[](size_t index) {
+        return *pools[index];
+    }
+
+    /**
+     * @brief Returns the pool at an index.
+     */
+    const PoolType& operator[](size_t index) const {
+        return *pools[index];
+    }
+
+private:
+
+    /**
+     * @brief Pool index of each request type.
+     */
+    std::array<int, 256> routes;
+
+    /**
+     * @brief Pools in the order they were added.
+     */
+    std::vector<std::unique_ptr<PoolType>> pools;
+};
+
+/**
+ * @brief Returns the console name of a request type's pool.
+ *
+ * @param request_type Request type.
+ * @return "streaming" for 'S', "processing" for 'P', otherwise "type-X".
+ */
+std::string pool_name(char request_type);
+
+/**
+ * @brief Parses a list of traffic classes.
+ *
+ * The list is comma-separated; each entry is type[:servers[:low-high[:share]]],
+ * for example "S:20,P:20,V:4:20-60:0.05". Missing server counts default to
+ * one server and missing ranges to 1-12. Entries without a share split what
+ * the others leave over equally.
+ *
+ * @param text List to parse.
+ * @param pools Receives one configuration per entry.
+ * @return false if an entry is malformed, a type repeats or the shares exceed 1.
+ */
+bool parse_pool_types(const std::string& text, std::vector<PoolConfig>& pools);
+
+#endif
@@ -0,0 +1,181 @@
+/**
+ * @file profiler.cpp
+ * @brief Implements the per-thread profile counters and the phase report.
+ */
+
+#include "profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Whether PROFILE_SCOPE timers record.
+ */
+std::atomic<bool> active(false);
+
+/**
+ * @brief Counters of one thread.
+ *
+ * Only the owning thread writes them; relaxed atomics let profile_collect()
+ * read them from another thread without locking the hot path.
+ */
+struct ThreadCounters {
+    std::atomic<uint64_t> ticks[PROFILE_PHASES];
+    std::atomic<uint64_t> calls[PROFILE_PHASES];
+
+    ThreadCounters();
+    ~ThreadCounters();
+};
+
+/**
+ * @brief Registry of live threads' counters and the totals of exited threads.
+ */
+std::mutex registry_lock;
+std::vector<ThreadCounters*> live_threads;
+ProfileTotals retired;
+
+/**
+ * @brief Clock readings when profiling was enabled, used to convert ticks to time.
+ */
+uint64_t enabled_ticks = 0;
+std::chrono::steady_clock::time_point enabled_at;
+
+/**
+ * @brief Counters of the calling thread.
+ */
+thread_local ThreadCounters counters;
+
+/**
+ * @brief Zeroes a thread's counters and registers them.
+ */
+ThreadCounters::ThreadCounters() {
+    for (size_t phase = 0; phase < PROFILE_PHASES; ++phase) {
+        ticks[phase].store(0, std::memory_order_relaxed);
+        calls[phase].store(0, std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> guard(registry_lock);
+    live_threads.push_back(this);
+}
+
+/**
+ * @brief Folds a finished thread's counters into the retired totals.
+ */
+ThreadCounters::~ThreadCounters() {
+    std::lock_guard<std::mutex> guard(registry_lock);
+    for (size_t phase = 0; phase < PROFILE_PHASES; ++phase) {
+        retired.ticks[phase] += ticks[phase].load(std::memory_order_relaxed);
+        retired.calls[phase] += calls[phase].load(std::memory_order_relaxed);
+    }
+    live_threads.erase(std::find(live_threads.begin(), live_threads.end(), this));
+}
+
+/**
+ * @brief Console names of the phases, in ProfilePhase order.
+ */
+const char* const PHASE_NAMES[PROFILE_PHASES] = {
+    "step 1 generate", "step 2 update", "step 3 assign", "step 4 scale", "step 5 clock/log",
+    "Firewall::isBlocked", "Firewall::classify_batch", "LoadBalancer::queue_request",
+    "LoadBalancer::process_request", "LoadBalancer::return_request", "ServerHandler::update_servers"};
+
+} // namespace
+
+/**
+ * @brief Starts or stops timing and, when starting, clears all counters.
+ *
+ * Enable profiling before the threads being profiled start timing; a
+ * counter cleared while its thread updates it may keep the old value.
+ *
+ * @param enabled Whether PROFILE_SCOPE timers record.
+ */
+void profile_set_enabled(bool enabled) {
+    if (enabled) {
+        std::lock_guard<std::mutex> guard(registry_lock);
+        retired = ProfileTotals();
+        for (ThreadCounters* thread : live_threads) {
+            for (size_t phase = 0; phase < PROFILE_PHASES; ++phase) {
+                thread->ticks[phase].store(0, std::memory_order_relaxed);
+                thread->calls[phase].store(0, std::memory_order_relaxed);
+            }
+        }
+        enabled_ticks = profile_clock();
+        enabled_at = std::chrono::steady_clock::now();
+    }
+    active.store(enabled, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Checks whether timers record.
+ *
+ * @return true between profile_set_enabled(true) and profile_set_enabled(false).
+ */
+bool profile_enabled() {
+    return active.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Adds one call and its ticks to the calling thread's counters.
+ *
+ * @param phase Profiled phase.
+ * @param ticks Ticks spent in the call.
+ */
+void profile_record(ProfilePhase phase, uint64_t ticks) {
+    size_t index = static_cast<size_t>(phase);
+    counters.ticks[index].store(counters.ticks[index].load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+    counters.calls[index].store(counters.calls[index].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Sums the counters of every thread.
+ *
+ * @return Totals since profiling was last enabled.
+ */
+ProfileTotals profile_collect() {
+    std::lock_guard<std::mutex> guard(registry_lock);
+    ProfileTotals totals = retired;
+    for (const ThreadCounters* thread : live_threads) {
+        for (size_t phase = 0; phase < PROFILE_PHASES; ++phase) {
+            totals.ticks[phase] += thread->ticks[phase].load(std::memory_order_relaxed);
+            totals.calls[phase] += thread->calls[phase].load(std::memory_order_relaxed);
+        }
+    }
+    return totals;
+}
+
+/**
+ * @brief Writes the per-phase breakdown of ticks and calls.
+ *
+ * Ticks are converted to milliseconds with the tick rate measured since
+ * profiling was enabled. The share column relates each phase to the sum of
+ * the five loop steps; nested phases are included in their step.
+ *
+ * @param out Stream receiving the table.
+ */
+void profile_report(std::ostream& out) {
+    ProfileTotals totals = profile_collect();
+    double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - enabled_at).count();
+    double ticks_per_ns = elapsed_ns > 0.0 ? static_cast<double>(profile_clock() - enabled_ticks) / elapsed_ns : 1.0;
+    uint64_t loop_ticks = 0;
+    for (size_t phase = 0; phase <= static_cast<size_t>(ProfilePhase::STEP_LOG); ++phase) {
+        loop_ticks += totals.ticks[phase];
+    }
+
+    char line[128];
+    std::snprintf(line, sizeof(line), "Profile (inclusive times, %.2f ticks/ns):", ticks_per_ns);
+    out << line << std::endl;
+    std::snprintf(line, sizeof(line), "%-30s %12s %16s %11s %10s %7s", "phase", "calls", "ticks", "ticks/call", "ms", "loop%");
+    out << line << std::endl;
+    for (size_t phase = 0; phase < PROFILE_PHASES; ++phase) {
+        uint64_t calls = totals.calls[phase];
+        uint64_t ticks = totals.ticks[phase];
+        std::snprintf(line, sizeof(line), "%-30s %12llu %16llu %11.1f %10.2f %7.1f", PHASE_NAMES[phase],
+                      static_cast<unsigned long long>(calls), static_cast<unsigned long long>(ticks),
+                      calls > 0 ? static_cast<double>(ticks) / calls : 0.0, ticks / ticks_per_ns / 1e6,
+                      loop_ticks > 0 ? 100.0 * ticks / loop_ticks : 0.0);
+        out << line << std::endl;
+    }
+}
@@ -0,0 +1,158 @@
+/**
+ * @file profiler.h
+ * @brief Declares the scoped cycle-counter timers used to profile the hot path.
+ *
+ * PROFILE_SCOPE(phase) times the rest of the enclosing block with the CPU
+ * timestamp counter (clock_gettime on other architectures) and adds the
+ * ticks and one call to the phase's counters. Counters are per thread, so
+ * sweep workers never contend; profile_collect() sums the live threads and
+ * those that already exited. Timing is off until profile_set_enabled(true),
+ * and building with -DNO_PROFILE (make PROFILE=0) removes the timers
+ * entirely.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+/**
+ * @brief Profiled phases.
+ *
+ * The STEP_ phases are the five steps of the simulation loop; the others
+ * are nested inside them, so phase times are inclusive.
+ */
+enum class ProfilePhase : uint8_t {
+    STEP_GENERATE,        ///< Step 1: generate or ingest requests and filter them.
+    STEP_UPDATE,          ///< Step 2: advance the servers and requeue preempted requests.
+    STEP_ASSIGN,          ///< Step 3: dispatch and steal.
+    STEP_SCALE,           ///< Step 4: scale the pools.
+    STEP_LOG,             ///< Step 5: count server cycles, advance the clock and log.
+    FIREWALL_IS_BLOCKED,  ///< Firewall::isBlocked.
+    FIREWALL_CLASSIFY,    ///< Firewall::classify_batch.
+    QUEUE_REQUEST,        ///< LoadBalancer::queue_request.
+    PROCESS_REQUEST,      ///< LoadBalancer::process_request.
+    RETURN_REQUEST,       ///< LoadBalancer::return_request.
+    UPDATE_SERVERS,       ///< ServerHandler::update_servers.
+    COUNT                 ///< Number of phases.
+};
+
+/**
+ * @brief Number of profiled phases.
+ */
+constexpr size_t PROFILE_PHASES = static_cast<size_t>(ProfilePhase::COUNT);
+
+/**
+ * @brief Counters summed over all threads.
+ */
+struct ProfileTotals {
+    uint64_t ticks[PROFILE_PHASES] = {};  ///< Timer ticks spent in each phase.
+    uint64_t calls[PROFILE_PHASES] = {};  ///< Times each phase was entered.
+};
+
+/**
+ * @brief Reads the profiling clock.
+ *
+ * @return Timestamp counter ticks, or nanoseconds where there is no TSC.
+ */
+inline uint64_t profile_clock() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+#endif
+}
+
+/**
+ * @brief Starts or stops timing and, when starting, clears all counters.
+ *
+ * @param enabled Whether PROFILE_SCOPE timers record.
+ */
+void profile_set_enabled(bool enabled);
+
+/**
+ * @brief Checks whether timers record.
+ *
+ * @return true between profile_set_enabled(true) and profile_set_enabled(false).
+ */
+bool profile_enabled();
+
+/**
+ * @brief Adds one call and its ticks to the calling thread's counters.
+ *
+ * @param phase Profiled phase.
+ * @param ticks Ticks spent in the call.
+ */
+void profile_record(ProfilePhase phase, uint64_t ticks);
+
+/**
+ * @brief Sums the counters of every thread.
+ *
+ * @return Totals since profiling was last enabled.
+ */
+ProfileTotals profile_collect();
+
+/**
+ * @brief Writes the per-phase breakdown of ticks and calls.
+ *
+ * @param out Stream receiving the table.
+ */
+void profile_report(std::ostream& out);
+
+/**
+ * @class ScopedTimer
+ * @brief Times its own lifetime and records it under a phase.
+ */
+class ScopedTimer {
+public:
+
+    /**
+     * @brief Starts timing if profiling is enabled.
+     *
+     * @param phase Phase the time is recorded under.
+     */
+    explicit ScopedTimer(ProfilePhase phase) : phase(phase), start(profile_enabled() ? profile_clock() : 0) {}
+
+    /**
+     * @brief Records the elapsed ticks.
+     */
+    ~ScopedTimer() {
+        if (start != 0) {
+            profile_record(phase, profile_clock() - start);
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    ProfilePhase phase;
+    uint64_t start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef NO_PROFILE
+constexpr bool PROFILE_COMPILED = false;
+#define PROFILE_SCOPE(phase) ((void)0)
+#else
+constexpr bool PROFILE_COMPILED = true;
+
+/**
+ * @brief Times the rest of the enclosing block under a ProfilePhase.
+ */
+#define PROFILE_SCOPE(phase) ScopedTimer PROFILE_CONCAT(profile_scope_, __LINE__)(phase)
+#endif
+
+#endif
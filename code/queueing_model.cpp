@@ -0,0 +1,301 @@
+/**
+ * @file queueing_model.cpp
+ * @brief Implements the M/G/c queueing model and the analytic / validation modes.
+ */
+
+#include "queueing_model.h"
+#include "firewall.h"
+#include "simulation.h"
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <string>
+
+// color codes
+#define RED     "\033[31m"
+#define GREEN   "\033[32m"
+#define YELLOW  "\033[33m"
+#define RESET   "\033[0m"
+
+/**
+ * @brief Describes a time_to_process drawn uniformly from the integers [low, high].
+ *
+ * A discrete uniform distribution over n values has variance (n^2 - 1) / 12.
+ *
+ * @param low Smallest value.
+ * @param high Largest value.
+ * @return Mean and scv of the discrete uniform distribution.
+ */
+ServiceDistribution ServiceDistribution::uniform(int low, int high) {
+    ServiceDistribution distribution;
+    double n = high - low + 1;
+    distribution.mean = (low + high) / 2.0;
+    distribution.scv = ((n * n - 1.0) / 12.0) / (distribution.mean * distribution.mean);
+    return distribution;
+}
+
+/**
+ * @brief Constructs the model of one pool.
+ *
+ * @param arrival_rate Mean requests per cycle reaching the pool.
+ * @param service Service-time distribution of the pool's requests.
+ */
+QueueingModel::QueueingModel(double arrival_rate, const ServiceDistribution& service)
+    : arrival_rate(arrival_rate), service(service) {}
+
+/**
+ * @brief Returns the offered load (arrival rate times mean service time).
+ *
+ * @return Offered load in Erlangs.
+ */
+double QueueingModel::offered_load() const {
+    return arrival_rate * service.mean;
+}
+
+/**
+ * @brief Returns the utilisation of each server.
+ *
+ * @param servers Number of servers.
+ * @return Offered load divided by the server count.
+ */
+double QueueingModel::utilisation(int servers) const {
+    return servers > 0 ? offered_load() / servers : 1.0;
+}
+
+/**
+ * @brief Returns the probability that an arriving request has to wait (Erlang C).
+ *
+ * Uses the Erlang-B recurrence B(k) = a B(k-1) / (k + a B(k-1)), which stays
+ * numerically stable for thousands of servers, and converts with
+ * C = c B / (c - a (1 - B)).
+ *
+ * @param servers Number of servers.
+ * @return Probability in [0, 1]; 1 when the pool is overloaded.
+ */
+double QueueingModel::wait_probability(int servers) const {
+    double load = offered_load();
+    if (servers <= 0 || load >= servers) {
+        return 1.0;
+    }
+    double erlang_b = 1.0;
+    for (int k = 1; k <= servers; ++k) {
+        erlang_b = load * erlang_b / (k + load * erlang_b);
+    }
+    return servers * erlang_b / (servers - load * (1.0 - erlang_b));
+}
+
+/**
+ * @brief Returns the mean time a request spends in the queue.
+ *
+ * M/M/c gives Wq = C / (c mu - lambda); the general service distribution
+ * is accounted for by multiplying with (1 + scv) / 2.
+ *
+ * @param servers Number of servers.
+ * @return Mean wait in cycles, or -1 when the pool is overloaded.
+ */
+double QueueingModel::mean_wait(int servers) const {
+    if (arrival_rate <= 0.0) {
+        return 0.0;
+    }
+    if (utilisation(servers) >= 1.0) {
+        return -1.0;
+    }
+    double service_rate = 1.0 / service.mean;
+    double mmc_wait = wait_probability(servers) / (servers * service_rate - arrival_rate);
+    return mmc_wait * (1.0 + service.scv) / 2.0;
+}
+
+/**
+ * @brief Returns the fewest servers whose mean wait meets a target.
+ *
+ * The wait falls monotonically with the server count, so the search starts
+ * at the first stable count and walks upwards.
+ *
+ * @param target_wait Target mean wait in cycles.
+ * @param max_servers Upper bound on the search.
+ * @return Server count, or -1 if max_servers is not enough.
+ */
+int QueueingModel::required_servers(double target_wait, int max_servers) const {
+    if (arrival_rate <= 0.0) {
+        return 1;
+    }
+    int servers = static_cast<int>(std::floor(offered_load())) + 1;
+    for (; servers <= max_servers; ++servers) {
+        if (mean_wait(servers) <= target_wait) {
+            return servers;
+        }
+    }
+    return -1;
+}
+
+namespace {
+
+/**
+ * @brief Console name of each pool.
+ */
+const char* const POOL_NAMES[2] = {"streaming", "processing"};
+
+/**
+ * @brief Inputs shared by the analytic and validation modes.
+ */
+struct ModelSettings {
+    double arrival_rate;        ///< Requests per cycle over both pools.
+    double streaming_share;     ///< Fraction of requests that are streaming.
+    int time_range[2][2];       ///< Uniform time_to_process range per pool.
+    double tick_us;             ///< Microseconds per cycle.
+    double target_wait_us[2];   ///< Target mean wait per pool.
+};
+
+/**
+ * @brief Parses a "low,high" time_to_process range.
+ *
+ * @return false if the text is malformed or low is not in [1, high].
+ */
+bool parse_time_range(const std::string& text, int range[2]) {
+    int low = 0, high = 0;
+    char trailing = 0;
+    if (std::sscanf(text.c_str(), "%d,%d%c", &low, &high, &trailing) != 2 || low < 1 || high < low) {
+        return false;
+    }
+    range[0] = low;
+    range[1] = high;
+    return true;
+}
+
+/**
+ * @brief Reads the model inputs from the configuration.
+ *
+ * @return false (after printing an error) on invalid options.
+ */
+bool read_settings(const Config& config, ModelSettings& settings) {
+    // the simulator's default bursts average 39.5 requests every 6.5 cycles
+    settings.arrival_rate = config.get_double("arrival-rate", 39.5 / 6.5);
+    settings.streaming_share = config.get_double("streaming-share", 0.5);
+    settings.tick_us = config.get_double("tick-us", 100.0);
+    double target = config.get_double("target-wait-us", 1000.0);
+    settings.target_wait_us[0] = config.get_double("streaming-target-wait-us", target);
+    settings.target_wait_us[1] = config.get_double("processing-target-wait-us", target);
+    const char* keys[2] = {"streaming-time", "processing-time"};
+    for (int pool = 0; pool < 2; ++pool) {
+        if (!parse_time_range(config.get_string(keys[pool], "1,12"), settings.time_range[pool])) {
+            std::cerr << RED << "Invalid --" << keys[pool] << ": expected low,high with 1 <= low <= high." << RESET << std::endl;
+            return false;
+        }
+    }
+    if (settings.arrival_rate <= 0.0 || settings.tick_us <= 0.0 ||
+        settings.streaming_share < 0.0 || settings.streaming_share > 1.0) {
+        std::cerr << RED << "--arrival-rate and --tick-us must be positive and --streaming-share in [0, 1]." << RESET << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Builds the model of one pool from the settings.
+ */
+QueueingModel pool_model(const ModelSettings& settings, int pool) {
+    double share = pool == 0 ? settings.streaming_share : 1.0 - settings.streaming_share;
+    return QueueingModel(settings.arrival_rate * share,
+                         ServiceDistribution::uniform(settings.time_range[pool][0], settings.time_range[pool][1]));
+}
+
+} // namespace
+
+/**
+ * @brief Prints the servers each pool needs for a target mean wait.
+ *
+ * @param config Parsed command-line / file options.
+ * @return 0 on success, 1 on invalid options.
+ */
+int run_analytic(const Config& config) {
+    ModelSettings settings;
+    if (!read_settings(config, settings)) {
+        return 1;
+    }
+    std::cout << GREEN << "M/G/c estimate for " << settings.arrival_rate << " requests per cycle ("
+              << settings.tick_us << " us per cycle)." << RESET << std::endl;
+    for (int pool = 0; pool < 2; ++pool) {
+        QueueingModel model = pool_model(settings, pool);
+        double target_cycles = settings.target_wait_us[pool] / settings.tick_us;
+        int servers = model.required_servers(target_cycles);
+        std::cout << POOL_NAMES[pool] << ": offered load " << model.offered_load() << " Erlangs";
+        if (servers < 0) {
+            std::cout << ", target wait of " << settings.target_wait_us[pool] << " us is not reachable." << std::endl;
+            continue;
+        }
+        std::cout << ", " << servers << " servers for a mean wait <= " << settings.target_wait_us[pool]
+                  << " us (predicted " << model.mean_wait(servers) * settings.tick_us << " us, utilisation "
+                  << model.utilisation(servers) * 100.0 << "%, P(wait) " << model.wait_probability(servers) * 100.0
+                  << "%)." << std::endl;
+    }
+    return 0;
+}
+
+/**
+ * @brief Compares model predictions with waits measured by the simulator.
+ *
+ * @param config Parsed command-line / file options.
+ * @return 0 on success, 1 on invalid options.
+ */
+int run_validation(const Config& config) {
+    ModelSettings settings;
+    if (!read_settings(config, settings)) {
+        return 1;
+    }
+    QueueingModel models[2] = {pool_model(settings, 0), pool_model(settings, 1)};
+    int recommended[2];
+    for (int pool = 0; pool < 2; ++pool) {
+        recommended[pool] = models[pool].required_servers(settings.target_wait_us[pool] / settings.tick_us);
+        if (recommended[pool] < 0) {
+            std::cerr << RED << "Target wait for the " << POOL_NAMES[pool] << " pool is not reachable." << RESET << std::endl;
+            return 1;
+        }
+    }
+
+    bool poisson = config.get_string("arrivals", "poisson") != "burst";
+    Firewall firewall;
+    std::cout << GREEN << "Validating M/G/c predictions against " << config.get_int("cycles", 200000)
+              << "-cycle simulations (" << (poisson ? "Poisson" : "burst") << " arrivals, fixed servers)." << RESET << std::endl;
+    std::cout << "pool        servers  util%   predicted_us  measured_us  error%" << std::endl;
+    // the recommended count and its neighbours; overloaded counts are skipped
+    for (int offset = -1; offset <= 1; ++offset) {
+        SimulationParams params;
+        params.streaming_servers = recommended[0] + offset;
+        params.processing_servers = recommended[1] + offset;
+        params.cycles = config.get_int("cycles", 200000);
+        params.check_server_count_buffer = 0;
+        params.initial_requests_per_server = 0;
+        params.arrival_rate = settings.arrival_rate;
+        params.poisson_arrivals = poisson;
+        params.streaming_share = settings.streaming_share;
+        for (int bound = 0; bound < 2; ++bound) {
+            params.streaming_time[bound] = settings.time_range[0][bound];
+            params.processing_time[bound] = settings.time_range[1][bound];
+        }
+        params.seed = config.has("seed") ? static_cast<uint32_t>(config.get_int("seed", 0)) : static_cast<uint32_t>(std::time(nullptr));
+        params.verbose = false;
+        int servers[2] = {params.streaming_servers, params.processing_servers};
+        if (models[0].utilisation(servers[0]) >= 1.0 || models[1].utilisation(servers[1]) >= 1.0) {
+            continue;
+        }
+
+        Simulation simulation(params, firewall, nullptr);
+        SimulationResult result = simulation.run();
+        double measured[2] = {result.mean_streaming_wait, result.mean_processing_wait};
+        for (int pool = 0; pool < 2; ++pool) {
+            double predicted_us = models[pool].mean_wait(servers[pool]) * settings.tick_us;
+            double measured_us = measured[pool] * settings.tick_us;
+            char line[128];
+            std::snprintf(line, sizeof(line), "%-10s  %7d  %5.1f  %12.1f  %11.1f  %6.1f",
+                          POOL_NAMES[pool], servers[pool], models[pool].utilisation(servers[pool]) * 100.0,
+                          predicted_us, measured_us,
+                          predicted_us > 0.0 ? (measured_us - predicted_us) / predicted_us * 100.0 : 0.0);
+            std::cout << (offset == 0 ? GREEN : "") << line << (offset == 0 ? RESET : "") << std::endl;
+        }
+    }
+    if (!poisson) {
+        std::cout << YELLOW << "Burst arrivals are not Poisson, so measured waits are expected to exceed the model." << RESET << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file queueing_model.h
+ * @brief Declares an analytic M/G/c queueing model for capacity questions.
+ *
+ * The model answers "how many servers does a pool need so that requests
+ * wait at most X on average" without simulating every cycle. Each pool is
+ * treated as an M/G/c queue: Poisson arrivals, a general service-time
+ * distribution summarised by its mean and squared coefficient of variation,
+ * and c identical servers. The mean wait uses the Erlang-C formula for
+ * M/M/c, scaled by (1 + scv) / 2 (the Allen-Cunneen approximation).
+ */
+
+#ifndef QUEUEING_MODEL_H
+#define QUEUEING_MODEL_H
+
+#include "config.h"
+
+/**
+ * @brief Service-time distribution of one request type, in clock cycles.
+ */
+struct ServiceDistribution {
+    double mean = 6.5;   ///< Mean time_to_process.
+    double scv = 0.0;    ///< Squared coefficient of variation (variance / mean^2).
+
+    /**
+     * @brief Describes a time_to_process drawn uniformly from the integers [low, high].
+     *
+     * @param low Smallest value.
+     * @param high Largest value.
+     * @return Mean and scv of the discrete uniform distribution.
+     */
+    static ServiceDistribution uniform(int low, int high);
+};
+
+/**
+ * @class QueueingModel
+ * @brief Closed-form M/G/c estimates for one server pool.
+ */
+class QueueingModel {
+public:
+
+    /**
+     * @brief Constructs the model of one pool.
+     *
+     * @param arrival_rate Mean requests per cycle reaching the pool.
+     * @param service Service-time distribution of the pool's requests.
+     */
+    QueueingModel(double arrival_rate, const ServiceDistribution& service);
+
+    /**
+     * @brief Returns the offered load (arrival rate times mean service time).
+     *
+     * @return Offered load in Erlangs; the pool needs more servers than this.
+     */
+    double offered_load() const;
+
+    /**
+     * @brief Returns the utilisation of each server.
+     *
+     * @param servers Number of servers.
+     * @return Offered load divided by the server count.
+     */
+    double utilisation(int servers) const;
+
+    /**
+     * @brief Returns the probability that an arriving request has to wait (Erlang C).
+     *
+     * @param servers Number of servers.
+     * @return Probability in [0, 1]; 1 when the pool is overloaded.
+     */
+    double wait_probability(int servers) const;
+
+    /**
+     * @brief Returns the mean time a request spends in the queue.
+     *
+     * @param servers Number of servers.
+     * @return Mean wait in cycles, or a negative value when the pool is
+     *         overloaded (utilisation >= 1) and the queue grows without bound.
+     */
+    double mean_wait(int servers) const;
+
+    /**
+     * @brief Returns the fewest servers whose mean wait meets a target.
+     *
+     * @param target_wait Target mean wait in cycles.
+     * @param max_servers Upper bound on the search.
+     * @return Server count, or -1 if max_servers is not enough.
+     */
+    int required_servers(double target_wait, int max_servers = 1000000) const;
+
+private:
+
+    /**
+     * @brief Mean requests per cycle.
+     */
+    double arrival_rate;
+
+    /**
+     * @brief Service-time distribution.
+     */
+    ServiceDistribution service;
+};
+
+/**
+ * @brief Prints the servers each pool needs for a target mean wait.
+ *
+ * Options: --arrival-rate (requests per cycle over both pools; default is the
+ * simulator's built-in rate), --streaming-share (fraction of requests that
+ * are streaming, default 0.5), --streaming-time=low,high and
+ * --processing-time=low,high (uniform time_to_process, default 1,12),
+ * --tick-us (microseconds per cycle, default 100) and --target-wait-us
+ * (or --streaming-target-wait-us / --processing-target-wait-us).
+ *
+ * @param config Parsed command-line / file options.
+ * @return 0 on success, 1 on invalid options.
+ */
+int run_analytic(const Config& config);
+
+/**
+ * @brief Compares model predictions with waits measured by the simulator.
+ *
+ * Takes the same options as run_analytic(). For each pool it simulates the
+ * recommended server count and its neighbours with a fixed number of
+ * servers (no scaling), no initial backlog and Poisson arrivals, and prints
+ * predicted against measured mean waits. --cycles sets the simulated length
+ * (default 200000); --arrivals=burst uses the simulator's bursty generator
+ * instead, which shows how far real traffic departs from the Poisson model.
+ *
+ * @param config Parsed command-line / file options.
+ * @return 0 on success, 1 on invalid options.
+ */
+int run_validation(const Config& config);
+
+#endif
@@ -15,12 +15,20 @@
  *
  * This value increments each time a new Request object is constructed.
  */
-int Request::next_id = 0;
+std::atomic<int> Request::next_id(0);
+
+/**
+ * @brief Constructs an empty Request for preallocated storage.
+ *
+ * The request ID is -1 and no ID is consumed from the counter.
+ */
+Request::Request()
+    : request_id(-1), ip_in(0), ip_out(0), time_to_process(0), request_type('\0'), remaining_work(0), slice_work(0) {}
 
 /**
  * @brief Constructs a Request object and assigns a unique ID.
  *
- * The constructor initializes all member variables using an initializer list.
+ * The dotted-quad addresses are converted to packed form with parse_ip().
  * The request_id is assigned using the static next_id counter.
  *
  * @param ip_in Source IP address of the request.
@@ -29,7 +37,73 @@ int Request::next_id = 0;
  * @param request_type Type of request (e.g., 'P' for processing, 'S' for streaming).
  */
 Request::Request(const std::string& ip_in, const std::string& ip_out, int time_to_process, char request_type)
-    : request_id(next_id++), ip_in(ip_in), ip_out(ip_out), time_to_process(time_to_process), request_type(request_type) {}
+    : Request(parse_ip(ip_in), parse_ip(ip_out), time_to_process, request_type) {}
+
+/**
+ * @brief Constructs a Request from packed IPv4 addresses and assigns a unique ID.
+ *
+ * @param ip_in Source IP address in integer form.
+ * @param ip_out Destination IP address in integer form.
+ * @param time_to_process Time required to process the request.
+ * @param request_type Type of request (e.g., 'P' for processing, 'S' for streaming).
+ */
+Request::Request(uint32_t ip_in, uint32_t ip_out, int time_to_process, char request_type)
+    : request_id(next_id++), ip_in(ip_in), ip_out(ip_out), time_to_process(time_to_process), request_type(request_type),
+      remaining_work(time_to_process), slice_work(time_to_process) {}
+
+/**
+ * @brief Converts a dotted-quad IPv4 string into its packed form.
+ *
+ * The address is parsed as four octets separated by '.' and packed into a
+ * 32-bit unsigned integer using left shifts.
+ *
+ * @param ip IPv4 address as a string (e.g., "10.0.0.1").
+ * @return Integer representation with the first octet in the high byte.
+ */
+uint32_t Request::parse_ip(const std::string& ip) {
+    uint32_t result = 0;
+    size_t start = 0;
+    for (int i = 0; i < 4; ++i) {
+        size_t end = ip.find('.', start);
+        if (end == std::string::npos) {
+            end = ip.length();
+        }
+        result = (result << 8) | static_cast<uint32_t>(std::stoi(ip.substr(start, end - start)));
+        start = end + 1;
+    }
+    return result;
+}
+
+/**
+ * @brief Converts a packed IPv4 address into dotted-quad form.
+ *
+ * @param ip Integer representation of the address.
+ * @return IPv4 address as a string.
+ */
+std::string Request::format_ip(uint32_t ip) {
+    return std::to_string((ip >> 24) & 0xFF) + "." +
+           std::to_string((ip >> 16) & 0xFF) + "." +
+           std::to_string((ip >> 8) & 0xFF) + "." +
+           std::to_string(ip & 0xFF);
+}
+
+/**
+ * @brief Returns the ID the next constructed request will get.
+ *
+ * @return Next request ID.
+ */
+int Request::peek_next_id() {
+    return next_id.load();
+}
+
+/**
+ * @brief Sets the ID the next constructed request will get.
+ *
+ * @param id Next request ID.
+ */
+void Request::set_next_id(int id) {
+    next_id.store(id);
+}
 
 /**
  * @brief Returns the unique identifier of this request.
@@ -46,7 +120,7 @@ int Request::get_request_id() const {
  * @return The incoming IP address as a string.
  */
 std::string Request::get_ip_in() const {
-    return ip_in;
+    return format_ip(ip_in);
 }
 
 /**
@@ -55,6 +129,24 @@ std::string Request::get_ip_in() const {
  * @return The outgoing IP address as a string.
  */
 std::string Request::get_ip_out() const {
+    return format_ip(ip_out);
+}
+
+/**
+ * @brief Returns the source IP address in packed form.
+ *
+ * @return The incoming IP address as an integer.
+ */
+uint32_t Request::get_ip_in_int() const {
+    return ip_in;
+}
+
+/**
+ * @brief Returns the destination IP address in packed form.
+ *
+ * @return The outgoing IP address as an integer.
+ */
+uint32_t Request::get_ip_out_int() const {
     return ip_out;
 }
 
@@ -74,4 +166,44 @@ int Request::get_time_to_process() const {
  */
 char Request::get_request_type() const {
     return request_type;
+}
+
+/**
+ * @brief Returns the processing time still owed to the request.
+ *
+ * @return Remaining work in simulation units.
+ */
+int Request::get_remaining_work() const {
+    return remaining_work;
+}
+
+/**
+ * @brief Returns the work the current (or next) time slice covers.
+ *
+ * A request that is never sliced runs one slice covering all of its work.
+ *
+ * @return Work of the slice in simulation units.
+ */
+int Request::get_slice_work() const {
+    return slice_work;
+}
+
+/**
+ * @brief Sets how much of the remaining work the next time slice covers.
+ *
+ * @param work Work of the slice, at most get_remaining_work().
+ */
+void Request::begin_slice(int work) {
+    slice_work = work;
+}
+
+/**
+ * @brief Deducts a finished time slice from the remaining work.
+ *
+ * @return true if work remains (the request was preempted).
+ */
+bool Request::end_slice() {
+    remaining_work -= slice_work;
+    slice_work = remaining_work;
+    return remaining_work > 0;
 }
\ No newline at end of file
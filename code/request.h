@@ -10,6 +10,8 @@
 #ifndef REQUEST_H
 #define REQUEST_H
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 
 /**
@@ -19,10 +21,19 @@
  * Each Request object contains identifying information including
  * source IP, destination IP, processing time, and request type.
  * A unique request ID is automatically assigned using a static counter.
+ * Addresses are stored in packed integer form so that a Request holds no
+ * heap memory and can live in a RequestArena slot.
  */
 class Request {
 public:
 
+    /**
+     * @brief Constructs an empty Request (ID -1) for preallocated storage.
+     *
+     * No request ID is consumed.
+     */
+    Request();
+
     /**
      * @brief Constructs a Request object.
      *
@@ -35,6 +46,51 @@ public:
      */
     Request(const std::string& ip_in, const std::string& ip_out, int time_to_process, char request_type);
 
+    /**
+     * @brief Constructs a Request from packed IPv4 addresses.
+     *
+     * Assigns a unique request ID and initializes all request fields.
+     *
+     * @param ip_in Source IP address in integer form.
+     * @param ip_out Destination IP address in integer form.
+     * @param time_to_process Time required to process the request.
+     * @param request_type Type of request (e.g., 'P' for processing, 'S' for streaming).
+     */
+    Request(uint32_t ip_in, uint32_t ip_out, int time_to_process, char request_type);
+
+    /**
+     * @brief Converts a dotted-quad IPv4 string into its packed form.
+     *
+     * @param ip IPv4 address as a string (e.g., "10.0.0.1").
+     * @return Integer representation with the first octet in the high byte.
+     */
+    static uint32_t parse_ip(const std::string& ip);
+
+    /**
+     * @brief Converts a packed IPv4 address into dotted-quad form.
+     *
+     * @param ip Integer representation of the address.
+     * @return IPv4 address as a string.
+     */
+    static std::string format_ip(uint32_t ip);
+
+    /**
+     * @brief Returns the ID the next constructed request will get.
+     *
+     * @return Next request ID.
+     */
+    static int peek_next_id();
+
+    /**
+     * @brief Sets the ID the next constructed request will get.
+     *
+     * Used when a checkpoint is restored, so new requests continue the
+     * checkpointed ID sequence.
+     *
+     * @param id Next request ID.
+     */
+    static void set_next_id(int id);
+
     /**
      * @brief Returns the unique identifier for this request.
      *
@@ -56,6 +112,20 @@ public:
      */
     std::string get_ip_out() const;
 
+    /**
+     * @brief Returns the source IP address in packed form.
+     *
+     * @return The incoming IP address as an integer.
+     */
+    uint32_t get_ip_in_int() const;
+
+    /**
+     * @brief Returns the destination IP address in packed form.
+     *
+     * @return The outgoing IP address as an integer.
+     */
+    uint32_t get_ip_out_int() const;
+
     /**
      * @brief Returns the processing time required for this request.
      *
@@ -70,12 +140,47 @@ public:
      */
     char get_request_type() const;
 
+    /**
+     * @brief Returns the processing time still owed to the request.
+     *
+     * Equals get_time_to_process() until a time slice of the request ends.
+     *
+     * @return Remaining work in simulation units.
+     */
+    int get_remaining_work() const;
+
+    /**
+     * @brief Returns the work the current (or next) time slice covers.
+     *
+     * @return Work of the slice in simulation units.
+     */
+    int get_slice_work() const;
+
+    /**
+     * @brief Sets how much of the remaining work the next time slice covers.
+     *
+     * @param work Work of the slice, at most get_remaining_work().
+     */
+    void begin_slice(int work);
+
+    /**
+     * @brief Deducts a finished time slice from the remaining work.
+     *
+     * The next slice covers all remaining work unless begin_slice() says otherwise.
+     *
+     * @return true if work remains (the request was preempted).
+     */
+    bool end_slice();
+
 private:
 
     /**
      * @brief Static counter used to generate unique request IDs.
+     *
+     * Atomic so that simulations running on several threads (see the sweep
+     * runner) still hand out unique IDs.
      */
-    static int next_id;
+    static std::atomic<int> next_id;
 
     /**
      * @brief Unique identifier for this request.
@@ -83,14 +188,14 @@ private:
     int request_id;
 
     /**
-     * @brief Source IP address of the request.
+     * @brief Source IP address of the request (packed).
      */
-    std::string ip_in;
+    uint32_t ip_in;
 
     /**
-     * @brief Destination IP address of the request.
+     * @brief Destination IP address of the request (packed).
      */
-    std::string ip_out;
+    uint32_t ip_out;
 
     /**
      * @brief Time required to process the request.
@@ -101,6 +206,16 @@ private:
      * @brief Type of request (e.g., processing or streaming).
      */
     char request_type;
+
+    /**
+     * @brief Processing time still owed (time-sliced scheduling).
+     */
+    int remaining_work;
+
+    /**
+     * @brief Work covered by the current time slice.
+     */
+    int slice_work;
 };
 
 #endif
\ No newline at end of file
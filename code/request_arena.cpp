@@ -0,0 +1,202 @@
+/**
+ * @file request_arena.cpp
+ * @brief Implements the RequestArena slab allocator.
+ */
+
+#include "request_arena.h"
+#include "alloc_counter.h"
+#include <type_traits>
+
+/**
+ * @brief Constructs an arena with room for at least initial_capacity requests.
+ *
+ * @param initial_capacity Number of slots to preallocate.
+ */
+RequestArena::RequestArena(size_t initial_capacity) {
+    do {
+        grow();
+    } while (capacity() < initial_capacity);
+}
+
+/**
+ * @brief Constructs a new Request in a free slot.
+ *
+ * A new chunk is only allocated when every existing slot is in use.
+ *
+ * @param ip_in Source IP address in integer form.
+ * @param ip_out Destination IP address in integer form.
+ * @param time_to_process Time required to process the request.
+ * @param request_type Type of request ('P' or 'S').
+ * @return Handle owning the new request.
+ */
+RequestHandle RequestArena::create(uint32_t ip_in, uint32_t ip_out, int time_to_process, char request_type) {
+    if (free_slots.empty()) {
+        grow();
+    }
+    uint32_t index = free_slots.back();
+    free_slots.pop_back();
+    chunks[index / CHUNK_SIZE][index % CHUNK_SIZE] = Request(ip_in, ip_out, time_to_process, request_type);
+    return RequestHandle(index, generations[index]);
+}
+
+/**
+ * @brief Places a copy of an existing request in a free slot.
+ *
+ * @param request Request to copy.
+ * @return Handle owning the copy.
+ */
+RequestHandle RequestArena::insert(const Request& request) {
+    if (free_slots.empty()) {
+        grow();
+    }
+    uint32_t index = free_slots.back();
+    free_slots.pop_back();
+    chunks[index / CHUNK_SIZE][index % CHUNK_SIZE] = request;
+    return RequestHandle(index, generations[index]);
+}
+
+/**
+ * @brief Returns the request owned by a handle.
+ *
+ * @param handle A valid handle issued by this arena.
+ * @return Reference to the request.
+ */
+Request& RequestArena::get(const RequestHandle& handle) {
+    return chunks[handle.index / CHUNK_SIZE][handle.index % CHUNK_SIZE];
+}
+
+/**
+ * @brief Returns the request owned by a handle.
+ *
+ * @param handle A valid handle issued by this arena.
+ * @return Reference to the request.
+ */
+const Request& RequestArena::get(const RequestHandle& handle) const {
+    return chunks[handle.index / CHUNK_SIZE][handle.index % CHUNK_SIZE];
+}
+
+/**
+ * @brief Checks whether a handle still refers to a live request.
+ *
+ * @param handle Handle to check.
+ * @return true if the handle is valid and its slot was not released.
+ */
+bool RequestArena::is_live(const RequestHandle& handle) const {
+    return handle.valid() && handle.index < generations.size() && generations[handle.index] == handle.generation;
+}
+
+/**
+ * @brief Destroys a request and returns its slot to the free list.
+ *
+ * The slot generation is bumped so stale handles can be detected.
+ *
+ * @param handle Handle owning the request; left empty afterwards.
+ */
+void RequestArena::release(RequestHandle&& handle) {
+    if (!is_live(handle)) {
+        return;
+    }
+    generations[handle.index]++;
+    free_slots.push_back(handle.index);
+    handle.index = RequestHandle::INVALID;
+}
+
+/**
+ * @brief Returns the number of live requests.
+ *
+ * @return Requests created and not yet released.
+ */
+size_t RequestArena::live() const {
+    return capacity() - free_slots.size();
+}
+
+/**
+ * @brief Returns the number of allocated slots.
+ *
+ * @return Total slot capacity across all chunks.
+ */
+size_t RequestArena::capacity() const {
+    return chunks.size() * CHUNK_SIZE;
+}
+
+/**
+ * @brief Writes every slot, its generation and the free list to a checkpoint.
+ *
+ * Requests are trivially copyable, so each chunk is written as one block.
+ *
+ * @param out Checkpoint being written.
+ */
+void RequestArena::save(CheckpointWriter& out) const {
+    static_assert(std::is_trivially_copyable<Request>::value, "arena chunks are checkpointed as raw bytes");
+    out.write(static_cast<uint64_t>(chunks.size()));
+    for (const auto& chunk : chunks) {
+        out.append(chunk.get(), CHUNK_SIZE * sizeof(Request));
+    }
+    out.write_vector(generations);
+    out.write_vector(free_slots);
+}
+
+/**
+ * @brief Replaces the arena's contents with a checkpointed arena.
+ *
+ * @param in Checkpoint being read.
+ * @return false if the arena section is malformed.
+ */
+bool RequestArena::restore(CheckpointReader& in) {
+    MEMORY_SCOPE(MemoryComponent::REQUESTS);
+    uint64_t chunk_count = 0;
+    in.read(chunk_count);
+    if (chunk_count == 0 || chunk_count > in.remaining() / (CHUNK_SIZE * sizeof(Request))) {
+        in.fail();
+        return false;
+    }
+    chunks.clear();
+    for (uint64_t i = 0; i < chunk_count; ++i) {
+        chunks.emplace_back(new Request[CHUNK_SIZE]);
+        in.take(chunks.back().get(), CHUNK_SIZE * sizeof(Request));
+    }
+    in.read_vector(generations);
+    in.read_vector(free_slots);
+    if (generations.size() != capacity() || free_slots.size() > capacity()) {
+        in.fail();
+    }
+    for (uint32_t slot : free_slots) {
+        if (slot >= capacity()) {
+            in.fail();
+            break;
+        }
+    }
+    free_slots.reserve(capacity());
+    return in.ok();
+}
+
+/**
+ * @brief Issues a handle for a live slot of a restored arena.
+ *
+ * @param index Slot index saved with the handle (0xFFFFFFFF for an empty handle).
+ * @return Handle owning the slot, or an empty handle.
+ */
+RequestHandle RequestArena::adopt(uint32_t index) const {
+    if (index >= generations.size()) {
+        return RequestHandle();
+    }
+    return RequestHandle(index, generations[index]);
+}
+
+/**
+ * @brief Allocates one more chunk of slots.
+ *
+ * The free list is reserved for the full capacity up front so that
+ * release() never reallocates it. New slots are pushed in reverse so the
+ * lowest index is handed out first.
+ */
+void RequestArena::grow() {
+    MEMORY_SCOPE(MemoryComponent::REQUESTS);
+    uint32_t base = static_cast<uint32_t>(capacity());
+    chunks.emplace_back(new Request[CHUNK_SIZE]);
+    generations.resize(capacity(), 0);
+    free_slots.reserve(capacity());
+    for (size_t i = CHUNK_SIZE; i-- > 0;) {
+        free_slots.push_back(base + static_cast<uint32_t>(i));
+    }
+}
@@ -0,0 +1,242 @@
+/**
+ * @file request_arena.h
+ * @brief Declares the RequestArena slab allocator and its RequestHandle.
+ *
+ * This header defines the arena that owns every in-flight Request. Requests
+ * are constructed in stable, recyclable slots and referred to through small
+ * move-only handles, so queues and servers pass 8-byte handles around instead
+ * of copying Request objects.
+ */
+
+#ifndef REQUEST_ARENA_H
+#define REQUEST_ARENA_H
+
+#include "checkpoint.h"
+#include "request.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @class RequestHandle
+ * @brief Move-only reference to a Request owned by a RequestArena.
+ *
+ * A handle is the unique owner of its arena slot: it cannot be copied, and
+ * moving it leaves the source empty. The slot generation guards against using
+ * a handle after its slot was released and reused.
+ */
+class RequestHandle {
+public:
+
+    /**
+     * @brief Constructs an empty handle.
+     */
+    RequestHandle() : index(INVALID), generation(0) {}
+
+    /**
+     * @brief Takes ownership from another handle, leaving it empty.
+     */
+    RequestHandle(RequestHandle&& other) noexcept : index(other.index), generation(other.generation) {
+        other.index = INVALID;
+    }
+
+    /**
+     * @brief Takes ownership from another handle, leaving it empty.
+     */
+    RequestHandle& operator=(RequestHandle&& other) noexcept {
+        index = other.index;
+        generation = other.generation;
+        other.index = INVALID;
+        return *this;
+    }
+
+    RequestHandle(const RequestHandle&) = delete;
+    RequestHandle& operator=(const RequestHandle&) = delete;
+
+    /**
+     * @brief Checks whether the handle owns a slot.
+     *
+     * @return true if the handle refers to a request, false if empty.
+     */
+    bool valid() const { return index != INVALID; }
+
+    /**
+     * @brief Returns the arena slot index.
+     *
+     * @return Slot index, or 0xFFFFFFFF if the handle is empty.
+     */
+    uint32_t get_index() const { return index; }
+
+private:
+    friend class RequestArena;
+
+    /**
+     * @brief Marker stored in empty handles.
+     */
+    static constexpr uint32_t INVALID = 0xFFFFFFFFu;
+
+    /**
+     * @brief Constructs a handle for a slot; only the arena creates handles.
+     */
+    RequestHandle(uint32_t index, uint32_t generation) : index(index), generation(generation) {}
+
+    /**
+     * @brief Slot index in the arena.
+     */
+    uint32_t index;
+
+    /**
+     * @brief Generation of the slot when the handle was issued.
+     */
+    uint32_t generation;
+};
+
+/**
+ * @class RequestArena
+ * @brief Slab allocator owning all in-flight requests.
+ *
+ * Slots are allocated in fixed-size chunks that never move, so a Request's
+ * address is stable for as long as its handle lives. Released slots go on a
+ * free list and are reused before a new chunk is allocated; once the arena
+ * has grown to the peak number of in-flight requests, creating and releasing
+ * requests performs no heap allocation.
+ */
+class RequestArena {
+public:
+
+    /**
+     * @brief Number of requests per allocated chunk.
+     */
+    static constexpr size_t CHUNK_SIZE = 4096;
+
+    /**
+     * @brief Constructs an arena with room for at least initial_capacity requests.
+     *
+     * @param initial_capacity Number of slots to preallocate.
+     */
+    explicit RequestArena(size_t initial_capacity = CHUNK_SIZE);
+
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+
+    /**
+     * @brief Constructs a new Request in a free slot.
+     *
+     * @param ip_in Source IP address in integer form.
+     * @param ip_out Destination IP address in integer form.
+     * @param time_to_process Time required to process the request.
+     * @param request_type Type of request ('P' or 'S').
+     * @return Handle owning the new request.
+     */
+    RequestHandle create(uint32_t ip_in, uint32_t ip_out, int time_to_process, char request_type);
+
+    /**
+     * @brief Places a copy of an existing request in a free slot.
+     *
+     * Used to bring back a request that was written out of the arena; the
+     * request keeps its ID and progress.
+     *
+     * @param request Request to copy.
+     * @return Handle owning the copy.
+     */
+    RequestHandle insert(const Request& request);
+
+    /**
+     * @brief Returns the request owned by a handle.
+     *
+     * @param handle A valid handle issued by this arena.
+     * @return Reference to the request, stable until the handle is released.
+     */
+    Request& get(const RequestHandle& handle);
+
+    /**
+     * @brief Returns the request owned by a handle.
+     *
+     * @param handle A valid handle issued by this arena.
+     * @return Reference to the request, stable until the handle is released.
+     */
+    const Request& get(const RequestHandle& handle) const;
+
+    /**
+     * @brief Checks whether a handle still refers to a live request.
+     *
+     * @param handle Handle to check.
+     * @return true if the handle is valid and its slot was not released.
+     */
+    bool is_live(const RequestHandle& handle) const;
+
+    /**
+     * @brief Destroys a request and returns its slot to the free list.
+     *
+     * @param handle Handle owning the request; left empty afterwards.
+     */
+    void release(RequestHandle&& handle);
+
+    /**
+     * @brief Returns the number of live requests.
+     *
+     * @return Requests created and not yet released.
+     */
+    size_t live() const;
+
+    /**
+     * @brief Returns the number of allocated slots.
+     *
+     * @return Total slot capacity across all chunks.
+     */
+    size_t capacity() const;
+
+    /**
+     * @brief Writes every slot, its generation and the free list to a checkpoint.
+     *
+     * @param out Checkpoint being written.
+     */
+    void save(CheckpointWriter& out) const;
+
+    /**
+     * @brief Replaces the arena's contents with a checkpointed arena.
+     *
+     * Handles issued before the restore become invalid. The owners of the
+     * restored requests take them back with adopt().
+     *
+     * @param in Checkpoint being read.
+     * @return false if the arena section is malformed.
+     */
+    bool restore(CheckpointReader& in);
+
+    /**
+     * @brief Issues a handle for a live slot of a restored arena.
+     *
+     * Each live slot must be adopted exactly once, by the queue or server
+     * that owned it when the checkpoint was written.
+     *
+     * @param index Slot index saved with the handle (0xFFFFFFFF for an empty handle).
+     * @return Handle owning the slot, or an empty handle.
+     */
+    RequestHandle adopt(uint32_t index) const;
+
+private:
+
+    /**
+     * @brief Allocates one more chunk of slots.
+     */
+    void grow();
+
+    /**
+     * @brief Fixed-size chunks of request slots.
+     */
+    std::vector<std::unique_ptr<Request[]>> chunks;
+
+    /**
+     * @brief Generation of each slot, bumped on release.
+     */
+    std::vector<uint32_t> generations;
+
+    /**
+     * @brief Indices of free slots.
+     */
+    std::vector<uint32_t> free_slots;
+};
+
+#endif
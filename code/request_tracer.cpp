@@ -0,0 +1,173 @@
+/**
+ * @file request_tracer.cpp
+ * @brief Implements the RequestTracer and its Chrome trace-event export.
+ */
+
+#include "request_tracer.h"
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+
+/**
+ * @brief Dispatch of a traced request that has not finished its slice yet.
+ */
+struct OpenSlice {
+    int cycle;      ///< Cycle the slice started.
+    int server_id;  ///< Server running the slice.
+    int pool;       ///< Pool of the server.
+};
+
+/**
+ * @brief Writes an event on a request's async track.
+ *
+ * @param out Output stream.
+ * @param phase "b" (begin), "e" (end) or "n" (instant).
+ * @param name Span or instant name.
+ * @param record Event the entry is written for.
+ */
+void write_async(std::ostream& out, const char* phase, const char* name, const TraceRecord& record) {
+    out << ",\n{\"name\":\"" << name << "\",\"cat\":\"request\",\"ph\":\"" << phase << "\",\"id\":" << record.request_id
+        << ",\"pid\":0,\"tid\":0,\"ts\":" << record.cycle << '}';
+}
+
+/**
+ * @brief Writes the slice a server ran for a request on the server's track.
+ *
+ * @param out Output stream.
+ * @param slice Start, server and pool of the slice.
+ * @param record PREEMPT or COMPLETE event that ended it.
+ */
+void write_server_slice(std::ostream& out, const OpenSlice& slice, const TraceRecord& record) {
+    out << ",\n{\"name\":\"request " << record.request_id << "\",\"cat\":\"server\",\"ph\":\"X\",\"pid\":" << slice.pool + 1
+        << ",\"tid\":" << slice.server_id << ",\"ts\":" << slice.cycle << ",\"dur\":" << record.cycle - slice.cycle
+        << ",\"args\":{\"end\":\"" << (record.event == TraceEvent::PREEMPT ? "preempted" : "completed") << "\"}}";
+}
+
+} // namespace
+
+/**
+ * @brief Constructs a tracer and allocates its buffer.
+ *
+ * @param sample_rate Fraction of requests traced, in (0, 1].
+ * @param capacity Maximum number of events kept.
+ */
+RequestTracer::RequestTracer(double sample_rate, size_t capacity)
+    : threshold(sample_rate >= 1.0 ? std::numeric_limits<uint32_t>::max()
+                                   : static_cast<uint32_t>(sample_rate * 4294967296.0)),
+      records(capacity), count(0), dropped(0) {}
+
+/**
+ * @brief Remembers which request occupies an arena slot.
+ *
+ * @param slot Arena slot index.
+ * @param request_id Request in the slot, or -1 if it is not traced.
+ */
+void RequestTracer::track(uint32_t slot, int request_id) {
+    if (slot >= slot_request.size()) {
+        slot_request.resize(slot + 1, -1);
+    }
+    slot_request[slot] = request_id;
+}
+
+/**
+ * @brief Records the COMPLETE event of the request that occupied a slot, if traced.
+ *
+ * @param cycle Clock cycle of the completion.
+ * @param slot Arena slot the request occupied.
+ */
+void RequestTracer::complete(int cycle, uint32_t slot) {
+    if (slot < slot_request.size() && slot_request[slot] >= 0) {
+        record(TraceEvent::COMPLETE, cycle, slot_request[slot], 0);
+        slot_request[slot] = -1;
+    }
+}
+
+/**
+ * @brief Returns the number of recorded events.
+ *
+ * @return Events in the buffer.
+ */
+size_t RequestTracer::size() const {
+    return count;
+}
+
+/**
+ * @brief Returns the number of events lost because the buffer was full.
+ *
+ * @return Dropped events.
+ */
+size_t RequestTracer::get_dropped() const {
+    return dropped;
+}
+
+/**
+ * @brief Writes the events as Chrome trace-event JSON.
+ *
+ * Events are stored in clock order, so each PREEMPT or COMPLETE event is
+ * paired with the latest DISPATCH of its request to draw the server slice.
+ *
+ * @param path Output file.
+ * @param pool_names Console names of the pools, by pool index.
+ * @return false if the file could not be written.
+ */
+bool RequestTracer::write_json(const std::string& path, const std::vector<std::string>& pool_names) const {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    out << "{\"traceEvents\":[\n"
+        << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"requests\"}}";
+    for (size_t pool = 0; pool < pool_names.size(); ++pool) {
+        out << ",\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pool + 1
+            << ",\"args\":{\"name\":\"" << pool_names[pool] << " servers\"}}";
+    }
+
+    std::unordered_map<int32_t, OpenSlice> running;
+    for (size_t i = 0; i < count; ++i) {
+        const TraceRecord& record = records[i];
+        switch (record.event) {
+        case TraceEvent::ARRIVE:
+            out << ",\n{\"name\":\"request\",\"cat\":\"request\",\"ph\":\"b\",\"id\":" << record.request_id
+                << ",\"pid\":0,\"tid\":0,\"ts\":" << record.cycle << ",\"args\":{\"type\":\""
+                << (record.request_type ? record.request_type : '?') << "\"}}";
+            break;
+        case TraceEvent::FIREWALL_PASS:
+            write_async(out, "n", "firewall pass", record);
+            break;
+        case TraceEvent::FIREWALL_BLOCK:
+            write_async(out, "n", "firewall block", record);
+            write_async(out, "e", "request", record);
+            break;
+        case TraceEvent::ENQUEUE:
+            write_async(out, "b", "queued", record);
+            break;
+        case TraceEvent::CACHE_HIT:
+            write_async(out, "e", "queued", record);
+            write_async(out, "n", "cache hit", record);
+            write_async(out, "e", "request", record);
+            break;
+        case TraceEvent::DISPATCH:
+            write_async(out, "e", "queued", record);
+            write_async(out, "b", "service", record);
+            running[record.request_id] = {record.cycle, record.server_id, record.pool};
+            break;
+        case TraceEvent::PREEMPT:
+        case TraceEvent::COMPLETE: {
+            write_async(out, "e", "service", record);
+            auto slice = running.find(record.request_id);
+            if (slice != running.end()) {
+                write_server_slice(out, slice->second, record);
+                running.erase(slice);
+            }
+            if (record.event == TraceEvent::COMPLETE) {
+                write_async(out, "e", "request", record);
+            }
+            break;
+        }
+        }
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,166 @@
+/**
+ * @file request_tracer.h
+ * @brief Declares the RequestTracer that records per-request lifecycle events.
+ *
+ * The tracer samples a fraction of requests by ID and appends their arrive,
+ * firewall, enqueue, dispatch, preempt and complete events to a buffer
+ * allocated once up front. Recording an event is a bounds check and a
+ * 16-byte store, and unsampled requests cost one multiply and compare. At
+ * the end of a run the buffer is exported as Chrome trace-event JSON, which
+ * chrome://tracing and Perfetto open directly.
+ */
+
+#ifndef REQUEST_TRACER_H
+#define REQUEST_TRACER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Lifecycle events of a traced request.
+ */
+enum class TraceEvent : uint8_t {
+    ARRIVE,          ///< Request created by the generator or taken from the ring.
+    FIREWALL_PASS,   ///< Firewall let the request through.
+    FIREWALL_BLOCK,  ///< Firewall blocked the request; its trace ends.
+    ENQUEUE,         ///< Request joined a pool's queue.
+    CACHE_HIT,       ///< Request answered by the response cache; its trace ends.
+    DISPATCH,        ///< Request started on a server.
+    PREEMPT,         ///< Request's time slice ended with work left.
+    COMPLETE         ///< Request finished on a server; its trace ends.
+};
+
+/**
+ * @brief One recorded event (16 bytes).
+ */
+struct TraceRecord {
+    int32_t cycle;        ///< Clock cycle of the event.
+    int32_t request_id;   ///< Request the event belongs to.
+    int32_t server_id;    ///< Server of DISPATCH events, otherwise -1.
+    TraceEvent event;     ///< What happened.
+    char request_type;    ///< Type of the request (0 if unknown).
+    uint8_t pool;         ///< Pool index of ENQUEUE, CACHE_HIT and DISPATCH events.
+    uint8_t reserved;     ///< Padding.
+};
+
+/**
+ * @class RequestTracer
+ * @brief Sampled, preallocated recorder of request lifecycle events.
+ *
+ * Requests are sampled by hashing their ID, so every event of a sampled
+ * request is kept and the others are skipped without touching the buffer.
+ * Once the buffer is full further events are counted as dropped.
+ */
+class RequestTracer {
+public:
+
+    /**
+     * @brief Constructs a tracer and allocates its buffer.
+     *
+     * @param sample_rate Fraction of requests traced, in (0, 1].
+     * @param capacity Maximum number of events kept.
+     */
+    RequestTracer(double sample_rate, size_t capacity);
+
+    /**
+     * @brief Checks whether a request is traced.
+     *
+     * @param request_id Request ID.
+     * @return true for about sample_rate of all IDs.
+     */
+    bool sampled(int request_id) const {
+        return static_cast<uint32_t>(request_id) * 2654435761u <= threshold;
+    }
+
+    /**
+     * @brief Appends an event of a sampled request.
+     *
+     * @param event What happened.
+     * @param cycle Clock cycle of the event.
+     * @param request_id Request ID (the caller checked sampled()).
+     * @param request_type Request type.
+     * @param pool Pool index, or 0 if the event has none.
+     * @param server_id Server ID of DISPATCH events, otherwise -1.
+     */
+    void record(TraceEvent event, int cycle, int request_id, char request_type, int pool = 0, int server_id = -1) {
+        if (count == records.size()) {
+            dropped++;
+            return;
+        }
+        records[count++] = {cycle, request_id, server_id, event, request_type, static_cast<uint8_t>(pool), 0};
+    }
+
+    /**
+     * @brief Remembers which request occupies an arena slot.
+     *
+     * Completions are reported by arena slot after the request was released,
+     * so the tracer keeps the ID of the sampled request in each slot.
+     *
+     * @param slot Arena slot index.
+     * @param request_id Request in the slot, or -1 if it is not traced.
+     */
+    void track(uint32_t slot, int request_id);
+
+    /**
+     * @brief Records the COMPLETE event of the request that occupied a slot, if traced.
+     *
+     * @param cycle Clock cycle of the completion.
+     * @param slot Arena slot the request occupied.
+     */
+    void complete(int cycle, uint32_t slot);
+
+    /**
+     * @brief Returns the number of recorded events.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Returns the number of events lost because the buffer was full.
+     */
+    size_t get_dropped() const;
+
+    /**
+     * @brief Writes the events as Chrome trace-event JSON.
+     *
+     * Each traced request becomes an async track with nested "queued" and
+     * "service" spans and instant events for the firewall verdict and cache
+     * hits. Each server gets a thread track (grouped by pool) showing the
+     * slices it ran. One cycle is shown as one microsecond.
+     *
+     * @param path Output file.
+     * @param pool_names Console names of the pools, by pool index.
+     * @return false if the file could not be written.
+     */
+    bool write_json(const std::string& path, const std::vector<std::string>& pool_names) const;
+
+private:
+
+    /**
+     * @brief Largest hashed request ID that is sampled.
+     */
+    uint32_t threshold;
+
+    /**
+     * @brief Preallocated event buffer.
+     */
+    std::vector<TraceRecord> records;
+
+    /**
+     * @brief Number of events recorded.
+     */
+    size_t count;
+
+    /**
+     * @brief Events lost because the buffer was full.
+     */
+    size_t dropped;
+
+    /**
+     * @brief Traced request ID in each arena slot (-1 = untraced).
+     */
+    std::vector<int32_t> slot_request;
+};
+
+#endif
@@ -0,0 +1,440 @@
+/**
+ * @file response_cache.cpp
+ * @brief Implements the ResponseCache class.
+ *
+ * This file contains the hash index, the LRU / CLOCK replacement logic and the
+ * TinyLFU frequency sketch used for admission.
+ */
+
+#include "response_cache.h"
+
+namespace {
+
+/**
+ * @brief Mixes a 64-bit key into a well-distributed hash (splitmix64 finalizer).
+ */
+uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief Returns the smallest power of two that is >= value.
+ */
+size_t next_pow2(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+/**
+ * @brief Saturation limit of a TinyLFU counter (4-bit counters).
+ */
+const uint8_t SKETCH_MAX = 15;
+
+/**
+ * @brief Number of hash rows in the frequency sketch.
+ */
+const size_t SKETCH_ROWS = 4;
+
+} // namespace
+
+/**
+ * @brief Constructs a cache with the given policy and capacity.
+ *
+ * Preallocates every internal array: the hash index is sized to at least twice
+ * the capacity to keep probe sequences short, and the sketch has one column
+ * per entry rounded up to a power of two. Counters are halved after ten
+ * increments per entry so that the sketch tracks recent popularity.
+ *
+ * @param policy Replacement / admission policy.
+ * @param capacity Maximum number of cached responses (at least 1).
+ */
+ResponseCache::ResponseCache(CachePolicy policy, size_t capacity)
+    : policy(policy), capacity(static_cast<uint32_t>(capacity > 0 ? capacity : 1)), count(0),
+      keys(this->capacity), prev(this->capacity, NONE), next(this->capacity, NONE), head(NONE), tail(NONE),
+      referenced(this->capacity, 0), hand(0),
+      index(next_pow2(2 * static_cast<size_t>(this->capacity)), NONE),
+      sketch_additions(0), sketch_sample_size(10 * static_cast<size_t>(this->capacity)),
+      hits(0), misses(0), rejected(0) {
+    index_mask = index.size() - 1;
+    size_t width = next_pow2(this->capacity < 16 ? 16 : this->capacity);
+    sketch_mask = width - 1;
+    if (policy == CachePolicy::TINYLFU) {
+        sketch.assign(SKETCH_ROWS * width, 0);
+    }
+}
+
+/**
+ * @brief Parses a policy name ("lru", "clock" or "tinylfu").
+ *
+ * @param name Policy name.
+ * @param policy Receives the parsed policy on success.
+ * @return true if the name was recognized, false otherwise.
+ */
+bool ResponseCache::parse_policy(const std::string& name, CachePolicy& policy) {
+    if (name == "lru") {
+        policy = CachePolicy::LRU;
+    } else if (name == "clock") {
+        policy = CachePolicy::CLOCK;
+    } else if (name == "tinylfu") {
+        policy = CachePolicy::TINYLFU;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Returns the name of a policy.
+ *
+ * @param policy Policy to name.
+ * @return "lru", "clock" or "tinylfu".
+ */
+const char* ResponseCache::policy_name(CachePolicy policy) {
+    switch (policy) {
+        case CachePolicy::LRU: return "lru";
+        case CachePolicy::CLOCK: return "clock";
+        case CachePolicy::TINYLFU: return "tinylfu";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Looks up a key and records a hit or a miss.
+ *
+ * @param key Cache key built with make_key().
+ * @return true on a hit, false on a miss.
+ */
+bool ResponseCache::lookup(uint64_t key) {
+    if (policy == CachePolicy::TINYLFU) {
+        sketch_increment(key);
+    }
+    uint32_t slot = find(key);
+    if (slot == NONE) {
+        misses++;
+        return false;
+    }
+    hits++;
+    if (policy == CachePolicy::CLOCK) {
+        referenced[slot] = 1;
+    } else if (slot != head) {
+        unlink(slot);
+        push_front(slot);
+    }
+    return true;
+}
+
+/**
+ * @brief Inserts the response for a key after it has been served.
+ *
+ * @param key Cache key built with make_key().
+ * @return true if the key is cached after the call, false if rejected.
+ */
+bool ResponseCache::insert(uint64_t key) {
+    if (find(key) != NONE) {
+        return true;
+    }
+    uint32_t slot;
+    if (count < capacity) {
+        slot = count++;
+    } else {
+        slot = choose_victim();
+        if (policy == CachePolicy::TINYLFU && sketch_estimate(key) <= sketch_estimate(keys[slot])) {
+            rejected++;
+            return false;
+        }
+        index_erase(keys[slot]);
+        if (policy != CachePolicy::CLOCK) {
+            unlink(slot);
+        }
+    }
+    keys[slot] = key;
+    index_insert(key, slot);
+    if (policy == CachePolicy::CLOCK) {
+        referenced[slot] = 1;
+    } else {
+        push_front(slot);
+    }
+    return true;
+}
+
+/**
+ * @brief Returns the number of lookups that hit.
+ *
+ * @return Hit count.
+ */
+long long ResponseCache::get_hits() const {
+    return hits;
+}
+
+/**
+ * @brief Returns the number of lookups that missed.
+ *
+ * @return Miss count.
+ */
+long long ResponseCache::get_misses() const {
+    return misses;
+}
+
+/**
+ * @brief Returns the number of insertions rejected by admission.
+ *
+ * @return Rejected admission count.
+ */
+long long ResponseCache::get_rejected() const {
+    return rejected;
+}
+
+/**
+ * @brief Returns the fraction of lookups that hit.
+ *
+ * @return Hit ratio in [0, 1], or 0 when nothing was looked up.
+ */
+double ResponseCache::hit_ratio() const {
+    long long total = hits + misses;
+    return total == 0 ? 0.0 : static_cast<double>(hits) / total;
+}
+
+/**
+ * @brief Returns the number of cached entries.
+ *
+ * @return Current entry count.
+ */
+size_t ResponseCache::size() const {
+    return count;
+}
+
+/**
+ * @brief Returns the configured policy.
+ *
+ * @return The replacement / admission policy.
+ */
+CachePolicy ResponseCache::get_policy() const {
+    return policy;
+}
+
+/**
+ * @brief Finds the entry slot holding key by linear probing.
+ *
+ * @param key Cache key.
+ * @return Entry slot, or NONE if the key is not cached.
+ */
+uint32_t ResponseCache::find(uint64_t key) const {
+    for (size_t i = mix(key) & index_mask; index[i] != NONE; i = (i + 1) & index_mask) {
+        if (keys[index[i]] == key) {
+            return index[i];
+        }
+    }
+    return NONE;
+}
+
+/**
+ * @brief Adds key -> slot to the hash index.
+ *
+ * @param key Cache key.
+ * @param slot Entry slot holding the key.
+ */
+void ResponseCache::index_insert(uint64_t key, uint32_t slot) {
+    size_t i = mix(key) & index_mask;
+    while (index[i] != NONE) {
+        i = (i + 1) & index_mask;
+    }
+    index[i] = slot;
+}
+
+/**
+ * @brief Removes key from the hash index.
+ *
+ * Uses backward-shift deletion so that no tombstones are needed: entries
+ * later in the probe run are moved back into the hole when their home
+ * bucket does not lie between the hole and their current position.
+ *
+ * @param key Cache key to remove.
+ */
+void ResponseCache::index_erase(uint64_t key) {
+    size_t hole = mix(key) & index_mask;
+    while (index[hole] != NONE && keys[index[hole]] != key) {
+        hole = (hole + 1) & index_mask;
+    }
+    if (index[hole] == NONE) {
+        return;
+    }
+    index[hole] = NONE;
+    for (size_t j = (hole + 1) & index_mask; index[j] != NONE; j = (j + 1) & index_mask) {
+        size_t home = mix(keys[index[j]]) & index_mask;
+        bool stays = (hole < j) ? (home > hole && home <= j) : (home > hole || home <= j);
+        if (!stays) {
+            index[hole] = index[j];
+            index[j] = NONE;
+            hole = j;
+        }
+    }
+}
+
+/**
+ * @brief Unlinks a slot from the recency list.
+ *
+ * @param slot Entry slot to unlink.
+ */
+void ResponseCache::unlink(uint32_t slot) {
+    if (prev[slot] != NONE) {
+        next[prev[slot]] = next[slot];
+    } else {
+        head = next[slot];
+    }
+    if (next[slot] != NONE) {
+        prev[next[slot]] = prev[slot];
+    } else {
+        tail = prev[slot];
+    }
+    prev[slot] = next[slot] = NONE;
+}
+
+/**
+ * @brief Links a slot at the most-recently-used end of the recency list.
+ *
+ * @param slot Entry slot to link.
+ */
+void ResponseCache::push_front(uint32_t slot) {
+    prev[slot] = NONE;
+    next[slot] = head;
+    if (head != NONE) {
+        prev[head] = slot;
+    }
+    head = slot;
+    if (tail == NONE) {
+        tail = slot;
+    }
+}
+
+/**
+ * @brief Chooses the slot to evict according to the policy.
+ *
+ * LRU and TinyLFU evict the tail of the recency list. CLOCK sweeps the hand,
+ * clearing reference bits, until it finds an unreferenced entry.
+ *
+ * @return The victim slot.
+ */
+uint32_t ResponseCache::choose_victim() {
+    if (policy != CachePolicy::CLOCK) {
+        return tail;
+    }
+    while (referenced[hand]) {
+        referenced[hand] = 0;
+        hand = (hand + 1) % capacity;
+    }
+    uint32_t victim = hand;
+    hand = (hand + 1) % capacity;
+    return victim;
+}
+
+/**
+ * @brief Records one access of key in the frequency sketch.
+ *
+ * Once the sample size is reached every counter is halved, so old
+ * popularity decays and the sketch follows shifts in the workload.
+ *
+ * @param key Cache key.
+ */
+void ResponseCache::sketch_increment(uint64_t key) {
+    size_t width = sketch_mask + 1;
+    for (size_t row = 0; row < SKETCH_ROWS; ++row) {
+        uint8_t& counter = sketch[row * width + (mix(key + row * 0xD6E8FEB86659FD93ull) & sketch_mask)];
+        if (counter < SKETCH_MAX) {
+            counter++;
+        }
+    }
+    if (++sketch_additions >= sketch_sample_size) {
+        for (uint8_t& counter : sketch) {
+            counter >>= 1;
+        }
+        sketch_additions /= 2;
+    }
+}
+
+/**
+ * @brief Estimates how often key was accessed recently.
+ *
+ * @param key Cache key.
+ * @return Minimum counter value across the sketch rows.
+ */
+uint8_t ResponseCache::sketch_estimate(uint64_t key) const {
+    size_t width = sketch_mask + 1;
+    uint8_t estimate = SKETCH_MAX;
+    for (size_t row = 0; row < SKETCH_ROWS; ++row) {
+        uint8_t counter = sketch[row * width + (mix(key + row * 0xD6E8FEB86659FD93ull) & sketch_mask)];
+        if (counter < estimate) {
+            estimate = counter;
+        }
+    }
+    return estimate;
+}
+
+/**
+ * @brief Writes the entries, recency state, sketch and counters to a checkpoint.
+ *
+ * @param out Checkpoint being written.
+ */
+void ResponseCache::save(CheckpointWriter& out) const {
+    out.write(policy);
+    out.write(capacity);
+    out.write(count);
+    out.write_vector(keys);
+    out.write_vector(prev);
+    out.write_vector(next);
+    out.write(head);
+    out.write(tail);
+    out.write_vector(referenced);
+    out.write(hand);
+    out.write_vector(index);
+    out.write_vector(sketch);
+    out.write(sketch_additions);
+    out.write(hits);
+    out.write(misses);
+    out.write(rejected);
+}
+
+/**
+ * @brief Replaces the cache contents with checkpointed ones.
+ *
+ * The index and sketch sizes follow from the capacity, so a section written
+ * by a cache of another capacity is rejected.
+ *
+ * @param in Checkpoint being read.
+ * @return false if the section was written by a cache with another policy or capacity.
+ */
+bool ResponseCache::restore(CheckpointReader& in) {
+    CachePolicy saved_policy = policy;
+    uint32_t saved_capacity = 0;
+    in.read(saved_policy);
+    in.read(saved_capacity);
+    if (saved_policy != policy || saved_capacity != capacity) {
+        in.fail();
+        return false;
+    }
+    size_t index_size = index.size();
+    size_t sketch_size = sketch.size();
+    in.read(count);
+    in.read_vector(keys);
+    in.read_vector(prev);
+    in.read_vector(next);
+    in.read(head);
+    in.read(tail);
+    in.read_vector(referenced);
+    in.read(hand);
+    in.read_vector(index);
+    in.read_vector(sketch);
+    in.read(sketch_additions);
+    in.read(hits);
+    in.read(misses);
+    in.read(rejected);
+    if (index.size() != index_size || sketch.size() != sketch_size || keys.size() != capacity) {
+        in.fail();
+    }
+    return in.ok();
+}
@@ -0,0 +1,286 @@
+/**
+ * @file response_cache.h
+ * @brief Declares the ResponseCache class that short-circuits repeat requests.
+ *
+ * This header defines a fixed-capacity cache keyed by (ip_out, request_type)
+ * that sits between a LoadBalancer and its ServerHandler. A request whose key
+ * was recently served is answered by the cache instead of occupying a server.
+ */
+
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include "checkpoint.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Replacement / admission policy used by a ResponseCache.
+ */
+enum class CachePolicy {
+    LRU,     ///< Evict the least recently used entry.
+    CLOCK,   ///< Second-chance eviction with one reference bit per entry.
+    TINYLFU  ///< LRU eviction guarded by a TinyLFU frequency admission filter.
+};
+
+/**
+ * @class ResponseCache
+ * @brief Compact, allocation-free cache of recently served responses.
+ *
+ * All storage (entry keys, recency links, reference bits, hash index and the
+ * TinyLFU frequency sketch) is allocated once in the constructor; lookups and
+ * insertions never allocate. Entries are addressed through an open-addressing
+ * hash index with linear probing.
+ */
+class ResponseCache {
+public:
+
+    /**
+     * @brief Constructs a cache with the given policy and capacity.
+     *
+     * @param policy Replacement / admission policy.
+     * @param capacity Maximum number of cached responses (at least 1).
+     */
+    ResponseCache(CachePolicy policy, size_t capacity);
+
+    /**
+     * @brief Parses a policy name ("lru", "clock" or "tinylfu").
+     *
+     * @param name Policy name.
+     * @param policy Receives the parsed policy on success.
+     * @return true if the name was recognized, false otherwise.
+     */
+    static bool parse_policy(const std::string& name, CachePolicy& policy);
+
+    /**
+     * @brief Returns the name of a policy.
+     *
+     * @param policy Policy to name.
+     * @return "lru", "clock" or "tinylfu".
+     */
+    static const char* policy_name(CachePolicy policy);
+
+    /**
+     * @brief Builds the cache key for a destination address and request type.
+     *
+     * @param ip_out Destination address in integer form.
+     * @param request_type Request type character.
+     * @return 64-bit cache key.
+     */
+    static uint64_t make_key(uint32_t ip_out, char request_type) {
+        return (static_cast<uint64_t>(static_cast<unsigned char>(request_type)) << 32) | ip_out;
+    }
+
+    /**
+     * @brief Looks up a key and records a hit or a miss.
+     *
+     * A hit refreshes the entry's recency. Every lookup is also counted in the
+     * TinyLFU frequency sketch.
+     *
+     * @param key Cache key built with make_key().
+     * @return true on a hit, false on a miss.
+     */
+    bool lookup(uint64_t key);
+
+    /**
+     * @brief Inserts the response for a key after it has been served.
+     *
+     * When the cache is full a victim is chosen by the policy. Under TinyLFU
+     * the new key is only admitted if it is estimated to be accessed more
+     * often than the victim.
+     *
+     * @param key Cache key built with make_key().
+     * @return true if the key is cached after the call, false if rejected.
+     */
+    bool insert(uint64_t key);
+
+    /**
+     * @brief Returns the number of lookups that hit.
+     *
+     * @return Hit count.
+     */
+    long long get_hits() const;
+
+    /**
+     * @brief Returns the number of lookups that missed.
+     *
+     * @return Miss count.
+     */
+    long long get_misses() const;
+
+    /**
+     * @brief Returns the number of insertions rejected by admission.
+     *
+     * @return Rejected admission count (always 0 for LRU and CLOCK).
+     */
+    long long get_rejected() const;
+
+    /**
+     * @brief Returns the fraction of lookups that hit.
+     *
+     * @return Hit ratio in [0, 1], or 0 when nothing was looked up.
+     */
+    double hit_ratio() const;
+
+    /**
+     * @brief Returns the number of cached entries.
+     *
+     * @return Current entry count.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Returns the configured policy.
+     *
+     * @return The replacement / admission policy.
+     */
+    CachePolicy get_policy() const;
+
+    /**
+     * @brief Writes the entries, recency state, sketch and counters to a checkpoint.
+     *
+     * @param out Checkpoint being written.
+     */
+    void save(CheckpointWriter& out) const;
+
+    /**
+     * @brief Replaces the cache contents with checkpointed ones.
+     *
+     * @param in Checkpoint being read.
+     * @return false if the section was written by a cache with another policy or capacity.
+     */
+    bool restore(CheckpointReader& in);
+
+private:
+
+    /**
+     * @brief Marker for "no entry" in links and the hash index.
+     */
+    static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+    /**
+     * @brief Finds the entry slot holding key.
+     *
+     * @return Entry slot, or NONE if the key is not cached.
+     */
+    uint32_t find(uint64_t key) const;
+
+    /**
+     * @brief Adds key -> slot to the hash index.
+     */
+    void index_insert(uint64_t key, uint32_t slot);
+
+    /**
+     * @brief Removes key from the hash index (backward-shift deletion).
+     */
+    void index_erase(uint64_t key);
+
+    /**
+     * @brief Unlinks a slot from the recency list.
+     */
+    void unlink(uint32_t slot);
+
+    /**
+     * @brief Links a slot at the most-recently-used end of the recency list.
+     */
+    void push_front(uint32_t slot);
+
+    /**
+     * @brief Chooses the slot to evict according to the policy.
+     */
+    uint32_t choose_victim();
+
+    /**
+     * @brief Records one access of key in the frequency sketch.
+     */
+    void sketch_increment(uint64_t key);
+
+    /**
+     * @brief Estimates how often key was accessed recently.
+     */
+    uint8_t sketch_estimate(uint64_t key) const;
+
+    /**
+     * @brief Replacement / admission policy.
+     */
+    CachePolicy policy;
+
+    /**
+     * @brief Maximum number of entries.
+     */
+    uint32_t capacity;
+
+    /**
+     * @brief Number of occupied entry slots.
+     */
+    uint32_t count;
+
+    /**
+     * @brief Key stored in each entry slot.
+     */
+    std::vector<uint64_t> keys;
+
+    /**
+     * @brief Recency list links (LRU and TinyLFU).
+     */
+    std::vector<uint32_t> prev;
+
+    /**
+     * @brief Recency list links (LRU and TinyLFU).
+     */
+    std::vector<uint32_t> next;
+
+    /**
+     * @brief Most and least recently used slots.
+     */
+    uint32_t head, tail;
+
+    /**
+     * @brief Reference bits used by CLOCK.
+     */
+    std::vector<uint8_t> referenced;
+
+    /**
+     * @brief Current position of the CLOCK hand.
+     */
+    uint32_t hand;
+
+    /**
+     * @brief Open-addressing index mapping keys to entry slots.
+     */
+    std::vector<uint32_t> index;
+
+    /**
+     * @brief Mask applied to hashes to select an index bucket.
+     */
+    size_t index_mask;
+
+    /**
+     * @brief Count-Min sketch counters (four rows) for TinyLFU.
+     */
+    std::vector<uint8_t> sketch;
+
+    /**
+     * @brief Mask applied to hashes to select a sketch column.
+     */
+    size_t sketch_mask;
+
+    /**
+     * @brief Sketch increments since the last aging pass.
+     */
+    size_t sketch_additions;
+
+    /**
+     * @brief Number of increments after which all counters are halved.
+     */
+    size_t sketch_sample_size;
+
+    /**
+     * @brief Hit, miss and rejected-admission counters.
+     */
+    long long hits, misses, rejected;
+};
+
+#endif
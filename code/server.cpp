@@ -6,38 +6,53 @@
  * request processing, and busy-time management logic.
  */
 
-#include <string>
 #include "server.h"
 
 /**
- * @brief Static counter used to assign unique IDs to servers.
+ * @brief Constructs a view of the server stored in a table slot.
  *
- * This value increments each time a new Server instance is created.
- */
-int Server::next_id = 0;
-
-/**
- * @brief Constructs a Server and assigns it a unique ID.
+ * The table slot is expected to have been created with ServerTable::add(),
+ * which assigns the unique server ID and leaves the server idle with no
+ * active request (active_request_id = -1).
  *
- * Initializes the server with:
- * - A unique server ID
- * - An empty IP address
- * - No active request (active_request_id = -1)
- * - A busy time of 0 (available state)
+ * @param table Table holding the server's state.
+ * @param slot Slot index of the server in the table.
  */
-Server::Server() : server_id(next_id++), server_ip(""), active_request_id(-1), busy_until_time(0) {}
+Server::Server(ServerTable* table, size_t slot) : table(table), slot(slot) {}
 
 /**
  * @brief Starts processing a request.
  *
  * Sets the active request ID and updates the server's busy time
- * by adding the request's processing duration.
+ * by adding the duration of the request's current slice, adjusted for the
+ * server's speed and type affinity.
  *
  * @param request The Request to begin processing.
  */
 void Server::start_request(const Request& request) {
-    active_request_id = request.get_request_id();
-    busy_until_time += request.get_time_to_process();
+    table->start(slot, request.get_request_id(), request.get_slice_work(), request.get_request_type());
+}
+
+/**
+ * @brief Starts processing a batch of requests for the same backend as one call.
+ *
+ * All members share the leader's destination and type, so the batch is
+ * converted to cycles like one request of that type.
+ *
+ * @param leader Request the batch was built around.
+ * @param work Nominal work of the whole batch (setup once plus every member's own work).
+ */
+void Server::start_batch(const Request& leader, int work) {
+    table->start(slot, leader.get_request_id(), work, leader.get_request_type());
+}
+
+/**
+ * @brief Finishes the active request immediately.
+ *
+ * Clears the server's busy time so it becomes available.
+ */
+void Server::finish_request() {
+    table->finish(slot);
 }
 
 /**
@@ -49,7 +64,80 @@ void Server::start_request(const Request& request) {
  * @return true if the server is available, false otherwise.
  */
 bool Server::is_available() const {
-    return busy_until_time <= 0;
+    return table->busy_until_time(slot) <= 0;
+}
+
+/**
+ * @brief Applies a hardware profile to the server.
+ *
+ * @param profile Speed, cost and affinity of the server.
+ */
+void Server::set_profile(const ServerProfile& profile) {
+    table->set_profile(slot, profile.speed, profile.cost, profile.affinity, profile.affinity_speedup);
+}
+
+/**
+ * @brief Returns the server's relative processing speed.
+ *
+ * @return Speed factor (1 = nominal).
+ */
+float Server::get_speed() const {
+    return table->speed(slot);
+}
+
+/**
+ * @brief Returns the server's relative cost per cycle.
+ *
+ * @return Cost factor (1 = nominal).
+ */
+float Server::get_cost() const {
+    return table->cost(slot);
+}
+
+/**
+ * @brief Returns how many cycles the server would need for a request.
+ *
+ * @param request The request.
+ * @return Service time after speed, affinity and slowdown adjustments.
+ */
+int Server::expected_service_time(const Request& request) const {
+    return table->service_time(slot, request.get_time_to_process(), request.get_request_type());
+}
+
+/**
+ * @brief Makes the server process every request slower.
+ *
+ * @param factor Multiplier applied to time_to_process (1 = normal speed).
+ */
+void Server::set_slowdown(float factor) {
+    table->set_slowdown(slot, factor);
+}
+
+/**
+ * @brief Returns the server's slowdown factor.
+ *
+ * @return Multiplier applied to time_to_process.
+ */
+float Server::get_slowdown() const {
+    return table->slowdown(slot);
+}
+
+/**
+ * @brief Stalls the active request for extra cycles.
+ *
+ * @param cycles Cycles added to the remaining busy time.
+ */
+void Server::stall(int cycles) {
+    table->stall(slot, cycles);
+}
+
+/**
+ * @brief Checks whether the server crashed and is still restarting.
+ *
+ * @return true while the server is down.
+ */
+bool Server::is_down() const {
+    return (table->state(slot) & ServerTable::FLAG_DOWN) != 0;
 }
 
 /**
@@ -58,7 +146,7 @@ bool Server::is_available() const {
  * @return The server ID.
  */
 int Server::get_server_id() const {
-    return server_id;
+    return table->server_id(slot);
 }
 
 /**
@@ -67,7 +155,7 @@ int Server::get_server_id() const {
  * @return The active request ID.
  */
 int Server::get_active_request_id() const {
-    return active_request_id;
+    return table->active_request_id(slot);
 }
 
 /**
@@ -76,7 +164,7 @@ int Server::get_active_request_id() const {
  * @return The remaining busy time in simulation units.
  */
 int Server::get_busy_until_time() const {
-    return busy_until_time;
+    return table->busy_until_time(slot);
 }
 
 /**
@@ -86,7 +174,23 @@ int Server::get_busy_until_time() const {
  * if the server is currently busy.
  */
 void Server::update_busy_time() {
-    if (busy_until_time > 0) {
-        busy_until_time -= 1;
-    }
-}
\ No newline at end of file
+    table->tick_one(slot);
+}
+
+/**
+ * @brief Returns the table slot this view refers to.
+ *
+ * @return Slot index in the owning ServerTable.
+ */
+size_t Server::get_slot() const {
+    return slot;
+}
+
+/**
+ * @brief Points the view at a different slot.
+ *
+ * @param new_slot New slot index of the server.
+ */
+void Server::set_slot(size_t new_slot) {
+    slot = new_slot;
+}
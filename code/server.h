@@ -3,15 +3,29 @@
  * @brief Declares the Server class representing a processing server instance.
  *
  * This header defines the Server class, which models an individual server
- * capable of processing requests. Each server maintains its own unique ID,
- * tracks the currently active request, and records how long it will remain busy.
+ * capable of processing requests. Each server has its own unique ID, tracks
+ * the currently active request, and records how long it will remain busy.
+ * The state itself lives in a ServerTable; a Server is a thin view of one
+ * table slot kept for callers that work with individual servers.
  */
 
 #ifndef SERVER_H
 #define SERVER_H
 
 #include "request.h"
-#include <string>
+#include "server_table.h"
+#include <cstddef>
+
+/**
+ * @brief Hardware profile of a server: speed, cost and request-type affinity.
+ */
+struct ServerProfile {
+    const char* name = "standard";  ///< Display name of the profile.
+    float speed = 1.0f;             ///< Relative processing speed (1 = nominal).
+    float cost = 1.0f;              ///< Relative cost per cycle (1 = nominal).
+    char affinity = 0;              ///< Request type the server is tuned for (0 = none).
+    float affinity_speedup = 1.0f;  ///< Extra speed factor for requests of the affinity type.
+};
 
 /**
  * @class Server
@@ -19,26 +33,50 @@
  *
  * Each Server instance has a unique identifier and can process one request
  * at a time. The server tracks the ID of the active request and the time
- * until which it remains busy.
+ * until which it remains busy. All reads and writes go to the server's slot
+ * in the owning ServerTable.
  */
 class Server {
 public:
 
     /**
-     * @brief Constructs a Server and assigns it a unique ID.
+     * @brief Constructs a view of the server stored in a table slot.
+     *
+     * @param table Table holding the server's state.
+     * @param slot Slot index of the server in the table.
      */
-    Server();
+    Server(ServerTable* table, size_t slot);
 
     /**
      * @brief Starts processing a request.
      *
      * Marks the server as busy and records the request ID and
-     * processing completion time.
+     * processing completion time. Only the request's current time slice
+     * (all of its work unless it is time-sliced) is scheduled.
      *
      * @param request The Request to begin processing.
      */
     void start_request(const Request& request);
 
+    /**
+     * @brief Starts processing a batch of requests for the same backend as one call.
+     *
+     * The server is busy for the combined work of the batch and reports the
+     * ID of the request the batch was built around as its active request.
+     *
+     * @param leader Request the batch was built around.
+     * @param work Nominal work of the whole batch (setup once plus every member's own work).
+     */
+    void start_batch(const Request& leader, int work);
+
+    /**
+     * @brief Finishes the active request immediately.
+     *
+     * Marks the server as available regardless of its remaining busy time.
+     * Used when request processing happens outside the simulated clock.
+     */
+    void finish_request();
+
     /**
      * @brief Checks whether the server is available.
      *
@@ -76,32 +114,90 @@ public:
      */
     void update_busy_time();
 
-private:
+    /**
+     * @brief Applies a hardware profile to the server.
+     *
+     * @param profile Speed, cost and affinity of the server.
+     */
+    void set_profile(const ServerProfile& profile);
+
+    /**
+     * @brief Returns the server's relative processing speed.
+     *
+     * @return Speed factor (1 = nominal).
+     */
+    float get_speed() const;
+
+    /**
+     * @brief Returns the server's relative cost per cycle.
+     *
+     * @return Cost factor (1 = nominal).
+     */
+    float get_cost() const;
+
+    /**
+     * @brief Returns how many cycles the server would need for a request.
+     *
+     * @param request The request.
+     * @return Service time after speed, affinity and slowdown adjustments.
+     */
+    int expected_service_time(const Request& request) const;
+
+    /**
+     * @brief Makes the server process every request slower.
+     *
+     * @param factor Multiplier applied to time_to_process (1 = normal speed).
+     */
+    void set_slowdown(float factor);
+
+    /**
+     * @brief Returns the server's slowdown factor.
+     *
+     * @return Multiplier applied to time_to_process.
+     */
+    float get_slowdown() const;
+
+    /**
+     * @brief Stalls the active request for extra cycles.
+     *
+     * @param cycles Cycles added to the remaining busy time.
+     */
+    void stall(int cycles);
 
     /**
-     * @brief Static counter used to assign unique server IDs.
+     * @brief Checks whether the server crashed and is still restarting.
+     *
+     * @return true while the server is down.
      */
-    static int next_id;
+    bool is_down() const;
 
     /**
-     * @brief Unique identifier for this server.
+     * @brief Returns the table slot this view refers to.
+     *
+     * @return Slot index in the owning ServerTable.
      */
-    int server_id;
+    size_t get_slot() const;
 
     /**
-     * @brief IP address assigned to the server.
+     * @brief Points the view at a different slot.
+     *
+     * Used by ServerHandler when the table moves a server to fill a hole.
+     *
+     * @param new_slot New slot index of the server.
      */
-    std::string server_ip;
+    void set_slot(size_t new_slot);
+
+private:
 
     /**
-     * @brief ID of the request currently being processed.
+     * @brief Table holding this server's state.
      */
-    int active_request_id;
+    ServerTable* table;
 
     /**
-     * @brief Simulation time until which the server remains busy.
+     * @brief Slot index of this server in the table.
      */
-    int busy_until_time;
+    size_t slot;
 };
 
 #endif
\ No newline at end of file
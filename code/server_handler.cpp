@@ -7,8 +7,12 @@
  */
 
 #include "server_handler.h"
+#include "alloc_counter.h"
 #include "server.h"
+#include "profiler.h"
+#include <algorithm>
 #include <iostream>
+#include <utility>
 
 /**
  * @brief ANSI escape code for orange-colored console output.
@@ -24,75 +28,318 @@
  * @brief Constructs an empty ServerHandler.
  *
  * Initializes the handler with no active servers.
+ *
+ * @param arena Arena owning the requests this handler processes.
  */
-ServerHandler::ServerHandler() {} // start with no servers
+ServerHandler::ServerHandler(RequestArena& arena)
+    : arena(arena), verbose(true), quantum(0), now(0), policy(DispatchPolicy::FIRST_IDLE), cost_rate(0.0),
+      batch_setup(0), prefetched(0) {} // start with no servers
 
 /**
  * @brief Adds a new server to the server pool.
  *
- * A new Server instance is dynamically allocated and stored
- * using std::unique_ptr for automatic memory management.
+ * A new slot is appended to the server table and a matching Server view
+ * is created for it. With fault injection enabled the new server may be a
+ * slow node.
+ *
+ * @param profile Speed, cost and affinity of the new server.
  */
-void ServerHandler::add_server() {
-    servers.emplace_back(new Server());
+void ServerHandler::add_server(const ServerProfile& profile) {
+    MEMORY_SCOPE(MemoryComponent::SERVERS);
+    size_t slot = table.add();
+    servers.emplace_back(new Server(&table, slot));
+    window_count.push_back(0);
+    windows.resize(window_count.size() * network.prefetch);
+    servers.back()->set_profile(profile);
+    if (faults.get_settings().enabled()) {
+        servers.back()->set_slowdown(faults.draw_slowdown());
+    }
+    cost_rate += profile.cost;
+    if (policy == DispatchPolicy::EARLIEST_COMPLETION) {
+        classify(slot);
+    }
 }
 
 /**
  * @brief Removes a server from the server pool.
  *
- * The server is identified by its unique server ID and erased
- * from the internal vector.
+ * If the server runs one copy of a hedged request, the other copy carries
+ * on alone; otherwise any request the server still owns is released.
+ * Requests waiting in its prefetch window are sent again to other servers. The
+ * table fills the freed slot with its last server; the matching view (and
+ * any hedge pairing) is moved along with it so views stay in slot order,
+ * and the removed view is destroyed.
  *
  * @param server Pointer to the Server to remove.
  */
 void ServerHandler::remove_server(Server* server) {
-    int server_id = server->get_server_id();
-    for (auto it = servers.begin(); it != servers.end(); ++it) {
-        if ((*it)->get_server_id() == server_id) {
-            servers.erase(it);
-            break;
+    MEMORY_SCOPE(MemoryComponent::SERVERS);
+    size_t slot = server->get_slot();
+    unpair(slot);
+    if (window_count[slot] > 0) {
+        requeue_window(slot);
+    }
+    if (!batches.empty() && table.holds(slot)) {
+        take_members(table.handle_at(slot).get_index(), members_scratch);
+        for (RequestHandle& member : members_scratch) {
+            arena.release(std::move(member));
+        }
+        members_scratch.clear();
+    }
+    arena.release(table.take_handle(slot));
+    cost_rate -= table.cost(slot);
+    if (policy == DispatchPolicy::EARLIEST_COMPLETION) {
+        classes[slot_class[slot]].free_at.remove(slot);
+    }
+    size_t moved_from = table.remove(slot);
+    if (moved_from != slot) {
+        servers[slot] = std::move(servers[moved_from]);
+        servers[slot]->set_slot(slot);
+        if (policy == DispatchPolicy::EARLIEST_COMPLETION) {
+            IndexedHeap& heap = classes[slot_class[moved_from]].free_at;
+            int64_t free_at = heap.key(moved_from);
+            heap.remove(moved_from);
+            heap.set(slot, free_at);
+            slot_class[slot] = slot_class[moved_from];
+        }
+        for (auto& hedge : hedges) {
+            if (hedge.first == moved_from) {
+                hedge.first = slot;
+            }
+            if (hedge.second == moved_from) {
+                hedge.second = slot;
+            }
         }
+        size_t size = static_cast<size_t>(network.prefetch);
+        for (size_t i = 0; i < window_count[moved_from]; ++i) {
+            windows[slot * size + i] = std::move(windows[moved_from * size + i]);
+        }
+        window_count[slot] = window_count[moved_from];
+    }
+    servers.pop_back();
+    window_count.pop_back();
+    windows.resize(window_count.size() * network.prefetch);
+    if (policy == DispatchPolicy::EARLIEST_COMPLETION) {
+        slot_class.pop_back();
     }
 }
 
 /**
  * @brief Retrieves an available server.
  *
- * Searches through the server pool and returns the first server
- * that is not currently processing a request.
+ * Scans the table's busy-time column with the vectorized idle kernel and
+ * returns the view of the first server that is not processing a request.
  *
  * @return Pointer to an available Server, or nullptr if none are available.
  */
 Server* ServerHandler::get_available_server() {
-    for (auto& server : servers) {
-        if (server->is_available()) {
-            return server.get();
+    long slot = table.find_idle();
+    return slot < 0 ? nullptr : servers[slot].get();
+}
+
+/**
+ * @brief Returns the server stored in a table slot.
+ *
+ * @param slot Slot index, in [0, get_server_count()).
+ * @return Pointer to the Server view of that slot.
+ */
+Server* ServerHandler::server_at(size_t slot) {
+    return servers[slot].get();
+}
+
+/**
+ * @brief Assigns a request to an available server.
+ *
+ * If a server is available, the request is started on that server and the
+ * server takes ownership of the handle until the request finishes. Under
+ * earliest-completion dispatch the request is only started if the server
+ * expected to finish it first is idle; otherwise that server is reserved
+ * until the request would finish there.
+ *
+ * With a prefetch window and no idle server, the request is sent ahead to
+ * the busy server with room in its window that is expected to be free
+ * first; it starts there after the requests ahead of it.
+ *
+ * @param request Handle of the request to assign.
+ * @return Pointer to the Server handling the request, or nullptr if the
+ *         request should wait (the caller keeps the handle).
+ */
+Server* ServerHandler::assign_request(RequestHandle&& request) {
+    Server* server = nullptr;
+    if (policy == DispatchPolicy::EARLIEST_COMPLETION) {
+        int64_t completion = 0;
+        long slot = select_earliest_completion(arena.get(request), completion);
+        if (slot < 0) {
+            return nullptr;
+        }
+        if (table.busy_until_time(static_cast<size_t>(slot)) > 0 || classes[slot_class[slot]].free_at.key(slot) > now) {
+            // the request waits for this server: book it until the request would finish there
+            MEMORY_SCOPE(MemoryComponent::SERVERS);
+            classes[slot_class[slot]].free_at.set(static_cast<size_t>(slot), completion);
+            reserved.push_back(static_cast<size_t>(slot));
+            return nullptr;
+        }
+        server = servers[slot].get();
+    } else {
+        server = get_available_server();
+        if (!server && network.prefetch > 0) {
+            long slot = pick_window();
+            if (slot < 0) {
+                return nullptr;
+            }
+            Prefetch& entry = windows[static_cast<size_t>(slot) * network.prefetch + window_count[slot]++];
+            entry.handle = std::move(request);
+            entry.ready_at = now + (network.rtt + 1) / 2;
+            prefetched++;
+            network_stats.prefetched++;
+            return servers[slot].get();
         }
     }
-    return nullptr;
+    if (server) {
+        plan_slice(server->get_slot(), arena.get(request));
+        start_in_slot(server->get_slot(), arena.get(request), 0, network.rtt);
+        table.hold(server->get_slot(), std::move(request));
+        network_stats.handoffs++;
+    }
+    return server;
 }
 
 /**
- * @brief Assigns a request to an available server.
+ * @brief Runs several requests for the same backend as one call on an idle server.
  *
- * If a server is available, the request is started on that server.
+ * The batch's nominal work is the setup once plus, for every member, its
+ * time_to_process less the setup (at least one cycle), so a batch of one
+ * costs exactly what the request costs alone.
  *
- * @param request The Request to assign.
- * @return Pointer to the Server handling the request, or nullptr if none are available.
+ * @param leader Handle of the request the batch was built around.
+ * @param members Handles of the other members; emptied when the batch starts.
+ * @return Pointer to the Server running the batch, or nullptr if every server is busy.
  */
-Server* ServerHandler::assign_request(const Request& request) {
+Server* ServerHandler::assign_batch(RequestHandle&& leader, std::vector<RequestHandle>& members) {
+    MEMORY_SCOPE(MemoryComponent::SERVERS);
     Server* server = get_available_server();
-    if (server) {
-        server->start_request(request);
+    if (!server) {
+        return nullptr;
     }
+    const Request& request = arena.get(leader);
+    int work = request.get_time_to_process();
+    for (const RequestHandle& member : members) {
+        int own = arena.get(member).get_time_to_process();
+        int item = std::max(own - batch_setup, 1);
+        work += item;
+        batch_stats.setup_cycles_saved += own - item;
+    }
+    batch_stats.batches++;
+    batch_stats.batched_requests += static_cast<long long>(members.size()) + 1;
+    start_in_slot(server->get_slot(), request, 0, network.rtt, work);
+    network_stats.handoffs++;
+    std::vector<RequestHandle>& batch = batches[leader.get_index()];
+    batch.swap(members);
+    members.clear();
+    table.hold(server->get_slot(), std::move(leader));
     return server;
 }
 
+/**
+ * @brief Drops the reservations made by assign_request() in this dispatch pass.
+ *
+ * Reserved servers get their real free time back; the waiting requests are
+ * placed again in the next pass.
+ */
+void ServerHandler::end_dispatch() {
+    for (size_t slot : reserved) {
+        if (slot < table.size()) {
+            refresh(slot);
+        }
+    }
+    reserved.clear();
+}
+
+/**
+ * @brief Checks whether assign_request() can place a request right now.
+ *
+ * @return true if a server is idle or a busy server's prefetch window has room.
+ */
+bool ServerHandler::can_accept() const {
+    if (table.find_idle() >= 0) {
+        return true;
+    }
+    return network.prefetch > 0 && policy == DispatchPolicy::FIRST_IDLE && pick_window() >= 0;
+}
+
+/**
+ * @brief Starts a request in a slot after delay cycles in transit, applying stalls and recording its start.
+ *
+ * The server is busy from now on but only starts working once the request
+ * has arrived; the delay is counted as a network gap.
+ *
+ * @param slot Slot index of an idle server.
+ * @param request Request to start (the leader of a batch).
+ * @param attempt Failed attempts of the request so far.
+ * @param delay Cycles until the request reaches the server (0 = already local).
+ * @param batch_work Nominal work of the batch the request leads (0 = the request's own slice).
+ */
+void ServerHandler::start_in_slot(size_t slot, const Request& request, int attempt, int delay, int batch_work) {
+    if (batch_work > 0) {
+        servers[slot]->start_batch(request, batch_work);
+    } else {
+        servers[slot]->start_request(request);
+    }
+    if (delay > 0) {
+        servers[slot]->stall(delay);
+        network_stats.gap_cycles += delay;
+    }
+    if (faults.get_settings().stall_probability > 0.0) {
+        int stall = faults.draw_stall();
+        if (stall > 0) {
+            servers[slot]->stall(stall);
+        }
+    }
+    table.set_started(slot, now, attempt);
+    refresh(slot);
+}
+
+/**
+ * @brief Limits the request's next slice to the work a slot finishes within one quantum.
+ *
+ * Work is measured in nominal cycles; on a slower or faster server the
+ * slice covers proportionally less or more of it, and always at least one
+ * unit so every slice makes progress. Hedged duplicates reuse the slice of
+ * the copy they shadow and do not call this.
+ *
+ * @param slot Slot index of the server that will run the slice.
+ * @param request Request to slice.
+ */
+void ServerHandler::plan_slice(size_t slot, Request& request) const {
+    int work = request.get_remaining_work();
+    if (quantum > 0) {
+        int cycles = table.service_time(slot, work, request.get_request_type());
+        if (cycles > quantum) {
+            work = static_cast<int>(static_cast<long long>(work) * quantum / cycles);
+            work = work > 0 ? work : 1;
+        }
+    }
+    request.begin_slice(work);
+}
+
+/**
+ * @brief Finishes a server's request immediately and releases it.
+ *
+ * @param server Server whose request is finished.
+ */
+void ServerHandler::finish_request(Server* server) {
+    server->finish_request();
+    arena.release(table.take_handle(server->get_slot()));
+    refresh(server->get_slot());
+}
+
 /**
  * @brief Scales the system up by adding a new server.
+ *
+ * @param profile Speed, cost and affinity of the new server.
  */
-void ServerHandler::scale_up() {
-    add_server();
+void ServerHandler::scale_up(const ServerProfile& profile) {
+    add_server(profile);
 }
 
 /**
@@ -113,24 +360,714 @@ int ServerHandler::get_server_count() const {
     return servers.size();
 }
 
+/**
+ * @brief Returns the number of servers not processing a request.
+ *
+ * @return The current idle server count.
+ */
+int ServerHandler::get_idle_server_count() const {
+    return table.count_idle();
+}
+
 /**
  * @brief Updates all busy servers.
  *
- * Iterates through the server pool and updates the busy time
- * for servers that are currently processing a request.
- * Console output is displayed to indicate server activity.
+ * Console output is displayed for every server that is currently processing
+ * a request, then the whole table is advanced one clock cycle with a single
+ * vectorized pass over the busy-time column. Crashes are injected, hedged
+ * requests with a finished copy are resolved, and requests that finished
+ * are recorded and released back to the arena. Finally idle servers pick
+ * up crash retries and duplicates of requests past the hedge threshold.
  */
 void ServerHandler::update_servers() {
+    PROFILE_SCOPE(ProfilePhase::UPDATE_SERVERS);
+    MEMORY_SCOPE(MemoryComponent::SERVERS);
+    if (verbose) {
+        for (size_t slot = 0; slot < table.size(); ++slot) {
+            if (table.busy_until_time(slot) > 0) {
+                std::cout << ORANGE
+                          << "Server " << table.server_id(slot)
+                          << " is busy with request " << table.active_request_id(slot)
+                          << " until time " << table.busy_until_time(slot)
+                          << "."
+                          << RESET << std::endl;
+            }
+        }
+    }
+    network_stats.busy_cycles += static_cast<long long>(table.size() - table.count_idle());
+    now++;
+    table.tick();
+    if (faults.get_settings().crash_probability > 0.0) {
+        inject_crashes();
+    }
+    if (!hedges.empty()) {
+        resolve_hedges();
+    }
+    table.collect_finished(finished);
+    completed.clear();
+    for (RequestHandle& handle : preempted) {
+        arena.release(std::move(handle));
+    }
+    preempted.clear();
+    for (RequestHandle& handle : finished) {
+        if (arena.get(handle).end_slice()) {
+            preempted.push_back(std::move(handle));
+            continue;
+        }
+        completed.push_back(handle.get_index());
+        if (!batches.empty()) {
+            take_members(handle.get_index(), members_scratch);
+            for (RequestHandle& member : members_scratch) {
+                completed.push_back(member.get_index());
+                arena.release(std::move(member));
+            }
+            members_scratch.clear();
+        }
+        arena.release(std::move(handle));
+    }
+    finished.clear();
+    if (prefetched > 0) {
+        start_prefetched();
+    }
+    if (!retry_queue.empty()) {
+        dispatch_retries();
+    }
+    if (hedging.hedge_after > 0) {
+        issue_hedges();
+    }
+}
+
+/**
+ * @brief Draws crashes for busy servers and returns restarted servers to service.
+ *
+ * A crashed server loses its request and stays down for restart_cycles. If
+ * the request was hedged, the other copy keeps running; otherwise it is
+ * queued for a retry, or dropped once max_retries is exhausted.
+ */
+void ServerHandler::inject_crashes() {
+    for (size_t slot = 0; slot < table.size(); ++slot) {
+        uint8_t state = table.state(slot);
+        if (state & ServerTable::FLAG_DOWN) {
+            if (!(state & ServerTable::FLAG_BUSY)) {
+                table.set_flag(slot, ServerTable::FLAG_DOWN, false);
+            }
+            continue;
+        }
+        bool running = (state & ServerTable::FLAG_BUSY) && (table.holds(slot) || (state & ServerTable::FLAG_HEDGED));
+        if (!running || !faults.draw_crash()) {
+            continue;
+        }
+        stats.crashes++;
+        if (window_count[slot] > 0) {
+            requeue_window(slot);
+        }
+        if (state & ServerTable::FLAG_HEDGED) {
+            stats.duplicate_cycles += now - table.started_at(slot);
+            unpair(slot);
+        } else {
+            RequestHandle handle = table.take_handle(slot);
+            int attempt = table.attempt(slot) + 1;
+            // a crashed batch is retried request by request
+            if (!batches.empty()) {
+                take_members(handle.get_index(), members_scratch);
+            }
+            members_scratch.push_back(std::move(handle));
+            for (RequestHandle& lost : members_scratch) {
+                if (attempt <= hedging.max_retries) {
+                    stats.retries++;
+                    retry_queue.push_back({std::move(lost), attempt});
+                } else {
+                    stats.failed++;
+                    arena.release(std::move(lost));
+                }
+            }
+            members_scratch.clear();
+        }
+        table.crash(slot, faults.get_settings().restart_cycles);
+        refresh(slot);
+    }
+}
+
+/**
+ * @brief Cancels the losing copy of every hedged request that has a winner.
+ *
+ * If the original copy finished it is collected as usual; if the duplicate
+ * finished first the handle moves to it so it is collected instead. The
+ * loser's server is freed and the cycles it spent are counted as duplicate
+ * load.
+ */
+void ServerHandler::resolve_hedges() {
+    for (size_t i = 0; i < hedges.size();) {
+        size_t primary = hedges[i].first;
+        size_t duplicate = hedges[i].second;
+        bool primary_done = table.busy_until_time(primary) <= 0;
+        bool duplicate_done = table.busy_until_time(duplicate) <= 0;
+        if (!primary_done && !duplicate_done) {
+            ++i;
+            continue;
+        }
+        size_t loser = primary_done ? duplicate : primary;
+        if (!primary_done) {
+            stats.hedge_wins++;
+            table.hold(duplicate, table.take_handle(primary));
+        }
+        stats.duplicate_cycles += now - table.started_at(loser);
+        table.finish(loser);
+        refresh(loser);
+        table.set_flag(primary_done ? primary : duplicate, ServerTable::FLAG_HEDGED, false);
+        hedges[i] = hedges.back();
+        hedges.pop_back();
+    }
+}
+
+/**
+ * @brief Starts queued retries on idle servers, oldest first.
+ */
+void ServerHandler::dispatch_retries() {
+    size_t started = 0;
+    for (; started < retry_queue.size(); ++started) {
+        long slot = table.find_idle();
+        if (slot < 0) {
+            break;
+        }
+        Retry& retry = retry_queue[started];
+        plan_slice(slot, arena.get(retry.handle));
+        start_in_slot(slot, arena.get(retry.handle), retry.attempt, network.rtt);
+        table.hold(slot, std::move(retry.handle));
+    }
+    retry_queue.erase(retry_queue.begin(), retry_queue.begin() + started);
+}
+
+/**
+ * @brief Starts duplicates of requests that have run past the hedge threshold.
+ *
+ * Each request is hedged at most once, and only while idle servers remain.
+ */
+void ServerHandler::issue_hedges() {
+    for (size_t slot = 0; slot < table.size(); ++slot) {
+        if (!table.holds(slot) || (table.state(slot) & ServerTable::FLAG_HEDGED) ||
+            table.busy_until_time(slot) <= 0 || now - table.started_at(slot) < hedging.hedge_after ||
+            (!batches.empty() && batches.count(table.handle_at(slot).get_index()) > 0)) {
+            continue;
+        }
+        long idle = table.find_idle();
+        if (idle < 0) {
+            return;
+        }
+        start_in_slot(idle, arena.get(table.handle_at(slot)), table.attempt(slot), network.rtt);
+        table.set_flag(slot, ServerTable::FLAG_HEDGED, true);
+        table.set_flag(idle, ServerTable::FLAG_HEDGED, true);
+        hedges.emplace_back(slot, idle);
+        stats.hedges_issued++;
+    }
+}
+
+/**
+ * @brief Finds the busy server with room in its window that is expected to be free first.
+ *
+ * Servers with fewer prefetched requests come first, then those whose
+ * current request ends sooner. Restarting servers take no requests.
+ *
+ * @return Slot index, or -1 if every window is full.
+ */
+long ServerHandler::pick_window() const {
+    long best = -1;
+    for (size_t slot = 0; slot < table.size(); ++slot) {
+        if (window_count[slot] >= network.prefetch || (table.state(slot) & ServerTable::FLAG_DOWN)) {
+            continue;
+        }
+        if (best < 0 || window_count[slot] < window_count[best] ||
+            (window_count[slot] == window_count[best] && table.busy_until_time(slot) < table.busy_until_time(best))) {
+            best = static_cast<long>(slot);
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Starts the oldest prefetched request on every free server whose window holds one.
+ *
+ * A request that is still in transit keeps the server waiting for the rest
+ * of the trip; one that arrived earlier has waited in the window behind the
+ * previous request.
+ */
+void ServerHandler::start_prefetched() {
+    size_t size = static_cast<size_t>(network.prefetch);
+    for (size_t slot = 0; slot < table.size() && prefetched > 0; ++slot) {
+        if (window_count[slot] == 0 || table.busy_until_time(slot) > 0) {
+            continue;
+        }
+        Prefetch* window = &windows[slot * size];
+        RequestHandle handle = std::move(window[0].handle);
+        int transit = window[0].ready_at - now;
+        for (size_t i = 1; i < window_count[slot]; ++i) {
+            window[i - 1] = std::move(window[i]);
+        }
+        window_count[slot]--;
+        prefetched--;
+        if (transit <= 0) {
+            network_stats.prefetch_hits++;
+            network_stats.window_wait_cycles -= transit;
+        }
+        plan_slice(slot, arena.get(handle));
+        start_in_slot(slot, arena.get(handle), 0, transit > 0 ? transit : 0);
+        table.hold(slot, std::move(handle));
+    }
+}
+
+/**
+ * @brief Sends a slot's prefetched requests to other servers through the retry queue.
+ *
+ * They never started, so they keep their attempt count.
+ *
+ * @param slot Slot index whose window is emptied.
+ */
+void ServerHandler::requeue_window(size_t slot) {
+    Prefetch* window = &windows[slot * static_cast<size_t>(network.prefetch)];
+    for (size_t i = 0; i < window_count[slot]; ++i) {
+        retry_queue.push_back({std::move(window[i].handle), 0});
+    }
+    prefetched -= window_count[slot];
+    window_count[slot] = 0;
+}
+
+/**
+ * @brief Drops the hedge pairing of a slot, keeping the other copy running.
+ *
+ * @param slot Slot index of one copy.
+ */
+void ServerHandler::unpair(size_t slot) {
+    long index = find_hedge(slot);
+    if (index < 0) {
+        return;
+    }
+    size_t primary = hedges[index].first;
+    size_t duplicate = hedges[index].second;
+    size_t other = (slot == primary) ? duplicate : primary;
+    if (slot == primary) {
+        table.hold(duplicate, table.take_handle(primary));
+    }
+    table.set_flag(slot, ServerTable::FLAG_HEDGED, false);
+    table.set_flag(other, ServerTable::FLAG_HEDGED, false);
+    hedges[index] = hedges.back();
+    hedges.pop_back();
+}
+
+/**
+ * @brief Moves the members of the batch led by a request out of batches.
+ *
+ * @param leader Arena slot index of the leader.
+ * @param members Receives the member handles (appended); nothing if the request leads no batch.
+ */
+void ServerHandler::take_members(uint32_t leader, std::vector<RequestHandle>& members) {
+    auto batch = batches.find(leader);
+    if (batch == batches.end()) {
+        return;
+    }
+    for (RequestHandle& member : batch->second) {
+        members.push_back(std::move(member));
+    }
+    batches.erase(batch);
+}
+
+/**
+ * @brief Finds the hedge pair containing a slot.
+ *
+ * @param slot Slot index.
+ * @return Index into hedges, or -1 if the slot is not hedged.
+ */
+long ServerHandler::find_hedge(size_t slot) const {
+    for (size_t i = 0; i < hedges.size(); ++i) {
+        if (hedges[i].first == slot || hedges[i].second == slot) {
+            return static_cast<long>(i);
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Enables or disables per-server console output.
+ *
+ * @param enabled Whether update_servers() prints busy servers.
+ */
+void ServerHandler::set_verbose(bool enabled) {
+    verbose = enabled;
+}
+
+/**
+ * @brief Enables fault injection for this pool.
+ *
+ * @param settings Fault rates.
+ * @param seed Seed of the injector's random number generator.
+ */
+void ServerHandler::set_fault_injection(const FaultSettings& settings, uint32_t seed) {
+    MEMORY_SCOPE(MemoryComponent::SERVERS);
+    faults.configure(settings, seed);
     for (auto& server : servers) {
-        if (server->is_available() == false) {
-            std::cout << ORANGE
-                      << "Server " << server->get_server_id()
-                      << " is busy with request " << server->get_active_request_id()
-                      << " until time " << server->get_busy_until_time()
-                      << "."
-                      << RESET << std::endl;
+        server->set_slowdown(faults.draw_slowdown());
+    }
+    if (policy == DispatchPolicy::EARLIEST_COMPLETION) {
+        rebuild_classes();
+    }
+}
+
+/**
+ * @brief Sets the hedging and retry policy.
+ *
+ * @param settings Hedge threshold and retry bound.
+ */
+void ServerHandler::set_hedging(const HedgeSettings& settings) {
+    hedging = settings;
+}
+
+/**
+ * @brief Sets the round trip to the servers and the prefetch window.
+ *
+ * @param settings Round trip and window size.
+ */
+void ServerHandler::set_network(const NetworkSettings& settings) {
+    MEMORY_SCOPE(MemoryComponent::SERVERS);
+    network = settings;
+    window_count.assign(table.size(), 0);
+    windows.clear();
+    windows.resize(table.size() * network.prefetch);
+    prefetched = 0;
+}
+
+/**
+ * @brief Returns the handoff counters.
+ *
+ * @return Counters accumulated since construction.
+ */
+const NetworkStats& ServerHandler::get_network_stats() const {
+    return network_stats;
+}
+
+/**
+ * @brief Returns the requests waiting in the servers' prefetch windows.
+ *
+ * @return Requests sent ahead and not started yet.
+ */
+int ServerHandler::get_prefetched_count() const {
+    return prefetched;
+}
+
+/**
+ * @brief Returns the requests that finished during the last update_servers().
+ *
+ * @return Arena slot indices of the finished requests.
+ */
+const std::vector<uint32_t>& ServerHandler::get_completed() const {
+    return completed;
+}
+
+/**
+ * @brief Returns the fault, hedge and retry counters.
+ *
+ * @return Counters accumulated since construction.
+ */
+const ResilienceStats& ServerHandler::get_resilience_stats() const {
+    return stats;
+}
+
+/**
+ * @brief Returns the batched call counters.
+ *
+ * @return Counters accumulated since construction.
+ */
+const BatchStats& ServerHandler::get_batch_stats() const {
+    return batch_stats;
+}
+
+/**
+ * @brief Sets the per-call setup work that a batch pays only once.
+ *
+ * @param setup Nominal setup cycles included in every request's time_to_process.
+ */
+void ServerHandler::set_batch_setup(int setup) {
+    batch_setup = setup;
+}
+
+/**
+ * @brief Runs requests in time slices of at most quantum cycles.
+ *
+ * @param quantum Slice length in cycles (0 = run requests to completion).
+ */
+void ServerHandler::set_time_slice(int quantum) {
+    this->quantum = quantum;
+}
+
+/**
+ * @brief Returns the requests whose time slice ended during the last update_servers().
+ *
+ * @return Handles of the preempted requests.
+ */
+std::vector<RequestHandle>& ServerHandler::get_preempted() {
+    return preempted;
+}
 
-            server->update_busy_time();
+/**
+ * @brief Returns the combined cost per cycle of all servers.
+ *
+ * @return Sum of the servers' cost factors.
+ */
+double ServerHandler::get_cost_rate() const {
+    return cost_rate;
+}
+
+/**
+ * @brief Selects how assign_request() picks a server.
+ *
+ * Switching to earliest-completion dispatch sorts the current servers into
+ * speed classes.
+ *
+ * @param policy Dispatch policy.
+ */
+void ServerHandler::set_dispatch_policy(DispatchPolicy policy) {
+    this->policy = policy;
+    if (policy == DispatchPolicy::EARLIEST_COMPLETION) {
+        rebuild_classes();
+    } else {
+        classes.clear();
+        slot_class.clear();
+    }
+}
+
+/**
+ * @brief Sets the request type the pool is built for.
+ *
+ * @param request_type Home request type.
+ * @param foreign_penalty Service time multiplier for other types.
+ */
+void ServerHandler::set_home_type(char request_type, float foreign_penalty) {
+    table.set_home_type(request_type, foreign_penalty);
+}
+
+/**
+ * @brief Finds the slot expected to complete a request first.
+ *
+ * Servers in a speed class need the same time for any request, so only the
+ * earliest-free server of each class is a candidate: its expected
+ * completion is max(free time, now) plus its service time. With k classes
+ * the choice costs O(k) and each heap update O(log n). Ties go to the
+ * cheaper server.
+ *
+ * @param request Request to place.
+ * @param completion Receives the expected completion cycle on that server.
+ * @return Slot of the best server, or -1 if there are no servers.
+ */
+long ServerHandler::select_earliest_completion(const Request& request, int64_t& completion) const {
+    long best = -1;
+    for (const SpeedClass& speed_class : classes) {
+        if (speed_class.free_at.empty()) {
+            continue;
+        }
+        size_t slot = speed_class.free_at.top();
+        int64_t start = speed_class.free_at.top_key() > now ? speed_class.free_at.top_key() : now;
+        int64_t finish = start + table.service_time(slot, request.get_remaining_work(), request.get_request_type());
+        if (best < 0 || finish < completion ||
+            (finish == completion && table.cost(slot) < table.cost(static_cast<size_t>(best)))) {
+            best = static_cast<long>(slot);
+            completion = finish;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Puts a slot into its speed class, creating the class if needed.
+ *
+ * @param slot Slot index of the server.
+ */
+void ServerHandler::classify(size_t slot) {
+    MEMORY_SCOPE(MemoryComponent::SERVERS);
+    float factor = table.slowdown(slot) / table.speed(slot);
+    char affinity = table.affinity(slot);
+    float speedup = table.affinity_speedup(slot);
+    size_t index = 0;
+    while (index < classes.size() &&
+           !(classes[index].factor == factor && classes[index].affinity == affinity &&
+             classes[index].affinity_speedup == speedup)) {
+        index++;
+    }
+    if (index == classes.size()) {
+        classes.push_back({factor, affinity, speedup, IndexedHeap()});
+    }
+    if (slot_class.size() <= slot) {
+        slot_class.resize(slot + 1);
+    }
+    slot_class[slot] = index;
+    classes[index].free_at.set(slot, now + table.busy_until_time(slot));
+}
+
+/**
+ * @brief Updates a slot's free time in its speed class heap.
+ *
+ * @param slot Slot index of the server.
+ */
+void ServerHandler::refresh(size_t slot) {
+    if (policy == DispatchPolicy::EARLIEST_COMPLETION) {
+        classes[slot_class[slot]].free_at.set(slot, now + table.busy_until_time(slot));
+    }
+}
+
+/**
+ * @brief Rebuilds every speed class from the table.
+ */
+void ServerHandler::rebuild_classes() {
+    MEMORY_SCOPE(MemoryComponent::SERVERS);
+    classes.clear();
+    slot_class.assign(table.size(), 0);
+    for (size_t slot = 0; slot < table.size(); ++slot) {
+        classify(slot);
+    }
+}
+
+/**
+ * @brief Writes the servers, running batches, pending retries, hedge pairs and counters to a checkpoint.
+ *
+ * @param out Checkpoint being written.
+ */
+void ServerHandler::save(CheckpointWriter& out) const {
+    table.save(out);
+    faults.save(out);
+    out.write(stats);
+    out.write(now);
+    out.write(cost_rate);
+    std::vector<uint32_t> retry_handles;
+    std::vector<int> retry_attempts;
+    for (const Retry& retry : retry_queue) {
+        retry_handles.push_back(retry.handle.get_index());
+        retry_attempts.push_back(retry.attempt);
+    }
+    out.write_vector(retry_handles);
+    out.write_vector(retry_attempts);
+    // std::pair is not trivially copyable, so each pair is stored as two slots
+    std::vector<uint64_t> hedge_slots;
+    for (const auto& hedge : hedges) {
+        hedge_slots.push_back(hedge.first);
+        hedge_slots.push_back(hedge.second);
+    }
+    out.write_vector(hedge_slots);
+    // each batch as its leader, its member count and then its members
+    std::vector<uint32_t> batch_handles;
+    for (const auto& batch : batches) {
+        batch_handles.push_back(batch.first);
+        batch_handles.push_back(static_cast<uint32_t>(batch.second.size()));
+        for (const RequestHandle& member : batch.second) {
+            batch_handles.push_back(member.get_index());
+        }
+    }
+    out.write_vector(batch_handles);
+    out.write(batch_stats);
+    // each slot's window as its request count, then the requests and their arrival cycles
+    std::vector<uint32_t> window_handles;
+    std::vector<int> window_ready;
+    for (size_t slot = 0; slot < window_count.size(); ++slot) {
+        for (size_t i = 0; i < window_count[slot]; ++i) {
+            const Prefetch& entry = windows[slot * network.prefetch + i];
+            window_handles.push_back(entry.handle.get_index());
+            window_ready.push_back(entry.ready_at);
+        }
+    }
+    out.write_vector(window_count);
+    out.write_vector(window_handles);
+    out.write_vector(window_ready);
+    out.write(network_stats);
+}
+
+/**
+ * @brief Replaces the pool's servers and state with checkpointed ones.
+ *
+ * The prefetch window size is configuration (set_network()); a checkpoint
+ * holding more requests in a window than it allows is rejected.
+ *
+ * @param in Checkpoint being read.
+ * @param restore_ids false to keep the process-wide server ID counter.
+ * @return false if the section is malformed.
+ */
+bool ServerHandler::restore(CheckpointReader& in, bool restore_ids) {
+    MEMORY_SCOPE(MemoryComponent::SERVERS);
+    if (!table.restore(in, arena, restore_ids)) {
+        return false;
+    }
+    faults.restore(in);
+    in.read(stats);
+    in.read(now);
+    in.read(cost_rate);
+    std::vector<uint32_t> retry_handles;
+    std::vector<int> retry_attempts;
+    std::vector<uint64_t> hedge_slots;
+    in.read_vector(retry_handles);
+    in.read_vector(retry_attempts);
+    in.read_vector(hedge_slots);
+    std::vector<uint32_t> batch_handles;
+    in.read_vector(batch_handles);
+    in.read(batch_stats);
+    std::vector<uint8_t> counts;
+    std::vector<uint32_t> window_handles;
+    std::vector<int> window_ready;
+    in.read_vector(counts);
+    in.read_vector(window_handles);
+    in.read_vector(window_ready);
+    in.read(network_stats);
+    size_t window_total = 0;
+    for (uint8_t count : counts) {
+        window_total += count;
+        if (count > network.prefetch) {
+            in.fail();
+        }
+    }
+    if (retry_handles.size() != retry_attempts.size() || hedge_slots.size() % 2 != 0 || counts.size() != table.size() ||
+        window_handles.size() != window_total || window_ready.size() != window_total) {
+        in.fail();
+    }
+    for (size_t i = 0; i < batch_handles.size(); i += 2 + batch_handles[i + 1]) {
+        if (i + 1 >= batch_handles.size() || batch_handles[i + 1] > batch_handles.size() - i - 2) {
+            in.fail();
+            break;
+        }
+    }
+    hedges.clear();
+    for (size_t i = 0; i + 1 < hedge_slots.size(); i += 2) {
+        if (hedge_slots[i] >= table.size() || hedge_slots[i + 1] >= table.size()) {
+            in.fail();
         }
+        hedges.emplace_back(static_cast<size_t>(hedge_slots[i]), static_cast<size_t>(hedge_slots[i + 1]));
     }
-}
\ No newline at end of file
+    if (!in.ok()) {
+        return false;
+    }
+    retry_queue.clear();
+    for (size_t i = 0; i < retry_handles.size(); ++i) {
+        retry_queue.push_back({arena.adopt(retry_handles[i]), retry_attempts[i]});
+    }
+    batches.clear();
+    for (size_t i = 0; i + 1 < batch_handles.size(); i += 2 + batch_handles[i + 1]) {
+        std::vector<RequestHandle>& members = batches[batch_handles[i]];
+        for (uint32_t k = 0; k < batch_handles[i + 1]; ++k) {
+            members.push_back(arena.adopt(batch_handles[i + 2 + k]));
+        }
+    }
+    servers.clear();
+    for (size_t slot = 0; slot < table.size(); ++slot) {
+        servers.emplace_back(new Server(&table, slot));
+    }
+    window_count = counts;
+    windows.clear();
+    windows.resize(table.size() * network.prefetch);
+    size_t next = 0;
+    for (size_t slot = 0; slot < window_count.size(); ++slot) {
+        for (size_t i = 0; i < window_count[slot]; ++i, ++next) {
+            windows[slot * network.prefetch + i] = {arena.adopt(window_handles[next]), window_ready[next]};
+        }
+    }
+    prefetched = static_cast<int>(window_total);
+    reserved.clear();
+    preempted.clear();
+    completed.clear();
+    if (policy == DispatchPolicy::EARLIEST_COMPLETION) {
+        rebuild_classes();
+    }
+    return true;
+}
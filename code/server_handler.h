@@ -11,34 +11,135 @@
 #define SERVER_HANDLER_H
 
 #include "server.h"
+#include "server_table.h"
 #include "firewall.h"
 #include "load_balancer.h"
+#include "request_arena.h"
+#include "fault_injector.h"
+#include "indexed_heap.h"
+#include <cstdint>
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * @brief How ServerHandler::assign_request() picks a server.
+ */
+enum class DispatchPolicy {
+    FIRST_IDLE,           ///< The first idle server in slot order.
+    EARLIEST_COMPLETION   ///< The server expected to finish the request first (may mean waiting).
+};
+
+/**
+ * @brief Hedging and retry policy of a server pool.
+ */
+struct HedgeSettings {
+    int hedge_after = 0;   ///< Cycles a request may run before a duplicate is issued (0 = never).
+    int max_retries = 0;   ///< Times a request lost in a server crash is started again.
+};
+
+/**
+ * @brief Counters describing faults, hedges and retries in a server pool.
+ */
+struct ResilienceStats {
+    long long crashes = 0;           ///< Busy servers that crashed.
+    long long retries = 0;           ///< Requests restarted after a crash.
+    long long failed = 0;            ///< Requests dropped after exhausting their retries.
+    long long hedges_issued = 0;     ///< Duplicate copies started.
+    long long hedge_wins = 0;        ///< Hedged requests where the duplicate finished first.
+    long long duplicate_cycles = 0;  ///< Server cycles spent on copies that lost or crashed.
+};
+
+/**
+ * @brief Counters describing coalesced backend calls in a server pool.
+ */
+struct BatchStats {
+    long long batches = 0;             ///< Calls that carried more than one request.
+    long long batched_requests = 0;    ///< Requests carried by those calls.
+    long long setup_cycles_saved = 0;  ///< Nominal setup work not repeated thanks to batching.
+};
+
+/**
+ * @brief Network between the balancer and the servers of a pool.
+ */
+struct NetworkSettings {
+    int rtt = 0;       ///< Round trip between the balancer and a server, in cycles (0 = instant handoff).
+    int prefetch = 0;  ///< Requests a busy server may hold locally, ahead of the one it runs.
+};
+
+/**
+ * @brief Counters describing request handoffs over the network.
+ */
+struct NetworkStats {
+    long long handoffs = 0;            ///< Requests sent to a server with nothing local to run.
+    long long prefetched = 0;          ///< Requests sent ahead into a busy server's window.
+    long long prefetch_hits = 0;       ///< Prefetched requests already local when their server became free.
+    long long gap_cycles = 0;          ///< Server cycles spent waiting for a request to arrive.
+    long long window_wait_cycles = 0;  ///< Cycles prefetched requests spent in a window before starting.
+    long long busy_cycles = 0;         ///< Server cycles spent busy, gaps included.
+};
 
 /**
  * @class ServerHandler
  * @brief Manages a pool of servers and distributes requests among them.
  *
- * The ServerHandler maintains ownership of multiple Server objects using
- * std::unique_ptr to ensure proper memory management. It supports adding
+ * Server state is stored in a ServerTable (structure of arrays) so that
+ * per-tick updates and idle scans run over contiguous memory. For callers
+ * that work with individual servers the handler also owns one Server view
+ * per table slot, kept in the same order as the table. It supports adding
  * and removing servers, assigning requests, and scaling server capacity
  * based on system load.
+ *
+ * A server owns the handle of the request it is processing and the handler
+ * returns it to the RequestArena when the request finishes.
+ *
+ * Optionally the handler injects faults (see FaultInjector), hedges slow
+ * requests by starting a duplicate on an idle server once they have run for
+ * hedge_after cycles (the first copy to finish wins and the other is
+ * cancelled) and restarts requests lost in a crash up to max_retries times.
+ *
+ * Requests for the same backend can also be run as one batched call (see
+ * assign_batch()). Each request's time_to_process is taken to include a
+ * fixed per-call setup; a batch pays the setup once plus every member's
+ * remaining work, and all members finish together.
+ *
+ * With a network model (see set_network()) a request handed to an idle
+ * server arrives one round trip later: the server's completion notice has
+ * to reach the balancer and the request has to travel back, and the server
+ * sits idle meanwhile. A prefetch window lets the balancer send requests to
+ * busy servers ahead of time; they travel half a round trip and wait in the
+ * server's window, so the next one is usually local when the current one
+ * finishes.
  */
 class ServerHandler {
 public:
 
     /**
      * @brief Constructs an empty ServerHandler with no active servers.
+     *
+     * @param arena Arena owning the requests this handler processes.
+     */
+    explicit ServerHandler(RequestArena& arena);
+
+    /**
+     * @brief ServerHandler is not copyable: its Server views refer to its table.
+     */
+    ServerHandler(const ServerHandler&) = delete;
+
+    /**
+     * @brief ServerHandler is not copy-assignable: its Server views refer to its table.
      */
-    ServerHandler();
+    ServerHandler& operator=(const ServerHandler&) = delete;
 
     /**
      * @brief Adds a new server to the pool.
      *
      * Creates and stores a new Server instance.
+     *
+     * @param profile Speed, cost and affinity of the new server.
      */
-    void add_server();
+    void add_server(const ServerProfile& profile = ServerProfile());
 
     /**
      * @brief Removes a server from the pool.
@@ -56,20 +157,72 @@ public:
      */
     Server* get_available_server();
 
+    /**
+     * @brief Returns the server stored in a table slot.
+     *
+     * @param slot Slot index, in [0, get_server_count()).
+     * @return Pointer to the Server view of that slot.
+     */
+    Server* server_at(size_t slot);
+
     /**
      * @brief Assigns a request to an available server.
      *
-     * If a server is available, the request is assigned to it.
+     * If a server is available, the request is started on it and the server
+     * takes ownership of the handle. Otherwise the handle is left untouched.
+     * Under DispatchPolicy::EARLIEST_COMPLETION no server is returned when a
+     * busy server is expected to finish the request before any idle one;
+     * that server is then reserved for the request, so later requests of the
+     * same dispatch pass see it busy for longer and may take idle servers.
+     * Call end_dispatch() once the pass is over.
      *
-     * @param request The Request to assign.
+     * @param request Handle of the request to assign.
      * @return Pointer to the Server handling the request, or nullptr if none are available.
      */
-    Server* assign_request(const Request& request);
+    Server* assign_request(RequestHandle&& request);
+
+    /**
+     * @brief Runs several requests for the same backend as one call on an idle server.
+     *
+     * The server takes ownership of the leader's handle, and the handler of
+     * the members'; they all complete when the batch does. Batches go to the
+     * first idle server under every dispatch policy, are not time-sliced or
+     * hedged, and are split into individual retries if their server crashes.
+     *
+     * @param leader Handle of the request the batch was built around.
+     * @param members Handles of the other members; emptied when the batch starts.
+     * @return Pointer to the Server running the batch, or nullptr if every server is busy
+     *         (the caller keeps all handles).
+     */
+    Server* assign_batch(RequestHandle&& leader, std::vector<RequestHandle>& members);
+
+    /**
+     * @brief Drops the reservations made by assign_request() in this dispatch pass.
+     */
+    void end_dispatch();
+
+    /**
+     * @brief Checks whether assign_request() can place a request right now.
+     *
+     * @return true if a server is idle or a busy server's prefetch window has room.
+     */
+    bool can_accept() const;
+
+    /**
+     * @brief Finishes a server's request immediately and releases it.
+     *
+     * Used when the work is carried out outside the simulated clock.
+     *
+     * @param server Server whose request is finished.
+     */
+    void finish_request(Server* server);
 
     /**
      * @brief Scales the system up by adding a server.
+     *
+     * @param profile Speed, cost and affinity of the new server.
      */
-    void scale_up();
+    void scale_up(const ServerProfile& profile = ServerProfile());
 
     /**
      * @brief Scales the system down by removing a server.
@@ -85,6 +238,38 @@ public:
      */
     int get_server_count() const;
 
+    /**
+     * @brief Returns the number of servers not processing a request.
+     *
+     * @return The current idle server count.
+     */
+    int get_idle_server_count() const;
+
+    /**
+     * @brief Returns the combined cost per cycle of all servers.
+     *
+     * @return Sum of the servers' cost factors.
+     */
+    double get_cost_rate() const;
+
+    /**
+     * @brief Selects how assign_request() picks a server.
+     *
+     * @param policy Dispatch policy (FIRST_IDLE by default).
+     */
+    void set_dispatch_policy(DispatchPolicy policy);
+
+    /**
+     * @brief Sets the request type the pool is built for.
+     *
+     * Requests of other types, stolen from another pool's queue, take
+     * foreign_penalty times longer.
+     *
+     * @param request_type Home request type.
+     * @param foreign_penalty Service time multiplier for other types.
+     */
+    void set_home_type(char request_type, float foreign_penalty);
+
     /**
      * @brief Updates the state of all servers.
      *
@@ -93,15 +278,385 @@ public:
      */
     void update_servers();
 
+    /**
+     * @brief Enables or disables per-server console output.
+     *
+     * @param enabled Whether update_servers() prints busy servers (default true).
+     */
+    void set_verbose(bool enabled);
+
+    /**
+     * @brief Enables fault injection for this pool.
+     *
+     * Existing and future servers draw their slowdown factor from the
+     * injector.
+     *
+     * @param settings Fault rates.
+     * @param seed Seed of the injector's random number generator.
+     */
+    void set_fault_injection(const FaultSettings& settings, uint32_t seed);
+
+    /**
+     * @brief Sets the hedging and retry policy.
+     *
+     * @param settings Hedge threshold and retry bound.
+     */
+    void set_hedging(const HedgeSettings& settings);
+
+    /**
+     * @brief Sets the per-call setup work that a batch pays only once.
+     *
+     * @param setup Nominal setup cycles included in every request's time_to_process.
+     */
+    void set_batch_setup(int setup);
+
+    /**
+     * @brief Sets the round trip to the servers and the prefetch window.
+     *
+     * Call while no request is held in a prefetch window (before the first
+     * dispatch). Prefetching applies to first-idle dispatch only; under
+     * earliest-completion dispatch the round trip is still paid on every
+     * handoff.
+     *
+     * @param settings Round trip and window size.
+     */
+    void set_network(const NetworkSettings& settings);
+
+    /**
+     * @brief Returns the handoff counters.
+     *
+     * @return Counters accumulated since construction.
+     */
+    const NetworkStats& get_network_stats() const;
+
+    /**
+     * @brief Returns the requests waiting in the servers' prefetch windows.
+     *
+     * @return Requests sent ahead and not started yet.
+     */
+    int get_prefetched_count() const;
+
+    /**
+     * @brief Returns the requests that finished during the last update_servers().
+     *
+     * The entries are arena slot indices (RequestHandle::get_index()) of
+     * requests that have already been released.
+     *
+     * @return Slot indices of the finished requests.
+     */
+    const std::vector<uint32_t>& get_completed() const;
+
+    /**
+     * @brief Runs requests in time slices of at most quantum cycles.
+     *
+     * A request that still has work left when its slice ends is handed back
+     * through get_preempted() so the caller can queue it again.
+     *
+     * @param quantum Slice length in cycles (0 = run requests to completion).
+     */
+    void set_time_slice(int quantum);
+
+    /**
+     * @brief Returns the requests whose time slice ended during the last update_servers().
+     *
+     * The caller takes the handles (typically back to the pool's queue)
+     * before the next update; any left behind are released then.
+     *
+     * @return Handles of the preempted requests.
+     */
+    std::vector<RequestHandle>& get_preempted();
+
+    /**
+     * @brief Returns the fault, hedge and retry counters.
+     *
+     * @return Counters accumulated since construction.
+     */
+    const ResilienceStats& get_resilience_stats() const;
+
+    /**
+     * @brief Returns the batched call counters.
+     *
+     * @return Counters accumulated since construction.
+     */
+    const BatchStats& get_batch_stats() const;
+
+    /**
+     * @brief Writes the servers, running batches, prefetch windows, pending retries, hedge pairs and counters to a checkpoint.
+     *
+     * Call between cycles, when no dispatch pass is open and no preempted
+     * handles are waiting to be collected.
+     *
+     * @param out Checkpoint being written.
+     */
+    void save(CheckpointWriter& out) const;
+
+    /**
+     * @brief Replaces the pool's servers and state with checkpointed ones.
+     *
+     * The dispatch policy, hedging, time slice and fault rates are
+     * configuration and are kept; the speed classes are rebuilt.
+     *
+     * @param in Checkpoint being read.
+     * @param restore_ids false to keep the process-wide server ID counter.
+     * @return false if the section is malformed.
+     */
+    bool restore(CheckpointReader& in, bool restore_ids = true);
+
 private:
 
     /**
-     * @brief Collection of managed Server instances.
+     * @brief Request lost in a crash, waiting to be started again.
+     */
+    struct Retry {
+        RequestHandle handle;  ///< The request.
+        int attempt;           ///< Failed attempts so far.
+    };
+
+    /**
+     * @brief Request sent ahead to a busy server.
+     */
+    struct Prefetch {
+        RequestHandle handle;  ///< The request.
+        int ready_at;          ///< Cycle at which it is local to the server.
+    };
+
+    /**
+     * @brief Draws crashes for busy servers and returns restarted servers to service.
+     */
+    void inject_crashes();
+
+    /**
+     * @brief Finds the busy server with room in its window that is expected to be free first (-1 if none).
+     */
+    long pick_window() const;
+
+    /**
+     * @brief Starts the oldest prefetched request on every free server whose window holds one.
+     */
+    void start_prefetched();
+
+    /**
+     * @brief Sends a slot's prefetched requests to other servers through the retry queue.
+     */
+    void requeue_window(size_t slot);
+
+    /**
+     * @brief Cancels the losing copy of every hedged request that has a winner.
+     */
+    void resolve_hedges();
+
+    /**
+     * @brief Starts queued retries on idle servers.
+     */
+    void dispatch_retries();
+
+    /**
+     * @brief Starts duplicates of requests that have run past the hedge threshold.
+     */
+    void issue_hedges();
+
+    /**
+     * @brief Starts a request in a slot after delay cycles in transit, applying stalls and recording its start.
+     */
+    void start_in_slot(size_t slot, const Request& request, int attempt, int delay, int batch_work = 0);
+
+    /**
+     * @brief Moves the members of the batch led by a request out of batches.
+     *
+     * @param leader Arena slot index of the leader.
+     * @param members Receives the member handles (appended); nothing if the request leads no batch.
+     */
+    void take_members(uint32_t leader, std::vector<RequestHandle>& members);
+
+    /**
+     * @brief Limits the request's next slice to the work a slot finishes within one quantum.
+     */
+    void plan_slice(size_t slot, Request& request) const;
+
+    /**
+     * @brief Drops the hedge pairing of a slot, keeping the other copy running.
      *
-     * Servers are owned via std::unique_ptr to ensure automatic
-     * cleanup and exclusive ownership.
+     * If the slot holds the request handle it is moved to the other copy.
+     */
+    void unpair(size_t slot);
+
+    /**
+     * @brief Index into hedges of the pair containing a slot, or -1.
+     */
+    long find_hedge(size_t slot) const;
+
+    /**
+     * @brief Servers with identical service times, ordered by when they are free.
+     */
+    struct SpeedClass {
+        float factor;           ///< Slowdown divided by speed.
+        char affinity;          ///< Affinity request type.
+        float affinity_speedup; ///< Speedup for the affinity type.
+        IndexedHeap free_at;    ///< Slot -> cycle at which the server is next free.
+    };
+
+    /**
+     * @brief Finds the slot expected to complete a request first (-1 if there are no servers).
+     */
+    long select_earliest_completion(const Request& request, int64_t& completion) const;
+
+    /**
+     * @brief Puts a slot into its speed class (earliest-completion dispatch only).
+     */
+    void classify(size_t slot);
+
+    /**
+     * @brief Updates a slot's free time in its speed class heap.
+     */
+    void refresh(size_t slot);
+
+    /**
+     * @brief Rebuilds every speed class from the table.
+     */
+    void rebuild_classes();
+
+    /**
+     * @brief Arena owning the requests processed by the servers.
+     */
+    RequestArena& arena;
+
+    /**
+     * @brief Whether update_servers() prints busy servers.
+     */
+    bool verbose;
+
+    /**
+     * @brief Scratch list of finished request handles, reused every tick.
+     */
+    std::vector<RequestHandle> finished;
+
+    /**
+     * @brief Requests whose time slice ended in the last update, with work left.
+     */
+    std::vector<RequestHandle> preempted;
+
+    /**
+     * @brief Time slice length in cycles (0 = run to completion).
+     */
+    int quantum;
+
+    /**
+     * @brief Contiguous per-server state of the pool.
+     */
+    ServerTable table;
+
+    /**
+     * @brief Server views, one per table slot and in slot order.
+     *
+     * Views are owned via std::unique_ptr so that Server pointers handed to
+     * callers stay valid while other servers are added or removed.
      */
     std::vector<std::unique_ptr<Server>> servers;
+
+    /**
+     * @brief Source of injected faults (disabled unless configured).
+     */
+    FaultInjector faults;
+
+    /**
+     * @brief Hedging and retry policy.
+     */
+    HedgeSettings hedging;
+
+    /**
+     * @brief Fault, hedge and retry counters.
+     */
+    ResilienceStats stats;
+
+    /**
+     * @brief Cycles advanced by update_servers(), used to time running requests.
+     */
+    int now;
+
+    /**
+     * @brief Arena slot indices of the requests finished in the last update.
+     */
+    std::vector<uint32_t> completed;
+
+    /**
+     * @brief Requests waiting to be restarted after a crash, oldest first.
+     */
+    std::vector<Retry> retry_queue;
+
+    /**
+     * @brief Running hedged requests as (slot holding the request, duplicate slot).
+     */
+    std::vector<std::pair<size_t, size_t>> hedges;
+
+    /**
+     * @brief How assign_request() picks a server.
+     */
+    DispatchPolicy policy;
+
+    /**
+     * @brief Speed classes used by earliest-completion dispatch.
+     */
+    std::vector<SpeedClass> classes;
+
+    /**
+     * @brief Speed class of each slot (earliest-completion dispatch only).
+     */
+    std::vector<size_t> slot_class;
+
+    /**
+     * @brief Busy slots reserved for waiting requests in the current dispatch pass.
+     */
+    std::vector<size_t> reserved;
+
+    /**
+     * @brief Sum of the cost factors of all servers.
+     */
+    double cost_rate;
+
+    /**
+     * @brief Nominal setup cycles a batch pays only once.
+     */
+    int batch_setup;
+
+    /**
+     * @brief Members of each running batch, keyed by the arena slot of the leader the server holds.
+     */
+    std::unordered_map<uint32_t, std::vector<RequestHandle>> batches;
+
+    /**
+     * @brief Scratch list of batch members being completed, retried or released.
+     */
+    std::vector<RequestHandle> members_scratch;
+
+    /**
+     * @brief Batched call counters.
+     */
+    BatchStats batch_stats;
+
+    /**
+     * @brief Round trip and prefetch window size.
+     */
+    NetworkSettings network;
+
+    /**
+     * @brief Handoff counters.
+     */
+    NetworkStats network_stats;
+
+    /**
+     * @brief Prefetch windows, network.prefetch entries per slot, oldest first.
+     */
+    std::vector<Prefetch> windows;
+
+    /**
+     * @brief Requests in each slot's window.
+     */
+    std::vector<uint8_t> window_count;
+
+    /**
+     * @brief Requests in all windows.
+     */
+    int prefetched;
 };
 
 #endif
\ No newline at end of file
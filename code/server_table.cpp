@@ -0,0 +1,604 @@
+/**
+ * @file server_table.cpp
+ * @brief Implements the ServerTable structure-of-arrays server storage.
+ *
+ * This file contains slot management and the vectorized per-tick update and
+ * idle-scan kernels. As in firewall.cpp, an AVX2 or SSE2 kernel is selected at
+ * runtime with a portable scalar fallback.
+ */
+
+#include "server_table.h"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SERVER_TABLE_HAVE_X86_KERNELS 1
+#endif
+
+namespace {
+
+/**
+ * @brief Signature of a per-tick update kernel.
+ */
+using TickKernel = void (*)(int32_t* busy, uint8_t* flags, size_t n);
+
+/**
+ * @brief Signature of an idle-scan kernel covering at most 64 servers.
+ */
+using IdleKernel = uint64_t (*)(const int32_t* busy, size_t n);
+
+/**
+ * @brief Scalar tick: decrement busy servers and refresh their busy flag.
+ */
+void tick_scalar(int32_t* busy, uint8_t* flags, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        busy[i] -= (busy[i] > 0);
+        flags[i] = static_cast<uint8_t>((flags[i] & ~ServerTable::FLAG_BUSY) | (busy[i] > 0 ? ServerTable::FLAG_BUSY : 0));
+    }
+}
+
+/**
+ * @brief Scalar idle scan: bit i is set when busy[i] <= 0.
+ */
+uint64_t idle_scalar(const int32_t* busy, size_t n) {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < n; ++i) {
+        bits |= static_cast<uint64_t>(busy[i] <= 0) << i;
+    }
+    return bits;
+}
+
+#ifdef SERVER_TABLE_HAVE_X86_KERNELS
+
+/**
+ * @brief Merges a 16-byte "still busy" mask into the state flags.
+ */
+inline void merge_busy_flags(uint8_t* flags, __m128i busy_bytes) {
+    __m128i state = _mm_loadu_si128(reinterpret_cast<__m128i*>(flags));
+    __m128i bit = _mm_set1_epi8(static_cast<char>(ServerTable::FLAG_BUSY));
+    state = _mm_or_si128(_mm_andnot_si128(bit, state), _mm_and_si128(busy_bytes, bit));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(flags), state);
+}
+
+/**
+ * @brief SSE2 tick: sixteen servers per iteration.
+ *
+ * cmpgt yields -1 for busy lanes, so adding the mask decrements exactly the
+ * servers with time left. The resulting "still busy" lanes are narrowed to
+ * bytes with saturating packs and merged into the flag column.
+ */
+void tick_sse2(int32_t* busy, uint8_t* flags, size_t n) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i still[4];
+        for (int k = 0; k < 4; ++k) {
+            __m128i* p = reinterpret_cast<__m128i*>(busy + i + 4 * k);
+            __m128i b = _mm_loadu_si128(p);
+            b = _mm_add_epi32(b, _mm_cmpgt_epi32(b, zero));
+            _mm_storeu_si128(p, b);
+            still[k] = _mm_cmpgt_epi32(b, zero);
+        }
+        __m128i words = _mm_packs_epi16(_mm_packs_epi32(still[0], still[1]), _mm_packs_epi32(still[2], still[3]));
+        merge_busy_flags(flags + i, words);
+    }
+    tick_scalar(busy + i, flags + i, n - i);
+}
+
+/**
+ * @brief SSE2 idle scan: four servers per compare.
+ */
+uint64_t idle_sse2(const int32_t* busy, size_t n) {
+    const __m128i one = _mm_set1_epi32(1);
+    uint64_t bits = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(busy + i));
+        uint64_t lanes = static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(one, b))));
+        bits |= lanes << i;
+    }
+    return bits | (idle_scalar(busy + i, n - i) << i);
+}
+
+/**
+ * @brief AVX2 tick: sixteen servers per iteration using 256-bit lanes.
+ *
+ * 256-bit packs operate per 128-bit half, so the packed words are permuted
+ * back into server order before the final narrowing to bytes.
+ */
+__attribute__((target("avx2")))
+void tick_avx2(int32_t* busy, uint8_t* flags, size_t n) {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i* p0 = reinterpret_cast<__m256i*>(busy + i);
+        __m256i* p1 = reinterpret_cast<__m256i*>(busy + i + 8);
+        __m256i b0 = _mm256_loadu_si256(p0);
+        __m256i b1 = _mm256_loadu_si256(p1);
+        b0 = _mm256_add_epi32(b0, _mm256_cmpgt_epi32(b0, zero));
+        b1 = _mm256_add_epi32(b1, _mm256_cmpgt_epi32(b1, zero));
+        _mm256_storeu_si256(p0, b0);
+        _mm256_storeu_si256(p1, b1);
+        __m256i words = _mm256_packs_epi32(_mm256_cmpgt_epi32(b0, zero), _mm256_cmpgt_epi32(b1, zero));
+        words = _mm256_permute4x64_epi64(words, 0xD8);
+        __m128i bytes = _mm_packs_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        merge_busy_flags(flags + i, bytes);
+    }
+    tick_scalar(busy + i, flags + i, n - i);
+}
+
+/**
+ * @brief AVX2 idle scan: eight servers per compare.
+ */
+__attribute__((target("avx2")))
+uint64_t idle_avx2(const int32_t* busy, size_t n) {
+    const __m256i one = _mm256_set1_epi32(1);
+    uint64_t bits = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(busy + i));
+        uint64_t lanes = static_cast<uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(one, b))));
+        bits |= lanes << i;
+    }
+    return bits | (idle_scalar(busy + i, n - i) << i);
+}
+
+#endif
+
+/**
+ * @brief Pair of kernels chosen for the running CPU.
+ */
+struct Kernels {
+    TickKernel tick;
+    IdleKernel idle;
+};
+
+/**
+ * @brief Picks the widest kernels supported by the running CPU.
+ */
+Kernels select_kernels() {
+#ifdef SERVER_TABLE_HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {tick_avx2, idle_avx2};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return {tick_sse2, idle_sse2};
+    }
+#endif
+    return {tick_scalar, idle_scalar};
+}
+
+/**
+ * @brief Kernels used by every ServerTable, resolved once at startup.
+ */
+const Kernels kernels = select_kernels();
+
+} // namespace
+
+/**
+ * @brief Static counter used to assign unique IDs to servers.
+ *
+ * This value increments each time a server is added to any table.
+ */
+std::atomic<int> ServerTable::next_id(0);
+
+/**
+ * @brief Constructs an empty table.
+ */
+ServerTable::ServerTable() = default;
+
+/**
+ * @brief Appends a new idle server with a fresh unique ID.
+ *
+ * The server starts with no active request (-1) and no busy time.
+ *
+ * @return Slot index of the new server.
+ */
+size_t ServerTable::add() {
+    server_ids.push_back(next_id++);
+    busy_until.push_back(0);
+    active_request_ids.push_back(-1);
+    flags.push_back(0);
+    slowdowns.push_back(1.0f);
+    speeds.push_back(1.0f);
+    costs.push_back(1.0f);
+    affinities.push_back(0);
+    affinity_speedups.push_back(1.0f);
+    started.push_back(0);
+    attempts.push_back(0);
+    active_handles.emplace_back();
+    holding.resize((server_ids.size() + 63) / 64, 0);
+    return server_ids.size() - 1;
+}
+
+/**
+ * @brief Removes the server in a slot by moving the last server into it.
+ *
+ * @param slot Slot index of the server to remove.
+ * @return Previous slot index of the server that moved into slot.
+ */
+size_t ServerTable::remove(size_t slot) {
+    size_t last = server_ids.size() - 1;
+    server_ids[slot] = server_ids[last];
+    busy_until[slot] = busy_until[last];
+    active_request_ids[slot] = active_request_ids[last];
+    flags[slot] = flags[last];
+    slowdowns[slot] = slowdowns[last];
+    speeds[slot] = speeds[last];
+    costs[slot] = costs[last];
+    affinities[slot] = affinities[last];
+    affinity_speedups[slot] = affinity_speedups[last];
+    started[slot] = started[last];
+    attempts[slot] = attempts[last];
+    active_handles[slot] = std::move(active_handles[last]);
+    set_holding(slot, active_handles[slot].valid());
+    set_holding(last, false);
+    server_ids.pop_back();
+    busy_until.pop_back();
+    active_request_ids.pop_back();
+    flags.pop_back();
+    slowdowns.pop_back();
+    speeds.pop_back();
+    costs.pop_back();
+    affinities.pop_back();
+    affinity_speedups.pop_back();
+    started.pop_back();
+    attempts.pop_back();
+    active_handles.pop_back();
+    return last;
+}
+
+/**
+ * @brief Starts a request on the server in a slot.
+ *
+ * The server's service time for the request (see service_time()) is added
+ * to its remaining busy time.
+ *
+ * @param slot Slot index of the server.
+ * @param request_id ID of the request being started.
+ * @param time_to_process Processing time of the request.
+ * @param request_type Type of the request (for the server's affinity).
+ */
+void ServerTable::start(size_t slot, int request_id, int time_to_process, char request_type) {
+    active_request_ids[slot] = request_id;
+    busy_until[slot] += service_time(slot, time_to_process, request_type);
+    if (busy_until[slot] > 0) {
+        flags[slot] |= FLAG_BUSY;
+    }
+}
+
+/**
+ * @brief Returns how long the server in a slot needs for a request.
+ *
+ * Nominal servers take exactly time_to_process cycles. Otherwise the
+ * processing time is scaled by slowdown / (speed x affinity speedup), and
+ * by the foreign penalty for requests that are not of the home type,
+ * rounded up and kept at one cycle or more.
+ *
+ * @param slot Slot index of the server.
+ * @param time_to_process Nominal processing time of the request.
+ * @param request_type Type of the request.
+ * @return Cycles the server would be busy.
+ */
+int ServerTable::service_time(size_t slot, int time_to_process, char request_type) const {
+    float factor = slowdowns[slot] / speeds[slot];
+    if (request_type != 0 && request_type == affinities[slot]) {
+        factor /= affinity_speedups[slot];
+    }
+    if (home_type != 0 && request_type != home_type) {
+        factor *= foreign_penalty;
+    }
+    if (factor == 1.0f || time_to_process <= 0) {
+        return time_to_process;
+    }
+    int cycles = static_cast<int>(std::ceil(time_to_process * factor));
+    return cycles > 0 ? cycles : 1;
+}
+
+/**
+ * @brief Sets the hardware profile of the server in a slot.
+ *
+ * @param slot Slot index of the server.
+ * @param speed Relative processing speed (1 = nominal).
+ * @param cost Relative cost per cycle (1 = nominal).
+ * @param affinity Request type the server is tuned for (0 = none).
+ * @param affinity_speedup Extra speed factor for requests of that type.
+ */
+void ServerTable::set_profile(size_t slot, float speed, float cost, char affinity, float affinity_speedup) {
+    speeds[slot] = speed > 0.0f ? speed : 1.0f;
+    costs[slot] = cost;
+    affinities[slot] = affinity;
+    affinity_speedups[slot] = affinity_speedup > 0.0f ? affinity_speedup : 1.0f;
+}
+
+/**
+ * @brief Sets the request type the pool is built for.
+ *
+ * @param request_type Home request type (0 = none, no penalty).
+ * @param foreign_penalty Service time multiplier for other types.
+ */
+void ServerTable::set_home_type(char request_type, float foreign_penalty) {
+    home_type = request_type;
+    this->foreign_penalty = foreign_penalty;
+}
+
+/**
+ * @brief Extends the remaining busy time of a busy server.
+ *
+ * @param slot Slot index of the server.
+ * @param cycles Extra busy cycles.
+ */
+void ServerTable::stall(size_t slot, int cycles) {
+    busy_until[slot] += cycles;
+    if (busy_until[slot] > 0) {
+        flags[slot] |= FLAG_BUSY;
+    }
+}
+
+/**
+ * @brief Abandons the server's request and keeps it down while it restarts.
+ *
+ * The server keeps no active request and counts as busy (and FLAG_DOWN)
+ * for restart_cycles cycles.
+ *
+ * @param slot Slot index of the server.
+ * @param restart_cycles Cycles until the server accepts requests again.
+ */
+void ServerTable::crash(size_t slot, int restart_cycles) {
+    active_request_ids[slot] = -1;
+    busy_until[slot] = restart_cycles;
+    flags[slot] = static_cast<uint8_t>((flags[slot] & ~FLAG_HEDGED) | FLAG_DOWN | (restart_cycles > 0 ? FLAG_BUSY : 0));
+}
+
+/**
+ * @brief Sets the factor applied to the processing time of every request.
+ *
+ * @param slot Slot index of the server.
+ * @param factor Slowdown factor (1 = normal speed).
+ */
+void ServerTable::set_slowdown(size_t slot, float factor) {
+    slowdowns[slot] = factor;
+}
+
+/**
+ * @brief Sets or clears state flags of the server in a slot.
+ *
+ * @param slot Slot index of the server.
+ * @param flag Flags to change.
+ * @param value Whether the flags are set.
+ */
+void ServerTable::set_flag(size_t slot, uint8_t flag, bool value) {
+    if (value) {
+        flags[slot] |= flag;
+    } else {
+        flags[slot] &= static_cast<uint8_t>(~flag);
+    }
+}
+
+/**
+ * @brief Records when the server's current request started.
+ *
+ * @param slot Slot index of the server.
+ * @param cycle Cycle at which the request started.
+ * @param attempt Number of earlier failed attempts of the request.
+ */
+void ServerTable::set_started(size_t slot, int cycle, int attempt) {
+    started[slot] = cycle;
+    attempts[slot] = static_cast<uint8_t>(attempt);
+}
+
+/**
+ * @brief Gives the server in a slot ownership of its active request.
+ *
+ * @param slot Slot index of the server.
+ * @param handle Handle of the request started on the server.
+ */
+void ServerTable::hold(size_t slot, RequestHandle&& handle) {
+    active_handles[slot] = std::move(handle);
+    set_holding(slot, active_handles[slot].valid());
+}
+
+/**
+ * @brief Takes the request handle held by the server in a slot.
+ *
+ * @param slot Slot index of the server.
+ * @return The held handle, or an empty handle if none is held.
+ */
+RequestHandle ServerTable::take_handle(size_t slot) {
+    set_holding(slot, false);
+    return std::move(active_handles[slot]);
+}
+
+/**
+ * @brief Moves the handles of every idle server still holding a request.
+ *
+ * @param finished Receives the handles of finished requests (appended).
+ */
+void ServerTable::collect_finished(std::vector<RequestHandle>& finished) {
+    size_t n = busy_until.size();
+    for (size_t word = 0; word < holding.size(); ++word) {
+        if (holding[word] == 0) {
+            continue;
+        }
+        size_t begin = word * 64;
+        uint64_t done = holding[word] & kernels.idle(busy_until.data() + begin, (n - begin < 64) ? n - begin : 64);
+        holding[word] &= ~done;
+        while (done != 0) {
+            size_t slot = begin + __builtin_ctzll(done);
+            finished.push_back(std::move(active_handles[slot]));
+            done &= done - 1;
+        }
+    }
+}
+
+/**
+ * @brief Sets or clears the holding bit of a slot.
+ *
+ * @param slot Slot index.
+ * @param value Whether the slot holds a request handle.
+ */
+void ServerTable::set_holding(size_t slot, bool value) {
+    uint64_t bit = 1ull << (slot % 64);
+    if (value) {
+        holding[slot / 64] |= bit;
+    } else {
+        holding[slot / 64] &= ~bit;
+    }
+}
+
+/**
+ * @brief Marks the server in a slot as finished and idle.
+ *
+ * Clears any remaining busy time, e.g. when the work is carried out outside
+ * the simulated clock by a real worker thread.
+ *
+ * @param slot Slot index of the server.
+ */
+void ServerTable::finish(size_t slot) {
+    busy_until[slot] = 0;
+    flags[slot] &= static_cast<uint8_t>(~(FLAG_BUSY | FLAG_HEDGED));
+}
+
+/**
+ * @brief Decrements the remaining busy time of one server.
+ *
+ * @param slot Slot index of the server.
+ */
+void ServerTable::tick_one(size_t slot) {
+    tick_scalar(&busy_until[slot], &flags[slot], 1);
+}
+
+/**
+ * @brief Advances every server by one clock cycle.
+ */
+void ServerTable::tick() {
+    kernels.tick(busy_until.data(), flags.data(), busy_until.size());
+}
+
+/**
+ * @brief Computes a bitmask of idle servers, 64 servers per word.
+ *
+ * @param mask Receives the bitmask; resized to cover every slot.
+ */
+void ServerTable::idle_mask(std::vector<uint64_t>& mask) const {
+    size_t n = busy_until.size();
+    mask.resize((n + 63) / 64);
+    for (size_t word = 0; word < mask.size(); ++word) {
+        size_t begin = word * 64;
+        mask[word] = kernels.idle(busy_until.data() + begin, (n - begin < 64) ? n - begin : 64);
+    }
+}
+
+/**
+ * @brief Finds the first idle server.
+ *
+ * Scans 64 servers at a time and stops at the first word with an idle bit.
+ *
+ * @return Slot index of an idle server, or -1 if every server is busy.
+ */
+long ServerTable::find_idle() const {
+    size_t n = busy_until.size();
+    for (size_t begin = 0; begin < n; begin += 64) {
+        uint64_t bits = kernels.idle(busy_until.data() + begin, (n - begin < 64) ? n - begin : 64);
+        if (bits != 0) {
+            return static_cast<long>(begin + __builtin_ctzll(bits));
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Counts the idle servers.
+ *
+ * @return Number of servers that are not processing a request.
+ */
+size_t ServerTable::count_idle() const {
+    size_t n = busy_until.size();
+    size_t idle = 0;
+    for (size_t begin = 0; begin < n; begin += 64) {
+        idle += __builtin_popcountll(kernels.idle(busy_until.data() + begin, (n - begin < 64) ? n - begin : 64));
+    }
+    return idle;
+}
+
+/**
+ * @brief Returns the number of servers in the table.
+ *
+ * @return Server count.
+ */
+size_t ServerTable::size() const {
+    return server_ids.size();
+}
+
+/**
+ * @brief Writes every column and the server ID counter to a checkpoint.
+ *
+ * Held request handles are saved as arena slot indices.
+ *
+ * @param out Checkpoint being written.
+ */
+void ServerTable::save(CheckpointWriter& out) const {
+    out.write(next_id.load());
+    out.write_vector(server_ids);
+    out.write_vector(busy_until);
+    out.write_vector(active_request_ids);
+    out.write_vector(flags);
+    out.write_vector(slowdowns);
+    out.write_vector(speeds);
+    out.write_vector(costs);
+    out.write_vector(affinities);
+    out.write_vector(affinity_speedups);
+    out.write_vector(started);
+    out.write_vector(attempts);
+    std::vector<uint32_t> handles(active_handles.size());
+    for (size_t slot = 0; slot < active_handles.size(); ++slot) {
+        handles[slot] = holds(slot) ? active_handles[slot].get_index() : 0xFFFFFFFFu;
+    }
+    out.write_vector(handles);
+}
+
+/**
+ * @brief Replaces the table with a checkpointed one.
+ *
+ * @param in Checkpoint being read.
+ * @param arena Restored arena the held request handles are adopted from.
+ * @param restore_ids false to keep the process-wide server ID counter.
+ * @return false if the table section is malformed.
+ */
+bool ServerTable::restore(CheckpointReader& in, const RequestArena& arena, bool restore_ids) {
+    int saved_next_id = 0;
+    in.read(saved_next_id);
+    if (restore_ids) {
+        next_id.store(saved_next_id);
+    }
+    in.read_vector(server_ids);
+    in.read_vector(busy_until);
+    in.read_vector(active_request_ids);
+    in.read_vector(flags);
+    in.read_vector(slowdowns);
+    in.read_vector(speeds);
+    in.read_vector(costs);
+    in.read_vector(affinities);
+    in.read_vector(affinity_speedups);
+    in.read_vector(started);
+    in.read_vector(attempts);
+    std::vector<uint32_t> handles;
+    in.read_vector(handles);
+    size_t count = server_ids.size();
+    if (busy_until.size() != count || active_request_ids.size() != count || flags.size() != count ||
+        slowdowns.size() != count || speeds.size() != count || costs.size() != count || affinities.size() != count ||
+        affinity_speedups.size() != count || started.size() != count || attempts.size() != count ||
+        handles.size() != count) {
+        in.fail();
+        return false;
+    }
+    active_handles.clear();
+    active_handles.resize(count);
+    holding.assign((count + 63) / 64, 0);
+    for (size_t slot = 0; slot < count; ++slot) {
+        active_handles[slot] = arena.adopt(handles[slot]);
+        set_holding(slot, active_handles[slot].valid());
+    }
+    return in.ok();
+}
@@ -0,0 +1,415 @@
+/**
+ * @file server_table.h
+ * @brief Declares the ServerTable class storing server state as parallel arrays.
+ *
+ * This header defines a structure-of-arrays table that keeps the state of
+ * every server in a pool in contiguous columns, so that per-tick updates and
+ * idle-server scans run as vector loops instead of following one pointer per
+ * server. The columns are LargeVector buffers, so a pool of 100k+ servers is
+ * backed by huge pages (see large_alloc.h).
+ */
+
+#ifndef SERVER_TABLE_H
+#define SERVER_TABLE_H
+
+#include "large_alloc.h"
+#include "request_arena.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class ServerTable
+ * @brief Structure-of-arrays storage for the servers of one pool.
+ *
+ * Each server occupies one slot; column i of every array describes the server
+ * in slot i. Slots are dense: removing a server moves the last server into the
+ * freed slot, so the arrays never contain holes.
+ */
+class ServerTable {
+public:
+
+    /**
+     * @brief State flag set while a server is processing a request.
+     */
+    static constexpr uint8_t FLAG_BUSY = 0x1;
+
+    /**
+     * @brief State flag set while a crashed server restarts.
+     */
+    static constexpr uint8_t FLAG_DOWN = 0x2;
+
+    /**
+     * @brief State flag set on both servers running copies of a hedged request.
+     */
+    static constexpr uint8_t FLAG_HEDGED = 0x4;
+
+    /**
+     * @brief Constructs an empty table.
+     */
+    ServerTable();
+
+    /**
+     * @brief Appends a new idle server with a fresh unique ID.
+     *
+     * @return Slot index of the new server.
+     */
+    size_t add();
+
+    /**
+     * @brief Removes the server in a slot.
+     *
+     * The last server is moved into the freed slot to keep the arrays dense.
+     *
+     * @param slot Slot index of the server to remove.
+     * @return Previous slot index of the server that moved into slot, or slot
+     *         itself if the removed server was the last one.
+     */
+    size_t remove(size_t slot);
+
+    /**
+     * @brief Starts a request on the server in a slot.
+     *
+     * The processing time is converted with service_time().
+     *
+     * @param slot Slot index of the server.
+     * @param request_id ID of the request being started.
+     * @param time_to_process Processing time of the request.
+     * @param request_type Type of the request (for the server's affinity).
+     */
+    void start(size_t slot, int request_id, int time_to_process, char request_type = 0);
+
+    /**
+     * @brief Returns how long the server in a slot needs for a request.
+     *
+     * time_to_process is multiplied by the slowdown factor and divided by
+     * the server's speed (and by its affinity speedup when the request type
+     * matches, or multiplied by the foreign penalty when it is not the home
+     * type), rounding up.
+     *
+     * @param slot Slot index of the server.
+     * @param time_to_process Nominal processing time of the request.
+     * @param request_type Type of the request.
+     * @return Cycles the server would be busy.
+     */
+    int service_time(size_t slot, int time_to_process, char request_type) const;
+
+    /**
+     * @brief Sets the hardware profile of the server in a slot.
+     *
+     * @param slot Slot index of the server.
+     * @param speed Relative processing speed (1 = nominal).
+     * @param cost Relative cost per cycle (1 = nominal).
+     * @param affinity Request type the server is tuned for (0 = none).
+     * @param affinity_speedup Extra speed factor for requests of that type.
+     */
+    void set_profile(size_t slot, float speed, float cost, char affinity, float affinity_speedup);
+
+    /**
+     * @brief Sets the request type the pool is built for.
+     *
+     * Requests of any other type (taken from another pool's queue) take
+     * foreign_penalty times longer on every server of the table.
+     *
+     * @param request_type Home request type (0 = none, no penalty).
+     * @param foreign_penalty Service time multiplier for other types.
+     */
+    void set_home_type(char request_type, float foreign_penalty);
+
+    /**
+     * @brief Extends the remaining busy time of a busy server.
+     *
+     * @param slot Slot index of the server.
+     * @param cycles Extra busy cycles.
+     */
+    void stall(size_t slot, int cycles);
+
+    /**
+     * @brief Abandons the server's request and keeps it down while it restarts.
+     *
+     * The held request handle (if any) is not touched; take it first.
+     *
+     * @param slot Slot index of the server.
+     * @param restart_cycles Cycles until the server accepts requests again.
+     */
+    void crash(size_t slot, int restart_cycles);
+
+    /**
+     * @brief Sets the factor applied to the processing time of every request.
+     *
+     * @param slot Slot index of the server.
+     * @param factor Slowdown factor (1 = normal speed).
+     */
+    void set_slowdown(size_t slot, float factor);
+
+    /**
+     * @brief Sets or clears state flags of the server in a slot.
+     *
+     * @param slot Slot index of the server.
+     * @param flag Flags to change (not FLAG_BUSY, which follows the busy time).
+     * @param value Whether the flags are set.
+     */
+    void set_flag(size_t slot, uint8_t flag, bool value);
+
+    /**
+     * @brief Records when the server's current request started.
+     *
+     * @param slot Slot index of the server.
+     * @param cycle Cycle at which the request started.
+     * @param attempt Number of earlier failed attempts of the request.
+     */
+    void set_started(size_t slot, int cycle, int attempt);
+
+    /**
+     * @brief Gives the server in a slot ownership of its active request.
+     *
+     * @param slot Slot index of the server.
+     * @param handle Handle of the request started on the server.
+     */
+    void hold(size_t slot, RequestHandle&& handle);
+
+    /**
+     * @brief Takes the request handle held by the server in a slot.
+     *
+     * @param slot Slot index of the server.
+     * @return The held handle, or an empty handle if none is held.
+     */
+    RequestHandle take_handle(size_t slot);
+
+    /**
+     * @brief Moves the handles of every idle server still holding a request.
+     *
+     * Runs over the idle bitmask and a parallel "holding" bitmask, so only
+     * servers that just finished are visited.
+     *
+     * @param finished Receives the handles of finished requests (appended).
+     */
+    void collect_finished(std::vector<RequestHandle>& finished);
+
+    /**
+     * @brief Marks the server in a slot as finished and idle.
+     *
+     * @param slot Slot index of the server.
+     */
+    void finish(size_t slot);
+
+    /**
+     * @brief Decrements the remaining busy time of one server.
+     *
+     * @param slot Slot index of the server.
+     */
+    void tick_one(size_t slot);
+
+    /**
+     * @brief Advances every server by one clock cycle.
+     *
+     * Remaining busy time is decremented for every busy server and the busy
+     * flag is cleared for servers that finish, using the widest vector kernel
+     * available on the CPU.
+     */
+    void tick();
+
+    /**
+     * @brief Computes a bitmask of idle servers.
+     *
+     * Bit (i % 64) of mask[i / 64] is set when the server in slot i is idle.
+     *
+     * @param mask Receives the bitmask; resized to cover every slot.
+     */
+    void idle_mask(std::vector<uint64_t>& mask) const;
+
+    /**
+     * @brief Finds the first idle server.
+     *
+     * @return Slot index of an idle server, or -1 if every server is busy.
+     */
+    long find_idle() const;
+
+    /**
+     * @brief Counts the idle servers.
+     *
+     * @return Number of servers that are not processing a request.
+     */
+    size_t count_idle() const;
+
+    /**
+     * @brief Returns the number of servers in the table.
+     *
+     * @return Server count.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Returns the unique ID of the server in a slot.
+     */
+    int server_id(size_t slot) const { return server_ids[slot]; }
+
+    /**
+     * @brief Returns the remaining busy time of the server in a slot.
+     */
+    int busy_until_time(size_t slot) const { return busy_until[slot]; }
+
+    /**
+     * @brief Returns the ID of the request active on the server in a slot.
+     */
+    int active_request_id(size_t slot) const { return active_request_ids[slot]; }
+
+    /**
+     * @brief Returns the state flags of the server in a slot.
+     */
+    uint8_t state(size_t slot) const { return flags[slot]; }
+
+    /**
+     * @brief Returns the slowdown factor of the server in a slot.
+     */
+    float slowdown(size_t slot) const { return slowdowns[slot]; }
+
+    /**
+     * @brief Returns the relative speed of the server in a slot.
+     */
+    float speed(size_t slot) const { return speeds[slot]; }
+
+    /**
+     * @brief Returns the relative cost per cycle of the server in a slot.
+     */
+    float cost(size_t slot) const { return costs[slot]; }
+
+    /**
+     * @brief Returns the request type the server in a slot is tuned for (0 = none).
+     */
+    char affinity(size_t slot) const { return affinities[slot]; }
+
+    /**
+     * @brief Returns the extra speed factor for requests of the server's affinity type.
+     */
+    float affinity_speedup(size_t slot) const { return affinity_speedups[slot]; }
+
+    /**
+     * @brief Returns the cycle at which the server's current request started.
+     */
+    int started_at(size_t slot) const { return started[slot]; }
+
+    /**
+     * @brief Returns the number of earlier failed attempts of the current request.
+     */
+    int attempt(size_t slot) const { return attempts[slot]; }
+
+    /**
+     * @brief Returns the request handle held by the server in a slot.
+     */
+    const RequestHandle& handle_at(size_t slot) const { return active_handles[slot]; }
+
+    /**
+     * @brief Returns whether the server in a slot holds a request handle.
+     */
+    bool holds(size_t slot) const { return (holding[slot / 64] >> (slot % 64)) & 1; }
+
+    /**
+     * @brief Writes every column and the server ID counter to a checkpoint.
+     *
+     * The home type and foreign penalty are configuration and not saved.
+     *
+     * @param out Checkpoint being written.
+     */
+    void save(CheckpointWriter& out) const;
+
+    /**
+     * @brief Replaces the table with a checkpointed one.
+     *
+     * @param in Checkpoint being read.
+     * @param arena Restored arena the held request handles are adopted from.
+     * @param restore_ids false to keep the process-wide server ID counter.
+     * @return false if the table section is malformed.
+     */
+    bool restore(CheckpointReader& in, const RequestArena& arena, bool restore_ids = true);
+
+private:
+
+    /**
+     * @brief Static counter used to assign unique server IDs (shared by all threads).
+     */
+    static std::atomic<int> next_id;
+
+    /**
+     * @brief Unique ID of each server.
+     */
+    LargeVector<int> server_ids;
+
+    /**
+     * @brief Remaining busy time of each server (0 when idle).
+     */
+    LargeVector<int32_t> busy_until;
+
+    /**
+     * @brief ID of the request each server is processing (-1 if none yet).
+     */
+    LargeVector<int> active_request_ids;
+
+    /**
+     * @brief State flags (FLAG_BUSY, ...) of each server.
+     */
+    LargeVector<uint8_t> flags;
+
+    /**
+     * @brief Factor applied to the processing time on each server.
+     */
+    LargeVector<float> slowdowns;
+
+    /**
+     * @brief Relative processing speed of each server.
+     */
+    LargeVector<float> speeds;
+
+    /**
+     * @brief Relative cost per cycle of each server.
+     */
+    LargeVector<float> costs;
+
+    /**
+     * @brief Request type each server is tuned for (0 = none).
+     */
+    LargeVector<char> affinities;
+
+    /**
+     * @brief Extra speed factor of each server for its affinity type.
+     */
+    LargeVector<float> affinity_speedups;
+
+    /**
+     * @brief Request type the pool is built for (0 = none).
+     */
+    char home_type = 0;
+
+    /**
+     * @brief Service time multiplier for requests of other types.
+     */
+    float foreign_penalty = 1.0f;
+
+    /**
+     * @brief Cycle at which each server's current request started.
+     */
+    LargeVector<int> started;
+
+    /**
+     * @brief Earlier failed attempts of each server's current request.
+     */
+    LargeVector<uint8_t> attempts;
+
+    /**
+     * @brief Handle of the request each server owns (empty if none).
+     */
+    LargeVector<RequestHandle> active_handles;
+
+    /**
+     * @brief Bit i set when active_handles[i] is valid.
+     */
+    LargeVector<uint64_t> holding;
+
+    /**
+     * @brief Sets or clears the holding bit of a slot.
+     */
+    void set_holding(size_t slot, bool value);
+};
+
+#endif
@@ -0,0 +1,337 @@
+/**
+ * @file shm_ring.cpp
+ * @brief Implements the ShmRing shared-memory request ring.
+ *
+ * This file contains the shared-memory setup, the bounded MPSC slot protocol
+ * and the futex-based sleep / wake logic for producers and the consumer.
+ */
+
+#include "shm_ring.h"
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <linux/futex.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * @brief Marks a mapping initialized by ShmRing::create().
+ */
+const uint64_t RING_MAGIC = 0x4C42524551524E47ull; // "LBREQRNG"
+
+/**
+ * @brief Layout version; bumped when ShmSlot or ShmRingHeader change.
+ */
+const uint32_t RING_VERSION = 1;
+
+/**
+ * @brief Sleeps while *word == expected (shared futex, works across processes).
+ *
+ * @return 0 when woken, -1 on timeout, mismatch or interruption.
+ */
+int futex_wait(std::atomic<uint32_t>* word, uint32_t expected, int timeout_ms) {
+    timespec timeout{};
+    timespec* timeout_ptr = nullptr;
+    if (timeout_ms >= 0) {
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_nsec = static_cast<long>(timeout_ms % 1000) * 1000000L;
+        timeout_ptr = &timeout;
+    }
+    return static_cast<int>(syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, timeout_ptr, nullptr, 0));
+}
+
+/**
+ * @brief Wakes up to count threads sleeping on word.
+ */
+void futex_wake(std::atomic<uint32_t>* word, int count) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, count, nullptr, nullptr, 0);
+}
+
+/**
+ * @brief Size of the mapping needed for a ring of the given capacity.
+ */
+size_t mapping_size_for(uint32_t capacity) {
+    return sizeof(ShmRingHeader) + static_cast<size_t>(capacity) * sizeof(ShmSlot);
+}
+
+} // namespace
+
+/**
+ * @brief Creates (or re-initializes) a ring as its consumer.
+ *
+ * Any stale object with the same name is replaced. Every slot's sequence is
+ * set to its own position so that all slots start out free.
+ *
+ * @param name Shared-memory object name, e.g. "/lb_requests".
+ * @param capacity Requested number of slots, rounded up to a power of two.
+ * @return The ring, or nullptr if the object could not be created.
+ */
+std::unique_ptr<ShmRing> ShmRing::create(const std::string& name, uint32_t capacity) {
+    uint32_t slots = 2;
+    while (slots < capacity && slots < (1u << 30)) {
+        slots <<= 1;
+    }
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        std::cerr << "shm_open(" << name << ") failed: " << std::strerror(errno) << std::endl;
+        return nullptr;
+    }
+    size_t size = mapping_size_for(slots);
+    if (ftruncate(fd, static_cast<off_t>(size)) < 0) {
+        std::cerr << "ftruncate(" << name << ") failed: " << std::strerror(errno) << std::endl;
+        close(fd);
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "mmap(" << name << ") failed: " << std::strerror(errno) << std::endl;
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    ShmRingHeader* header = new (mapping) ShmRingHeader();
+    header->capacity = slots;
+    header->version = RING_VERSION;
+    header->tail.store(0);
+    header->head.store(0);
+    header->data_futex.store(0);
+    header->consumer_waiting.store(0);
+    header->space_futex.store(0);
+    header->producers_waiting.store(0);
+    ShmSlot* slot_array = reinterpret_cast<ShmSlot*>(header + 1);
+    for (uint32_t i = 0; i < slots; ++i) {
+        new (&slot_array[i]) ShmSlot();
+        slot_array[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = RING_MAGIC;
+    return std::unique_ptr<ShmRing>(new ShmRing(name, mapping, size, true));
+}
+
+/**
+ * @brief Attaches to an existing ring as a producer.
+ *
+ * @param name Shared-memory object name used by the consumer.
+ * @return The ring, or nullptr if it does not exist or is not a ring.
+ */
+std::unique_ptr<ShmRing> ShmRing::attach(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        std::cerr << "shm_open(" << name << ") failed: " << std::strerror(errno) << std::endl;
+        return nullptr;
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(ShmRingHeader)) {
+        close(fd);
+        return nullptr;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+    ShmRingHeader* header = static_cast<ShmRingHeader*>(mapping);
+    if (header->magic != RING_MAGIC || header->version != RING_VERSION || mapping_size_for(header->capacity) > size) {
+        std::cerr << name << " is not a request ring of version " << RING_VERSION << std::endl;
+        munmap(mapping, size);
+        return nullptr;
+    }
+    return std::unique_ptr<ShmRing>(new ShmRing(name, mapping, size, false));
+}
+
+/**
+ * @brief Wraps an existing mapping.
+ *
+ * @param name Shared-memory object name.
+ * @param mapping Start of the mapping.
+ * @param mapping_size Length of the mapping.
+ * @param owner Whether this process created the ring.
+ */
+ShmRing::ShmRing(const std::string& name, void* mapping, size_t mapping_size, bool owner)
+    : name(name), mapping(mapping), mapping_size(mapping_size), owner(owner),
+      header(static_cast<ShmRingHeader*>(mapping)), slots(reinterpret_cast<ShmSlot*>(header + 1)),
+      mask(header->capacity - 1) {}
+
+/**
+ * @brief Unmaps the ring; the creator also unlinks the shared object.
+ */
+ShmRing::~ShmRing() {
+    munmap(mapping, mapping_size);
+    if (owner) {
+        shm_unlink(name.c_str());
+    }
+}
+
+/**
+ * @brief Publishes a request if a slot is free.
+ *
+ * A producer claims position p by advancing the tail with a CAS once the slot
+ * for p is free (sequence == p), writes the payload, and publishes it by
+ * storing sequence = p + 1. The consumer is woken only if it is asleep.
+ *
+ * @return true if the request was written, false if the ring is full.
+ */
+bool ShmRing::try_push(uint32_t ip_in, uint32_t ip_out, uint16_t time_to_process, char request_type) {
+    uint64_t position = header->tail.load(std::memory_order_relaxed);
+    ShmSlot* slot;
+    while (true) {
+        slot = &slots[position & mask];
+        uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+        int32_t difference = static_cast<int32_t>(sequence - static_cast<uint32_t>(position));
+        if (difference == 0) {
+            if (header->tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            return false;
+        } else {
+            position = header->tail.load(std::memory_order_relaxed);
+        }
+    }
+    slot->ip_in = ip_in;
+    slot->ip_out = ip_out;
+    slot->time_to_process = time_to_process;
+    slot->request_type = request_type;
+    slot->sequence.store(static_cast<uint32_t>(position + 1), std::memory_order_release);
+
+    // a release store does not order the load below; without the fence the load can
+    // pass the publish and miss a consumer that is about to sleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (header->consumer_waiting.load(std::memory_order_seq_cst)) {
+        header->data_futex.fetch_add(1, std::memory_order_seq_cst);
+        futex_wake(&header->data_futex, 1);
+    }
+    return true;
+}
+
+/**
+ * @brief Publishes a request, sleeping on a futex while the ring is full.
+ *
+ * The producer registers itself as waiting, re-checks for space, and only
+ * then sleeps, so a release_batch() between the check and the sleep changes
+ * the futex word and prevents a lost wake-up.
+ *
+ * @param timeout_ms Maximum time to wait for space per attempt, or -1 to wait forever.
+ * @return true if the request was written, false on timeout.
+ */
+bool ShmRing::push(uint32_t ip_in, uint32_t ip_out, uint16_t time_to_process, char request_type, int timeout_ms) {
+    while (!try_push(ip_in, ip_out, time_to_process, request_type)) {
+        header->producers_waiting.fetch_add(1, std::memory_order_seq_cst);
+        uint32_t observed = header->space_futex.load(std::memory_order_seq_cst);
+        bool full = size_approx() >= header->capacity;
+        int result = full ? futex_wait(&header->space_futex, observed, timeout_ms) : 0;
+        header->producers_waiting.fetch_sub(1, std::memory_order_seq_cst);
+        if (result < 0 && errno == ETIMEDOUT) {
+            return try_push(ip_in, ip_out, time_to_process, request_type);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Returns a contiguous run of published slots without copying.
+ *
+ * @param first Receives a pointer to the first readable slot.
+ * @param max Maximum number of slots to return.
+ * @return Number of readable slots starting at first.
+ */
+size_t ShmRing::acquire_batch(const ShmSlot*& first, size_t max) {
+    uint64_t head = header->head.load(std::memory_order_relaxed);
+    size_t until_wrap = header->capacity - (head & mask);
+    if (max > until_wrap) {
+        max = until_wrap;
+    }
+    first = &slots[head & mask];
+    size_t count = 0;
+    while (count < max &&
+           first[count].sequence.load(std::memory_order_acquire) == static_cast<uint32_t>(head + count + 1)) {
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Returns slots obtained from acquire_batch() to the producers.
+ *
+ * Each slot's sequence is advanced by one lap (position + capacity) so it is
+ * free for the producer that will claim it next.
+ *
+ * @param count Number of slots consumed.
+ */
+void ShmRing::release_batch(size_t count) {
+    if (count == 0) {
+        return;
+    }
+    uint64_t head = header->head.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i) {
+        slots[(head + i) & mask].sequence.store(static_cast<uint32_t>(head + i + header->capacity), std::memory_order_release);
+    }
+    header->head.store(head + count, std::memory_order_release);
+    // order the head store before the waiting check (see try_push)
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (header->producers_waiting.load(std::memory_order_seq_cst) > 0) {
+        header->space_futex.fetch_add(1, std::memory_order_seq_cst);
+        futex_wake(&header->space_futex, INT_MAX);
+    }
+}
+
+/**
+ * @brief Sleeps until a producer publishes data or the timeout expires.
+ *
+ * @param timeout_ms Maximum time to wait.
+ * @return true if data is available, false on timeout.
+ */
+bool ShmRing::wait_for_data(int timeout_ms) {
+    if (has_data()) {
+        return true;
+    }
+    header->consumer_waiting.store(1, std::memory_order_seq_cst);
+    uint32_t observed = header->data_futex.load(std::memory_order_seq_cst);
+    if (!has_data()) {
+        futex_wait(&header->data_futex, observed, timeout_ms);
+    }
+    header->consumer_waiting.store(0, std::memory_order_seq_cst);
+    return has_data();
+}
+
+/**
+ * @brief Returns the approximate number of published or claimed slots.
+ *
+ * @return tail - head at the time of the call.
+ */
+size_t ShmRing::size_approx() const {
+    uint64_t tail = header->tail.load(std::memory_order_acquire);
+    uint64_t head = header->head.load(std::memory_order_acquire);
+    return static_cast<size_t>(tail - head);
+}
+
+/**
+ * @brief Returns the number of slots in the ring.
+ *
+ * @return Ring capacity.
+ */
+uint32_t ShmRing::capacity() const {
+    return header->capacity;
+}
+
+/**
+ * @brief Whether the consumer's next slot is published.
+ *
+ * @return true if acquire_batch() would return at least one slot.
+ */
+bool ShmRing::has_data() const {
+    uint64_t head = header->head.load(std::memory_order_relaxed);
+    return slots[head & mask].sequence.load(std::memory_order_seq_cst) == static_cast<uint32_t>(head + 1);
+}
@@ -0,0 +1,193 @@
+/**
+ * @file shm_ring.h
+ * @brief Declares the ShmRing shared-memory request ring.
+ *
+ * This header defines a bounded multi-producer / single-consumer ring that
+ * lives in a POSIX shared-memory object (shm_open + mmap). External processes
+ * write packed requests into it and the simulator drains them in place.
+ * Blocked producers and an idle consumer sleep on futexes in the shared
+ * mapping instead of spinning.
+ */
+
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * @struct ShmSlot
+ * @brief One 16-byte ring entry holding a packed request.
+ *
+ * The sequence field implements the bounded-queue protocol: a slot at ring
+ * position p is free for producers when sequence == p and readable by the
+ * consumer when sequence == p + 1.
+ */
+struct ShmSlot {
+    std::atomic<uint32_t> sequence; ///< Publication state of the slot.
+    uint32_t ip_in;                 ///< Source IPv4 address in integer form.
+    uint32_t ip_out;                ///< Destination IPv4 address in integer form.
+    uint16_t time_to_process;       ///< Processing time in clock cycles.
+    char request_type;              ///< 'P' (processing) or 'S' (streaming).
+    uint8_t reserved;               ///< Unused, keeps the slot at 16 bytes.
+};
+
+/**
+ * @struct ShmRingHeader
+ * @brief Control block at the start of the shared mapping.
+ *
+ * Producer and consumer cursors sit on separate cache lines to avoid false
+ * sharing between processes.
+ */
+struct ShmRingHeader {
+    uint64_t magic;                                    ///< Identifies an initialized ring.
+    uint32_t version;                                  ///< Layout version.
+    uint32_t capacity;                                 ///< Number of slots (power of two).
+    alignas(64) std::atomic<uint64_t> tail;            ///< Next position claimed by producers.
+    alignas(64) std::atomic<uint64_t> head;            ///< Next position read by the consumer.
+    alignas(64) std::atomic<uint32_t> data_futex;      ///< Bumped to wake a waiting consumer.
+    std::atomic<uint32_t> consumer_waiting;            ///< Non-zero while the consumer sleeps.
+    alignas(64) std::atomic<uint32_t> space_futex;     ///< Bumped to wake waiting producers.
+    std::atomic<uint32_t> producers_waiting;           ///< Number of sleeping producers.
+};
+
+/**
+ * @class ShmRing
+ * @brief Bounded MPSC ring of packed requests in POSIX shared memory.
+ *
+ * The consumer (the simulator) creates the ring; producers attach to it by
+ * name. Producers claim positions with a compare-and-swap on the tail, so any
+ * number of producer threads or processes may write concurrently. The consumer
+ * reads published slots directly from the mapping (acquire_batch) and hands
+ * them back (release_batch), so requests are never copied out of the ring.
+ */
+class ShmRing {
+public:
+
+    /**
+     * @brief Creates (or re-initializes) a ring as its consumer.
+     *
+     * @param name Shared-memory object name, e.g. "/lb_requests".
+     * @param capacity Requested number of slots, rounded up to a power of two.
+     * @return The ring, or nullptr if the object could not be created.
+     */
+    static std::unique_ptr<ShmRing> create(const std::string& name, uint32_t capacity);
+
+    /**
+     * @brief Attaches to an existing ring as a producer.
+     *
+     * @param name Shared-memory object name used by the consumer.
+     * @return The ring, or nullptr if it does not exist or is not a ring.
+     */
+    static std::unique_ptr<ShmRing> attach(const std::string& name);
+
+    /**
+     * @brief Unmaps the ring; the creator also unlinks the shared object.
+     */
+    ~ShmRing();
+
+    ShmRing(const ShmRing&) = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+
+    /**
+     * @brief Publishes a request if a slot is free.
+     *
+     * @return true if the request was written, false if the ring is full.
+     */
+    bool try_push(uint32_t ip_in, uint32_t ip_out, uint16_t time_to_process, char request_type);
+
+    /**
+     * @brief Publishes a request, sleeping on a futex while the ring is full.
+     *
+     * @param timeout_ms Maximum time to wait for space, or -1 to wait forever.
+     * @return true if the request was written, false on timeout.
+     */
+    bool push(uint32_t ip_in, uint32_t ip_out, uint16_t time_to_process, char request_type, int timeout_ms = -1);
+
+    /**
+     * @brief Returns a contiguous run of published slots without copying.
+     *
+     * The run stops at the first unpublished slot, at the end of the slot
+     * array, or after max slots. The slots stay valid until release_batch().
+     *
+     * @param first Receives a pointer to the first readable slot.
+     * @param max Maximum number of slots to return.
+     * @return Number of readable slots starting at first.
+     */
+    size_t acquire_batch(const ShmSlot*& first, size_t max);
+
+    /**
+     * @brief Returns slots obtained from acquire_batch() to the producers.
+     *
+     * Wakes producers that are waiting for space.
+     *
+     * @param count Number of slots consumed (at most the acquired count).
+     */
+    void release_batch(size_t count);
+
+    /**
+     * @brief Sleeps until a producer publishes data or the timeout expires.
+     *
+     * @param timeout_ms Maximum time to wait.
+     * @return true if data is available, false on timeout.
+     */
+    bool wait_for_data(int timeout_ms);
+
+    /**
+     * @brief Returns the approximate number of published or claimed slots.
+     *
+     * @return tail - head at the time of the call.
+     */
+    size_t size_approx() const;
+
+    /**
+     * @brief Returns the number of slots in the ring.
+     *
+     * @return Ring capacity.
+     */
+    uint32_t capacity() const;
+
+private:
+
+    /**
+     * @brief Wraps an existing mapping.
+     */
+    ShmRing(const std::string& name, void* mapping, size_t mapping_size, bool owner);
+
+    /**
+     * @brief Whether the consumer's next slot is published.
+     */
+    bool has_data() const;
+
+    /**
+     * @brief Shared-memory object name.
+     */
+    std::string name;
+
+    /**
+     * @brief Start and length of the mapping.
+     */
+    void* mapping;
+    size_t mapping_size;
+
+    /**
+     * @brief Whether this process created the ring (and unlinks it).
+     */
+    bool owner;
+
+    /**
+     * @brief Control block and slot array inside the mapping.
+     */
+    ShmRingHeader* header;
+    ShmSlot* slots;
+
+    /**
+     * @brief capacity - 1, used to map positions to slots.
+     */
+    uint64_t mask;
+};
+
+#endif
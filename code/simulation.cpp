@@ -0,0 +1,1690 @@
+/**
+ * @file simulation.cpp
+ * @brief Implements the Simulation class.
+ *
+ * The loop mirrors the original single-run simulation in main.cpp; all
+ * state, including the random number generator, belongs to the instance.
+ */
+
+#include "simulation.h"
+#include "alloc_counter.h"
+#include "large_alloc.h"
+#include "profiler.h"
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <utility>
+
+// color codes
+#define RED     "\033[31m"
+#define GREEN   "\033[32m"
+#define YELLOW  "\033[33m"
+#define BLUE    "\033[34m"
+#define RESET   "\033[0m"
+
+namespace {
+
+
+/**
+ * @brief Server kinds of a heterogeneous fleet.
+ *
+ * A fast server does twice the work per cycle for 2.5 times the price; a
+ * cheap one runs at 60% speed for half the price.
+ */
+const ServerProfile STANDARD_PROFILE;
+const ServerProfile FAST_PROFILE = {"fast", 2.0f, 2.5f, 0, 1.0f};
+const ServerProfile CHEAP_PROFILE = {"cheap", 0.6f, 0.5f, 0, 1.0f};
+
+/**
+ * @brief Builds the streaming and processing classes from the two-pool parameters.
+ *
+ * @param params Parameters of the run.
+ * @return Traffic classes of a run without an explicit pool list.
+ */
+std::vector<PoolConfig> default_pools(const SimulationParams& params) {
+    std::vector<PoolConfig> configs(2);
+    configs[0].request_type = 'S';
+    configs[0].initial_servers = params.streaming_servers;
+    configs[0].share = params.streaming_share;
+    configs[1].request_type = 'P';
+    configs[1].initial_servers = params.processing_servers;
+    configs[1].share = 1.0 - params.streaming_share;
+    for (int bound = 0; bound < 2; ++bound) {
+        configs[0].time_range[bound] = params.streaming_time[bound];
+        configs[1].time_range[bound] = params.processing_time[bound];
+    }
+    for (PoolConfig& config : configs) {
+        config.name = pool_name(config.request_type);
+    }
+    return configs;
+}
+
+/**
+ * @brief Columns of the per-cycle metrics; each pool adds METRIC_POOL_COLUMNS more.
+ */
+enum MetricColumn : size_t {
+    METRIC_CYCLE,        ///< Clock cycle.
+    METRIC_ARRIVALS,     ///< Requests that arrived (queued or blocked).
+    METRIC_BLOCKED,      ///< Requests blocked by the firewall.
+    METRIC_ASSIGNED,     ///< Requests assigned to a server or served from the cache.
+    METRIC_POOL_FIRST    ///< First per-pool column.
+};
+
+/**
+ * @brief Per-pool metric columns, in order: queue depth, servers, idle servers, scale events.
+ */
+const size_t METRIC_POOL_COLUMNS = 4;
+
+/**
+ * @brief Applies visit to every counter a run accumulates cycle by cycle.
+ *
+ * The same list is used to save and to restore the counters, so the two
+ * cannot drift apart.
+ *
+ * @param result Counters (const when saving).
+ * @param visit Function called with a reference to each counter.
+ */
+template <class Result, class Visit>
+void visit_counters(Result& result, Visit visit) {
+    visit(result.requests_generated);
+    visit(result.requests_served);
+    visit(result.requests_blocked);
+    visit(result.servers_created);
+    visit(result.servers_removed);
+    visit(result.server_cycles);
+    visit(result.cache_saved_cycles);
+    visit(result.requests_completed);
+    visit(result.server_cost);
+    visit(result.fast_servers_added);
+    visit(result.cheap_servers_added);
+    visit(result.requests_stolen);
+    visit(result.preemptions);
+    visit(result.auto_blocks);
+    visit(result.requests_auto_blocked);
+}
+
+} // namespace
+
+/**
+ * @brief Creates the pools, initial servers and optional response cache.
+ *
+ * @param params Parameters of the run.
+ * @param firewall Firewall applied to every request (shared, read-only).
+ * @param log Stream receiving the periodic and final log, or nullptr.
+ */
+Simulation::Simulation(const SimulationParams& params, const Firewall& firewall, std::ostream* log)
+    : params(params), firewall(firewall), null_log(nullptr), logFile(log ? *log : null_log),
+      rng(params.seed), ring(nullptr), link(nullptr), attack_prefix(0), latency_sum(0), short_latency_sum(0), time_to_add_requests(0),
+      requests_per_clock(0), restored(false), clock(0) {
+    logFile << "Firewall initialized (batch classification kernel: " << Firewall::batch_kernel_name() << ")." << std::endl;
+    double total_share = 0.0;
+    for (const PoolConfig& config : traffic_classes(params)) {
+        if (pools.add(config, arena) == PoolRegistry<SimulationPool>::NO_POOL) {
+            logFile << "Request type " << config.request_type << " already has a pool; duplicate ignored." << std::endl;
+            continue;
+        }
+        total_share += config.share;
+        cumulative_share.push_back(total_share);
+    }
+    for (double& bound : cumulative_share) {
+        bound = total_share > 0.0 ? bound / total_share : 1.0;
+    }
+    for (size_t index = 0; index < pools.size(); ++index) {
+        SimulationPool& pool = pools[index];
+        pool.queue.set_thresholds(params.low_load, params.high_load);
+        pool.servers.set_verbose(params.verbose);
+        pool.servers.set_hedging(params.hedging);
+        pool.servers.set_dispatch_policy(params.dispatch);
+        pool.servers.set_time_slice(params.time_slice);
+        if (params.coalesce_max > 1) {
+            pool.queue.set_coalescing(static_cast<size_t>(params.coalesce_window), static_cast<size_t>(params.coalesce_max));
+            pool.servers.set_batch_setup(params.batch_setup);
+        }
+        pool.servers.set_network(params.network);
+        if (params.work_stealing) {
+            pool.servers.set_home_type(pool.config.request_type, static_cast<float>(params.steal_penalty));
+        }
+        if (params.faults.enabled()) {
+            pool.servers.set_fault_injection(params.faults, params.seed + 1 + static_cast<uint32_t>(index));
+        }
+        if (params.queue_budget > 0) {
+            SpillHooks hooks;
+            hooks.pack = [this](const RequestHandle& request) { return pack_slot(request); };
+            hooks.unpack = [this](const RequestHandle& request, uint64_t tag) { unpack_slot(request, tag); };
+            if (!pool.queue.enable_spill(arena, params.queue_budget, params.spill_dir, hooks)) {
+                std::cerr << RED << "Could not create a spill file in " << params.spill_dir << "; the "
+                          << pool.config.name << " queue stays in memory." << RESET << std::endl;
+            }
+        }
+    }
+    if (params.queue_budget > 0) {
+        logFile << "Queue budget: " << params.queue_budget << " requests per pool in memory, backlog spilled to "
+                << params.spill_dir << "." << std::endl;
+    }
+    if (params.faults.enabled()) {
+        logFile << "Fault injection: stall probability " << params.faults.stall_probability << " (" << params.faults.stall_cycles
+                << " cycles), crash probability " << params.faults.crash_probability << " per cycle (restart "
+                << params.faults.restart_cycles << " cycles), slow nodes " << params.faults.slow_fraction * 100.0
+                << "% at x" << params.faults.slow_multiplier << "." << std::endl;
+    }
+    if (params.coalesce_max > 1) {
+        logFile << "Coalescing up to " << params.coalesce_max << " requests for the same backend from the first "
+                << params.coalesce_window << " queued, " << params.batch_setup << " setup cycles per call." << std::endl;
+    }
+    if (params.hedging.hedge_after > 0 || params.hedging.max_retries > 0) {
+        logFile << "Hedging after " << params.hedging.hedge_after << " cycles (0 = off), up to "
+                << params.hedging.max_retries << " retries after a crash." << std::endl;
+    }
+    logFile << "Load balancers initialized (scale down below " << params.low_load << " and up above "
+            << params.high_load << " queued requests per server, checked every "
+            << params.check_server_count_buffer << " cycles)." << std::endl;
+
+    for (size_t index = 0; index < pools.size(); ++index) {
+        SimulationPool& pool = pools[index];
+        int initial_servers = pool.config.initial_servers;
+        int fast = static_cast<int>(std::lround(params.fast_share * initial_servers));
+        int cheap = static_cast<int>(std::lround(params.cheap_share * initial_servers));
+        for (int i = 0; i < initial_servers; ++i) {
+            const ServerProfile& kind = i < fast ? FAST_PROFILE : i < fast + cheap ? CHEAP_PROFILE : STANDARD_PROFILE;
+            pool.servers.add_server(pool_profile(pool, kind));
+        }
+        result.servers_created += initial_servers;
+    }
+    logFile << "Server handlers initialized (" << pools.size() << " pools, "
+            << (params.dispatch == DispatchPolicy::EARLIEST_COMPLETION ? "shortest expected completion" : "first idle")
+            << " dispatch";
+    if (params.fast_share > 0.0 || params.cheap_share > 0.0) {
+        logFile << ", " << params.fast_share * 100.0 << "% fast and " << params.cheap_share * 100.0 << "% cheap servers";
+    }
+    if (params.fast_backlog > 0.0) {
+        logFile << ", scaling adds fast servers above " << params.fast_backlog << " queued requests per server";
+    }
+    logFile << ")" << std::endl;
+
+    backends.resize(params.backends > 0 ? params.backends : 0);
+    for (auto& backend : backends) {
+        backend = generate_random_ip();
+    }
+    if (!backends.empty()) {
+        logFile << "Destination IPs drawn from " << backends.size() << " backend addresses." << std::endl;
+    }
+    if (params.attack_share > 0.0) {
+        attack_prefix = generate_random_ip() & 0xFFFFFF00u;
+        logFile << params.attack_share * 100.0 << "% of requests sent by " << params.attackers << " attacking sources in "
+                << Request::format_ip(attack_prefix) << "/24." << std::endl;
+    }
+    if (params.heavy_hitters.enabled()) {
+        detector.reset(new HeavyHitterDetector(params.heavy_hitters));
+        logFile << "Heavy-hitter detection: blocking sources above " << params.heavy_hitters.share * 100.0
+                << "% of the requests in a " << params.heavy_hitters.window << "-cycle window for "
+                << params.heavy_hitters.block_cycles << " cycles (" << detector->memory_bytes() / 1024 << " KiB)." << std::endl;
+    }
+
+    if (params.cache != "off") {
+        CachePolicy policy;
+        if (ResponseCache::parse_policy(params.cache, policy)) {
+            cache.reset(new ResponseCache(policy, params.cache_capacity));
+            logFile << "Response cache initialized (" << ResponseCache::policy_name(policy)
+                    << ", capacity " << params.cache_capacity << ")." << std::endl;
+        } else if (params.verbose) {
+            std::cout << YELLOW << "Unknown cache policy '" << params.cache << "', cache disabled." << RESET << std::endl;
+        }
+    }
+
+    if (!params.trace_path.empty()) {
+        tracer.reset(new RequestTracer(params.trace_sample, params.trace_capacity));
+        logFile << "Tracing " << params.trace_sample * 100.0 << "% of requests (up to " << params.trace_capacity
+                << " events) to " << params.trace_path << "." << std::endl;
+    }
+
+    if (!params.metrics_path.empty() || !params.metrics_csv_path.empty()) {
+        std::vector<std::string> columns = {"cycle", "arrivals", "blocked", "assigned"};
+        for (size_t index = 0; index < pools.size(); ++index) {
+            const std::string& name = pools[index].config.name;
+            for (const char* metric : {"_queue", "_servers", "_idle", "_scale"}) {
+                columns.push_back(name + metric);
+            }
+        }
+        metrics.reset(new MetricsRecorder(columns));
+        if (metrics->open(params.metrics_path, params.metrics_csv_path)) {
+            scale_events.assign(pools.size(), 0);
+            logFile << "Recording per-cycle metrics (" << columns.size() << " columns) to "
+                    << (params.metrics_path.empty() ? params.metrics_csv_path : params.metrics_path) << "." << std::endl;
+        } else {
+            std::cerr << RED << "Could not open the metrics output; metrics disabled." << RESET << std::endl;
+            metrics.reset();
+        }
+    }
+}
+
+/**
+ * @brief Takes requests from a shared-memory ring instead of generating them.
+ *
+ * @param ring Ring written by external producers.
+ */
+void Simulation::set_source(ShmRing* ring) {
+    this->ring = ring;
+}
+
+/**
+ * @brief Takes each cycle's requests from a topology's distributor instead of generating them.
+ *
+ * @param link Link to the distributor.
+ */
+void Simulation::set_link(InstanceLink* link) {
+    this->link = link;
+}
+
+/**
+ * @brief Runs the simulation for the configured number of cycles.
+ *
+ * Without a shared-memory source the load balancers start with
+ * initial_requests_per_server (100 by default) queued requests per initial
+ * server.
+ *
+ * @return Measurements of the run.
+ */
+SimulationResult Simulation::run() {
+    // requests from the shared-memory ring or a distributor (or a restored checkpoint) replace the generated initial queue
+    int initial_servers = 0;
+    for (size_t index = 0; index < pools.size(); ++index) {
+        initial_servers += pools[index].config.initial_servers;
+    }
+    int initial_request_count = ring || link || restored ? 0 : initial_servers * params.initial_requests_per_server;
+    if (restored) {
+        logFile << "Resuming from a checkpoint at clock cycle " << clock << "." << std::endl;
+    } else {
+        logFile << "Initial request queue size: " << initial_request_count << "." << std::endl;
+    }
+    for (size_t index = 0; index < pools.size(); ++index) {
+        const PoolConfig& config = pools[index].config;
+        logFile << config.name << " requests ('" << config.request_type << "', "
+                << (cumulative_share[index] - (index > 0 ? cumulative_share[index - 1] : 0.0)) * 100.0
+                << "% of generated traffic) take " << config.time_range[0] << " to " << config.time_range[1]
+                << " clock cycles to process" << std::endl;
+    }
+    logFile << "Starting simulation..." << std::endl;
+
+    if (!restored) {
+        generate_burst(initial_request_count);
+        result.requests_generated += route_burst();
+        time_to_add_requests = generate_burst_interval();
+        requests_per_clock = generate_random_request_count();
+    }
+    std::poisson_distribution<int> poisson(mean_arrival_rate());
+    int checkpoint_at = params.checkpoint_at > 0 ? params.checkpoint_at : params.cycles;
+    if (metrics) {
+        metrics->prime(METRIC_ARRIVALS, result.requests_generated + result.requests_blocked);
+        metrics->prime(METRIC_BLOCKED, result.requests_blocked);
+        metrics->prime(METRIC_ASSIGNED, result.requests_served);
+    }
+
+    while (clock < params.cycles) {
+        // step 1: add new requests to the load balancers
+        {
+            PROFILE_SCOPE(ProfilePhase::STEP_GENERATE);
+            if (ring) {
+                // sleep on the ring's futex instead of spinning when there is nothing to do
+                bool idle = true;
+                for (size_t index = 0; index < pools.size() && idle; ++index) {
+                    const SimulationPool& pool = pools[index];
+                    idle = pool.queue.is_empty() && pool.servers.get_idle_server_count() == pool.servers.get_server_count();
+                }
+                if (idle) {
+                    ring->wait_for_data(100);
+                }
+                ingest_from_ring();
+                result.requests_generated += route_burst();
+            } else if (link) {
+                ingest_from_link();
+                result.requests_generated += route_burst();
+            } else if (params.poisson_arrivals) {
+                generate_burst(poisson(rng));
+                result.requests_generated += route_burst();
+            } else if (time_to_add_requests <= 0) {
+                generate_burst(requests_per_clock);
+                result.requests_generated += route_burst();
+                time_to_add_requests = generate_burst_interval();
+                requests_per_clock = generate_random_request_count();
+            }
+        }
+
+        // step 2: check each server's busy time and update it
+        {
+            PROFILE_SCOPE(ProfilePhase::STEP_UPDATE);
+            for (size_t index = 0; index < pools.size(); ++index) {
+                ServerHandler& servers = pools[index].servers;
+                servers.update_servers();
+                for (uint32_t slot : servers.get_completed()) {
+                    record_completed(slot);
+                    if (tracer) {
+                        tracer->complete(clock, slot);
+                    }
+                }
+                // time-sliced requests with work left rejoin the tail of their own pool's queue
+                for (RequestHandle& handle : servers.get_preempted()) {
+                    const Request& request = arena.get(handle);
+                    int home = pools.route(request.get_request_type());
+                    home = home == PoolRegistry<SimulationPool>::NO_POOL ? static_cast<int>(index) : home;
+                    trace(TraceEvent::PREEMPT, request);
+                    trace(TraceEvent::ENQUEUE, request, home);
+                    pools[home].queue.queue_request(std::move(handle));
+                    result.preemptions++;
+                }
+                servers.get_preempted().clear();
+            }
+        }
+
+        // step 3: check if there are any open servers and assign requests to them
+        {
+            PROFILE_SCOPE(ProfilePhase::STEP_ASSIGN);
+            for (size_t index = 0; index < pools.size(); ++index) {
+                dispatch(pools[index]);
+            }
+            if (params.work_stealing && pools.size() > 1) {
+                for (size_t index = 0; index < pools.size(); ++index) {
+                    steal(pools[index]);
+                }
+            }
+        }
+
+        // step 4: check load balancer and scale up or down servers only every check_server_count_buffer clocks
+        {
+            PROFILE_SCOPE(ProfilePhase::STEP_SCALE);
+            if (params.check_server_count_buffer > 0 && clock % params.check_server_count_buffer == 0) {
+                for (size_t index = 0; index < pools.size(); ++index) {
+                    int servers = pools[index].servers.get_server_count();
+                    scale(pools[index]);
+                    if (metrics) {
+                        scale_events[index] = pools[index].servers.get_server_count() - servers;
+                    }
+                }
+            }
+        }
+
+        // step 5: increment clock
+        {
+            PROFILE_SCOPE(ProfilePhase::STEP_LOG);
+            for (size_t index = 0; index < pools.size(); ++index) {
+                result.server_cycles += pools[index].servers.get_server_count();
+                result.server_cost += pools[index].servers.get_cost_rate();
+            }
+            if (metrics) {
+                record_metrics();
+            }
+            clock++;
+            time_to_add_requests--;
+            if (link && clock % params.load_report_interval == 0) {
+                report_load();
+            }
+            if (params.verbose) {
+                std::cout << BLUE << "Clock: " << clock << RESET << std::endl;
+            }
+            if (clock % 50 == 0) {
+                log_progress();
+            }
+            if (memory_report_requested()) {
+                std::cout << "Clock " << clock << ": ";
+                memory_report(std::cout);
+                logFile << "Clock " << clock << ": ";
+                large_alloc_report(std::cout);
+                memory_report(logFile);
+                large_alloc_report(logFile);
+            }
+        }
+
+        if (!params.checkpoint_path.empty() && clock == checkpoint_at) {
+            if (write_checkpoint(params.checkpoint_path, firewall, *this)) {
+                logFile << "Checkpoint written to " << params.checkpoint_path << " at clock cycle " << clock << "." << std::endl;
+            } else {
+                std::cerr << RED << "Could not write checkpoint " << params.checkpoint_path << "." << RESET << std::endl;
+            }
+        }
+    }
+
+    result.cycles = clock;
+    for (size_t index = 0; index < pools.size(); ++index) {
+        const SimulationPool& pool = pools[index];
+        PoolResult pool_result;
+        pool_result.name = pool.config.name;
+        pool_result.request_type = pool.config.request_type;
+        pool_result.final_servers = pool.servers.get_server_count();
+        pool_result.final_queue = pool.queue.get_queue_size();
+        pool_result.served = pool.served;
+        pool_result.mean_wait = pool.served > 0 ? static_cast<double>(pool.wait_sum) / pool.served : 0.0;
+        pool_result.stolen = pool.stolen;
+        pool_result.given = pool.given;
+        pool_result.spill_writes = pool.queue.get_spill_writes();
+        pool_result.peak_spilled = pool.queue.get_peak_spilled();
+        result.pools.push_back(pool_result);
+    }
+    // the two-pool fields report the streaming and processing classes when they exist
+    int streaming = pools.route('S');
+    int processing = pools.route('P');
+    if (streaming != PoolRegistry<SimulationPool>::NO_POOL) {
+        result.final_streaming_servers = result.pools[streaming].final_servers;
+        result.final_streaming_queue = result.pools[streaming].final_queue;
+        result.mean_streaming_wait = result.pools[streaming].mean_wait;
+    }
+    if (processing != PoolRegistry<SimulationPool>::NO_POOL) {
+        result.final_processing_servers = result.pools[processing].final_servers;
+        result.final_processing_queue = result.pools[processing].final_queue;
+        result.mean_processing_wait = result.pools[processing].mean_wait;
+    }
+    result.mean_latency = result.requests_completed > 0 ? static_cast<double>(latency_sum) / result.requests_completed : 0.0;
+    result.latency_p50 = latency_percentile(latency_histogram, 0.50);
+    result.latency_p90 = latency_percentile(latency_histogram, 0.90);
+    result.latency_p99 = latency_percentile(latency_histogram, 0.99);
+    long long short_completed = 0;
+    for (long long count : short_latency_histogram) {
+        short_completed += count;
+    }
+    result.mean_short_latency = short_completed > 0 ? static_cast<double>(short_latency_sum) / short_completed : 0.0;
+    result.short_latency_p99 = latency_percentile(short_latency_histogram, 0.99);
+    for (size_t index = 0; index < pools.size(); ++index) {
+        const ResilienceStats& stats = pools[index].servers.get_resilience_stats();
+        result.resilience.crashes += stats.crashes;
+        result.resilience.retries += stats.retries;
+        result.resilience.failed += stats.failed;
+        result.resilience.hedges_issued += stats.hedges_issued;
+        result.resilience.hedge_wins += stats.hedge_wins;
+        result.resilience.duplicate_cycles += stats.duplicate_cycles;
+        const BatchStats& batching = pools[index].servers.get_batch_stats();
+        result.batching.batches += batching.batches;
+        result.batching.batched_requests += batching.batched_requests;
+        result.batching.setup_cycles_saved += batching.setup_cycles_saved;
+        const NetworkStats& network = pools[index].servers.get_network_stats();
+        result.network.handoffs += network.handoffs;
+        result.network.prefetched += network.prefetched;
+        result.network.prefetch_hits += network.prefetch_hits;
+        result.network.gap_cycles += network.gap_cycles;
+        result.network.window_wait_cycles += network.window_wait_cycles;
+        result.network.busy_cycles += network.busy_cycles;
+    }
+    result.utilization = result.server_cycles > 0
+                             ? static_cast<double>(result.network.busy_cycles - result.network.gap_cycles) / result.server_cycles
+                             : 0.0;
+    log_summary();
+    if (metrics) {
+        long long rows = metrics->get_rows();
+        if (metrics->close()) {
+            logFile << "Metrics: " << rows << " cycles written to "
+                    << (params.metrics_path.empty() ? params.metrics_csv_path : params.metrics_path)
+                    << (!params.metrics_path.empty() && !params.metrics_csv_path.empty() ? " and " + params.metrics_csv_path : "")
+                    << "." << std::endl;
+        } else {
+            std::cerr << RED << "Could not write the metrics output." << RESET << std::endl;
+        }
+    }
+    if (tracer) {
+        std::vector<std::string> pool_names;
+        for (size_t index = 0; index < pools.size(); ++index) {
+            pool_names.push_back(pools[index].config.name);
+        }
+        if (tracer->write_json(params.trace_path, pool_names)) {
+            logFile << "Trace: " << tracer->size() << " events written to " << params.trace_path << " ("
+                    << tracer->get_dropped() << " dropped)." << std::endl;
+        } else {
+            std::cerr << RED << "Could not write trace file " << params.trace_path << "." << RESET << std::endl;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Writes the simulation state to a checkpoint.
+ *
+ * The section starts with the traffic classes and cache settings so that
+ * restore() can refuse a checkpoint of a differently configured run.
+ *
+ * @param out Checkpoint being written.
+ */
+void Simulation::save(CheckpointWriter& out) const {
+    std::string types;
+    for (size_t index = 0; index < pools.size(); ++index) {
+        types += pools[index].config.request_type;
+    }
+    out.write_string(types);
+    out.write(static_cast<uint8_t>(cache ? 1 : 0));
+    out.write(static_cast<uint8_t>(detector ? 1 : 0));
+
+    out.write(Request::peek_next_id());
+    out.write_rng(rng);
+    out.write(clock);
+    out.write(time_to_add_requests);
+    out.write(requests_per_clock);
+    visit_counters(result, [&out](const auto& counter) { out.write(counter); });
+    out.write(latency_sum);
+    out.write(short_latency_sum);
+    out.write_vector(latency_histogram);
+    out.write_vector(short_latency_histogram);
+    out.write_vector(arrival_clock);
+    out.write_vector(slot_flags);
+    out.write_vector(backends);
+
+    arena.save(out);
+    for (size_t index = 0; index < pools.size(); ++index) {
+        const SimulationPool& pool = pools[index];
+        out.write(pool.wait_sum);
+        out.write(pool.served);
+        out.write(pool.stolen);
+        out.write(pool.given);
+        pool.queue.save(out);
+        pool.servers.save(out);
+    }
+    if (cache) {
+        cache->save(out);
+    }
+    auto_firewall.save(out);
+    if (detector) {
+        detector->save(out);
+    }
+}
+
+/**
+ * @brief Replaces the simulation state with a checkpointed one.
+ *
+ * @param in Checkpoint being read.
+ * @param restore_ids false to keep the process-wide request and server ID
+ *        counters (see read_checkpoint()).
+ * @return false (after printing an error) if the checkpoint does not match.
+ */
+bool Simulation::restore(CheckpointReader& in, bool restore_ids) {
+    std::string types, expected;
+    for (size_t index = 0; index < pools.size(); ++index) {
+        expected += pools[index].config.request_type;
+    }
+    uint8_t has_cache = 0;
+    uint8_t has_detector = 0;
+    in.read_string(types);
+    in.read(has_cache);
+    in.read(has_detector);
+    if (!in.ok() || types != expected || (has_cache != 0) != static_cast<bool>(cache)) {
+        std::cerr << RED << "The checkpoint was written with request types '" << types << "' and "
+                  << (has_cache ? "a" : "no") << " response cache; this run has '" << expected << "' and "
+                  << (cache ? "a" : "no") << " cache." << RESET << std::endl;
+        return false;
+    }
+    if ((has_detector != 0) != static_cast<bool>(detector)) {
+        std::cerr << RED << "The checkpoint was written " << (has_detector ? "with" : "without")
+                  << " heavy-hitter detection; this run must be too (--auto-block-share)." << RESET << std::endl;
+        return false;
+    }
+
+    int next_request_id = 0;
+    in.read(next_request_id);
+    if (restore_ids) {
+        Request::set_next_id(next_request_id);
+    }
+    in.read_rng(rng);
+    in.read(clock);
+    in.read(time_to_add_requests);
+    in.read(requests_per_clock);
+    visit_counters(result, [&in](auto& counter) { in.read(counter); });
+    in.read(latency_sum);
+    in.read(short_latency_sum);
+    in.read_vector(latency_histogram);
+    in.read_vector(short_latency_histogram);
+    in.read_vector(arrival_clock);
+    in.read_vector(slot_flags);
+    in.read_vector(backends);
+
+    bool ok = arena.restore(in);
+    for (size_t index = 0; ok && index < pools.size(); ++index) {
+        SimulationPool& pool = pools[index];
+        in.read(pool.wait_sum);
+        in.read(pool.served);
+        in.read(pool.stolen);
+        in.read(pool.given);
+        ok = pool.queue.restore(in, arena) && pool.servers.restore(in, restore_ids);
+    }
+    if (ok && cache) {
+        ok = cache->restore(in);
+    }
+    ok = ok && auto_firewall.restore(in);
+    if (ok && detector) {
+        ok = detector->restore(in);
+    }
+    if (!ok || !in.ok() || in.remaining() != 0) {
+        std::cerr << RED << "The checkpoint is truncated or malformed." << RESET << std::endl;
+        return false;
+    }
+    restored = true;
+    return true;
+}
+
+/**
+ * @brief Returns the current clock cycle.
+ *
+ * @return Cycles simulated so far (including those before a restored checkpoint).
+ */
+int Simulation::get_clock() const {
+    return clock;
+}
+
+/**
+ * @brief Reseeds the run's random number generator.
+ *
+ * @param seed New seed.
+ */
+void Simulation::reseed(uint32_t seed) {
+    rng.seed(seed);
+}
+
+/**
+ * @brief Generates a random IPv4 address in packed form.
+ *
+ * Each of the four octets is drawn uniformly from [0, 255].
+ *
+ * @return Random IPv4 address (first octet in the high byte).
+ */
+uint32_t Simulation::generate_random_ip() {
+    uint32_t ip = 0;
+    for (int i = 0; i < 4; ++i) {
+        ip = (ip << 8) | static_cast<uint32_t>(rng() % 256);
+    }
+    return ip;
+}
+
+/**
+ * @brief Generates a destination IPv4 address for a request.
+ *
+ * When a backend pool is configured the destination is drawn from it, which
+ * models many clients talking to a limited set of services; otherwise a fully
+ * random address is generated.
+ *
+ * @return Destination IPv4 address.
+ */
+uint32_t Simulation::generate_destination_ip() {
+    if (backends.empty()) {
+        return generate_random_ip();
+    }
+    return backends[rng() % backends.size()];
+}
+
+/**
+ * @brief Generates the number of cycles until the next request burst.
+ *
+ * @return Random value in the range [1, 12].
+ */
+int Simulation::generate_burst_interval() {
+    return static_cast<int>(rng() % 12) + 1;
+}
+
+/**
+ * @brief Generates the number of requests in the next burst.
+ *
+ * By default a burst holds 20 to 59 requests. With an arrival rate set the
+ * burst size is drawn uniformly from [0.5, 1.5) times the mean burst size
+ * that yields that rate (bursts are 6.5 cycles apart on average).
+ *
+ * @return Request count of the next burst.
+ */
+int Simulation::generate_random_request_count() {
+    if (params.arrival_rate > 0.0) {
+        double mean_burst = params.arrival_rate * 6.5;
+        std::uniform_real_distribution<double> spread(0.5, 1.5);
+        return static_cast<int>(mean_burst * spread(rng) + 0.5);
+    }
+    return static_cast<int>(rng() % 40) + 20;
+}
+
+/**
+ * @brief Returns the mean number of generated requests per cycle.
+ *
+ * Without an explicit arrival rate, bursts of 20 to 59 requests (mean 39.5)
+ * arrive every 1 to 12 cycles (mean 6.5).
+ *
+ * @return Mean arrivals per cycle over both request types.
+ */
+double Simulation::mean_arrival_rate() const {
+    return params.arrival_rate > 0.0 ? params.arrival_rate : 39.5 / 6.5;
+}
+
+/**
+ * @brief Adds count generated requests to the pending burst.
+ *
+ * Each request belongs to a pool's traffic class with the probability of
+ * that pool's share; its time_to_process is drawn uniformly from the
+ * class's configured range, or from its long range for the class's
+ * long_share of requests.
+ *
+ * @param count Number of requests to generate.
+ */
+void Simulation::generate_burst(int count) {
+    std::uniform_real_distribution<double> share(0.0, 1.0);
+    for (int i = 0; i < count; ++i) {
+        uint32_t ip_in = 0;
+        if (params.attack_share > 0.0 && share(rng) < params.attack_share) {
+            ip_in = attack_prefix | static_cast<uint32_t>(rng() % static_cast<uint32_t>(params.attackers));
+        } else {
+            ip_in = generate_random_ip();
+        }
+        uint32_t ip_out = generate_destination_ip();
+        double draw = share(rng);
+        size_t index = 0;
+        while (index + 1 < cumulative_share.size() && draw >= cumulative_share[index]) {
+            index++;
+        }
+        const PoolConfig& config = pools[index].config;
+        const int* range = config.time_range;
+        if (config.long_share > 0.0 && share(rng) < config.long_share) {
+            range = config.long_time;
+        }
+        int time_to_process = range[0] + static_cast<int>(rng() % static_cast<uint32_t>(range[1] - range[0] + 1));
+        burst.push_back(arena.create(ip_in, ip_out, time_to_process, config.request_type));
+        mark_long(burst.back().get_index(), range == config.long_time);
+    }
+}
+
+/**
+ * @brief Filters the pending burst through the firewall and queues the rest.
+ *
+ * The whole burst is classified in one Firewall::classify_batch call; requests
+ * that pass are queued in the pool registered for their type (types without
+ * a pool go to the first pool), and blocked requests are reported, counted
+ * and released.
+ *
+ * @return Number of requests that passed the firewall and were queued.
+ */
+int Simulation::route_burst() {
+    burst_ips.resize(burst.size());
+    burst_verdicts.resize((burst.size() + 7) / 8);
+    for (size_t i = 0; i < burst.size(); ++i) {
+        burst_ips[i] = arena.get(burst[i]).get_ip_in_int();
+    }
+    if (detector) {
+        detect_heavy_hitters();
+    }
+    firewall.classify_batch(burst_ips.data(), burst_ips.size(), burst_verdicts.data());
+    if (auto_firewall.get_range_count() > 0) {
+        auto_verdicts.resize(burst_verdicts.size());
+        auto_firewall.classify_batch(burst_ips.data(), burst_ips.size(), auto_verdicts.data());
+        for (size_t i = 0; i < burst_verdicts.size(); ++i) {
+            result.requests_auto_blocked += __builtin_popcount(auto_verdicts[i] & ~burst_verdicts[i] & 0xFFu);
+            burst_verdicts[i] |= auto_verdicts[i];
+        }
+    }
+    if (arrival_clock.size() < arena.capacity()) {
+        arrival_clock.resize(arena.capacity());
+    }
+
+    int queued = 0;
+    for (size_t i = 0; i < burst.size(); ++i) {
+        const Request& request = arena.get(burst[i]);
+        bool blocked = Firewall::is_blocked_verdict(burst_verdicts.data(), i);
+        trace(TraceEvent::ARRIVE, request);
+        trace(blocked ? TraceEvent::FIREWALL_BLOCK : TraceEvent::FIREWALL_PASS, request);
+        if (blocked == false) {
+            arrival_clock[burst[i].get_index()] = clock;
+            int pool = pools.route(request.get_request_type());
+            pool = pool == PoolRegistry<SimulationPool>::NO_POOL ? 0 : pool;
+            if (tracer) {
+                int request_id = request.get_request_id();
+                tracer->track(burst[i].get_index(), tracer->sampled(request_id) ? request_id : -1);
+            }
+            trace(TraceEvent::ENQUEUE, request, pool);
+            pools[pool].queue.queue_request(std::move(burst[i]));
+            queued++;
+        } else {
+            if (params.verbose) {
+                std::cout << YELLOW << "Request from " << request.get_ip_in() << " is blocked by the firewall." << RESET << std::endl;
+            }
+            logFile << "Request from " << request.get_ip_in() << " is blocked by the firewall." << std::endl;
+            result.requests_blocked++;
+            arena.release(std::move(burst[i]));
+        }
+    }
+    burst.clear();
+    return queued;
+}
+
+/**
+ * @brief Counts the burst's sources in the detector and blocks the ones that crossed a threshold.
+ *
+ * Expired automatic blocks are dropped first, and the window slides to the
+ * current cycle. Every request is counted, blocked or not, so a source stays
+ * visible while its block lasts and is blocked again if it keeps sending.
+ */
+void Simulation::detect_heavy_hitters() {
+    size_t expired = auto_firewall.expire(clock);
+    if (expired > 0) {
+        logFile << "Clock " << clock << ": " << expired << " automatic block(s) expired." << std::endl;
+    }
+    detector->advance(clock);
+    promotions.clear();
+    for (uint32_t ip : burst_ips) {
+        detector->add(ip, clock, promotions);
+    }
+    for (const HeavyHitter& hitter : promotions) {
+        auto_firewall.block_until(hitter.first, hitter.last, clock + params.heavy_hitters.block_cycles);
+        result.auto_blocks++;
+        std::string range = Request::format_ip(hitter.first) + (hitter.first == hitter.last ? "" : "/24");
+        logFile << "Clock " << clock << ": blocking " << range << " (about " << hitter.estimate << " of "
+                << hitter.window_total << " requests in the window) until clock "
+                << clock + params.heavy_hitters.block_cycles << "." << std::endl;
+        if (params.verbose) {
+            std::cout << RED << "Heavy hitter " << range << " blocked until clock "
+                      << clock + params.heavy_hitters.block_cycles << "." << RESET << std::endl;
+        }
+    }
+}
+
+/**
+ * @brief Creates requests for the published entries of the shared-memory ring.
+ *
+ * Slots are read in place from the ring mapping and released once the
+ * request has been constructed in the arena, so producers can reuse them
+ * immediately.
+ */
+void Simulation::ingest_from_ring() {
+    burst.clear();
+    while (burst.size() < params.shm_batch) {
+        const ShmSlot* slots = nullptr;
+        size_t count = ring->acquire_batch(slots, params.shm_batch - burst.size());
+        if (count == 0) {
+            break;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            burst.push_back(arena.create(slots[i].ip_in, slots[i].ip_out, slots[i].time_to_process, slots[i].request_type));
+            mark_long(burst.back().get_index(), false);
+        }
+        ring->release_batch(count);
+    }
+}
+
+/**
+ * @brief Creates requests for the distributor's batch of the current cycle.
+ *
+ * Waits until the distributor has sent the batch; after the distributor
+ * closed the link the cycle gets no arrivals.
+ */
+void Simulation::ingest_from_link() {
+    burst.clear();
+    link->take(arrivals);
+    for (const Arrival& arrival : arrivals) {
+        burst.push_back(arena.create(arrival.ip_in, arrival.ip_out, arrival.time_to_process, arrival.request_type));
+        mark_long(burst.back().get_index(), arrival.is_long);
+    }
+}
+
+/**
+ * @brief Publishes the queued requests and servers over all pools on the link.
+ */
+void Simulation::report_load() {
+    LoadReport report;
+    report.cycle = clock;
+    for (size_t index = 0; index < pools.size(); ++index) {
+        report.queued += pools[index].queue.get_queue_size();
+        report.servers += pools[index].servers.get_server_count();
+    }
+    link->report(report);
+}
+
+/**
+ * @brief Assigns queued requests of one pool to its idle servers.
+ *
+ * Requests whose response is cached are answered immediately and do not
+ * occupy a server; each request is looked up once, not again when it is
+ * retaken after waiting. Under earliest-completion dispatch a request may choose
+ * to wait for a busy server; it stays at the head of the queue while later
+ * requests take the idle servers it passed over. With coalescing, queued
+ * requests for the same backend as the one taken from the queue are run
+ * together with it as one batched call.
+ *
+ * @param pool Pool to dispatch.
+ */
+void Simulation::dispatch(SimulationPool& pool) {
+    int pool_index = pools.route(pool.config.request_type);
+    LoadBalancer& load_balancer = pool.queue;
+    ServerHandler& server_handler = pool.servers;
+    while (!load_balancer.is_empty() && server_handler.can_accept()) {
+        RequestHandle handle = load_balancer.process_request();
+        const Request& request = arena.get(handle);
+        // a preempted request resumes its remaining work; it already waited and passed the cache
+        bool first_slice = request.get_remaining_work() == request.get_time_to_process();
+        uint64_t cache_key = 0;
+        if (cache && first_slice) {
+            cache_key = ResponseCache::make_key(request.get_ip_out_int(), request.get_request_type());
+            if (lookup_once(handle.get_index(), cache_key)) {
+                result.cache_saved_cycles += request.get_time_to_process();
+                record_served(pool, handle.get_index());
+                record_completed(handle.get_index());
+                trace(TraceEvent::CACHE_HIT, request, pool_index);
+                if (tracer) {
+                    tracer->track(handle.get_index(), -1);
+                }
+                if (params.verbose) {
+                    std::cout << GREEN << "Request from " << request.get_ip_in() << " to " << request.get_ip_out() << " served from cache." << RESET << std::endl;
+                }
+                arena.release(std::move(handle));
+                continue;
+            }
+        }
+        uint32_t index = handle.get_index();
+        if (first_slice && load_balancer.take_batch(arena, request, batch) > 0) {
+            dispatch_batch(pool, std::move(handle), cache_key);
+            continue;
+        }
+        Server* server = server_handler.assign_request(std::move(handle));
+        if (server) {
+            trace(TraceEvent::DISPATCH, request, pool_index, server->get_server_id());
+            if (first_slice) {
+                record_served(pool, index);
+            }
+            if (cache && first_slice) {
+                cache->insert(cache_key);
+            }
+            if (params.verbose) {
+                std::cout << BLUE << "Assigned request from " << request.get_ip_in() << " sent to " << pool.config.name << " server " << server->get_server_id() << "." << RESET << std::endl;
+            }
+        } else {
+            // a faster busy server will finish the request sooner: it waits, later requests may go ahead
+            if (params.verbose) {
+                std::cout << YELLOW << "Request from " << request.get_ip_in() << " waits for a faster " << pool.config.name << " server." << RESET << std::endl;
+            }
+            deferred.push_back(std::move(handle));
+        }
+    }
+    // waiting requests keep their place at the head of the queue
+    while (!deferred.empty()) {
+        load_balancer.return_request(std::move(deferred.back()));
+        deferred.pop_back();
+    }
+    server_handler.end_dispatch();
+}
+
+/**
+ * @brief Starts a request and the queued requests coalesced with it as one backend call.
+ *
+ * Every member counts as served now and completes with the batch. If no
+ * server takes the batch the members go back to the head of the queue in
+ * their order and the request waits like any other.
+ *
+ * @param pool Pool being dispatched.
+ * @param leader Request the batch was built around; the members are in batch.
+ * @param cache_key Response cache key of the batch (0 without a cache).
+ */
+void Simulation::dispatch_batch(SimulationPool& pool, RequestHandle&& leader, uint64_t cache_key) {
+    // assign_batch() takes the first idle server, so the members can be traced on it beforehand
+    Server* server = pool.servers.get_available_server();
+    if (server == nullptr) {
+        while (!batch.empty()) {
+            pool.queue.return_request(std::move(batch.back()));
+            batch.pop_back();
+        }
+        deferred.push_back(std::move(leader));
+        return;
+    }
+    int pool_index = pools.route(pool.config.request_type);
+    size_t size = batch.size() + 1;
+    record_served(pool, leader.get_index());
+    for (const RequestHandle& member : batch) {
+        record_served(pool, member.get_index());
+        trace(TraceEvent::DISPATCH, arena.get(member), pool_index, server->get_server_id());
+    }
+    const Request& request = arena.get(leader);
+    pool.servers.assign_batch(std::move(leader), batch);
+    trace(TraceEvent::DISPATCH, request, pool_index, server->get_server_id());
+    if (cache) {
+        cache->insert(cache_key);
+    }
+    if (params.verbose) {
+        std::cout << BLUE << "Batched " << size << " requests to " << request.get_ip_out() << " on " << pool.config.name
+                  << " server " << server->get_server_id() << "." << RESET << std::endl;
+    }
+}
+
+/**
+ * @brief Lets a pool's idle servers take requests from the most backed-up other pool.
+ *
+ * Only a pool whose own queue is empty steals, and only from pools holding
+ * more than steal_threshold queued requests per server. A stolen request
+ * runs steal_penalty times longer (the servers are not built for its type)
+ * and counts toward its own pool's queue wait. At most steal_limit requests
+ * are stolen per pool and cycle.
+ *
+ * @param thief Pool whose servers are idle.
+ */
+void Simulation::steal(SimulationPool& thief) {
+    int thief_index = pools.route(thief.config.request_type);
+    ServerHandler& server_handler = thief.servers;
+    int taken = 0;
+    while ((params.steal_limit == 0 || taken < params.steal_limit) && thief.queue.is_empty() &&
+           server_handler.get_available_server() != nullptr) {
+        SimulationPool* victim = nullptr;
+        double deepest = params.steal_threshold;
+        for (size_t index = 0; index < pools.size(); ++index) {
+            SimulationPool& pool = pools[index];
+            int servers = pool.servers.get_server_count();
+            double backlog = static_cast<double>(pool.queue.get_queue_size()) / (servers > 0 ? servers : 1);
+            if (&pool != &thief && backlog > deepest) {
+                victim = &pool;
+                deepest = backlog;
+            }
+        }
+        if (!victim) {
+            break;
+        }
+        RequestHandle handle = victim->queue.process_request();
+        uint32_t index = handle.get_index();
+        const Request& request = arena.get(handle);
+        bool first_slice = request.get_remaining_work() == request.get_time_to_process();
+        Server* server = server_handler.assign_request(std::move(handle));
+        if (!server) {
+            victim->queue.return_request(std::move(handle));
+            break;
+        }
+        trace(TraceEvent::DISPATCH, request, thief_index, server->get_server_id());
+        if (first_slice) {
+            record_served(*victim, index);
+        }
+        thief.stolen++;
+        victim->given++;
+        result.requests_stolen++;
+        taken++;
+        if (params.verbose) {
+            std::cout << BLUE << thief.config.name << " server " << server->get_server_id() << " took a "
+                      << victim->config.name << " request." << RESET << std::endl;
+        }
+    }
+    server_handler.end_dispatch();
+}
+
+/**
+ * @brief Scales one pool up or down according to its queue length.
+ *
+ * A pool never shrinks below one server and only removes an idle server.
+ *
+ * @param pool Pool to scale.
+ */
+void Simulation::scale(SimulationPool& pool) {
+    LoadBalancer& load_balancer = pool.queue;
+    ServerHandler& server_handler = pool.servers;
+    int decision = pool.scale_decision();
+    if (decision < 0) {
+        // only scale down if there is a server that is not busy
+        Server* down_server = server_handler.get_available_server();
+        if (down_server) {
+            server_handler.scale_down(down_server);
+            result.servers_removed++;
+            if (params.verbose) {
+                std::cout << RED << "Scaling down " << pool.config.name << " servers. Current server count: " << server_handler.get_server_count() << "." << RESET << std::endl;
+            }
+        }
+    } else if (decision > 0) {
+        // with heterogeneous scaling a deep backlog buys speed, a shallow one buys cheap capacity
+        const ServerProfile* kind = &STANDARD_PROFILE;
+        if (params.fast_backlog > 0.0) {
+            bool deep = load_balancer.get_queue_size() > params.fast_backlog * server_handler.get_server_count();
+            kind = deep ? &FAST_PROFILE : &CHEAP_PROFILE;
+            (deep ? result.fast_servers_added : result.cheap_servers_added)++;
+        }
+        server_handler.scale_up(pool_profile(pool, *kind));
+        result.servers_created++;
+        if (params.verbose) {
+            std::cout << GREEN << "Scaling up " << pool.config.name << " servers. Current server count: " << server_handler.get_server_count() << "." << RESET << std::endl;
+        }
+    }
+}
+
+/**
+ * @brief Returns the server profile of a pool for a given kind of server.
+ *
+ * Servers of a pool are tuned for the pool's request type, so they process
+ * it affinity_speedup times faster.
+ *
+ * @param pool Pool the server joins.
+ * @param kind Base profile (standard, fast or cheap).
+ * @return The profile, tuned to the pool's request type.
+ */
+ServerProfile Simulation::pool_profile(const SimulationPool& pool, const ServerProfile& kind) const {
+    ServerProfile profile = kind;
+    if (params.affinity_speedup != 1.0f) {
+        profile.affinity = pool.config.request_type;
+        profile.affinity_speedup = params.affinity_speedup;
+    }
+    return profile;
+}
+
+/**
+ * @brief Records the queue wait of a request leaving its queue.
+ *
+ * @param pool Pool the request was queued in.
+ * @param index Arena slot of the request.
+ */
+void Simulation::record_served(SimulationPool& pool, uint32_t index) {
+    pool.wait_sum += clock - arrival_clock[index];
+    pool.served++;
+    result.requests_served++;
+}
+
+/**
+ * @brief Records a lifecycle event of a request if tracing is on and the request is sampled.
+ *
+ * @param event What happened.
+ * @param request The request.
+ * @param pool Pool index of queue and dispatch events.
+ * @param server_id Server of dispatch events, otherwise -1.
+ */
+void Simulation::trace(TraceEvent event, const Request& request, int pool, int server_id) {
+    if (tracer && tracer->sampled(request.get_request_id())) {
+        tracer->record(event, clock, request.get_request_id(), request.get_request_type(), pool, server_id);
+    }
+}
+
+/**
+ * @brief Records whether a newly created request was drawn from the long range.
+ *
+ * @param index Arena slot of the request.
+ * @param is_long Whether its time_to_process came from the long range.
+ */
+void Simulation::mark_long(uint32_t index, bool is_long) {
+    if (slot_flags.size() < arena.capacity()) {
+        slot_flags.resize(arena.capacity());
+    }
+    slot_flags[index] = is_long ? SLOT_LONG : 0;
+}
+
+/**
+ * @brief Looks a request up in the response cache unless it was looked up before.
+ *
+ * A request that chose to wait for a faster server is taken from the queue
+ * again on later passes; counting it each time would add misses and, with
+ * TinyLFU, inflate its key's frequency.
+ *
+ * @param index Arena slot of the request.
+ * @param key Cache key of the request.
+ * @return true on a hit during this call.
+ */
+bool Simulation::lookup_once(uint32_t index, uint64_t key) {
+    if (slot_flags.size() < arena.capacity()) {
+        slot_flags.resize(arena.capacity());
+    }
+    if (slot_flags[index] & SLOT_CACHE_CHECKED) {
+        return false;
+    }
+    slot_flags[index] |= SLOT_CACHE_CHECKED;
+    return cache->lookup(key);
+}
+
+/**
+ * @brief Packs the per-slot state of a queued request that is being spilled.
+ *
+ * The arrival cycle goes in the upper bits and the slot flags in the lowest
+ * eight; the tracer forgets the slot, which is about to be released.
+ *
+ * @param request Queued request leaving the arena.
+ * @return Tag stored with the spilled request.
+ */
+uint64_t Simulation::pack_slot(const RequestHandle& request) {
+    uint32_t index = request.get_index();
+    uint64_t flags = index < slot_flags.size() ? slot_flags[index] : 0;
+    if (tracer) {
+        tracer->track(index, -1);
+    }
+    return static_cast<uint64_t>(static_cast<uint32_t>(arrival_clock[index])) << 8 | flags;
+}
+
+/**
+ * @brief Applies packed per-slot state to the new slot of a request read back from disk.
+ *
+ * @param request Request in its new slot.
+ * @param tag Tag returned by pack_slot().
+ */
+void Simulation::unpack_slot(const RequestHandle& request, uint64_t tag) {
+    uint32_t index = request.get_index();
+    if (arrival_clock.size() < arena.capacity()) {
+        arrival_clock.resize(arena.capacity());
+    }
+    arrival_clock[index] = static_cast<int>(static_cast<uint32_t>(tag >> 8));
+    if (slot_flags.size() < arena.capacity()) {
+        slot_flags.resize(arena.capacity());
+    }
+    slot_flags[index] = static_cast<uint8_t>(tag & 0xFF);
+    if (tracer) {
+        int request_id = arena.get(request).get_request_id();
+        tracer->track(index, tracer->sampled(request_id) ? request_id : -1);
+    }
+}
+
+/**
+ * @brief Records the arrival-to-completion latency of a finished request.
+ *
+ * Requests finish either in the cache or when their server (or, for a
+ * hedged request, the first of its copies) completes. Requests that were not
+ * drawn from a long range are also counted in the short-request histogram.
+ *
+ * @param index Arena slot the request occupied.
+ */
+void Simulation::record_completed(uint32_t index) {
+    int latency = clock - arrival_clock[index];
+    size_t bucket = static_cast<size_t>(latency);
+    if (bucket >= latency_histogram.size()) {
+        latency_histogram.resize(bucket + 1);
+    }
+    latency_histogram[bucket]++;
+    latency_sum += latency;
+    result.requests_completed++;
+    if (index < slot_flags.size() && (slot_flags[index] & SLOT_LONG) == 0) {
+        if (bucket >= short_latency_histogram.size()) {
+            short_latency_histogram.resize(bucket + 1);
+        }
+        short_latency_histogram[bucket]++;
+        short_latency_sum += latency;
+    }
+}
+
+/**
+ * @brief Returns the latency below which the given fraction of requests fall.
+ *
+ * @param histogram Number of requests per latency.
+ * @param fraction Percentile as a fraction in (0, 1].
+ * @return Latency in cycles, or 0 if the histogram is empty.
+ */
+int Simulation::latency_percentile(const std::vector<long long>& histogram, double fraction) const {
+    long long total = 0;
+    for (long long count : histogram) {
+        total += count;
+    }
+    long long rank = static_cast<long long>(fraction * total);
+    long long seen = 0;
+    for (size_t latency = 0; latency < histogram.size(); ++latency) {
+        seen += histogram[latency];
+        if (seen > rank || seen == total) {
+            return static_cast<int>(latency);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes the periodic statistics block to the log.
+ */
+void Simulation::log_progress() {
+    logFile << std::endl;
+    logFile << "Clock: " << clock << std::endl;
+    for (size_t index = 0; index < pools.size(); ++index) {
+        const SimulationPool& pool = pools[index];
+        logFile << "Current " << pool.config.name << " server count: " << pool.servers.get_server_count() << "." << std::endl;
+        logFile << "Current " << pool.config.name << " load balancer queue size: " << pool.queue.get_queue_size() << "." << std::endl;
+    }
+    logFile << "Requests processed (or currently processing) so far: " << result.requests_served << "." << std::endl;
+}
+
+/**
+ * @brief Records the current cycle's row of metrics.
+ *
+ * Queue depths, server and idle counts are sampled at the end of the cycle;
+ * arrivals, blocked and assigned requests are the cycle's growth of the run
+ * totals, and scale events the servers added (or removed, negative) by
+ * scaling this cycle.
+ */
+void Simulation::record_metrics() {
+    metrics->set(METRIC_CYCLE, clock);
+    metrics->set_delta(METRIC_ARRIVALS, result.requests_generated + result.requests_blocked);
+    metrics->set_delta(METRIC_BLOCKED, result.requests_blocked);
+    metrics->set_delta(METRIC_ASSIGNED, result.requests_served);
+    for (size_t index = 0; index < pools.size(); ++index) {
+        const SimulationPool& pool = pools[index];
+        size_t column = METRIC_POOL_FIRST + index * METRIC_POOL_COLUMNS;
+        metrics->set(column, pool.queue.get_queue_size());
+        metrics->set(column + 1, pool.servers.get_server_count());
+        metrics->set(column + 2, pool.servers.get_idle_server_count());
+        metrics->set(column + 3, scale_events[index]);
+        scale_events[index] = 0;
+    }
+    metrics->end_row();
+}
+
+/**
+ * @brief Writes the final statistics to the log.
+ */
+void Simulation::log_summary() {
+    logFile << std::endl << std::endl;
+    logFile << "Simulation ended at clock " << clock << "." << std::endl;
+    int final_queue = 0;
+    for (const PoolResult& pool : result.pools) {
+        logFile << "Final " << pool.name << " server count: " << pool.final_servers << std::endl;
+        final_queue += pool.final_queue;
+    }
+
+    logFile << "Total request queue size at the end of simulation: " << final_queue << std::endl;
+    for (const PoolResult& pool : result.pools) {
+        logFile << "Final " << pool.name << " load balancer queue size: " << pool.final_queue << std::endl;
+    }
+
+    logFile << "Total requests generated: " << result.requests_generated << std::endl;
+    logFile << "Total requests processed (or currently processing): " << result.requests_served << std::endl;
+
+    logFile << "Total servers created: " << result.servers_created << std::endl;
+    logFile << "Total servers removed: " << result.servers_removed << std::endl;
+    if (params.fast_backlog > 0.0) {
+        logFile << "Servers added by scaling: " << result.fast_servers_added << " fast, "
+                << result.cheap_servers_added << " cheap" << std::endl;
+    }
+    logFile << "Server cost: " << result.server_cost << " (" << result.server_cycles << " server cycles)" << std::endl;
+    if (params.work_stealing) {
+        logFile << "Requests served by another pool: " << result.requests_stolen << " (";
+        for (size_t index = 0; index < result.pools.size(); ++index) {
+            const PoolResult& pool = result.pools[index];
+            logFile << (index > 0 ? "; " : "") << pool.name << " took " << pool.stolen << ", gave " << pool.given;
+        }
+        logFile << ")" << std::endl;
+    }
+    logFile << "Total requests blocked by firewall: " << result.requests_blocked << std::endl;
+    if (detector) {
+        logFile << "Automatic blocks: " << result.auto_blocks << " (" << result.requests_auto_blocked
+                << " requests blocked by them, " << auto_firewall.get_range_count() << " still active)" << std::endl;
+        logFile << "Top talkers in the last window:";
+        for (const HeavyHitter& talker : detector->top(5)) {
+            logFile << " " << Request::format_ip(talker.first) << (talker.first == talker.last ? "" : "/24") << " ("
+                    << talker.estimate << ")";
+        }
+        logFile << " of " << detector->window_total() << " requests" << std::endl;
+    }
+
+    logFile << "Mean queue wait: ";
+    for (size_t index = 0; index < result.pools.size(); ++index) {
+        logFile << (index > 0 ? ", " : "") << result.pools[index].name << " " << result.pools[index].mean_wait;
+    }
+    logFile << " clock cycles" << std::endl;
+    logFile << "Request latency mean/p50/p90/p99: " << result.mean_latency << "/" << result.latency_p50 << "/"
+            << result.latency_p90 << "/" << result.latency_p99 << " clock cycles" << std::endl;
+    if (params.time_slice > 0) {
+        logFile << "Time slice: " << params.time_slice << " cycles, " << result.preemptions << " preemptions" << std::endl;
+    }
+    if (params.coalesce_max > 1) {
+        const BatchStats& batching = result.batching;
+        double mean_batch = batching.batches > 0 ? static_cast<double>(batching.batched_requests) / batching.batches : 0.0;
+        logFile << "Coalesced backend calls: " << batching.batches << " carrying " << batching.batched_requests
+                << " requests (mean batch " << mean_batch << "), setup cycles saved: " << batching.setup_cycles_saved
+                << std::endl;
+    }
+    if (params.network.rtt > 0 || params.network.prefetch > 0) {
+        const NetworkStats& network = result.network;
+        int windows = 0;
+        for (size_t index = 0; index < pools.size(); ++index) {
+            windows += pools[index].servers.get_prefetched_count();
+        }
+        logFile << "Network: round trip " << params.network.rtt << " cycles, prefetch window " << params.network.prefetch
+                << "; " << network.handoffs << " requests sent to idle servers, " << network.prefetched
+                << " prefetched (" << network.prefetch_hits << " already local when their server became free), "
+                << windows << " still in windows" << std::endl;
+        logFile << "Server cycles waiting on the network: " << network.gap_cycles << " ("
+                << (result.server_cycles > 0 ? 100.0 * network.gap_cycles / result.server_cycles : 0.0)
+                << "%), mean window wait of prefetched requests: "
+                << (network.prefetch_hits > 0 ? static_cast<double>(network.window_wait_cycles) / network.prefetch_hits : 0.0)
+                << " cycles" << std::endl;
+    }
+    logFile << "Server utilization (working, not waiting on the network): " << result.utilization * 100.0 << "%" << std::endl;
+    if (params.long_share > 0.0) {
+        logFile << "Short request latency mean/p99: " << result.mean_short_latency << "/" << result.short_latency_p99
+                << " clock cycles" << std::endl;
+    }
+    if (params.queue_budget > 0) {
+        logFile << "Requests spilled to disk: ";
+        for (size_t index = 0; index < result.pools.size(); ++index) {
+            const PoolResult& pool = result.pools[index];
+            logFile << (index > 0 ? "; " : "") << pool.name << " " << pool.spill_writes << " (peak " << pool.peak_spilled
+                    << " on disk)";
+        }
+        logFile << std::endl;
+    }
+
+    const ResilienceStats& resilience = result.resilience;
+    if (params.faults.enabled() || params.hedging.hedge_after > 0) {
+        double duplicate_load = result.server_cycles > 0 ? 100.0 * resilience.duplicate_cycles / result.server_cycles : 0.0;
+        logFile << std::endl;
+        logFile << "Server crashes: " << resilience.crashes << ", retries: " << resilience.retries
+                << ", requests failed: " << resilience.failed << std::endl;
+        logFile << "Hedged requests: " << resilience.hedges_issued << " (duplicate finished first in "
+                << resilience.hedge_wins << ")" << std::endl;
+        logFile << "Server cycles spent on cancelled or crashed copies: " << resilience.duplicate_cycles
+                << " (" << duplicate_load << "% of server capacity)" << std::endl;
+    }
+
+    if (cache) {
+        // a server is busy for time_to_process cycles per request, so every
+        // total_simulation_time cycles the cache saved is one server's worth of work
+        double servers_saved = clock > 0 ? static_cast<double>(result.cache_saved_cycles) / clock : 0.0;
+        logFile << std::endl;
+        logFile << "Response cache policy: " << ResponseCache::policy_name(cache->get_policy()) << std::endl;
+        logFile << "Response cache hits: " << cache->get_hits() << ", misses: " << cache->get_misses()
+                << ", hit ratio: " << cache->hit_ratio() * 100.0 << "%" << std::endl;
+        logFile << "Response cache admissions rejected: " << cache->get_rejected() << std::endl;
+        logFile << "Server cycles saved by the cache: " << result.cache_saved_cycles
+                << " (about " << servers_saved << " fewer servers needed)" << std::endl;
+        if (params.verbose) {
+            std::cout << GREEN << "Response cache hit ratio: " << cache->hit_ratio() * 100.0 << "%, "
+                      << servers_saved << " fewer servers needed." << RESET << std::endl;
+        }
+    }
+    memory_report(logFile);
+    large_alloc_report(logFile);
+}
+
+/**
+ * @brief Reads the fault injection, hedging and retry options.
+ *
+ * @param config Parsed command-line / file options.
+ * @param params Parameters receiving params.faults and params.hedging.
+ */
+void read_resilience_settings(const Config& config, SimulationParams& params) {
+    FaultSettings& faults = params.faults;
+    faults.stall_probability = config.get_double("stall-probability", faults.stall_probability);
+    faults.stall_cycles = config.get_int("stall-cycles", faults.stall_cycles);
+    faults.crash_probability = config.get_double("crash-probability", faults.crash_probability);
+    faults.restart_cycles = config.get_int("restart-cycles", faults.restart_cycles);
+    faults.slow_fraction = config.get_double("slow-fraction", faults.slow_fraction);
+    faults.slow_multiplier = config.get_double("slow-multiplier", faults.slow_multiplier);
+    params.hedging.hedge_after = config.get_int("hedge-after", params.hedging.hedge_after);
+    params.hedging.max_retries = config.get_int("max-retries", params.hedging.max_retries);
+}
+
+/**
+ * @brief Reads the server fleet and dispatch options.
+ *
+ * @param config Parsed command-line / file options.
+ * @param params Parameters receiving the fleet settings.
+ * @return false (after printing an error) on invalid options.
+ */
+bool read_fleet_settings(const Config& config, SimulationParams& params) {
+    std::string dispatch = config.get_string("dispatch", "first-idle");
+    if (dispatch == "sec") {
+        params.dispatch = DispatchPolicy::EARLIEST_COMPLETION;
+    } else if (dispatch == "first-idle") {
+        params.dispatch = DispatchPolicy::FIRST_IDLE;
+    } else {
+        std::cerr << RED << "Unknown --dispatch '" << dispatch << "': expected first-idle or sec." << RESET << std::endl;
+        return false;
+    }
+    if (config.has("types") && !parse_pool_types(config.get_string("types", ""), params.pools)) {
+        std::cerr << RED << "Invalid --types: expected type[:servers[:low-high[:share]]] entries with distinct "
+                  << "types and shares summing to at most 1." << RESET << std::endl;
+        return false;
+    }
+    params.fast_share = config.get_double("fast-share", params.fast_share);
+    params.cheap_share = config.get_double("cheap-share", params.cheap_share);
+    params.fast_backlog = config.get_double("fast-backlog", params.fast_backlog);
+    params.affinity_speedup = static_cast<float>(config.get_double("affinity-speedup", params.affinity_speedup));
+    params.work_stealing = config.get_bool("steal", params.work_stealing);
+    params.steal_penalty = config.get_double("steal-penalty", params.steal_penalty);
+    params.steal_limit = config.get_int("steal-limit", params.steal_limit);
+    params.steal_threshold = config.get_double("steal-threshold", params.steal_threshold);
+    params.time_slice = config.get_int("time-slice", params.time_slice);
+    params.coalesce_max = config.get_int("coalesce", params.coalesce_max);
+    params.coalesce_window = config.get_int("coalesce-window", params.coalesce_window);
+    params.batch_setup = config.get_int("batch-setup", params.batch_setup);
+    params.network.rtt = config.get_int("rtt", params.network.rtt);
+    params.network.prefetch = config.get_int("prefetch", params.network.prefetch);
+    params.long_share = config.get_double("long-share", params.long_share);
+    if (config.has("long-time")) {
+        char trailing = 0;
+        std::string range = config.get_string("long-time", "");
+        if (std::sscanf(range.c_str(), "%d,%d%c", &params.long_time[0], &params.long_time[1], &trailing) != 2 ||
+            params.long_time[0] < 1 || params.long_time[1] < params.long_time[0]) {
+            std::cerr << RED << "Invalid --long-time: expected low,high with 1 <= low <= high." << RESET << std::endl;
+            return false;
+        }
+    }
+    if (params.time_slice < 0 || params.long_share < 0.0 || params.long_share > 1.0) {
+        std::cerr << RED << "--time-slice must be non-negative and --long-share in [0, 1]." << RESET << std::endl;
+        return false;
+    }
+    if (params.coalesce_max < 0 || params.coalesce_window < 1 || params.batch_setup < 0) {
+        std::cerr << RED << "--coalesce and --batch-setup must be non-negative and --coalesce-window positive." << RESET << std::endl;
+        return false;
+    }
+    if (params.network.rtt < 0 || params.network.prefetch < 0 || params.network.prefetch > 64) {
+        std::cerr << RED << "--rtt must be non-negative and --prefetch in [0, 64]." << RESET << std::endl;
+        return false;
+    }
+    if (params.steal_penalty < 1.0 || params.steal_limit < 0 || params.steal_threshold < 0.0) {
+        std::cerr << RED << "--steal-penalty must be at least 1, --steal-limit and --steal-threshold non-negative." << RESET << std::endl;
+        return false;
+    }
+    if (params.fast_share < 0.0 || params.cheap_share < 0.0 || params.fast_share + params.cheap_share > 1.0 ||
+        params.fast_backlog < 0.0 || params.affinity_speedup <= 0.0f) {
+        std::cerr << RED << "--fast-share and --cheap-share must be non-negative with a sum of at most 1, "
+                  << "--fast-backlog non-negative and --affinity-speedup positive." << RESET << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Reads the request tracing options.
+ *
+ * @param config Parsed command-line / file options.
+ * @param params Parameters receiving the trace settings.
+ * @return false (after printing an error) on invalid options.
+ */
+bool read_trace_settings(const Config& config, SimulationParams& params) {
+    params.trace_path = config.get_string("trace", "");
+    params.trace_sample = config.get_double("trace-sample", params.trace_sample);
+    int capacity = config.get_int("trace-capacity", static_cast<int>(params.trace_capacity));
+    if (params.trace_sample <= 0.0 || params.trace_sample > 1.0 || capacity < 1) {
+        std::cerr << RED << "Invalid trace options: --trace-sample must be in (0, 1] and --trace-capacity positive." << RESET << std::endl;
+        return false;
+    }
+    params.trace_capacity = static_cast<size_t>(capacity);
+    return true;
+}
+
+/**
+ * @brief Returns the traffic classes a run serves.
+ *
+ * @param params Parameters of the run.
+ * @return Traffic classes in pool order.
+ */
+std::vector<PoolConfig> traffic_classes(const SimulationParams& params) {
+    std::vector<PoolConfig> configs = params.pools.empty() ? default_pools(params) : params.pools;
+    for (PoolConfig& config : configs) {
+        if (config.request_type == 'S') {
+            config.long_share = params.long_share;
+            config.long_time[0] = params.long_time[0];
+            config.long_time[1] = params.long_time[1];
+        }
+    }
+    return configs;
+}
+
+/**
+ * @brief Reads the per-cycle metrics options.
+ *
+ * @param config Parsed command-line / file options.
+ * @param params Parameters receiving the metrics settings.
+ */
+void read_metrics_settings(const Config& config, SimulationParams& params) {
+    params.metrics_path = config.get_string("metrics", "");
+    params.metrics_csv_path = config.get_string("metrics-csv", "");
+}
+
+/**
+ * @brief Reads the queue memory budget options.
+ *
+ * @param config Parsed command-line / file options.
+ * @param params Parameters receiving the budget settings.
+ * @return false (after printing an error) on invalid options.
+ */
+bool read_spill_settings(const Config& config, SimulationParams& params) {
+    params.queue_budget = config.get_int("queue-budget", params.queue_budget);
+    params.spill_dir = config.get_string("spill-dir", params.spill_dir);
+    if (params.queue_budget < 0) {
+        std::cerr << RED << "--queue-budget must be non-negative." << RESET << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Reads the heavy-hitter detection and attack traffic options.
+ *
+ * @param config Parsed command-line / file options.
+ * @param params Parameters receiving the settings.
+ * @return false (after printing an error) on invalid options.
+ */
+bool read_heavy_hitter_settings(const Config& config, SimulationParams& params) {
+    HeavyHitterSettings& settings = params.heavy_hitters;
+    settings.share = config.get_double("auto-block-share", settings.share);
+    settings.prefix_share = config.get_double("auto-block-prefix-share", settings.prefix_share);
+    settings.window = config.get_int("auto-block-window", settings.window);
+    settings.block_cycles = config.get_int("auto-block-cycles", settings.block_cycles);
+    settings.min_requests = config.get_int("auto-block-min", static_cast<int>(settings.min_requests));
+    int width = config.get_int("auto-block-width", static_cast<int>(settings.width));
+    int capacity = config.get_int("auto-block-capacity", static_cast<int>(settings.capacity));
+    params.attack_share = config.get_double("attack-share", params.attack_share);
+    params.attackers = config.get_int("attackers", params.attackers);
+    if (settings.share < 0.0 || settings.share >= 1.0 || settings.prefix_share < 0.0 || settings.window < 1 ||
+        settings.block_cycles < 1 || settings.min_requests < 0 || width < 1 || capacity < 1) {
+        std::cerr << RED << "Invalid --auto-block options: shares must be in [0, 1) and the window, block cycles, "
+                  << "width and capacity positive." << RESET << std::endl;
+        return false;
+    }
+    if (params.attack_share < 0.0 || params.attack_share > 1.0 || params.attackers < 1 || params.attackers > 256) {
+        std::cerr << RED << "--attack-share must be in [0, 1] and --attackers in [1, 256]." << RESET << std::endl;
+        return false;
+    }
+    settings.width = static_cast<size_t>(width);
+    settings.capacity = static_cast<size_t>(capacity);
+    return true;
+}
+
+/**
+ * @brief Writes a checkpoint file of a firewall and a simulation.
+ *
+ * @param path Output file.
+ * @param firewall Firewall of the simulation.
+ * @param simulation Simulation to save.
+ * @return false if the file could not be written.
+ */
+bool write_checkpoint(const std::string& path, const Firewall& firewall, const Simulation& simulation) {
+    CheckpointWriter out;
+    firewall.save(out);
+    simulation.save(out);
+    return out.save(path);
+}
+
+/**
+ * @brief Restores a firewall and a simulation from a checkpoint file.
+ *
+ * @param path Checkpoint file.
+ * @param firewall Firewall receiving the blocked ranges (the one the simulation uses).
+ * @param simulation Simulation built with the checkpoint's traffic classes.
+ * @param restore_ids false to leave the process-wide request and server ID
+ *        counters alone, as forks running next to other simulations must.
+ * @return false (after printing an error) if the file is unreadable or does not match.
+ */
+bool read_checkpoint(const std::string& path, Firewall& firewall, Simulation& simulation, bool restore_ids) {
+    CheckpointReader in;
+    if (!in.open(path)) {
+        std::cerr << RED << "Could not open checkpoint " << path << "." << RESET << std::endl;
+        return false;
+    }
+    if (!firewall.restore(in)) {
+        std::cerr << RED << "The checkpoint " << path << " is malformed." << RESET << std::endl;
+        return false;
+    }
+    return simulation.restore(in, restore_ids);
+}
@@ -0,0 +1,670 @@
+/**
+ * @file simulation.h
+ * @brief Declares the Simulation class that runs one load balancer simulation.
+ *
+ * A Simulation owns everything one run needs (arena, load balancers, server
+ * handlers, cache and random number generator), so several simulations can
+ * run side by side on different threads. main.cpp runs a single verbose
+ * simulation; the sweep runner (see sweep.h) runs many quiet ones.
+ */
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "checkpoint.h"
+#include "config.h"
+#include "fault_injector.h"
+#include "firewall.h"
+#include "heavy_hitters.h"
+#include "instance_link.h"
+#include "load_balancer.h"
+#include "metrics_recorder.h"
+#include "pool_registry.h"
+#include "request_arena.h"
+#include "request_tracer.h"
+#include "response_cache.h"
+#include "server_handler.h"
+#include "shm_ring.h"
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Parameters of one simulation run.
+ */
+struct SimulationParams {
+    int streaming_servers = 1;          ///< Initial streaming server count.
+    int processing_servers = 1;         ///< Initial processing server count.
+    int cycles = 0;                     ///< Number of clock cycles to simulate.
+    int check_server_count_buffer = 3;  ///< Scale up/down only every this many cycles.
+    double low_load = 50.0;             ///< Queued requests per server below which a pool scales down.
+    double high_load = 80.0;            ///< Queued requests per server above which a pool scales up.
+    double arrival_rate = 0.0;          ///< Mean requests per cycle (0 = built-in burst generator).
+    bool poisson_arrivals = false;      ///< Poisson arrivals every cycle instead of bursts.
+    double streaming_share = 0.5;       ///< Fraction of generated requests that are streaming.
+    int streaming_time[2] = {1, 12};    ///< Inclusive time_to_process range of streaming requests.
+    int processing_time[2] = {1, 12};   ///< Inclusive time_to_process range of processing requests.
+    int initial_requests_per_server = 100; ///< Requests queued before the first cycle, per initial server.
+    int backends = 0;                   ///< Destination addresses drawn from this many backends (0 = random).
+    std::string cache = "off";          ///< Response cache policy name, or "off".
+    int cache_capacity = 1024;          ///< Response cache capacity in entries.
+    size_t shm_batch = 4096;            ///< Maximum requests taken from a shared-memory ring per cycle.
+    FaultSettings faults;               ///< Stalls, crashes and slow nodes injected into both pools.
+    HedgeSettings hedging;              ///< Hedged dispatch and crash retries in both pools.
+    DispatchPolicy dispatch = DispatchPolicy::FIRST_IDLE; ///< How each pool picks a server.
+    double fast_share = 0.0;            ///< Fraction of the initial servers with the fast profile.
+    double cheap_share = 0.0;           ///< Fraction of the initial servers with the cheap profile.
+    double fast_backlog = 0.0;          ///< Queued requests per server above which scaling adds fast servers, otherwise cheap ones (0 = standard servers).
+    float affinity_speedup = 1.0f;      ///< Extra speed of a pool's servers for the pool's own request type.
+    std::vector<PoolConfig> pools;      ///< Traffic classes; empty = streaming and processing from the fields above.
+    bool work_stealing = false;         ///< Idle servers take requests from other pools' queues.
+    double steal_penalty = 1.5;         ///< Service time multiplier of a request served by another pool.
+    int steal_limit = 8;                ///< Requests one pool may steal per cycle (0 = no limit).
+    double steal_threshold = 1.0;       ///< Queued requests per server a pool needs before others steal from it.
+    int time_slice = 0;                 ///< Cycles a request runs before it is preempted and requeued (0 = run to completion).
+    double long_share = 0.0;            ///< Fraction of streaming requests drawn from long_time instead.
+    int long_time[2] = {100, 400};      ///< Inclusive time_to_process range of long streaming requests.
+    std::string trace_path;             ///< Chrome trace-event JSON written at the end of the run (empty = no tracing).
+    double trace_sample = 0.01;         ///< Fraction of requests traced.
+    size_t trace_capacity = 1 << 20;    ///< Trace events kept; later events are dropped.
+    std::string checkpoint_path;        ///< Checkpoint written during the run (empty = none).
+    int checkpoint_at = 0;              ///< Cycle after which the checkpoint is written (0 = end of the run).
+    int queue_budget = 0;               ///< Queued requests per pool kept in memory before the backlog spills to disk (0 = no limit).
+    std::string spill_dir = "/tmp";     ///< Directory of the spill files.
+    std::string metrics_path;           ///< Columnar binary per-cycle metrics (empty = none).
+    std::string metrics_csv_path;       ///< The same metrics as CSV (empty = none).
+    int load_report_interval = 10;      ///< Cycles between load reports over an InstanceLink.
+    int coalesce_max = 0;               ///< Largest batch of requests for one backend run as one call (0 or 1 = per-request dispatch).
+    int coalesce_window = 32;           ///< Queued requests behind the head searched for batch members.
+    int batch_setup = 2;                ///< Nominal per-call setup cycles that a batch pays only once.
+    NetworkSettings network;            ///< Balancer-server round trip and per-server prefetch window.
+    HeavyHitterSettings heavy_hitters;  ///< Automatic blocking of top-talking sources and /24s.
+    double attack_share = 0.0;          ///< Fraction of generated requests sent from one /24 of attackers.
+    int attackers = 1;                  ///< Attacking sources in that /24 (1 to 256).
+    uint32_t seed = 0;                  ///< Seed of the run's random number generator.
+    bool verbose = true;                ///< Print per-request events to the console.
+};
+
+/**
+ * @brief Measurements of one pool at the end of a run.
+ */
+struct PoolResult {
+    std::string name;                   ///< Console name of the pool.
+    char request_type = 0;              ///< Request type served by the pool.
+    int final_servers = 0;              ///< Server count at the end.
+    int final_queue = 0;                ///< Queue length at the end.
+    long long served = 0;               ///< Requests taken from the queue.
+    double mean_wait = 0.0;             ///< Mean queue wait of served requests (cycles).
+    long long stolen = 0;               ///< Requests the pool's servers took from other pools.
+    long long given = 0;                ///< Requests other pools took from this pool's queue.
+    long long spill_writes = 0;         ///< Queued requests written to the pool's spill file.
+    size_t peak_spilled = 0;            ///< Largest number of the pool's queued requests on disk at once.
+};
+
+/**
+ * @brief Pool type used by the simulator.
+ */
+using SimulationPool = Pool;
+
+/**
+ * @brief Measurements collected during one simulation run.
+ */
+struct SimulationResult {
+    int cycles = 0;                     ///< Clock cycles simulated.
+    long long requests_generated = 0;   ///< Requests that passed the firewall and were queued.
+    long long requests_served = 0;      ///< Requests assigned to a server or served from the cache.
+    long long requests_blocked = 0;     ///< Requests rejected by the firewall.
+    int servers_created = 0;            ///< Servers created, including the initial ones.
+    int servers_removed = 0;            ///< Servers removed by scaling down.
+    int final_streaming_servers = 0;    ///< Streaming server count at the end.
+    int final_processing_servers = 0;   ///< Processing server count at the end.
+    int final_streaming_queue = 0;      ///< Streaming queue length at the end.
+    int final_processing_queue = 0;     ///< Processing queue length at the end.
+    long long server_cycles = 0;        ///< Sum of the server count over all cycles.
+    long long cache_saved_cycles = 0;   ///< Server cycles saved by cache hits.
+    double mean_streaming_wait = 0.0;   ///< Mean queue wait of served streaming requests (cycles).
+    double mean_processing_wait = 0.0;  ///< Mean queue wait of served processing requests (cycles).
+    int latency_p50 = 0;                ///< Median time from arrival to completion (cycles).
+    int latency_p90 = 0;                ///< 90th percentile latency (cycles).
+    int latency_p99 = 0;                ///< 99th percentile latency (cycles).
+    long long requests_completed = 0;   ///< Requests that finished on a server or in the cache.
+    double server_cost = 0.0;           ///< Sum of the servers' cost factors over all cycles.
+    int fast_servers_added = 0;         ///< Fast servers created by scaling up.
+    int cheap_servers_added = 0;        ///< Cheap servers created by scaling up.
+    long long requests_stolen = 0;      ///< Requests served by a pool other than their own.
+    double mean_latency = 0.0;          ///< Mean time from arrival to completion (cycles).
+    long long preemptions = 0;          ///< Time slices that ended with work left.
+    double mean_short_latency = 0.0;    ///< Mean latency of requests not drawn from a long range (cycles).
+    int short_latency_p99 = 0;          ///< 99th percentile latency of those requests (cycles).
+    ResilienceStats resilience;         ///< Faults, hedges and retries of both pools combined.
+    BatchStats batching;                ///< Coalesced backend calls of all pools combined.
+    NetworkStats network;               ///< Request handoffs of all pools combined.
+    double utilization = 0.0;           ///< Share of server cycles spent working (busy and not waiting on the network).
+    long long auto_blocks = 0;          ///< Sources and /24s blocked by heavy-hitter detection.
+    long long requests_auto_blocked = 0; ///< Requests rejected only by those automatic blocks.
+    std::vector<PoolResult> pools;      ///< Per-pool measurements, in pool order.
+};
+
+/**
+ * @class Simulation
+ * @brief Runs the request generation, filtering, dispatch and scaling loop.
+ *
+ * Each cycle the simulation (1) adds new requests, either generated or taken
+ * from a shared-memory ring, (2) advances the servers, (3) assigns queued
+ * requests to idle servers (optionally letting idle pools steal from
+ * backed-up ones), (4) scales each pool every check_server_count_buffer
+ * cycles and (5) advances the clock. Requests are
+ * routed to pools by type through a PoolRegistry, so any number of traffic
+ * classes share the same loop.
+ */
+class Simulation {
+public:
+
+    /**
+     * @brief Creates the pools, initial servers and optional response cache.
+     *
+     * @param params Parameters of the run.
+     * @param firewall Firewall applied to every request (shared, read-only).
+     * @param log Stream receiving the periodic and final log, or nullptr.
+     */
+    Simulation(const SimulationParams& params, const Firewall& firewall, std::ostream* log);
+
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    /**
+     * @brief Takes requests from a shared-memory ring instead of generating them.
+     *
+     * Must be called before run(). The ring must outlive the simulation.
+     *
+     * @param ring Ring written by external producers.
+     */
+    void set_source(ShmRing* ring);
+
+    /**
+     * @brief Takes each cycle's requests from a topology's distributor instead of generating them.
+     *
+     * The simulation also publishes its load over the link every
+     * load_report_interval cycles. Must be called before run(); the link must
+     * outlive the simulation.
+     *
+     * @param link Link to the distributor.
+     */
+    void set_link(InstanceLink* link);
+
+    /**
+     * @brief Runs the simulation for the configured number of cycles.
+     *
+     * @return Measurements of the run.
+     */
+    SimulationResult run();
+
+    /**
+     * @brief Writes the simulation state to a checkpoint.
+     *
+     * Saves the arena, every pool's queue, servers and counters, the response
+     * cache, the latency statistics, the clock and the random number
+     * generator, so a restored simulation continues exactly where this one
+     * was. Called between cycles.
+     *
+     * @param out Checkpoint being written.
+     */
+    void save(CheckpointWriter& out) const;
+
+    /**
+     * @brief Replaces the simulation state with a checkpointed one.
+     *
+     * The simulation must have been built with the same traffic classes and
+     * cache settings as the one that was saved. run() then continues from
+     * the checkpointed clock up to params.cycles without generating the
+     * initial backlog.
+     *
+     * @param in Checkpoint being read.
+     * @param restore_ids false to keep the process-wide request and server ID
+     *        counters (see read_checkpoint()).
+     * @return false (after printing an error) if the checkpoint does not match.
+     */
+    bool restore(CheckpointReader& in, bool restore_ids = true);
+
+    /**
+     * @brief Returns the current clock cycle.
+     */
+    int get_clock() const;
+
+    /**
+     * @brief Reseeds the run's random number generator.
+     *
+     * Lets runs forked from one checkpoint draw different traffic.
+     *
+     * @param seed New seed.
+     */
+    void reseed(uint32_t seed);
+
+private:
+
+    /**
+     * @brief Generates a random IPv4 address in packed form.
+     */
+    uint32_t generate_random_ip();
+
+    /**
+     * @brief Generates a destination address, from the backend pool if configured.
+     */
+    uint32_t generate_destination_ip();
+
+    /**
+     * @brief Generates the number of cycles until the next burst, in [1, 12].
+     */
+    int generate_burst_interval();
+
+    /**
+     * @brief Generates the size of the next request burst.
+     */
+    int generate_random_request_count();
+
+    /**
+     * @brief Returns the mean number of generated requests per cycle.
+     */
+    double mean_arrival_rate() const;
+
+    /**
+     * @brief Adds count generated requests to the pending burst.
+     */
+    void generate_burst(int count);
+
+    /**
+     * @brief Filters the pending burst through the firewall and queues the rest.
+     *
+     * @return Number of requests queued.
+     */
+    int route_burst();
+
+    /**
+     * @brief Counts the burst's sources in the detector and blocks the ones that crossed a threshold.
+     */
+    void detect_heavy_hitters();
+
+    /**
+     * @brief Creates requests for the published entries of the shared-memory ring.
+     */
+    void ingest_from_ring();
+
+    /**
+     * @brief Creates requests for the distributor's batch of the current cycle.
+     */
+    void ingest_from_link();
+
+    /**
+     * @brief Publishes the queued requests and servers over all pools on the link.
+     */
+    void report_load();
+
+    /**
+     * @brief Assigns queued requests of one pool to its idle servers.
+     *
+     * @param pool Pool to dispatch.
+     */
+    void dispatch(SimulationPool& pool);
+
+    /**
+     * @brief Lets a pool's idle servers take requests from the most backed-up other pool.
+     *
+     * @param thief Pool whose servers are idle.
+     */
+    void steal(SimulationPool& thief);
+
+    /**
+     * @brief Starts a request and the members in batch as one backend call.
+     *
+     * @param pool Pool being dispatched.
+     * @param leader Request the batch was built around.
+     * @param cache_key Response cache key of the batch (0 without a cache).
+     */
+    void dispatch_batch(SimulationPool& pool, RequestHandle&& leader, uint64_t cache_key);
+
+    /**
+     * @brief Scales one pool up or down according to its queue length.
+     *
+     * @param pool Pool to scale.
+     */
+    void scale(SimulationPool& pool);
+
+    /**
+     * @brief Returns the server profile of a pool for a given kind of server.
+     *
+     * @param pool Pool the server joins.
+     * @param kind Base profile (standard, fast or cheap).
+     * @return The profile, tuned to the pool's request type.
+     */
+    ServerProfile pool_profile(const SimulationPool& pool, const ServerProfile& kind) const;
+
+    /**
+     * @brief Records the queue wait of a request leaving its queue.
+     *
+     * @param pool Pool the request was queued in.
+     * @param index Arena slot of the request.
+     */
+    void record_served(SimulationPool& pool, uint32_t index);
+
+    /**
+     * @brief Records a lifecycle event of a request if tracing is on and the request is sampled.
+     */
+    void trace(TraceEvent event, const Request& request, int pool = 0, int server_id = -1);
+
+    /**
+     * @brief Records whether a newly created request was drawn from the long range.
+     */
+    void mark_long(uint32_t index, bool is_long);
+
+    /**
+     * @brief Looks a request up in the response cache unless it was looked up before.
+     *
+     * @return true on a hit during this call.
+     */
+    bool lookup_once(uint32_t index, uint64_t key);
+
+    /**
+     * @brief Packs the per-slot state of a queued request that is being spilled.
+     */
+    uint64_t pack_slot(const RequestHandle& request);
+
+    /**
+     * @brief Applies packed per-slot state to the new slot of a request read back from disk.
+     */
+    void unpack_slot(const RequestHandle& request, uint64_t tag);
+
+    /**
+     * @brief Records the arrival-to-completion latency of a finished request.
+     */
+    void record_completed(uint32_t index);
+
+    /**
+     * @brief Returns the latency below which the given fraction of a histogram's requests fall.
+     */
+    int latency_percentile(const std::vector<long long>& histogram, double fraction) const;
+
+    /**
+     * @brief Writes the periodic statistics block to the log.
+     */
+    void log_progress();
+
+    /**
+     * @brief Records the current cycle's row of metrics.
+     */
+    void record_metrics();
+
+    /**
+     * @brief Writes the final statistics to the log.
+     */
+    void log_summary();
+
+    SimulationParams params;
+    const Firewall& firewall;
+    std::ostream null_log;
+    std::ostream& logFile;
+    std::mt19937 rng;
+    RequestArena arena;
+    PoolRegistry<SimulationPool> pools;
+
+    /**
+     * @brief Upper bound of each pool's share of generated requests, in pool order.
+     */
+    std::vector<double> cumulative_share;
+
+    std::unique_ptr<ResponseCache> cache;
+
+    /**
+     * @brief Lifecycle tracer (only with a trace path).
+     */
+    std::unique_ptr<RequestTracer> tracer;
+
+    /**
+     * @brief Per-cycle metrics recorder (only with a metrics path).
+     */
+    std::unique_ptr<MetricsRecorder> metrics;
+
+    /**
+     * @brief Net servers added by scaling in the current cycle, per pool (only with metrics).
+     */
+    std::vector<int> scale_events;
+    ShmRing* ring;
+
+    /**
+     * @brief Link to a topology's distributor (nullptr = generate or ingest locally).
+     */
+    InstanceLink* link;
+
+    /**
+     * @brief Batch taken from the link, reused every cycle.
+     */
+    std::vector<Arrival> arrivals;
+    std::vector<uint32_t> backends;
+
+    /**
+     * @brief Requests created this cycle, waiting for the firewall.
+     */
+    std::vector<RequestHandle> burst;
+
+    /**
+     * @brief Requests waiting for a busy server during one dispatch pass.
+     */
+    std::vector<RequestHandle> deferred;
+
+    /**
+     * @brief Members of the batch being dispatched, besides the request it is built around.
+     */
+    std::vector<RequestHandle> batch;
+
+    /**
+     * @brief Scratch buffers for batch firewall classification.
+     */
+    std::vector<uint32_t> burst_ips;
+    std::vector<uint8_t> burst_verdicts;
+
+    /**
+     * @brief Top-talker detector (only with heavy-hitter detection).
+     */
+    std::unique_ptr<HeavyHitterDetector> detector;
+
+    /**
+     * @brief Ranges blocked by the detector, with their expiry; consulted after the shared firewall.
+     */
+    Firewall auto_firewall;
+
+    /**
+     * @brief Ranges the detector reported in the current burst.
+     */
+    std::vector<HeavyHitter> promotions;
+
+    /**
+     * @brief Verdicts of auto_firewall for the current burst.
+     */
+    std::vector<uint8_t> auto_verdicts;
+
+    /**
+     * @brief Network of the attacking sources (only with an attack share).
+     */
+    uint32_t attack_prefix;
+
+    /**
+     * @brief Clock cycle at which each queued request arrived, by arena slot.
+     */
+    std::vector<int> arrival_clock;
+
+    /**
+     * @brief Number of served requests per latency (in cycles).
+     */
+    std::vector<long long> latency_histogram;
+
+    /**
+     * @brief Sum of the latencies of all completed requests.
+     */
+    long long latency_sum;
+
+    /**
+     * @brief SLOT_LONG and SLOT_CACHE_CHECKED flags of each request, by arena slot.
+     */
+    std::vector<uint8_t> slot_flags;
+
+    /**
+     * @brief Set in slot_flags when the request was drawn from a long range.
+     */
+    static constexpr uint8_t SLOT_LONG = 1;
+
+    /**
+     * @brief Set in slot_flags once the request was looked up in the response cache.
+     */
+    static constexpr uint8_t SLOT_CACHE_CHECKED = 2;
+
+    /**
+     * @brief Latency histogram and sum of the requests not drawn from a long range.
+     */
+    std::vector<long long> short_latency_histogram;
+    long long short_latency_sum;
+
+    /**
+     * @brief Cycles until the next burst and the size of that burst (built-in generator).
+     */
+    int time_to_add_requests;
+    int requests_per_clock;
+
+    /**
+     * @brief Whether the state came from a checkpoint.
+     */
+    bool restored;
+
+    int clock;
+    SimulationResult result;
+};
+
+/**
+ * @brief Reads the fault injection, hedging and retry options.
+ *
+ * Options: --stall-probability, --stall-cycles, --crash-probability,
+ * --restart-cycles, --slow-fraction, --slow-multiplier, --hedge-after and
+ * --max-retries.
+ *
+ * @param config Parsed command-line / file options.
+ * @param params Parameters receiving params.faults and params.hedging.
+ */
+void read_resilience_settings(const Config& config, SimulationParams& params);
+
+/**
+ * @brief Reads the server fleet and dispatch options.
+ *
+ * Options: --dispatch=first-idle|sec (sec = shortest expected completion),
+ * --fast-share and --cheap-share (fractions of the initial servers with the
+ * fast and cheap profiles), --fast-backlog, --affinity-speedup, --types
+ * (traffic classes, see parse_pool_types(); replaces the streaming and
+ * processing pools), --steal with --steal-penalty, --steal-limit and
+ * --steal-threshold (cross-pool work stealing), and --time-slice with
+ * --long-share and --long-time=low,high (time-sliced scheduling and a share
+ * of long streaming requests), and --coalesce=N with --coalesce-window and
+ * --batch-setup (run up to N queued requests for the same backend as one
+ * call that pays the setup cycles once), and --rtt=N with --prefetch=N
+ * (balancer-server round trip in cycles and requests a busy server may
+ * hold ahead, see ServerHandler::set_network()).
+ *
+ * @param config Parsed command-line / file options.
+ * @param params Parameters receiving the fleet settings.
+ * @return false (after printing an error) on invalid options.
+ */
+bool read_fleet_settings(const Config& config, SimulationParams& params);
+
+/**
+ * @brief Reads the request tracing options.
+ *
+ * Options: --trace=PATH (write a Chrome trace-event JSON file of sampled
+ * requests at the end of the run), --trace-sample (fraction of requests
+ * traced, default 0.01) and --trace-capacity (events kept, default 1048576).
+ *
+ * @param config Parsed command-line / file options.
+ * @param params Parameters receiving the trace settings.
+ * @return false (after printing an error) on invalid options.
+ */
+bool read_trace_settings(const Config& config, SimulationParams& params);
+
+/**
+ * @brief Returns the traffic classes a run serves.
+ *
+ * These are the --types classes, or streaming and processing built from the
+ * two-pool fields; the long streaming settings are applied to type 'S'.
+ *
+ * @param params Parameters of the run.
+ * @return Traffic classes in pool order.
+ */
+std::vector<PoolConfig> traffic_classes(const SimulationParams& params);
+
+/**
+ * @brief Reads the per-cycle metrics options.
+ *
+ * --metrics=PATH writes every cycle's queue depths, server and idle counts,
+ * arrivals, assignments, blocked requests and scale events as columnar
+ * binary (see MetricsRecorder); --metrics-csv=PATH writes them as CSV.
+ *
+ * @param config Parsed command-line / file options.
+ * @param params Parameters receiving the metrics settings.
+ */
+void read_metrics_settings(const Config& config, SimulationParams& params);
+
+/**
+ * @brief Reads the queue memory budget options.
+ *
+ * --queue-budget=N keeps at most about N queued requests per pool in memory
+ * and spills the rest of the backlog to --spill-dir (default /tmp).
+ *
+ * @param config Parsed command-line / file options.
+ * @param params Parameters receiving the budget settings.
+ * @return false (after printing an error) on invalid options.
+ */
+bool read_spill_settings(const Config& config, SimulationParams& params);
+
+/**
+ * @brief Reads the heavy-hitter detection and attack traffic options.
+ *
+ * --auto-block-share=X blocks a source sending more than X of the requests
+ * in the sliding window, and a /24 sending more than
+ * --auto-block-prefix-share (default twice X), for --auto-block-cycles
+ * (default 500). --auto-block-window (cycles, default 200),
+ * --auto-block-min (requests in the window before anything is blocked,
+ * default 500), --auto-block-width (sketch counters per row, default 4096)
+ * and --auto-block-capacity (tracked top talkers, default 64) size the
+ * detector. --attack-share=X sends X of the generated requests from
+ * --attackers=N (default 1) sources in one /24.
+ *
+ * @param config Parsed command-line / file options.
+ * @param params Parameters receiving the settings.
+ * @return false (after printing an error) on invalid options.
+ */
+bool read_heavy_hitter_settings(const Config& config, SimulationParams& params);
+
+/**
+ * @brief Writes a checkpoint file of a firewall and a simulation.
+ *
+ * The file holds the firewall's blocked ranges followed by Simulation::save().
+ *
+ * @param path Output file.
+ * @param firewall Firewall of the simulation.
+ * @param simulation Simulation to save.
+ * @return false if the file could not be written.
+ */
+bool write_checkpoint(const std::string& path, const Firewall& firewall, const Simulation& simulation);
+
+/**
+ * @brief Restores a firewall and a simulation from a checkpoint file.
+ *
+ * The file is memory-mapped and its sections copied out in order.
+ *
+ * @param path Checkpoint file.
+ * @param firewall Firewall receiving the blocked ranges (the one the simulation uses).
+ * @param simulation Simulation built with the checkpoint's traffic classes.
+ * @param restore_ids false to leave the process-wide request and server ID
+ *        counters alone, as forks running next to other simulations must.
+ * @return false (after printing an error) if the file is unreadable or does not match.
+ */
+bool read_checkpoint(const std::string& path, Firewall& firewall, Simulation& simulation, bool restore_ids = true);
+
+#endif
@@ -0,0 +1,237 @@
+/**
+ * @file spill_file.cpp
+ * @brief Implements the append-only segment file used to spill queue backlogs.
+ */
+
+#include "spill_file.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <type_traits>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * @brief Rounds a file offset up to the next page boundary.
+ *
+ * @param offset File offset.
+ * @return Smallest page-aligned offset not below offset.
+ */
+uint64_t page_align(uint64_t offset) {
+    static const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    return (offset + page - 1) / page * page;
+}
+
+/**
+ * @brief Writes a whole buffer at a file offset.
+ *
+ * @param fd File descriptor.
+ * @param data First byte.
+ * @param size Number of bytes.
+ * @param offset File offset.
+ * @return false on a write error.
+ */
+bool write_all(int fd, const char* data, size_t size, uint64_t offset) {
+    while (size > 0) {
+        ssize_t written = pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+} // namespace
+
+/**
+ * @brief Constructs a spill file with no file open.
+ */
+SpillFile::SpillFile() : fd(-1), end(0), record_count(0) {
+    static_assert(std::is_trivially_copyable<SpilledRequest>::value, "spilled requests are written as raw bytes");
+}
+
+/**
+ * @brief Unmaps any prefetched segment and closes the file.
+ */
+SpillFile::~SpillFile() {
+    for (const Segment& segment : pending) {
+        if (segment.mapping) {
+            munmap(segment.mapping, segment.count * sizeof(SpilledRequest));
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+/**
+ * @brief Creates the temporary file.
+ *
+ * The file is unlinked immediately, so it disappears with the process.
+ *
+ * @param directory Directory the file is created in.
+ * @return false if the file could not be created.
+ */
+bool SpillFile::open(const std::string& directory) {
+    std::string path = directory + "/lb_spill_XXXXXX";
+    fd = mkstemp(&path[0]);
+    if (fd < 0) {
+        std::cerr << "mkstemp(" << path << ") failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    unlink(path.c_str());
+    return true;
+}
+
+/**
+ * @brief Appends records as a new segment at the back of the FIFO.
+ *
+ * The segment starts on a page boundary so that prefetch() can map it.
+ *
+ * @param records First record.
+ * @param count Number of records.
+ * @return false if the write failed (nothing is appended then).
+ */
+bool SpillFile::append(const SpilledRequest* records, size_t count) {
+    if (fd < 0 || count == 0) {
+        return false;
+    }
+    uint64_t offset = page_align(end);
+    if (!write_all(fd, reinterpret_cast<const char*>(records), count * sizeof(SpilledRequest), offset)) {
+        return false;
+    }
+    end = offset + count * sizeof(SpilledRequest);
+    pending.push_back({offset, count, nullptr});
+    record_count += count;
+    return true;
+}
+
+/**
+ * @brief Maps the oldest segment and asks the kernel to read it ahead.
+ *
+ * Does nothing if the segment is already mapped or there is none. A failed
+ * mapping is ignored; take_front() then falls back to pread.
+ */
+void SpillFile::prefetch() {
+    if (pending.empty() || pending.front().mapping) {
+        return;
+    }
+    Segment& segment = pending.front();
+    size_t bytes = segment.count * sizeof(SpilledRequest);
+    void* mapping = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, static_cast<off_t>(segment.offset));
+    if (mapping == MAP_FAILED) {
+        return;
+    }
+    madvise(mapping, bytes, MADV_SEQUENTIAL);
+    madvise(mapping, bytes, MADV_WILLNEED);
+    segment.mapping = mapping;
+}
+
+/**
+ * @brief Removes the oldest segment and appends its records to a vector.
+ *
+ * The segment's disk blocks are released: the whole file is truncated once
+ * the last segment is read, otherwise the segment is punched out. A segment
+ * that cannot be read is removed all the same, so its records are lost.
+ *
+ * @param records Vector receiving the records.
+ * @return false if there is no segment or it could not be read.
+ */
+bool SpillFile::take_front(std::vector<SpilledRequest>& records) {
+    if (pending.empty()) {
+        return false;
+    }
+    Segment segment = pending.front();
+    size_t bytes = segment.count * sizeof(SpilledRequest);
+    bool read = true;
+    if (segment.mapping) {
+        const SpilledRequest* first = static_cast<const SpilledRequest*>(segment.mapping);
+        records.insert(records.end(), first, first + segment.count);
+        munmap(segment.mapping, bytes);
+    } else {
+        read = read_segment(segment, records);
+    }
+    pending.pop_front();
+    record_count -= segment.count;
+    if (pending.empty()) {
+        end = 0;
+        if (ftruncate(fd, 0) != 0) {
+            std::cerr << "ftruncate(spill file) failed: " << std::strerror(errno) << std::endl;
+        }
+    } else {
+        fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(segment.offset),
+                  static_cast<off_t>(bytes));
+    }
+    return read;
+}
+
+/**
+ * @brief Appends every spilled record, oldest first, without removing any.
+ *
+ * @param records Vector receiving the records.
+ * @return false if a segment could not be read.
+ */
+bool SpillFile::copy_all(std::vector<SpilledRequest>& records) const {
+    for (const Segment& segment : pending) {
+        if (!read_segment(segment, records)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Returns the number of records on disk.
+ *
+ * @return Spilled records not taken back yet.
+ */
+size_t SpillFile::size() const {
+    return record_count;
+}
+
+/**
+ * @brief Returns the number of segments on disk.
+ *
+ * @return Segments not taken back yet.
+ */
+size_t SpillFile::segments() const {
+    return pending.size();
+}
+
+/**
+ * @brief Reads a segment with pread.
+ *
+ * @param segment Segment to read.
+ * @param records Vector receiving the records.
+ * @return false if the read came up short.
+ */
+bool SpillFile::read_segment(const Segment& segment, std::vector<SpilledRequest>& records) const {
+    size_t first = records.size();
+    records.resize(first + segment.count);
+    char* data = reinterpret_cast<char*>(records.data() + first);
+    size_t remaining = segment.count * sizeof(SpilledRequest);
+    uint64_t offset = segment.offset;
+    while (remaining > 0) {
+        ssize_t got = pread(fd, data, remaining, static_cast<off_t>(offset));
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            records.resize(first);
+            return false;
+        }
+        data += got;
+        remaining -= static_cast<size_t>(got);
+        offset += static_cast<uint64_t>(got);
+    }
+    return true;
+}
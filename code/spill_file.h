@@ -0,0 +1,146 @@
+/**
+ * @file spill_file.h
+ * @brief Declares the append-only segment file a LoadBalancer spills its backlog to.
+ *
+ * A SpillFile holds the cold middle of a queue as a FIFO of segments. Each
+ * segment is one block of SpilledRequest records appended at the end of a
+ * single unlinked temporary file, starting on a page boundary so that it can
+ * be memory-mapped on its own. Segments are read back oldest first; the
+ * oldest can be mapped and prefetched before it is needed, and its disk
+ * space is released once read.
+ */
+
+#ifndef SPILL_FILE_H
+#define SPILL_FILE_H
+
+#include "request.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A queued request written to disk.
+ */
+struct SpilledRequest {
+    Request request;  ///< Copy of the request, including its ID and remaining work.
+    uint64_t tag;     ///< Per-slot state of the queue's owner (see SpillHooks).
+};
+
+/**
+ * @class SpillFile
+ * @brief FIFO of request segments in an append-only temporary file.
+ */
+class SpillFile {
+public:
+
+    /**
+     * @brief Constructs a spill file with no file open.
+     */
+    SpillFile();
+
+    /**
+     * @brief Unmaps any prefetched segment and closes the file.
+     */
+    ~SpillFile();
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    /**
+     * @brief Creates the temporary file.
+     *
+     * The file is unlinked immediately, so it disappears with the process.
+     *
+     * @param directory Directory the file is created in.
+     * @return false if the file could not be created.
+     */
+    bool open(const std::string& directory);
+
+    /**
+     * @brief Appends records as a new segment at the back of the FIFO.
+     *
+     * @param records First record.
+     * @param count Number of records.
+     * @return false if the write failed (nothing is appended then).
+     */
+    bool append(const SpilledRequest* records, size_t count);
+
+    /**
+     * @brief Maps the oldest segment and asks the kernel to read it ahead.
+     *
+     * Does nothing if the segment is already mapped or there is none.
+     */
+    void prefetch();
+
+    /**
+     * @brief Removes the oldest segment and appends its records to a vector.
+     *
+     * A segment that cannot be read is removed all the same.
+     *
+     * @param records Vector receiving the records.
+     * @return false if there is no segment or it could not be read.
+     */
+    bool take_front(std::vector<SpilledRequest>& records);
+
+    /**
+     * @brief Appends every spilled record, oldest first, without removing any.
+     *
+     * @param records Vector receiving the records.
+     * @return false if a segment could not be read.
+     */
+    bool copy_all(std::vector<SpilledRequest>& records) const;
+
+    /**
+     * @brief Returns the number of records on disk.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Returns the number of segments on disk.
+     */
+    size_t segments() const;
+
+private:
+
+    /**
+     * @brief One block of records in the file.
+     */
+    struct Segment {
+        uint64_t offset;  ///< Page-aligned file offset of the first record.
+        size_t count;     ///< Number of records.
+        void* mapping;    ///< Prefetched mapping of the segment, or nullptr.
+    };
+
+    /**
+     * @brief Reads a segment with pread.
+     *
+     * @param segment Segment to read.
+     * @param records Vector receiving the records.
+     * @return false if the read came up short.
+     */
+    bool read_segment(const Segment& segment, std::vector<SpilledRequest>& records) const;
+
+    /**
+     * @brief Descriptor of the unlinked file (-1 if none).
+     */
+    int fd;
+
+    /**
+     * @brief File offset where the next segment is written.
+     */
+    uint64_t end;
+
+    /**
+     * @brief Segments on disk, oldest first.
+     */
+    std::deque<Segment> pending;
+
+    /**
+     * @brief Records on disk.
+     */
+    size_t record_count;
+};
+
+#endif
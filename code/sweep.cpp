@@ -0,0 +1,765 @@
+/**
+ * @file sweep.cpp
+ * @brief Implements the work-stealing pool and the parameter-sweep runner.
+ */
+
+#include "sweep.h"
+#include "alloc_counter.h"
+#include "firewall.h"
+#include "large_alloc.h"
+#include "profiler.h"
+#include "simulation.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+// color codes
+#define RED     "\033[31m"
+#define GREEN   "\033[32m"
+#define RESET   "\033[0m"
+
+/**
+ * @brief Starts the worker threads.
+ *
+ * @param threads Number of workers (at least one).
+ */
+WorkStealingPool::WorkStealingPool(size_t threads) : pending(0), next_worker(0), steals(0), stopping(false) {
+    if (threads == 0) {
+        threads = 1;
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back(new Worker());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        this->threads.emplace_back(&WorkStealingPool::work, this, i);
+    }
+}
+
+/**
+ * @brief Waits for all submitted tasks and joins the workers.
+ */
+WorkStealingPool::~WorkStealingPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> guard(state_lock);
+        stopping = true;
+    }
+    work_available.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+/**
+ * @brief Queues a task on the next worker's deque, round-robin.
+ *
+ * @param task Function run once on some worker.
+ */
+void WorkStealingPool::submit(std::function<void()> task) {
+    size_t index;
+    {
+        std::lock_guard<std::mutex> guard(state_lock);
+        index = next_worker;
+        next_worker = (next_worker + 1) % workers.size();
+        pending++;
+    }
+    {
+        std::lock_guard<std::mutex> guard(workers[index]->lock);
+        workers[index]->tasks.push_back(std::move(task));
+    }
+    work_available.notify_all();
+}
+
+/**
+ * @brief Blocks until every submitted task has finished.
+ */
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> guard(state_lock);
+    all_done.wait(guard, [this] { return pending == 0; });
+}
+
+/**
+ * @brief Returns the number of tasks a worker took from another worker's deque.
+ *
+ * @return Total steals since construction.
+ */
+size_t WorkStealingPool::get_steals() const {
+    std::lock_guard<std::mutex> guard(state_lock);
+    return steals;
+}
+
+/**
+ * @brief Pops a task from the worker's own deque or steals one.
+ *
+ * The worker's own deque is used LIFO; victims are scanned starting at the
+ * next worker and robbed FIFO, taking their oldest task.
+ *
+ * @param index Worker looking for work.
+ * @param task Receives the task.
+ * @return true if a task was found.
+ */
+bool WorkStealingPool::take(size_t index, std::function<void()>& task) {
+    {
+        Worker& own = *workers[index];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < workers.size(); ++offset) {
+        Worker& victim = *workers[(index + offset) % workers.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            std::lock_guard<std::mutex> state_guard(state_lock);
+            steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Main loop of a worker: run tasks until the pool stops.
+ *
+ * With NUMA placement on, worker i runs on node i modulo the node count, so
+ * the simulations it builds take their buffers from that node.
+ *
+ * @param index Worker index.
+ */
+void WorkStealingPool::work(size_t index) {
+    numa_pin_thread(index);
+    std::function<void()> task;
+    while (true) {
+        if (take(index, task)) {
+            task();
+            task = nullptr;
+            std::lock_guard<std::mutex> guard(state_lock);
+            if (--pending == 0) {
+                all_done.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(state_lock);
+        if (stopping) {
+            return;
+        }
+        // tasks may have been queued between take() and acquiring the lock, so
+        // only sleep briefly; submit() also wakes every worker
+        work_available.wait_for(guard, std::chrono::milliseconds(10));
+    }
+}
+
+namespace {
+
+/**
+ * @brief One swept option: its values and how a value is applied to a run.
+ */
+struct SweepDimension {
+    const char* key;                               ///< Option name (without --).
+    double fallback;                               ///< Value when the option is not given.
+    void (*apply)(SimulationParams&, double);      ///< Stores a value in a run's parameters.
+    std::vector<double> values;                    ///< Values to sweep.
+    bool boolean = false;                          ///< Also accepts true/false (as 1/0), like Config::get_bool().
+};
+
+/**
+ * @brief Values of one sweep point (one CSV row per repeat), one per dimension.
+ */
+using SweepPoint = std::vector<double>;
+
+/**
+ * @brief Returns the swept options; a new parameter only needs a row here.
+ */
+std::vector<SweepDimension> sweep_dimensions() {
+    return {
+        {"streaming-servers", 10, [](SimulationParams& p, double v) { p.streaming_servers = static_cast<int>(v); }, {}},
+        {"processing-servers", 10, [](SimulationParams& p, double v) { p.processing_servers = static_cast<int>(v); }, {}},
+        {"low-load", 50, [](SimulationParams& p, double v) { p.low_load = v; }, {}},
+        {"high-load", 80, [](SimulationParams& p, double v) { p.high_load = v; }, {}},
+        {"check-buffer", 3, [](SimulationParams& p, double v) { p.check_server_count_buffer = static_cast<int>(v); }, {}},
+        {"arrival-rate", 0, [](SimulationParams& p, double v) { p.arrival_rate = v; }, {}},
+        {"hedge-after", 0, [](SimulationParams& p, double v) { p.hedging.hedge_after = static_cast<int>(v); }, {}},
+        {"steal", 0, [](SimulationParams& p, double v) { p.work_stealing = v != 0.0; }, {}, true},
+        {"time-slice", 0, [](SimulationParams& p, double v) { p.time_slice = static_cast<int>(v); }, {}},
+        {"coalesce", 0, [](SimulationParams& p, double v) { p.coalesce_max = static_cast<int>(v); }, {}},
+        {"rtt", 0, [](SimulationParams& p, double v) { p.network.rtt = static_cast<int>(v); }, {}},
+        {"prefetch", 0, [](SimulationParams& p, double v) { p.network.prefetch = static_cast<int>(v); }, {}},
+    };
+}
+
+/**
+ * @brief Returns the values of the dimension with the given option name.
+ */
+const std::vector<double>& swept(const std::vector<SweepDimension>& dimensions, const std::string& key) {
+    static const std::vector<double> none;
+    for (const SweepDimension& dimension : dimensions) {
+        if (key == dimension.key) {
+            return dimension.values;
+        }
+    }
+    return none;
+}
+
+/**
+ * @brief Returns every combination of the dimensions' values.
+ *
+ * The last dimension varies fastest, as in nested loops over the dimensions
+ * in order.
+ *
+ * @param dimensions Swept options, each with at least one value.
+ * @return One point per combination.
+ */
+std::vector<SweepPoint> cartesian_product(const std::vector<SweepDimension>& dimensions) {
+    std::vector<SweepPoint> points(1);
+    for (const SweepDimension& dimension : dimensions) {
+        std::vector<SweepPoint> extended;
+        extended.reserve(points.size() * dimension.values.size());
+        for (const SweepPoint& point : points) {
+            for (double value : dimension.values) {
+                extended.push_back(point);
+                extended.back().push_back(value);
+            }
+        }
+        points.swap(extended);
+    }
+    return points;
+}
+
+/**
+ * @brief Parses one swept option into its list of values.
+ *
+ * Accepts a comma-separated list whose items are numbers or ranges
+ * "first:last:step" (inclusive of last).
+ *
+ * @param text Option value.
+ * @param values Receives the values.
+ * @return false if the text is malformed or yields no values.
+ */
+bool parse_values(const std::string& text, std::vector<double>& values) {
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = text.find(',', start);
+        std::string item = text.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        double parts[3] = {0.0, 0.0, 1.0};
+        int part_count = 0;
+        const char* cursor = item.c_str();
+        while (part_count < 3) {
+            char* end = nullptr;
+            parts[part_count++] = std::strtod(cursor, &end);
+            if (end == cursor) {
+                return false;
+            }
+            cursor = end;
+            if (*cursor != ':') {
+                break;
+            }
+            cursor++;
+        }
+        if (*cursor != '\0' || part_count == 2) {
+            return false;
+        }
+        if (part_count == 1) {
+            values.push_back(parts[0]);
+        } else {
+            if (parts[2] <= 0.0 || parts[1] < parts[0]) {
+                return false;
+            }
+            for (double value = parts[0]; value <= parts[1] + parts[2] * 1e-9; value += parts[2]) {
+                values.push_back(value);
+            }
+        }
+        if (comma == std::string::npos) {
+            break;
+        }
+        start = comma + 1;
+    }
+    return !values.empty();
+}
+
+/**
+ * @brief Replaces the true/false words of a comma-separated list with 1 and 0.
+ *
+ * Accepts the same words as Config::get_bool(); other items are kept.
+ */
+std::string boolean_items(const std::string& text) {
+    std::string converted;
+    size_t start = 0;
+    while (true) {
+        size_t comma = text.find(',', start);
+        std::string item = text.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        if (item == "true" || item == "yes" || item == "on") {
+            item = "1";
+        } else if (item == "false" || item == "no" || item == "off") {
+            item = "0";
+        }
+        converted += item;
+        if (comma == std::string::npos) {
+            return converted;
+        }
+        converted += ',';
+        start = comma + 1;
+    }
+}
+
+/**
+ * @brief Reads one swept option, falling back to a single default value.
+ *
+ * @param boolean Also accept true/false items (as 1/0).
+ * @return false (after printing an error) if the option is malformed.
+ */
+bool read_values(const Config& config, const std::string& key, double fallback, bool boolean,
+                 std::vector<double>& values) {
+    if (!config.has(key)) {
+        values.push_back(fallback);
+        return true;
+    }
+    std::string text = config.get_string(key, "");
+    if (!parse_values(boolean ? boolean_items(text) : text, values)) {
+        std::cerr << RED << "Invalid value for --" << key << ": expected v1,v2,... or first:last:step"
+                  << (boolean ? " (or true,false)." : ".") << RESET << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Derives a well-mixed 32-bit seed for a run (splitmix64 finalizer).
+ */
+uint32_t run_seed(uint64_t base, uint64_t run) {
+    uint64_t z = base + (run + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return static_cast<uint32_t>(z ^ (z >> 31));
+}
+
+/**
+ * @brief Returns the share of server capacity spent on cancelled or crashed copies.
+ */
+double duplicate_load(const SimulationResult& result) {
+    return result.server_cycles > 0 ? 100.0 * result.resilience.duplicate_cycles / result.server_cycles : 0.0;
+}
+
+/**
+ * @brief Prints mean p99 latency and duplicate load for each hedge threshold.
+ *
+ * The p99 change is relative to the runs without hedging (hedge_after 0)
+ * when those are part of the sweep.
+ */
+void report_hedging(const std::vector<double>& hedge, const std::vector<SimulationParams>& params,
+                    const std::vector<SimulationResult>& results) {
+    double baseline_p99 = -1.0;
+    std::cout << "hedge_after  mean_p99  p99_change%  duplicate_load%" << std::endl;
+    for (double threshold : hedge) {
+        double p99 = 0.0, load = 0.0;
+        int runs = 0;
+        for (size_t run = 0; run < results.size(); ++run) {
+            if (params[run].hedging.hedge_after == static_cast<int>(threshold)) {
+                p99 += results[run].latency_p99;
+                load += duplicate_load(results[run]);
+                runs++;
+            }
+        }
+        if (runs == 0) {
+            continue;
+        }
+        p99 /= runs;
+        load /= runs;
+        if (threshold == 0) {
+            baseline_p99 = p99;
+        }
+        char change[32] = "-";
+        if (baseline_p99 > 0.0) {
+            std::snprintf(change, sizeof(change), "%.1f", (p99 - baseline_p99) / baseline_p99 * 100.0);
+        }
+        char line[96];
+        std::snprintf(line, sizeof(line), "%11d  %8.1f  %11s  %15.2f", static_cast<int>(threshold), p99, change, load);
+        std::cout << line << std::endl;
+    }
+}
+
+/**
+ * @brief Prints servers created, server cycles and p99 latency with and without work stealing.
+ *
+ * The changes are relative to the runs without stealing.
+ */
+void report_stealing(const std::vector<SimulationParams>& params, const std::vector<SimulationResult>& results) {
+    double created[2] = {0.0, 0.0}, cycles[2] = {0.0, 0.0}, p99[2] = {0.0, 0.0}, stolen[2] = {0.0, 0.0};
+    int runs[2] = {0, 0};
+    for (size_t run = 0; run < results.size(); ++run) {
+        int mode = params[run].work_stealing ? 1 : 0;
+        created[mode] += results[run].servers_created;
+        cycles[mode] += static_cast<double>(results[run].server_cycles);
+        p99[mode] += results[run].latency_p99;
+        stolen[mode] += static_cast<double>(results[run].requests_stolen);
+        runs[mode]++;
+    }
+    if (runs[0] == 0 || runs[1] == 0) {
+        return;
+    }
+    std::cout << "steal  servers_created  server_cycles  mean_p99  stolen" << std::endl;
+    for (int mode = 0; mode < 2; ++mode) {
+        char line[96];
+        std::snprintf(line, sizeof(line), "%5s  %15.1f  %13.0f  %8.1f  %6.0f", mode ? "on" : "off",
+                      created[mode] / runs[mode], cycles[mode] / runs[mode], p99[mode] / runs[mode], stolen[mode] / runs[mode]);
+        std::cout << line << std::endl;
+    }
+    if (created[0] > 0.0 && cycles[0] > 0.0) {
+        std::cout << "Work stealing changes servers created by "
+                  << (created[1] / runs[1] - created[0] / runs[0]) / (created[0] / runs[0]) * 100.0
+                  << "% and server cycles by " << (cycles[1] / runs[1] - cycles[0] / runs[0]) / (cycles[0] / runs[0]) * 100.0
+                  << "%." << std::endl;
+    }
+}
+
+/**
+ * @brief Prints sojourn time, short-request latency and preemptions for each time slice.
+ *
+ * The short-request p99 change is relative to the runs without slicing
+ * (time_slice 0) when those are part of the sweep.
+ */
+void report_time_slicing(const std::vector<double>& slices, const std::vector<SimulationParams>& params,
+                         const std::vector<SimulationResult>& results) {
+    double baseline_p99 = -1.0;
+    std::cout << "time_slice  mean_sojourn  mean_p99  short_mean  short_p99  short_p99_change%  preemptions" << std::endl;
+    for (double quantum : slices) {
+        double mean = 0.0, p99 = 0.0, short_mean = 0.0, short_p99 = 0.0, preemptions = 0.0;
+        int runs = 0;
+        for (size_t run = 0; run < results.size(); ++run) {
+            if (params[run].time_slice == static_cast<int>(quantum)) {
+                mean += results[run].mean_latency;
+                p99 += results[run].latency_p99;
+                short_mean += results[run].mean_short_latency;
+                short_p99 += results[run].short_latency_p99;
+                preemptions += static_cast<double>(results[run].preemptions);
+                runs++;
+            }
+        }
+        if (runs == 0) {
+            continue;
+        }
+        short_p99 /= runs;
+        if (quantum == 0) {
+            baseline_p99 = short_p99;
+        }
+        char change[32] = "-";
+        if (baseline_p99 > 0.0) {
+            std::snprintf(change, sizeof(change), "%.1f", (short_p99 - baseline_p99) / baseline_p99 * 100.0);
+        }
+        char line[128];
+        std::snprintf(line, sizeof(line), "%10d  %12.2f  %8.1f  %10.2f  %9.1f  %17s  %11.0f", static_cast<int>(quantum),
+                      mean / runs, p99 / runs, short_mean / runs, short_p99, change, preemptions / runs);
+        std::cout << line << std::endl;
+    }
+}
+
+/**
+ * @brief Prints throughput, latency and batch size for each coalescing limit.
+ *
+ * The latency changes are relative to per-request dispatch (coalesce 0 or
+ * 1) when it is part of the sweep.
+ */
+void report_coalescing(const std::vector<double>& limits, const std::vector<SimulationParams>& params,
+                       const std::vector<SimulationResult>& results) {
+    double baseline_mean = -1.0, baseline_p99 = -1.0;
+    std::cout << "coalesce  completed/cycle  mean_latency  mean_change%  mean_p99  p99_change%  mean_batch  server_cycles" << std::endl;
+    for (double limit : limits) {
+        double throughput = 0.0, mean = 0.0, p99 = 0.0, cycles = 0.0, batches = 0.0, batched = 0.0;
+        int runs = 0;
+        for (size_t run = 0; run < results.size(); ++run) {
+            if (params[run].coalesce_max == static_cast<int>(limit)) {
+                const SimulationResult& r = results[run];
+                throughput += r.cycles > 0 ? static_cast<double>(r.requests_completed) / r.cycles : 0.0;
+                mean += r.mean_latency;
+                p99 += r.latency_p99;
+                cycles += static_cast<double>(r.server_cycles);
+                batches += static_cast<double>(r.batching.batches);
+                batched += static_cast<double>(r.batching.batched_requests);
+                runs++;
+            }
+        }
+        if (runs == 0) {
+            continue;
+        }
+        mean /= runs;
+        p99 /= runs;
+        if (limit <= 1) {
+            baseline_mean = mean;
+            baseline_p99 = p99;
+        }
+        char mean_change[32] = "-", p99_change[32] = "-";
+        if (baseline_mean > 0.0) {
+            std::snprintf(mean_change, sizeof(mean_change), "%.1f", (mean - baseline_mean) / baseline_mean * 100.0);
+        }
+        if (baseline_p99 > 0.0) {
+            std::snprintf(p99_change, sizeof(p99_change), "%.1f", (p99 - baseline_p99) / baseline_p99 * 100.0);
+        }
+        char line[160];
+        std::snprintf(line, sizeof(line), "%8d  %15.3f  %12.2f  %12s  %8.1f  %11s  %10.2f  %13.0f", static_cast<int>(limit),
+                      throughput / runs, mean, mean_change, p99, p99_change, batches > 0.0 ? batched / batches : 1.0,
+                      cycles / runs);
+        std::cout << line << std::endl;
+    }
+}
+
+/**
+ * @brief Prints throughput, utilization and latency for each round trip and prefetch window.
+ *
+ * The changes are relative to the zero-latency handoff (round trip 0,
+ * no prefetching) when it is part of the sweep.
+ */
+void report_network(const std::vector<double>& rtts, const std::vector<double>& windows,
+                    const std::vector<SimulationParams>& params, const std::vector<SimulationResult>& results) {
+    double baseline_mean = -1.0, baseline_utilization = -1.0;
+    std::cout << "  rtt  prefetch  completed/cycle  utilization%  util_change%  network_gap%  mean_latency  mean_change%"
+                 "  mean_wait  window_wait  server_cycles" << std::endl;
+    for (double rtt : rtts) {
+        for (double window : windows) {
+            double throughput = 0.0, utilization = 0.0, gap = 0.0, mean = 0.0, wait = 0.0, window_wait = 0.0, cycles = 0.0;
+            int runs = 0;
+            for (size_t run = 0; run < results.size(); ++run) {
+                if (params[run].network.rtt != static_cast<int>(rtt) || params[run].network.prefetch != static_cast<int>(window)) {
+                    continue;
+                }
+                const SimulationResult& r = results[run];
+                throughput += r.cycles > 0 ? static_cast<double>(r.requests_completed) / r.cycles : 0.0;
+                utilization += r.utilization;
+                gap += r.server_cycles > 0 ? static_cast<double>(r.network.gap_cycles) / r.server_cycles : 0.0;
+                mean += r.mean_latency;
+                wait += (r.mean_streaming_wait + r.mean_processing_wait) / 2.0;
+                window_wait += r.network.prefetch_hits > 0
+                                   ? static_cast<double>(r.network.window_wait_cycles) / r.network.prefetch_hits
+                                   : 0.0;
+                cycles += static_cast<double>(r.server_cycles);
+                runs++;
+            }
+            if (runs == 0) {
+                continue;
+            }
+            mean /= runs;
+            utilization /= runs;
+            if (rtt == 0 && window == 0) {
+                baseline_mean = mean;
+                baseline_utilization = utilization;
+            }
+            char mean_change[32] = "-", utilization_change[32] = "-";
+            if (baseline_mean > 0.0) {
+                std::snprintf(mean_change, sizeof(mean_change), "%.1f", (mean - baseline_mean) / baseline_mean * 100.0);
+            }
+            if (baseline_utilization > 0.0) {
+                std::snprintf(utilization_change, sizeof(utilization_change), "%.1f",
+                              (utilization - baseline_utilization) / baseline_utilization * 100.0);
+            }
+            char line[192];
+            std::snprintf(line, sizeof(line), "%5d  %8d  %15.3f  %12.1f  %12s  %12.1f  %12.2f  %12s  %9.1f  %11.2f  %13.0f",
+                          static_cast<int>(rtt), static_cast<int>(window), throughput / runs, utilization * 100.0,
+                          utilization_change, gap / runs * 100.0, mean, mean_change, wait / runs, window_wait / runs,
+                          cycles / runs);
+            std::cout << line << std::endl;
+        }
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Runs a parameter sweep and writes its results as CSV.
+ *
+ * Runs are independent: each builds its own Simulation with a seed derived
+ * from --seed and the run number, so results do not depend on the thread
+ * count or the order in which workers pick up runs.
+ *
+ * @param config Parsed command-line / file options.
+ * @return 0 on success, 1 on invalid options or an unwritable output file.
+ */
+int run_sweep(const Config& config) {
+    std::vector<SweepDimension> dimensions = sweep_dimensions();
+    for (SweepDimension& dimension : dimensions) {
+        if (!read_values(config, dimension.key, dimension.fallback, dimension.boolean, dimension.values)) {
+            return 1;
+        }
+    }
+
+    uint64_t base_seed = static_cast<uint64_t>(config.get_int("seed", 1));
+    int samples = config.get_int("samples", 0);
+    std::vector<SweepPoint> points;
+    if (samples > 0) {
+        std::mt19937 rng(static_cast<uint32_t>(base_seed));
+        for (int i = 0; i < samples; ++i) {
+            SweepPoint point;
+            for (const SweepDimension& dimension : dimensions) {
+                point.push_back(dimension.values[rng() % dimension.values.size()]);
+            }
+            points.push_back(point);
+        }
+    } else {
+        points = cartesian_product(dimensions);
+    }
+
+    int repeats = config.get_int("repeats", 1);
+    if (repeats < 1) {
+        repeats = 1;
+    }
+    int cycles = config.get_int("cycles", 10000);
+    double cycle_seconds = config.get_double("cycle-seconds", 1.0);
+    std::string output = config.get_string("output", "sweep.csv");
+    size_t thread_count = static_cast<size_t>(config.get_int("threads", static_cast<int>(std::thread::hardware_concurrency())));
+
+    std::ofstream csv(output);
+    if (!csv) {
+        std::cerr << RED << "Could not open " << output << " for writing." << RESET << std::endl;
+        return 1;
+    }
+
+    Firewall firewall;
+    std::string range = config.get_string("block-range", "none");
+    size_t comma = range.find(',');
+    if (range != "none" && comma != std::string::npos) {
+        firewall.blockRange(range.substr(0, comma), range.substr(comma + 1));
+    }
+
+    SimulationParams fleet;
+    if (!read_fleet_settings(config, fleet) || !read_spill_settings(config, fleet) ||
+        !read_heavy_hitter_settings(config, fleet)) {
+        return 1;
+    }
+
+    size_t runs = points.size() * static_cast<size_t>(repeats);
+    std::vector<SimulationParams> params(runs);
+    std::vector<SimulationResult> results(runs);
+    for (size_t run = 0; run < runs; ++run) {
+        const SweepPoint& point = points[run / repeats];
+        SimulationParams& p = params[run];
+        p.cycles = cycles;
+        p.initial_requests_per_server = config.get_int("initial-queue", 100);
+        p.backends = config.get_int("backends", 0);
+        p.cache = config.get_string("cache", "off");
+        p.cache_capacity = config.get_int("cache-capacity", 1024);
+        p.seed = run_seed(base_seed, run);
+        p.verbose = false;
+        read_resilience_settings(config, p);
+        p.dispatch = fleet.dispatch;
+        p.fast_share = fleet.fast_share;
+        p.cheap_share = fleet.cheap_share;
+        p.fast_backlog = fleet.fast_backlog;
+        p.affinity_speedup = fleet.affinity_speedup;
+        p.pools = fleet.pools;
+        p.steal_penalty = fleet.steal_penalty;
+        p.steal_limit = fleet.steal_limit;
+        p.steal_threshold = fleet.steal_threshold;
+        p.coalesce_window = fleet.coalesce_window;
+        p.batch_setup = fleet.batch_setup;
+        p.long_share = fleet.long_share;
+        p.queue_budget = fleet.queue_budget;
+        p.spill_dir = fleet.spill_dir;
+        p.heavy_hitters = fleet.heavy_hitters;
+        p.attack_share = fleet.attack_share;
+        p.attackers = fleet.attackers;
+        p.long_time[0] = fleet.long_time[0];
+        p.long_time[1] = fleet.long_time[1];
+        for (size_t d = 0; d < dimensions.size(); ++d) {
+            dimensions[d].apply(p, point[d]);
+        }
+    }
+
+    // every run forks from the checkpoint; a probe restore checks it, loads the shared firewall once and
+    // sets the process-wide request and server ID counters, which the concurrent forks must not rewind
+    std::string checkpoint = config.get_string("restore", "");
+    if (!checkpoint.empty()) {
+        Simulation probe(params[0], firewall, nullptr);
+        if (!read_checkpoint(checkpoint, firewall, probe)) {
+            return 1;
+        }
+    }
+
+    std::cout << GREEN << "Sweep: " << runs << " runs of " << cycles << " cycles on "
+              << thread_count << " threads." << RESET << std::endl;
+    bool profiling = config.get_bool("profile", false) && PROFILE_COMPILED;
+    profile_set_enabled(profiling);
+    auto started = std::chrono::steady_clock::now();
+    size_t steals = 0;
+    {
+        WorkStealingPool pool(thread_count);
+        for (size_t run = 0; run < runs; ++run) {
+            pool.submit([&params, &results, &firewall, &checkpoint, run] {
+                Simulation simulation(params[run], firewall, nullptr);
+                if (!checkpoint.empty()) {
+                    Firewall rules;
+                    if (!read_checkpoint(checkpoint, rules, simulation, false)) {
+                        return;
+                    }
+                    simulation.reseed(params[run].seed);
+                }
+                results[run] = simulation.run();
+            });
+        }
+        pool.wait();
+        steals = pool.get_steals();
+    }
+    if (profiling) {
+        profile_set_enabled(false);
+        profile_report(std::cout);
+    }
+    memory_report(std::cout);
+    large_alloc_report(std::cout);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    csv << "run,seed,streaming_servers,processing_servers,low_load,high_load,check_buffer,arrival_rate,"
+           "cycles,requests_generated,requests_served,requests_blocked,throughput_per_cycle,"
+           "latency_p50,latency_p90,latency_p99,mean_streaming_wait,mean_processing_wait,"
+           "final_streaming_servers,final_processing_servers,final_queue,servers_created,servers_removed,"
+           "server_cycles,server_hours,hedge_after,crashes,retries,failed,hedges,duplicate_load_pct,server_cost,steal,stolen,"
+           "time_slice,preemptions,mean_latency,mean_short_latency,short_latency_p99,coalesce,batches,batched_requests,"
+           "rtt,prefetch,utilization,network_gap_cycles,prefetched\n";
+    for (size_t run = 0; run < runs; ++run) {
+        const SimulationParams& p = params[run];
+        const SimulationResult& r = results[run];
+        double throughput = r.cycles > 0 ? static_cast<double>(r.requests_served) / r.cycles : 0.0;
+        csv << run << ',' << p.seed << ',' << p.streaming_servers << ',' << p.processing_servers << ','
+            << p.low_load << ',' << p.high_load << ',' << p.check_server_count_buffer << ',' << p.arrival_rate << ','
+            << r.cycles << ',' << r.requests_generated << ',' << r.requests_served << ',' << r.requests_blocked << ','
+            << throughput << ',' << r.latency_p50 << ',' << r.latency_p90 << ',' << r.latency_p99 << ','
+            << r.mean_streaming_wait << ',' << r.mean_processing_wait << ','
+            << r.final_streaming_servers << ',' << r.final_processing_servers << ','
+            << r.final_streaming_queue + r.final_processing_queue << ',' << r.servers_created << ',' << r.servers_removed << ','
+            << r.server_cycles << ',' << r.server_cycles * cycle_seconds / 3600.0 << ','
+            << p.hedging.hedge_after << ',' << r.resilience.crashes << ',' << r.resilience.retries << ','
+            << r.resilience.failed << ',' << r.resilience.hedges_issued << ',' << duplicate_load(r) << ',' << r.server_cost << ','
+            << (p.work_stealing ? 1 : 0) << ',' << r.requests_stolen << ','
+            << p.time_slice << ',' << r.preemptions << ',' << r.mean_latency << ',' << r.mean_short_latency << ','
+            << r.short_latency_p99 << ',' << p.coalesce_max << ',' << r.batching.batches << ','
+            << r.batching.batched_requests << ',' << p.network.rtt << ',' << p.network.prefetch << ','
+            << r.utilization << ',' << r.network.gap_cycles << ',' << r.network.prefetched << '\n';
+    }
+    const std::vector<double>& hedge = swept(dimensions, "hedge-after");
+    const std::vector<double>& slice = swept(dimensions, "time-slice");
+    const std::vector<double>& coalesce = swept(dimensions, "coalesce");
+    const std::vector<double>& rtt = swept(dimensions, "rtt");
+    const std::vector<double>& prefetch = swept(dimensions, "prefetch");
+    if (hedge.size() > 1) {
+        report_hedging(hedge, params, results);
+    }
+    if (swept(dimensions, "steal").size() > 1) {
+        report_stealing(params, results);
+    }
+    if (slice.size() > 1) {
+        report_time_slicing(slice, params, results);
+    }
+    if (coalesce.size() > 1) {
+        report_coalescing(coalesce, params, results);
+    }
+    if (rtt.size() > 1 || prefetch.size() > 1) {
+        report_network(rtt, prefetch, params, results);
+    }
+
+    std::cout << GREEN << "Sweep finished in " << elapsed << " s (" << steals << " tasks stolen); results written to "
+              << output << "." << RESET << std::endl;
+    return 0;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file sweep.h
+ * @brief Declares the parameter-sweep runner used for capacity planning.
+ *
+ * A sweep runs many independent quiet simulations (see Simulation) over a
+ * grid or a random sample of parameters on a work-stealing thread pool and
+ * writes one CSV row per run.
+ */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "config.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class WorkStealingPool
+ * @brief Fixed set of worker threads, each with its own task deque.
+ *
+ * Tasks are spread round-robin over the workers' deques. A worker takes
+ * tasks from the back of its own deque and, when that is empty, steals from
+ * the front of the others, so long simulations on one worker do not leave
+ * the remaining workers idle.
+ */
+class WorkStealingPool {
+public:
+
+    /**
+     * @brief Starts the worker threads.
+     *
+     * @param threads Number of workers (at least one).
+     */
+    explicit WorkStealingPool(size_t threads);
+
+    /**
+     * @brief Waits for all submitted tasks and joins the workers.
+     */
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+     * @brief Queues a task.
+     *
+     * @param task Function run once on some worker.
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * @brief Blocks until every submitted task has finished.
+     */
+    void wait();
+
+    /**
+     * @brief Returns the number of tasks a worker took from another worker's deque.
+     *
+     * @return Total steals since construction.
+     */
+    size_t get_steals() const;
+
+private:
+
+    /**
+     * @brief Task deque owned by one worker.
+     */
+    struct Worker {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    /**
+     * @brief Main loop of worker index.
+     */
+    void work(size_t index);
+
+    /**
+     * @brief Pops a task from the worker's own deque or steals one.
+     */
+    bool take(size_t index, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    mutable std::mutex state_lock;
+    std::condition_variable work_available;
+    std::condition_variable all_done;
+    size_t pending;
+    size_t next_worker;
+    size_t steals;
+    bool stopping;
+};
+
+/**
+ * @brief Runs a parameter sweep and writes its results as CSV.
+ *
+ * Each swept option accepts a single value, a comma-separated list or a
+ * range "first:last:step": --streaming-servers, --processing-servers,
+ * --low-load, --high-load, --check-buffer, --arrival-rate, --hedge-after,
+ * --steal (true/false or 1/0, e.g. --steal=false,true), --time-slice,
+ * --coalesce, --rtt and --prefetch. When several hedge thresholds are swept,
+ * a table of mean p99 latency against the duplicate load is printed as well;
+ * sweeping --steal=0,1 prints the servers created with and without work
+ * stealing, and several time slices print sojourn times, short-request
+ * latency and preemptions per slice length, and several coalescing limits
+ * print throughput and latency against per-request dispatch; several round
+ * trips or prefetch windows print utilization, network gaps and queueing
+ * against the zero-latency handoff. The full grid
+ * is run unless --samples=N asks for N random points from it. Other options:
+ * --cycles, --initial-queue (requests queued per initial server before the
+ * first cycle, default 100), --repeats (seeds per point), --seed, --threads, --output
+ * (CSV path, default sweep.csv), --cycle-seconds (wall time of one cycle,
+ * used for server-hours), --block-range, --restore (fork every run from a
+ * checkpoint written with --checkpoint: the checkpoint supplies the servers,
+ * queues and blocked ranges, each run is reseeded with its own seed and runs
+ * up to --cycles), --profile (per-phase timing summed
+ * over all runs, see profiler.h), the fault options read by
+ * read_resilience_settings(), the fleet options read by
+ * read_fleet_settings(), the queue budget read by read_spill_settings() and
+ * the automatic blocking and attack options read by read_heavy_hitter_settings().
+ * --numa=true pins worker i to NUMA node i (modulo the node count) so each
+ * run's server tables and queues are allocated on the node that runs it.
+ * The heap usage of each component, summed over all runs, and the huge-page
+ * counters (see large_alloc.h) are printed at the end.
+ *
+ * @param config Parsed command-line / file options.
+ * @return 0 on success, 1 on invalid options or an unwritable output file.
+ */
+int run_sweep(const Config& config);
+
+#endif
@@ -0,0 +1,345 @@
+/**
+ * @file topology.cpp
+ * @brief Implements the front distributor and the multi-instance topology runner.
+ */
+
+#include "topology.h"
+#include "alloc_counter.h"
+#include "large_alloc.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+// color codes
+#define RED     "\033[31m"
+#define GREEN   "\033[32m"
+#define RESET   "\033[0m"
+
+/**
+ * @brief Parses a --distribution value.
+ *
+ * @param text "ecmp", "round-robin" or "least-queue".
+ * @param distribution Receives the strategy.
+ * @return false for an unknown name.
+ */
+bool parse_distribution(const std::string& text, Distribution& distribution) {
+    if (text == "ecmp") {
+        distribution = Distribution::ECMP_HASH;
+    } else if (text == "round-robin") {
+        distribution = Distribution::ROUND_ROBIN;
+    } else if (text == "least-queue") {
+        distribution = Distribution::LEAST_QUEUE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Returns the console name of a distribution strategy.
+ *
+ * @param distribution Strategy.
+ * @return Name as accepted by parse_distribution().
+ */
+const char* distribution_name(Distribution distribution) {
+    switch (distribution) {
+    case Distribution::ECMP_HASH:
+        return "ecmp";
+    case Distribution::ROUND_ROBIN:
+        return "round-robin";
+    case Distribution::LEAST_QUEUE:
+        return "least-queue";
+    }
+    return "?";
+}
+
+/**
+ * @brief Creates the instances and their links.
+ *
+ * Every instance gets the shared settings with its own seed, no console
+ * output and no per-run files (traces, metrics, checkpoints), which would
+ * collide between instances. Instance i is built with NUMA node i (modulo
+ * the node count) as home, the node its thread is pinned to in run().
+ *
+ * @param params Parameters of the run.
+ * @param firewall Firewall rules copied into every instance.
+ */
+Topology::Topology(const TopologyParams& params, const Firewall& firewall)
+    : params(params), classes(traffic_classes(params.instance)), rng(params.seed),
+      firewalls(static_cast<size_t>(params.instances), firewall), batches(static_cast<size_t>(params.instances)),
+      next_instance(0), estimated_queue(static_cast<size_t>(params.instances), 0),
+      report_cycle(static_cast<size_t>(params.instances), -1), routed(static_cast<size_t>(params.instances), 0),
+      imbalance_sum(0.0), imbalance_samples(0), imbalance_peak(0.0) {
+    double total_share = 0.0;
+    for (const PoolConfig& config : classes) {
+        total_share += config.share;
+        cumulative_share.push_back(total_share);
+    }
+    for (double& bound : cumulative_share) {
+        bound = total_share > 0.0 ? bound / total_share : 1.0;
+    }
+    backends.resize(params.instance.backends > 0 ? params.instance.backends : 0);
+    for (uint32_t& backend : backends) {
+        backend = rng();
+    }
+
+    int home = numa_set_home(-1);
+    for (int index = 0; index < params.instances; ++index) {
+        numa_set_home(index);
+        SimulationParams instance = params.instance;
+        instance.seed = params.seed + 1 + static_cast<uint32_t>(index);
+        instance.verbose = false;
+        instance.trace_path.clear();
+        instance.metrics_path.clear();
+        instance.metrics_csv_path.clear();
+        instance.checkpoint_path.clear();
+        links.emplace_back(new InstanceLink(static_cast<size_t>(params.max_lag)));
+        instances.emplace_back(new Simulation(instance, firewalls[index], nullptr));
+        instances.back()->set_link(links.back().get());
+    }
+    numa_set_home(home);
+}
+
+/**
+ * @brief Starts the instance threads, distributes the traffic and waits for the instances.
+ *
+ * The distributor runs on the calling thread. Each cycle it draws the
+ * cluster's arrivals, sends every instance its share (possibly none) and
+ * moves on; it only waits when an instance falls max_lag cycles behind.
+ *
+ * @return Per-instance and cluster measurements.
+ */
+TopologyResult Topology::run() {
+    TopologyResult result;
+    result.instances.resize(instances.size());
+    auto started = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t index = 0; index < instances.size(); ++index) {
+        threads.emplace_back([this, &result, index] {
+            numa_pin_thread(index);
+            result.instances[index] = instances[index]->run();
+        });
+    }
+
+    std::poisson_distribution<int> poisson(params.arrival_rate);
+    int interval = params.instance.load_report_interval;
+    for (int cycle = 0; cycle < params.instance.cycles; ++cycle) {
+        bool sample = cycle % interval == 0;
+        if (sample || params.distribution == Distribution::LEAST_QUEUE) {
+            read_reports(sample);
+        }
+        generate(poisson(rng));
+        for (const Arrival& arrival : cycle_arrivals) {
+            size_t index = pick(arrival);
+            batches[index].push_back(arrival);
+            routed[index]++;
+        }
+        for (size_t index = 0; index < links.size(); ++index) {
+            links[index]->send(batches[index]);
+        }
+    }
+    for (auto& link : links) {
+        link->close();
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    result.routed = routed;
+    result.mean_imbalance = imbalance_samples > 0 ? imbalance_sum / imbalance_samples : 0.0;
+    result.peak_imbalance = imbalance_peak;
+    return result;
+}
+
+/**
+ * @brief Draws one cycle's arrivals for the whole cluster.
+ *
+ * Classes, processing times and destinations are drawn the way a single
+ * simulation draws its own traffic.
+ *
+ * @param count Number of requests.
+ */
+void Topology::generate(int count) {
+    std::uniform_real_distribution<double> share(0.0, 1.0);
+    cycle_arrivals.clear();
+    for (int i = 0; i < count; ++i) {
+        Arrival arrival;
+        arrival.ip_in = rng();
+        arrival.ip_out = backends.empty() ? rng() : backends[rng() % backends.size()];
+        double draw = share(rng);
+        size_t index = 0;
+        while (index + 1 < cumulative_share.size() && draw >= cumulative_share[index]) {
+            index++;
+        }
+        const PoolConfig& config = classes[index];
+        const int* range = config.time_range;
+        arrival.is_long = config.long_share > 0.0 && share(rng) < config.long_share;
+        if (arrival.is_long) {
+            range = config.long_time;
+        }
+        arrival.time_to_process = range[0] + static_cast<int>(rng() % static_cast<uint32_t>(range[1] - range[0] + 1));
+        arrival.request_type = config.request_type;
+        cycle_arrivals.push_back(arrival);
+    }
+}
+
+/**
+ * @brief Picks the instance a request is sent to.
+ *
+ * @param arrival Request being distributed.
+ * @return Instance index.
+ */
+size_t Topology::pick(const Arrival& arrival) {
+    size_t count = instances.size();
+    switch (params.distribution) {
+    case Distribution::ECMP_HASH: {
+        uint64_t flow = (static_cast<uint64_t>(arrival.ip_in) << 32 | arrival.ip_out) * 0x9E3779B97F4A7C15ull;
+        flow ^= flow >> 29;
+        return static_cast<size_t>(((flow >> 32) * count) >> 32);
+    }
+    case Distribution::ROUND_ROBIN: {
+        size_t index = next_instance;
+        next_instance = (next_instance + 1) % count;
+        return index;
+    }
+    case Distribution::LEAST_QUEUE: {
+        size_t best = 0;
+        for (size_t index = 1; index < count; ++index) {
+            if (estimated_queue[index] < estimated_queue[best]) {
+                best = index;
+            }
+        }
+        estimated_queue[best]++;
+        return best;
+    }
+    }
+    return 0;
+}
+
+/**
+ * @brief Reads the instances' latest load reports into the least-queue estimates and imbalance statistics.
+ *
+ * An estimate is reset to the reported queue only when a newer report
+ * arrived; until then it keeps counting the requests sent since.
+ *
+ * @param sample Whether to add the reports to the imbalance statistics.
+ */
+void Topology::read_reports(bool sample) {
+    long long total = 0;
+    long long largest = 0;
+    bool complete = true;
+    for (size_t index = 0; index < links.size(); ++index) {
+        LoadReport report = links[index]->latest();
+        if (report.cycle != report_cycle[index]) {
+            report_cycle[index] = report.cycle;
+            estimated_queue[index] = report.queued;
+        }
+        complete = complete && report.cycle >= 0;
+        total += report.queued;
+        largest = std::max<long long>(largest, report.queued);
+    }
+    if (sample && complete && total > 0) {
+        double ratio = static_cast<double>(largest) * links.size() / total;
+        imbalance_sum += ratio;
+        imbalance_samples++;
+        imbalance_peak = std::max(imbalance_peak, ratio);
+    }
+}
+
+/**
+ * @brief Runs a topology from command-line options and prints per-instance results.
+ *
+ * @param config Parsed command-line / file options.
+ * @return 0 on success, 1 on invalid options or an unwritable output file.
+ */
+int run_topology(const Config& config) {
+    TopologyParams params;
+    params.instances = config.get_int("instances", params.instances);
+    params.max_lag = config.get_int("max-lag", params.max_lag);
+    params.seed = config.has("seed") ? static_cast<uint32_t>(config.get_int("seed", 0)) : static_cast<uint32_t>(std::time(nullptr));
+    std::string distribution = config.get_string("distribution", "ecmp");
+    if (!parse_distribution(distribution, params.distribution)) {
+        std::cerr << RED << "Unknown --distribution '" << distribution << "': expected ecmp, round-robin or least-queue." << RESET << std::endl;
+        return 1;
+    }
+    params.arrival_rate = config.get_double("arrival-rate", 39.5 / 6.5 * params.instances);
+
+    SimulationParams& instance = params.instance;
+    instance.cycles = config.get_int("cycles", 10000);
+    instance.streaming_servers = config.get_int("streaming-servers", 2);
+    instance.processing_servers = config.get_int("processing-servers", 2);
+    instance.check_server_count_buffer = config.get_int("check-buffer", 3);
+    instance.low_load = config.get_double("low-load", 50.0);
+    instance.high_load = config.get_double("high-load", 80.0);
+    instance.backends = config.get_int("backends", 0);
+    instance.load_report_interval = config.get_int("report-interval", instance.load_report_interval);
+    read_resilience_settings(config, instance);
+    if (!read_fleet_settings(config, instance) || !read_spill_settings(config, instance) ||
+        !read_heavy_hitter_settings(config, instance)) {
+        return 1;
+    }
+    if (params.instances < 1 || params.max_lag < 1 || instance.load_report_interval < 1 || instance.cycles < 1 ||
+        params.arrival_rate <= 0.0) {
+        std::cerr << RED << "--instances, --max-lag, --report-interval and --cycles must be positive and "
+                  << "--arrival-rate above 0." << RESET << std::endl;
+        return 1;
+    }
+
+    std::string output = config.get_string("output", "topology.csv");
+    std::ofstream csv(output);
+    if (!csv) {
+        std::cerr << RED << "Could not open " << output << " for writing." << RESET << std::endl;
+        return 1;
+    }
+    Firewall firewall;
+    std::string range = config.get_string("block-range", "none");
+    size_t comma = range.find(',');
+    if (range != "none" && comma != std::string::npos) {
+        firewall.blockRange(range.substr(0, comma), range.substr(comma + 1));
+    }
+
+    std::cout << "Running " << params.instances << " instances behind a front distributor ("
+              << distribution_name(params.distribution) << ", " << params.arrival_rate << " requests per cycle, load reports every "
+              << instance.load_report_interval << " cycles, lag up to " << params.max_lag << " cycles)." << std::endl;
+    Topology topology(params, firewall);
+    TopologyResult result = topology.run();
+
+    csv << "instance,routed,requests_generated,requests_blocked,requests_served,requests_completed,final_servers,"
+           "servers_created,servers_removed,final_queue,server_cycles,mean_latency,latency_p99\n";
+    char line[160];
+    std::snprintf(line, sizeof(line), "%8s %10s %10s %10s %8s %8s %10s %10s %6s", "instance", "routed", "blocked",
+                  "completed", "servers", "created", "queue", "mean lat", "p99");
+    std::cout << line << std::endl;
+    long long servers_created = 0, server_cycles = 0, completed = 0;
+    for (size_t index = 0; index < result.instances.size(); ++index) {
+        const SimulationResult& r = result.instances[index];
+        int servers = 0, queue = 0;
+        for (const PoolResult& pool : r.pools) {
+            servers += pool.final_servers;
+            queue += pool.final_queue;
+        }
+        servers_created += r.servers_created;
+        server_cycles += r.server_cycles;
+        completed += r.requests_completed;
+        std::snprintf(line, sizeof(line), "%8zu %10lld %10lld %10lld %8d %8d %10d %10.2f %6d", index, result.routed[index],
+                      r.requests_blocked, r.requests_completed, servers, r.servers_created, queue, r.mean_latency, r.latency_p99);
+        std::cout << line << std::endl;
+        csv << index << ',' << result.routed[index] << ',' << r.requests_generated << ',' << r.requests_blocked << ','
+            << r.requests_served << ',' << r.requests_completed << ',' << servers << ',' << r.servers_created << ','
+            << r.servers_removed << ',' << queue << ',' << r.server_cycles << ',' << r.mean_latency << ','
+            << r.latency_p99 << '\n';
+    }
+    std::cout << "Reported queue imbalance (largest / mean): " << result.mean_imbalance << " on average, "
+              << result.peak_imbalance << " at peak." << std::endl;
+    std::cout << "Cluster: " << completed << " requests completed, " << servers_created << " servers created, "
+              << server_cycles << " server cycles." << std::endl;
+    memory_report(std::cout);
+    large_alloc_report(std::cout);
+    std::cout << GREEN << "Topology finished in " << result.seconds << " s; results written to " << output << "." << RESET << std::endl;
+    return 0;
+}
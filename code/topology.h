@@ -0,0 +1,226 @@
+/**
+ * @file topology.h
+ * @brief Declares the multi-instance cluster topology: a front distributor and N balancer instances.
+ *
+ * Each instance is a complete Simulation with its own firewall, pools,
+ * load balancers and server handlers, running on its own thread. The front
+ * distributor generates the cluster's traffic cycle by cycle and spreads it
+ * over the instances (ECMP flow hash, round-robin or least-queue) through an
+ * InstanceLink per instance. Instances report their load back
+ * asynchronously, so least-queue decisions use reports that are a few cycles
+ * old, as an L4 tier's would be.
+ */
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include "config.h"
+#include "firewall.h"
+#include "instance_link.h"
+#include "simulation.h"
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief How the front distributor picks an instance for a request.
+ */
+enum class Distribution {
+    ECMP_HASH,    ///< Hash of the source and destination address, so a flow always lands on the same instance.
+    ROUND_ROBIN,  ///< Instances in turn.
+    LEAST_QUEUE   ///< Fewest queued requests by the last report plus the requests sent since.
+};
+
+/**
+ * @brief Parses a --distribution value.
+ *
+ * @param text "ecmp", "round-robin" or "least-queue".
+ * @param distribution Receives the strategy.
+ * @return false for an unknown name.
+ */
+bool parse_distribution(const std::string& text, Distribution& distribution);
+
+/**
+ * @brief Returns the console name of a distribution strategy.
+ *
+ * @param distribution Strategy.
+ * @return Name as accepted by parse_distribution().
+ */
+const char* distribution_name(Distribution distribution);
+
+/**
+ * @brief Parameters of a topology run.
+ */
+struct TopologyParams {
+    int instances = 4;                                ///< Balancer instances.
+    Distribution distribution = Distribution::ECMP_HASH; ///< Front distribution strategy.
+    double arrival_rate = 0.0;                        ///< Mean requests per cycle over the whole cluster.
+    int max_lag = 8;                                  ///< Cycles the distributor may run ahead of an instance.
+    uint32_t seed = 0;                                ///< Seed of the distributor; instance i uses seed + 1 + i.
+    SimulationParams instance;                        ///< Settings shared by every instance (cycles, pools, scaling, ...).
+};
+
+/**
+ * @brief Measurements of a topology run.
+ */
+struct TopologyResult {
+    std::vector<SimulationResult> instances;  ///< Per-instance results, in instance order.
+    std::vector<long long> routed;            ///< Requests the distributor sent to each instance.
+    double mean_imbalance = 0.0;              ///< Mean over report samples of the largest reported queue over the mean.
+    double peak_imbalance = 0.0;              ///< Largest such ratio.
+    double seconds = 0.0;                     ///< Wall time of the run.
+};
+
+/**
+ * @class Topology
+ * @brief Runs N balancer instances behind a front distributor.
+ */
+class Topology {
+public:
+
+    /**
+     * @brief Creates the instances and their links.
+     *
+     * @param params Parameters of the run.
+     * @param firewall Firewall rules copied into every instance.
+     */
+    Topology(const TopologyParams& params, const Firewall& firewall);
+
+    Topology(const Topology&) = delete;
+    Topology& operator=(const Topology&) = delete;
+
+    /**
+     * @brief Starts the instance threads, distributes the traffic and waits for the instances.
+     *
+     * @return Per-instance and cluster measurements.
+     */
+    TopologyResult run();
+
+private:
+
+    /**
+     * @brief Draws one cycle's arrivals for the whole cluster.
+     *
+     * @param count Number of requests.
+     */
+    void generate(int count);
+
+    /**
+     * @brief Picks the instance a request is sent to.
+     *
+     * @param arrival Request being distributed.
+     * @return Instance index.
+     */
+    size_t pick(const Arrival& arrival);
+
+    /**
+     * @brief Reads the instances' latest load reports into the least-queue estimates and imbalance statistics.
+     *
+     * @param sample Whether to add the reports to the imbalance statistics.
+     */
+    void read_reports(bool sample);
+
+    /**
+     * @brief Parameters of the run.
+     */
+    TopologyParams params;
+
+    /**
+     * @brief Traffic classes, in the instances' pool order.
+     */
+    std::vector<PoolConfig> classes;
+
+    /**
+     * @brief Upper bound of each class's share of the traffic, normalized to 1.
+     */
+    std::vector<double> cumulative_share;
+
+    /**
+     * @brief Distributor's random number generator.
+     */
+    std::mt19937 rng;
+
+    /**
+     * @brief Destination addresses (empty = random destinations).
+     */
+    std::vector<uint32_t> backends;
+
+    /**
+     * @brief Each instance's copy of the firewall rules.
+     */
+    std::vector<Firewall> firewalls;
+
+    /**
+     * @brief Links to the instances.
+     */
+    std::vector<std::unique_ptr<InstanceLink>> links;
+
+    /**
+     * @brief The balancer instances.
+     */
+    std::vector<std::unique_ptr<Simulation>> instances;
+
+    /**
+     * @brief Current cycle's arrivals before distribution.
+     */
+    std::vector<Arrival> cycle_arrivals;
+
+    /**
+     * @brief Current cycle's batch for each instance.
+     */
+    std::vector<std::vector<Arrival>> batches;
+
+    /**
+     * @brief Next instance of the round-robin strategy.
+     */
+    size_t next_instance;
+
+    /**
+     * @brief Least-queue estimate: last reported queue plus requests sent since.
+     */
+    std::vector<long long> estimated_queue;
+
+    /**
+     * @brief Cycle of the report each estimate is based on.
+     */
+    std::vector<int> report_cycle;
+
+    /**
+     * @brief Requests sent to each instance.
+     */
+    std::vector<long long> routed;
+
+    /**
+     * @brief Sum and count of the sampled imbalance ratios, and the largest one.
+     */
+    double imbalance_sum;
+    long long imbalance_samples;
+    double imbalance_peak;
+};
+
+/**
+ * @brief Runs a topology from command-line options and prints per-instance results.
+ *
+ * Options: --instances=N (default 4), --distribution=ecmp|round-robin|least-queue,
+ * --arrival-rate=X (requests per cycle over the cluster, default 6.08 per
+ * instance), --report-interval=N (cycles between load reports, default 10),
+ * --max-lag=N (cycles the distributor may run ahead, default 8), --cycles,
+ * --seed, --streaming-servers and --processing-servers (per instance,
+ * default 2), --types, --block-range, --backends, --low-load, --high-load,
+ * --check-buffer, --output (per-instance CSV, default topology.csv), and the
+ * fault, fleet, queue budget and --auto-block options of a single simulation
+ * (each instance detects heavy hitters in its own share of the traffic; the
+ * distributor does not generate --attack-share traffic). With --numa=true
+ * instance i is built on and runs pinned to NUMA node i (modulo the node
+ * count). The heap usage of each component, summed over the instances, and
+ * the huge-page counters (see large_alloc.h) are printed at the end.
+ *
+ * @param config Parsed command-line / file options.
+ * @return 0 on success, 1 on invalid options or an unwritable output file.
+ */
+int run_topology(const Config& config);
+
+#endif